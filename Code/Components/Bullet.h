@@ -1,8 +1,16 @@
 // Copyright 2017-2019 Crytek GmbH / Crytek Group. All rights reserved.
 #pragma once
 
+#include "GamePlugin.h"
+#include "Core/Ballistics.h"
+#include "Systems/BulletPool.h"
+#include "Systems/GameProfiler.h"
+#include "Systems/ImpactSystem.h"
+#include "Systems/ResourceHandles.h"
+
 ////////////////////////////////////////////////////////
 // Physicalized bullet shot from weaponry, expires on collision with another object
+// Bullets are owned by Game::CBulletPool, which keeps them hidden and asleep between shots
 ////////////////////////////////////////////////////////
 class CBulletComponent final : public IEntityComponent
 {
@@ -12,58 +20,124 @@ public:
 	// IEntityComponent
 	virtual void Initialize() override
 	{
+		// Model and material are resolved once from the preload manifest, every pooled bullet shares them by handle
+		Game::CResourceHandles& handles = CGamePlugin::GetInstance()->GetResourceHandles();
+		static const Game::TMeshHandle geometryHandle = handles.RegisterMesh("%ENGINE%/EngineAssets/Objects/primitive_sphere.cgf");
+		// This material has the 'mat_projectile' surface type applied, which has no material effects of its own
+		// The impact effects of 'mat_bullet' in Libs/MaterialEffects are played by Game::CImpactSystem instead
+		static const Game::TMaterialHandle materialHandle = handles.RegisterMaterial("Materials/bullet");
+
 		// Set the model
 		const int geometrySlot = 0;
-		m_pEntity->LoadGeometry(geometrySlot, "%ENGINE%/EngineAssets/Objects/primitive_sphere.cgf");
+		m_pEntity->SetStatObj(handles.Get(geometryHandle), geometrySlot, false);
 
-		// Load the custom bullet material.
-		// This material has the 'mat_bullet' surface type applied, which is set up to play sounds on collision with 'mat_default' objects in Libs/MaterialEffects
-		auto *pBulletMaterial = gEnv->p3DEngine->GetMaterialManager()->LoadMaterial("Materials/bullet");
-		m_pEntity->SetMaterial(pBulletMaterial);
+		// Apply the custom bullet material
+		m_pEntity->SetMaterial(handles.Get(materialHandle));
 
 		// Now create the physical representation of the entity
 		SEntityPhysicalizeParams physParams;
 		physParams.type = PE_RIGID;
-		physParams.mass = 20000.f;
+		physParams.mass = Game::kBulletMass;
 		m_pEntity->Physicalize(physParams);
 
 		// Make sure that bullets are always rendered regardless of distance
 		// Ratio is 0 - 255, 255 being 100% visibility
 		GetEntity()->SetViewDistRatio(255);
+	}
+
+	// Reflect type to set a unique identifier for this component
+	static void ReflectType(Schematyc::CTypeDesc<CBulletComponent>& desc)
+	{
+		desc.SetGUID("{B53A9A5F-F27A-42CB-82C7-B1E379C41A2A}"_cry_guid);
+	}
+
+	virtual Cry::Entity::EventFlags GetEventMask() const override { return ENTITY_EVENT_COLLISION; }
+	virtual void ProcessEvent(const SEntityEvent& event) override
+	{
+		// Handle the OnCollision event, in order to have the entity returned to the pool on collision
+		if (event.event == ENTITY_EVENT_COLLISION)
+		{
+			// Queue the impact and the return of this bullet, unless it has already been done
+			if (m_isActive)
+			{
+				GAME_PROFILE_SCOPE("CBulletComponent::OnCollision");
+				GAME_PROFILE_COUNTER("Bullet::Collisions", 1);
+
+				m_isActive = false;
+
+				Game::CImpactSystem& impactSystem = CGamePlugin::GetInstance()->GetImpactSystem();
+
+				// Collision info can be retrieved using the event pointer
+				const EventPhysCollision* pCollision = reinterpret_cast<const EventPhysCollision*>(event.ptr);
+				if (pCollision != nullptr)
+				{
+					// The bullet can be either side of the collision, the normal points from the first to the second
+					const int bulletIndex = pCollision->pEntity[1] == GetEntity()->GetPhysics() ? 1 : 0;
+					const int targetIndex = 1 - bulletIndex;
+					const Vec3 normal = bulletIndex == 0 ? -pCollision->n : pCollision->n;
+
+					IEntity* pTarget = gEnv->pEntitySystem->GetEntityFromPhysics(pCollision->pEntity[targetIndex]);
+					impactSystem.QueueImpact(pCollision->pt, normal, pCollision->idmat[targetIndex], GetEntityId(), pTarget != nullptr ? pTarget->GetId() : INVALID_ENTITYID);
+				}
+
+				impactSystem.QueueRelease(GetEntityId(), m_pOwningPool);
+			}
+		}
+	}
+	// ~IEntityComponent
+
+	void SetOwningPool(Game::CBulletPool* pPool) { m_pOwningPool = pPool; }
+	bool IsActive() const { return m_isActive; }
+
+	// Moves the bullet to the muzzle, makes it visible and propels it forward
+	void Launch(const Vec3& position, const Quat& rotation)
+	{
+		GAME_PROFILE_SCOPE("CBulletComponent::Launch");
+
+		m_pEntity->SetPosRotScale(position, rotation, m_pEntity->GetScale());
+		m_pEntity->Hide(false);
+		m_pEntity->EnablePhysics(true);
 
 		// Apply an impulse so that the bullet flies forward
 		if (auto *pPhysics = GetEntity()->GetPhysics())
 		{
-			pe_action_impulse impulseAction;
+			// Pooled bullets keep whatever velocity they had when they were put to sleep
+			pe_action_set_velocity resetVelocityAction;
+			resetVelocityAction.v = ZERO;
+			resetVelocityAction.w = ZERO;
+			pPhysics->Action(&resetVelocityAction);
 
-			const float initialVelocity = 1000.f;
+			pe_action_impulse impulseAction;
 
 			// Set the actual impulse, in this cause the value of the initial velocity CVar in bullet's forward direction
-			impulseAction.impulse = GetEntity()->GetWorldRotation().GetColumn1() * initialVelocity;
+			impulseAction.impulse = rotation.GetColumn1() * Game::kBulletLaunchImpulse;
 
 			// Send to the physical entity
 			pPhysics->Action(&impulseAction);
 		}
-	}
 
-	// Reflect type to set a unique identifier for this component
-	static void ReflectType(Schematyc::CTypeDesc<CBulletComponent>& desc)
-	{
-		desc.SetGUID("{B53A9A5F-F27A-42CB-82C7-B1E379C41A2A}"_cry_guid);
+		m_isActive = true;
 	}
 
-	virtual Cry::Entity::EventFlags GetEventMask() const override { return ENTITY_EVENT_COLLISION; }
-	virtual void ProcessEvent(const SEntityEvent& event) override
+	// Hides the bullet and takes it out of the physical world until it is launched again
+	void Deactivate()
 	{
-		// Handle the OnCollision event, in order to have the entity removed on collision
-		if (event.event == ENTITY_EVENT_COLLISION)
-		{
-			// Collision info can be retrieved using the event pointer
-			//EventPhysCollision *physCollision = reinterpret_cast<EventPhysCollision *>(event.ptr);
+		GAME_PROFILE_SCOPE("CBulletComponent::Deactivate");
+
+		m_isActive = false;
 
-			// Queue removal of this entity, unless it has already been done
-			gEnv->pEntitySystem->RemoveEntity(GetEntityId());
+		if (auto *pPhysics = GetEntity()->GetPhysics())
+		{
+			pe_action_awake sleepAction;
+			sleepAction.bAwake = 0;
+			pPhysics->Action(&sleepAction);
 		}
+
+		m_pEntity->EnablePhysics(false);
+		m_pEntity->Hide(true);
 	}
-	// ~IEntityComponent
-};
\ No newline at end of file
+
+private:
+	Game::CBulletPool* m_pOwningPool = nullptr;
+	bool m_isActive = false;
+};
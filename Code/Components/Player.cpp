@@ -2,6 +2,16 @@
 #include "StdAfx.h"
 #include "Player.h"
 #include "Weapon.h"
+#include "GamePlugin.h"
+#include "Systems/BotDriver.h"
+#include "Systems/CharacterAnimation.h"
+#include "Systems/GameRecorder.h"
+#include "Systems/GameProfiler.h"
+#include "Systems/LagCompensation.h"
+#include "Systems/NetRelevancy.h"
+#include "Systems/PlayerSystem.h"
+#include "Systems/ResourceHandles.h"
+#include "Systems/SpatialIndex.h"
 
 #include <DefaultComponents/Cameras/CameraComponent.h>
 #include <DefaultComponents/Input/InputComponent.h>
@@ -11,9 +21,32 @@
 #include <CrySchematyc/Env/Elements/EnvComponent.h>
 #include <CryCore/StaticInstanceList.h>
 #include <CrySchematyc/Env/IEnvRegistrar.h>
+#include <CryNetwork/Rmi.h>
+#include <CryGame/IGameFramework.h>
+
+#include <chrono>
 
 namespace Game
 {
+	namespace
+	{
+		float g_predictionErrorThreshold = 0.25f;
+		int g_inputRedundancy = 3;
+		int g_playerInputTickRate = 0;
+
+		// A hitch drops input ticks beyond this instead of sending a burst of commands
+		constexpr uint32 kMaxInputTicksPerFrame = 4;
+
+		// Timestamps of queued input events, in seconds
+		double GetInputTime()
+		{
+			return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+	}
+
+	static_assert(static_cast<uint8>(CPlayerComponent::EInputFlag::Walk) == ePlayerInputFlag_Walk, "Input flags are sent as SPlayerInputCommand::flags");
+	static_assert(static_cast<uint8>(CPlayerComponent::EInputFlag::Jump) == ePlayerInputFlag_Jump, "Input flags are sent as SPlayerInputCommand::flags");
+
 	static void RegisterPlayerComponent(Schematyc::IEnvRegistrar& registrar)
 	{
 		Schematyc::CEnvRegistrationScope scope = registrar.Scope(IEntity::GetEntityScopeGUID());
@@ -31,35 +64,123 @@ namespace Game
 		m_pCharacterControllerComponnet = m_pEntity->GetOrCreateComponent<Cry::DefaultComponents::CCharacterControllerComponent>();
 		m_pAdvancedAnimationComponent = m_pEntity->GetOrCreateComponent<Cry::DefaultComponents::CAdvancedAnimationComponent>();
 		m_pWeaponComponent = m_pEntity->GetOrCreateComponent<CWeaponComponent>();
+
+		// Components are initialized within the spawn, before CBotDriver gets hold of the entity
+		m_isBot = CGamePlugin::GetInstance()->GetBotDriver().IsSpawningBot();
+
+		m_pEntity->GetNetEntity()->BindToNetwork();
+
+		// Input is sent every tick and every packet repeats the previous commands, so there is no point in reliable delivery
+		SRmi<RMI_WRAP(&CPlayerComponent::SvRequestInput)>::Register(this, eRAT_NoAttach, false, eNRT_UnreliableOrdered);
+
+		CGamePlugin::GetInstance()->GetLagCompensation().Register(*m_pEntity, *m_pAdvancedAnimationComponent);
+
+		// Roughly the character controller capsule
+		m_spatialHandle = CGamePlugin::GetInstance()->GetSpatialIndex().Register(GetEntityId(), eSpatialType_Player, m_pEntity->GetWorldPos(), 1.f);
+
+		CGamePlugin::GetInstance()->GetPlayerSystem().Register(*this);
+
+		m_barrelAttachmentHandle = CGamePlugin::GetInstance()->GetResourceHandles().RegisterAttachment("barrel_out");
+
+		// Characters at the same LOD update on different frames
+		const float animationPhase = static_cast<float>((GetEntityId() * 0x9E3779B9u) >> 8) / static_cast<float>(1 << 24);
+		InitializeAnimationLod(m_animationLod, animationPhase, CCharacterAnimation::GetLodParams());
+	}
+
+	void CPlayerComponent::OnShutDown()
+	{
+		CGamePlugin::GetInstance()->GetPlayerSystem().Unregister(*this);
+
+		CGamePlugin::GetInstance()->GetLagCompensation().Unregister(GetEntityId());
+
+		CGamePlugin::GetInstance()->GetSpatialIndex().Unregister(m_spatialHandle);
+		m_spatialHandle = CSpatialIndex::kInvalidHandle;
+	}
+
+	void CPlayerComponent::RegisterCVars()
+	{
+		REGISTER_CVAR2("g_predictionErrorThreshold", &g_predictionErrorThreshold, g_predictionErrorThreshold, VF_NULL, "Distance between the predicted and the server position of the local player above which the client rewinds and replays its input");
+		REGISTER_CVAR2("g_inputRedundancy", &g_inputRedundancy, g_inputRedundancy, VF_NULL, "Number of most recent input commands in every input packet, a packet loss is covered as long as one of the following packets arrives");
+		REGISTER_CVAR2("g_playerInputTickRate", &g_playerInputTickRate, g_playerInputTickRate, VF_NULL, "Rate in Hz at which local players consume input and send input commands, independent of the frame rate\n0 = once per frame");
+	}
+
+	void CPlayerComponent::UnregisterCVars()
+	{
+		if (IConsole* pConsole = gEnv->pConsole)
+		{
+			pConsole->UnregisterVariable("g_predictionErrorThreshold", true);
+			pConsole->UnregisterVariable("g_inputRedundancy", true);
+			pConsole->UnregisterVariable("g_playerInputTickRate", true);
+		}
 	}
 
 	Cry::Entity::EventFlags CPlayerComponent::GetEventMask() const
 	{
+		// Only listens for what can wake it, in place of the update
+		if (m_dormancy.isDormant)
+		{
+			return Cry::Entity::EEvent::GameplayStarted | Cry::Entity::EEvent::Reset | Cry::Entity::EEvent::TransformChanged | Cry::Entity::EEvent::PhysicsCollision;
+		}
+
+		if (CPlayerSystem::IsBatchingEnabled())
+		{
+			return Cry::Entity::EEvent::GameplayStarted | Cry::Entity::EEvent::Reset;
+		}
+
 		return Cry::Entity::EEvent::GameplayStarted | Cry::Entity::EEvent::Update | Cry::Entity::EEvent::Reset;
 	}
 
 	void CPlayerComponent::ProcessEvent(const SEntityEvent& event)
 	{
+		GAME_PROFILE_SCOPE("CPlayerComponent::ProcessEvent");
+
 		switch (event.event)
 		{
 		case Cry::Entity::EEvent::GameplayStarted:
 		{
-			InitializeInput();
+			Wake();
+			if (!m_isBot)
+			{
+				InitializeInput();
+			}
+			InitializeAnimation();
 			break;
 		}
 		case Cry::Entity::EEvent::Update:
 		{
+			// Only received while CPlayerSystem doesn't update players in a batch
+			const float frameTime = event.fParam[0];
+
+			BeginFrameUpdate(frameTime);
 			UpdatePlayerMovement();
 			UpdateCameraRotation();
-
+			EndFrameUpdate();
+			break;
+		}
+		// Only received while dormant: moved by physics, a teleport or a respawn, or hit by something
+		case Cry::Entity::EEvent::TransformChanged:
+		case Cry::Entity::EEvent::PhysicsCollision:
+		{
+			Wake();
 			break;
 		}
 		case Cry::Entity::EEvent::Reset:
 		{
+			Wake();
+
 			m_inputFlags.Clear();
 			m_movementDelta = ZERO;
-			m_mouseDeltaRotation = ZERO;
-			m_lookOrientation = IDENTITY;
+			m_pressedInputFlags.Clear();
+			m_inputQueue.Reset();
+			m_inputTimestep.Reset();
+			m_lookYaw = 0.f;
+			m_lookPitch = 0.f;
+
+			m_predictionHistory.Clear();
+			m_receivedCommands.Clear();
+			m_lastAcknowledgedSequence = m_nextInputSequence - 1;
+			m_hasPendingServerState = false;
+			m_snapshots.Reset();
 
 			Matrix34 cameraDefaultMatrix;
 			cameraDefaultMatrix.SetTranslation(m_cameraDefaultPos);
@@ -72,24 +193,25 @@ namespace Game
 
 	void CPlayerComponent::InitializeInput()
 	{
+		// Input is only queued here and consumed by UpdateInput, every mouse event of a frame counts
 		/* Mouse input*/
-		m_pInputComponent->RegisterAction("player", "yaw", [this](int activationMode, float value) {m_mouseDeltaRotation.y = -value; });
+		m_pInputComponent->RegisterAction("player", "yaw", [this](int activationMode, float value) {PushInputEvent(EInputEventType::LookY, -value); });
 		m_pInputComponent->BindAction("player", "yaw", eAID_KeyboardMouse, eKI_MouseY);
 
-		m_pInputComponent->RegisterAction("player", "pitch", [this](int activationMode, float value) {m_mouseDeltaRotation.x = -value; });
+		m_pInputComponent->RegisterAction("player", "pitch", [this](int activationMode, float value) {PushInputEvent(EInputEventType::LookX, -value); });
 		m_pInputComponent->BindAction("player", "pitch", eAID_KeyboardMouse, eKI_MouseX);
 
 		/* Keyboard input*/
-		m_pInputComponent->RegisterAction("player", "moveforward", [this](int activationMode, float value) {m_movementDelta.y = value; });
+		m_pInputComponent->RegisterAction("player", "moveforward", [this](int activationMode, float value) {PushInputEvent(EInputEventType::MoveForward, value); });
 		m_pInputComponent->BindAction("player", "moveforward", eAID_KeyboardMouse, eKI_W);
 
-		m_pInputComponent->RegisterAction("player", "moveback", [this](int activationMode, float value) {m_movementDelta.y = -value; });
+		m_pInputComponent->RegisterAction("player", "moveback", [this](int activationMode, float value) {PushInputEvent(EInputEventType::MoveBack, value); });
 		m_pInputComponent->BindAction("player", "moveback", eAID_KeyboardMouse, eKI_S);
 
-		m_pInputComponent->RegisterAction("player", "moveright", [this](int activationMode, float value) {m_movementDelta.x = value; });
+		m_pInputComponent->RegisterAction("player", "moveright", [this](int activationMode, float value) {PushInputEvent(EInputEventType::MoveRight, value); });
 		m_pInputComponent->BindAction("player", "moveright", eAID_KeyboardMouse, eKI_D);
 
-		m_pInputComponent->RegisterAction("player", "moveleft", [this](int activationMode, float value) {m_movementDelta.x = -value; });
+		m_pInputComponent->RegisterAction("player", "moveleft", [this](int activationMode, float value) {PushInputEvent(EInputEventType::MoveLeft, value); });
 		m_pInputComponent->BindAction("player", "moveleft", eAID_KeyboardMouse, eKI_A);
 
 		m_pInputComponent->RegisterAction("player", "walk", [this](int activationMode, float value) {HandleInputFlagChange(EInputFlag::Walk, EInputFlagType::Hold, activationMode); });
@@ -100,56 +222,278 @@ namespace Game
 
 		m_pInputComponent->RegisterAction("player", "shoot", [this](int activationMode, float value) 
 			{
-				if (activationMode == eAAM_OnPress)
+				// Shots of a replay come from the recording
+				if (activationMode == eAAM_OnPress && !CGamePlugin::GetInstance()->GetGameRecorder().IsReplaying())
 				{
-					if (auto pCharacter = m_pAdvancedAnimationComponent->GetCharacter())
-					{
-						if (auto pBarrelAttachment = pCharacter->GetIAttachmentManager()->GetInterfaceByName("barrel_out"))
-						{
-							m_pWeaponComponent->Shoot(pBarrelAttachment->GetAttWorldAbsolute());
-						}
-					}
+					Fire();
 				}
 			});
 		m_pInputComponent->BindAction("player", "shoot", eAID_KeyboardMouse, EKeyId::eKI_Mouse1);
 	}
 
-	void CPlayerComponent::UpdatePlayerMovement()
+	bool CPlayerComponent::Fire()
+	{
+		if (auto pCharacter = m_pAdvancedAnimationComponent->GetCharacter())
+		{
+			if (auto pBarrelAttachment = CGamePlugin::GetInstance()->GetResourceHandles().Get(*pCharacter, m_barrelAttachmentHandle, m_barrelAttachment))
+			{
+				m_pWeaponComponent->Shoot(pBarrelAttachment->GetAttWorldAbsolute());
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void CPlayerComponent::ActivateView()
+	{
+		m_pCameraComponent->Activate();
+	}
+
+	void CPlayerComponent::InitializeAnimation()
 	{
-		Vec3 velocity = Vec3(m_movementDelta.x, m_movementDelta.y, 0.0f);
-		velocity.Normalize();
-		velocity *= (IsInputFlagActive(EInputFlag::Walk) ? m_walkSpeed : m_movementSpeed);
+		// The animation database is loaded with the component's properties, the ids are valid from here on
+		m_idleFragmentId = m_pAdvancedAnimationComponent->GetFragmentId("Idle");
+		m_walkFragmentId = m_pAdvancedAnimationComponent->GetFragmentId("Walk");
+		m_rotateTagId = m_pAdvancedAnimationComponent->GetTagId("Rotate");
+		// The default fragment is already playing
+		m_activeFragmentId = m_idleFragmentId;
+		m_locomotion = SLocomotionState();
 
-		if (m_pCharacterControllerComponnet->IsOnGround() && IsInputFlagActive(EInputFlag::Jump))
+		m_isGroundAlignmentConfigured = m_pAdvancedAnimationComponent->IsGroundAlignmentEnabled();
+		m_isGroundAlignmentActive = m_isGroundAlignmentConfigured;
+	}
+
+	void CPlayerComponent::UpdateAnimation(float deltaTime, float frameTime)
+	{
+		ICharacterInstance* pCharacter = m_pAdvancedAnimationComponent->GetCharacter();
+		if (pCharacter == nullptr)
 		{
-			Vec3 jumpVelocity(0, 0, m_JumpHeight);
-			m_pCharacterControllerComponnet->ChangeVelocity(jumpVelocity, Cry::DefaultComponents::CCharacterControllerComponent::EChangeVelocityMode::Add);
+			return;
+		}
+
+		// A skipped frame keeps the pose, the next update catches up by playing faster for one frame
+		if (deltaTime <= 0.f)
+		{
+			pCharacter->SetFlags(pCharacter->GetFlags() & ~CS_FLAG_UPDATE);
+			return;
+		}
+		pCharacter->SetFlags(pCharacter->GetFlags() | CS_FLAG_UPDATE);
+		pCharacter->SetPlaybackScale(frameTime > 0.f ? deltaTime / frameTime : 1.f);
+
+		const bool isGroundAlignmentActive = m_isGroundAlignmentConfigured && m_animationLod.lod == EAnimationLod::Full;
+		if (isGroundAlignmentActive != m_isGroundAlignmentActive)
+		{
+			m_isGroundAlignmentActive = isGroundAlignmentActive;
+			m_pAdvancedAnimationComponent->EnableGroundAlignment(isGroundAlignmentActive);
+		}
+
+		const Vec3 velocity = IsRemote() ? m_playbackVelocity : GetVelocity();
+		UpdateLocomotion(m_locomotion, SVec3f(velocity.x, velocity.y, velocity.z), m_pEntity->GetWorldRotation().GetRotZ(), deltaTime, SLocomotionParams());
+
+		m_pAdvancedAnimationComponent->SetMotionParameter(eMotionParamID_TravelSpeed, m_locomotion.travelSpeed);
+		m_pAdvancedAnimationComponent->SetMotionParameter(eMotionParamID_TravelAngle, m_locomotion.travelAngle);
+		m_pAdvancedAnimationComponent->SetMotionParameter(eMotionParamID_TurnAngle, m_locomotion.turnAngle);
+		if (m_rotateTagId != TAG_ID_INVALID)
+		{
+			m_pAdvancedAnimationComponent->SetTagWithId(m_rotateTagId, m_locomotion.isTurning);
+		}
+
+		const FragmentID fragmentId = m_locomotion.fragment == ELocomotionFragment::Walk ? m_walkFragmentId : m_idleFragmentId;
+		if (fragmentId != m_activeFragmentId && fragmentId != FRAGMENT_ID_INVALID)
+		{
+			m_activeFragmentId = fragmentId;
+			m_pAdvancedAnimationComponent->QueueFragmentWithId(fragmentId);
+		}
+	}
+
+	void CPlayerComponent::PushInputEvent(EInputEventType type, float value)
+	{
+		Wake();
+
+		SInputEvent event;
+		event.time = GetInputTime();
+		event.type = type;
+		event.value = value;
+		m_inputQueue.Push(event);
+	}
+
+	void CPlayerComponent::UpdateInput(float frameTime)
+	{
+		GAME_PROFILE_SCOPE("CPlayerComponent::UpdateInput");
+
+		// Remote players on the server are steered by ApplyInputCommand, bots by CBotDriver
+		if (!IsLocallyControlled() || m_isBot)
+		{
+			return;
+		}
+
+		CGameRecorder& recorder = CGamePlugin::GetInstance()->GetGameRecorder();
+		// A replay steers the player through ApplyExternalInput, live input is dropped so that the queue doesn't overflow
+		if (recorder.IsReplaying())
+		{
+			m_inputQueue.Drain(GetInputTime());
+			return;
+		}
+
+		m_inputTimestep.SetRate(static_cast<float>(max(0, g_playerInputTickRate)));
+		const uint32 tickCount = m_inputTimestep.Advance(frameTime, kMaxInputTicksPerFrame);
+		if (tickCount == 0)
+		{
+			// No tick ended this frame, movement keeps the input of the last tick
+			return;
+		}
+
+		const double frameEndTime = GetInputTime();
+		const SPlayerLookParams lookParams = GetLookParams();
+		uint8 frameFlags = 0;
+
+		for (uint32 tick = 0; tick < tickCount; ++tick)
+		{
+			// Each tick only sees the events that happened before it ended
+			const SAccumulatedInput input = m_inputQueue.Drain(frameEndTime - m_inputTimestep.GetTickEndOffset(tick));
+			GAME_PROFILE_COUNTER("Player::InputEvents", static_cast<int64>(input.eventCount));
+
+			m_movementDelta = Vec2(input.moveX, input.moveY);
+			SetInputFlags(input.flags);
+			ApplyLookInput(m_lookYaw, m_lookPitch, input.lookDeltaX, input.lookDeltaY, lookParams);
+			frameFlags |= input.flags;
+
+			if (IsPredictingMovement())
+			{
+				// Recorded as sent, the command is quantized and takes the next sequence number
+				recorder.RecordInput(GetEntityId(), InputCommandCodec::RoundTripCommand(CreateInputCommand(m_inputTimestep.GetTickLength())));
+				SendInputCommand(m_inputTimestep.GetTickLength());
+			}
+			else
+			{
+				recorder.RecordInput(GetEntityId(), CreateInputCommand(m_inputTimestep.GetTickLength()));
+			}
+		}
+
+		// Physics only steps once per frame, a jump tapped in any of this frame's ticks still counts
+		SetInputFlags(frameFlags);
+
+		const uint32 droppedCount = m_inputQueue.GetDroppedCount();
+		if (droppedCount != m_droppedInputEventCount)
+		{
+			CryLogAlways("[Player] Input queue overflow, %u events dropped", droppedCount - m_droppedInputEventCount);
+			m_droppedInputEventCount = droppedCount;
+		}
+	}
+
+	void CPlayerComponent::BeginFrameUpdate(float frameTime)
+	{
+		m_updateFrameTime = frameTime;
+
+		if (IsPredictingMovement())
+		{
+			ReconcileWithServer();
+		}
+
+		UpdateInput(frameTime);
+	}
+
+	void CPlayerComponent::EndFrameUpdate()
+	{
+		CGamePlugin::GetInstance()->GetSpatialIndex().Move(m_spatialHandle, m_pEntity->GetWorldPos());
+
+		// Otherwise CNetRelevancy decides when the movement is replicated
+		if (gEnv->bServer && !CNetRelevancy::IsEnabled())
+		{
+			NetMarkAspectsDirty(kMovementAspect);
 		}
 
-		m_pCharacterControllerComponnet->SetVelocity(m_pEntity->GetWorldRotation() * velocity);
+		CheckDormancy();
+	}
+
+	void CPlayerComponent::PrepareBatchedUpdate(CPlayerBatch& batch, size_t index, float frameTime)
+	{
+		BeginFrameUpdate(frameTime);
+
+		batch.SetInput(index, m_movementDelta.x, m_movementDelta.y, m_pEntity->GetWorldRotation().GetRotZ(), m_inputFlags.UnderlyingValue(), m_pCharacterControllerComponnet->IsOnGround(), GetMovementParams());
+
+		// The look angles are already integrated per input tick, the batch only builds the rotations
+		batch.SetLookInput(index, m_lookYaw, m_lookPitch, 0.f, 0.f, GetLookParams());
+	}
+
+	void CPlayerComponent::ApplyBatchedUpdate(const CPlayerBatch& batch, size_t index)
+	{
+		ApplyMovement(batch.GetVelocity(index), batch.IsJumping(index));
+		ApplyLookRotation(batch.GetLookRotation(index));
+		EndFrameUpdate();
+	}
+
+	void CPlayerComponent::UpdatePlayerMovement()
+	{
+		GAME_PROFILE_SCOPE("CPlayerComponent::UpdatePlayerMovement");
+
+		// Shared with the replay in ReconcileWithServer, so that both produce the same velocity for the same input
+		const SVec3f velocity = ComputeDesiredVelocity(m_movementDelta.x, m_movementDelta.y, m_pEntity->GetWorldRotation().GetRotZ(), IsInputFlagActive(EInputFlag::Walk), GetMovementParams());
+		ApplyMovement(velocity, ShouldJump(m_pCharacterControllerComponnet->IsOnGround(), m_inputFlags.UnderlyingValue()));
 	}
 
 	void CPlayerComponent::UpdateCameraRotation()
 	{
-		Ang3 rotationAngle = CCamera::CreateAnglesYPR(Matrix33(m_lookOrientation));
-		rotationAngle.x += m_mouseDeltaRotation.x * m_rotationSpeed;
-		rotationAngle.y = CLAMP(rotationAngle.y + m_mouseDeltaRotation.y * m_rotationSpeed, m_rotationLimitsMinPitch, m_rotationLimitsMaxPitch);
-		rotationAngle.z = 0;
+		GAME_PROFILE_SCOPE("CPlayerComponent::UpdateCameraRotation");
+
+		ApplyLookRotation(ComputeLookRotation(m_lookYaw, m_lookPitch));
+	}
+
+	void CPlayerComponent::CheckDormancy()
+	{
+		// Remote players on clients are placed by snapshots and a client's own player reconciles with the server, both keep updating
+		if (!CPlayerSystem::IsDormancyEnabled() || IsRemote() || IsPredictingMovement())
+		{
+			return;
+		}
 
-		m_lookOrientation = Quat(CCamera::CreateOrientationYPR(rotationAngle));
+		const bool hasLookChanged = m_lookYaw != m_dormancyLookYaw || m_lookPitch != m_dormancyLookPitch;
+		m_dormancyLookYaw = m_lookYaw;
+		m_dormancyLookPitch = m_lookPitch;
 
-		Ang3 yawAngle = CCamera::CreateAnglesYPR(Matrix33(m_lookOrientation));
-		yawAngle.y = 0;
-		const Quat finalYaw = Quat(CCamera::CreateOrientationYPR(yawAngle));
-		m_pEntity->SetRotation(finalYaw);
+		const SDormancyParams params = CPlayerSystem::GetDormancyParams();
+		const Vec3 velocity = GetVelocity();
+		const bool isQuiescent = IsPlayerQuiescent(m_movementDelta.x, m_movementDelta.y, m_inputFlags.UnderlyingValue(), hasLookChanged,
+			m_pCharacterControllerComponnet->IsOnGround(), SVec3f(velocity.x, velocity.y, velocity.z), params);
 
-		Ang3 pitchAngle = CCamera::CreateAnglesYPR(Matrix33(m_lookOrientation));
-		pitchAngle.x = 0;
-		Matrix34 finalCamMatrix;
-		finalCamMatrix.SetTranslation(m_pCameraComponent->GetTransformMatrix().GetTranslation());
-		Matrix33 camRotation = CCamera::CreateOrientationYPR(pitchAngle);
-		finalCamMatrix.SetRotation33(camRotation);
-		m_pCameraComponent->SetTransformMatrix(finalCamMatrix);
+		if (UpdateDormancy(m_dormancy, isQuiescent, m_updateFrameTime, params))
+		{
+			// Swaps the update for the events that wake the player, CPlayerSystem drops it from the batch with its next update
+			m_pEntity->UpdateComponentEventMask(this);
+		}
+	}
+
+	void CPlayerComponent::Wake()
+	{
+		if (WakeFromDormancy(m_dormancy))
+		{
+			m_pEntity->UpdateComponentEventMask(this);
+			CGamePlugin::GetInstance()->GetPlayerSystem().OnPlayerWoken(*this);
+		}
+	}
+
+	void CPlayerComponent::ApplyMovement(const SVec3f& velocity, bool isJumping)
+	{
+		// Physics steps once per frame, a second tick of the same frame would add the jump again
+		if (isJumping && m_lastJumpFrameId != gEnv->nMainFrameID)
+		{
+			m_lastJumpFrameId = gEnv->nMainFrameID;
+			Vec3 jumpVelocity(0, 0, m_JumpHeight);
+			m_pCharacterControllerComponnet->ChangeVelocity(jumpVelocity, Cry::DefaultComponents::CCharacterControllerComponent::EChangeVelocityMode::Add);
+		}
+
+		m_pCharacterControllerComponnet->SetVelocity(Vec3(velocity.x, velocity.y, velocity.z));
+	}
+
+	void CPlayerComponent::ApplyLookRotation(const SLookRotation& rotation)
+	{
+		// The entity only yaws and the camera only pitches, both rotations are built directly from their half angles
+		m_pEntity->SetRotation(Quat(rotation.yawW, 0.f, 0.f, rotation.yawZ));
+
+		Matrix34 cameraTransform;
+		cameraTransform.SetRotation33(Matrix33(Quat(rotation.pitchW, rotation.pitchX, 0.f, 0.f)));
+		cameraTransform.SetTranslation(m_pCameraComponent->GetTransformMatrix().GetTranslation());
+		m_pCameraComponent->SetTransformMatrix(cameraTransform);
 	}
 
 	void CPlayerComponent::HandleInputFlagChange(const EInputFlag inputFlags, const EInputFlagType inputType, int activationMode)
@@ -160,11 +504,11 @@ namespace Game
 		{
 			if (activationMode == eAAM_OnRelease)
 			{
-				m_inputFlags.Remove(inputFlags);
+				m_pressedInputFlags.Remove(inputFlags);
 			}
 			else
 			{
-				m_inputFlags.Add(inputFlags);
+				m_pressedInputFlags.Add(inputFlags);
 			}
 			break;
 		}
@@ -172,7 +516,7 @@ namespace Game
 		{
 			if (activationMode == eAAM_OnRelease)
 			{
-				m_inputFlags ^= inputFlags;
+				m_pressedInputFlags ^= inputFlags;
 			}
 			break;
 		}
@@ -180,20 +524,397 @@ namespace Game
 		{
 			if (activationMode == eAAM_OnPress)
 			{
-				m_inputFlags.Add(inputFlags);
+				m_pressedInputFlags.Add(inputFlags);
 			}
 			else
 			{
-				m_inputFlags.Remove(inputFlags);
+				m_pressedInputFlags.Remove(inputFlags);
 			}
 			break;
 		}
 		}
+
+		Wake();
+
+		SInputEvent event;
+		event.time = GetInputTime();
+		event.type = EInputEventType::Flags;
+		event.flags = m_pressedInputFlags.UnderlyingValue();
+		m_inputQueue.Push(event);
 	}
+
 	bool CPlayerComponent::IsInputFlagActive(const EInputFlag inputFlag) const
 	{
 		return m_inputFlags.Check(inputFlag);
 	}
+
+	void CPlayerComponent::SetInputFlags(uint8 flags)
+	{
+		m_inputFlags.Clear();
+		if (flags & ePlayerInputFlag_Walk)
+		{
+			m_inputFlags.Add(EInputFlag::Walk);
+		}
+		if (flags & ePlayerInputFlag_Jump)
+		{
+			m_inputFlags.Add(EInputFlag::Jump);
+		}
+	}
+
+	bool CPlayerComponent::IsLocallyControlled() const
+	{
+		if (m_pEntity->GetFlags() & ENTITY_FLAG_LOCAL_PLAYER)
+		{
+			return true;
+		}
+
+		// Players placed in the level are not owned by any client and are controlled by the server
+		return gEnv->bServer && m_pEntity->GetNetEntity()->GetChannelId() == 0;
+	}
+
+	bool CPlayerComponent::IsPredictingMovement() const
+	{
+		return !gEnv->bServer && IsLocallyControlled();
+	}
+
+	bool CPlayerComponent::IsRemote() const
+	{
+		return !gEnv->bServer && !IsLocallyControlled();
+	}
+
+	void CPlayerComponent::Teleport(const Matrix34& transform)
+	{
+		m_pEntity->SetWorldTM(transform);
+
+		// Remote clients jump to the new position instead of playing the way there back
+		++m_teleportCount;
+		NetMarkAspectsDirty(kMovementAspect);
+	}
+
+	void CPlayerComponent::ApplySnapshotSample(const SSnapshotSample& sample)
+	{
+		if (sample.result != ESnapshotSampleResult::Empty)
+		{
+			m_pEntity->SetPos(Vec3(sample.position.x, sample.position.y, sample.position.z));
+			m_playbackVelocity = Vec3(sample.velocity.x, sample.velocity.y, sample.velocity.z);
+		}
+	}
+
+	Vec3 CPlayerComponent::GetViewDirection() const
+	{
+		const SVec3f direction = GetLookDirection(m_lookYaw, m_lookPitch);
+		return Vec3(direction.x, direction.y, direction.z);
+	}
+
+	Vec3 CPlayerComponent::GetVelocity() const
+	{
+		return m_pCharacterControllerComponnet->GetVelocity();
+	}
+
+	SPlayerMovementParams CPlayerComponent::GetMovementParams() const
+	{
+		SPlayerMovementParams params;
+		params.movementSpeed = m_movementSpeed;
+		params.walkSpeed = m_walkSpeed;
+		params.jumpVelocity = m_JumpHeight;
+		params.gravity = gEnv->pPhysicalWorld->GetPhysVars()->gravity.z;
+		return params;
+	}
+
+	SPlayerLookParams CPlayerComponent::GetLookParams() const
+	{
+		SPlayerLookParams params;
+		params.rotationSpeed = m_rotationSpeed;
+		params.minPitch = m_rotationLimitsMinPitch;
+		params.maxPitch = m_rotationLimitsMaxPitch;
+		return params;
+	}
+
+	SPlayerInputCommand CPlayerComponent::CreateInputCommand(float frameTime) const
+	{
+		SPlayerInputCommand command;
+		command.sequence = m_nextInputSequence;
+		command.frameTime = frameTime;
+		command.moveX = m_movementDelta.x;
+		command.moveY = m_movementDelta.y;
+		command.yaw = m_lookYaw;
+		command.pitch = m_lookPitch;
+		command.flags = m_inputFlags.UnderlyingValue();
+		return command;
+	}
+
+	void CPlayerComponent::SendInputCommand(float frameTime)
+	{
+		// Predict with the quantized command, the server applies exactly the same input
+		SPredictedMove move;
+		move.command = InputCommandCodec::RoundTripCommand(CreateInputCommand(frameTime));
+		m_predictionHistory.Insert(move.command.sequence, move);
+		++m_nextInputSequence;
+
+		// Repeat the newest commands the server has not acknowledged yet, oldest first
+		const uint32 maxCount = static_cast<uint32>(clamp_tpl(g_inputRedundancy, 1, static_cast<int>(InputCommandCodec::kMaxCommandsPerPacket)));
+		const uint32 unacknowledgedCount = move.command.sequence - m_lastAcknowledgedSequence;
+
+		SPlayerInputCommand commands[InputCommandCodec::kMaxCommandsPerPacket];
+		uint32 count = 0;
+
+		for (uint32 sequence = move.command.sequence + 1 - min(maxCount, unacknowledgedCount); sequence <= move.command.sequence; ++sequence)
+		{
+			// Commands have to be consecutive, history lost to a reset starts the packet over
+			if (const SPredictedMove* pMove = m_predictionHistory.Find(sequence))
+			{
+				commands[count++] = pMove->command;
+			}
+			else
+			{
+				count = 0;
+			}
+		}
+
+		const SPredictedMove* pBaselineMove = m_predictionHistory.Find(m_lastAcknowledgedSequence);
+
+		SInputPacketParams params;
+		const size_t size = InputCommandCodec::EncodePacket(commands, count, pBaselineMove != nullptr ? &pBaselineMove->command : nullptr, params.data, sizeof(params.data));
+		if (size == 0)
+		{
+			CryLogAlways("[Player] Input packet for command %u does not fit into %u bytes", move.command.sequence, static_cast<uint32>(sizeof(params.data)));
+			return;
+		}
+
+		params.size = static_cast<uint8>(size);
+		params.viewTime = CGamePlugin::GetInstance()->GetPlayerSystem().GetRemoteViewTime();
+		SRmi<RMI_WRAP(&CPlayerComponent::SvRequestInput)>::InvokeOnServer(this, std::move(params));
+	}
+
+	bool CPlayerComponent::SvRequestInput(SInputPacketParams&& params, INetChannel* pNetChannel)
+	{
+		// Only the client owning this player may steer it
+		if (gEnv->pGameFramework->GetGameChannelId(pNetChannel) != m_pEntity->GetNetEntity()->GetChannelId())
+		{
+			return false;
+		}
+
+		const auto lookupBaseline = [this](uint32 sequence) -> const SPlayerInputCommand*
+		{
+			return m_receivedCommands.Find(sequence);
+		};
+
+		SPlayerInputCommand commands[InputCommandCodec::kMaxCommandsPerPacket];
+		const size_t count = InputCommandCodec::DecodePacket(params.data, params.size, m_lastProcessedSequence, lookupBaseline, commands, CRY_ARRAY_COUNT(commands));
+
+		// Corrupt, or delta encoded against a command that never arrived, the next packets carry the same input
+		if (count == 0)
+		{
+			return true;
+		}
+
+		// Delivery is unreliable, commands that were already applied or that arrive after a newer one are outdated
+		const SPlayerInputCommand& newestCommand = commands[count - 1];
+		if (newestCommand.sequence <= m_lastProcessedSequence)
+		{
+			return true;
+		}
+
+		// Only the newest command is applied, but a jump tapped during a command that was never received still counts
+		uint8 skippedFlags = 0;
+		for (size_t i = 0; i < count; ++i)
+		{
+			m_receivedCommands.Insert(commands[i].sequence, commands[i]);
+
+			if (commands[i].sequence > m_lastProcessedSequence)
+			{
+				skippedFlags |= commands[i].flags & ePlayerInputFlag_Jump;
+			}
+		}
+
+		SPlayerInputCommand command = newestCommand;
+		command.flags |= skippedFlags;
+
+		m_lastProcessedSequence = command.sequence;
+		m_viewTime = params.viewTime;
+		ApplyInputCommand(command);
+		CGamePlugin::GetInstance()->GetGameRecorder().RecordInput(GetEntityId(), command);
+
+		if (!CNetRelevancy::IsEnabled())
+		{
+			NetMarkAspectsDirty(kMovementAspect);
+		}
+		return true;
+	}
+
+	void CPlayerComponent::ApplyInputCommand(const SPlayerInputCommand& command)
+	{
+		const float previousYaw = m_lookYaw;
+		const float previousPitch = m_lookPitch;
+
+		m_movementDelta = Vec2(clamp_tpl(command.moveX, -1.f, 1.f), clamp_tpl(command.moveY, -1.f, 1.f));
+
+		m_lookYaw = WrapAngle(command.yaw);
+		m_lookPitch = clamp_tpl(command.pitch, m_rotationLimitsMinPitch, m_rotationLimitsMaxPitch);
+
+		SetInputFlags(command.flags);
+
+		// Idle clients keep sending the same command every tick, only a change wakes the player
+		if (m_movementDelta.x != 0.f || m_movementDelta.y != 0.f || (command.flags & ePlayerInputFlag_Jump) != 0 || m_lookYaw != previousYaw || m_lookPitch != previousPitch)
+		{
+			Wake();
+		}
+	}
+
+	bool CPlayerComponent::NetSerialize(TSerialize ser, EEntityAspects aspect, uint8 profile, int flags)
+	{
+		if (aspect == kMovementAspect)
+		{
+			uint32 sequence = m_lastProcessedSequence;
+			// Sender clock of the snapshot, remote players are played back against it
+			float serverTime = gEnv->pTimer->GetCurrTime();
+			Vec3 position = m_pEntity->GetWorldPos();
+			Vec3 velocity = m_pCharacterControllerComponnet->GetVelocity();
+			bool isOnGround = m_pCharacterControllerComponnet->IsOnGround();
+			// A count rather than a flag, so that a teleport isn't lost when the snapshot that carried it is
+			uint8 teleportCount = m_teleportCount;
+
+			ser.Value("seq", sequence, 'ui32');
+			ser.Value("time", serverTime);
+			ser.Value("pos", position, 'wrld');
+			ser.Value("vel", velocity, 'vel0');
+			ser.Value("ground", isOnGround, 'bool');
+			ser.Value("teleport", teleportCount, 'ui8');
+
+			if (ser.IsReading())
+			{
+				const bool isTeleport = teleportCount != m_teleportCount;
+				m_teleportCount = teleportCount;
+				OnServerMovementState(sequence, serverTime, position, velocity, isOnGround, isTeleport);
+			}
+		}
+
+		return true;
+	}
+
+	void CPlayerComponent::OnServerMovementState(uint32 sequence, float serverTime, const Vec3& position, const Vec3& velocity, bool isOnGround, bool isTeleport)
+	{
+		if (IsPredictingMovement())
+		{
+			// Applied at the start of the next update, so that the replay runs in a well defined place of the frame
+			m_serverMovementSequence = sequence;
+			m_serverMovementState.position = SVec3f(position.x, position.y, position.z);
+			m_serverMovementState.velocity = SVec3f(velocity.x, velocity.y, velocity.z);
+			m_serverMovementState.isOnGround = isOnGround;
+			m_hasPendingServerState = true;
+		}
+		else if (!gEnv->bServer && CPlayerSystem::IsInterpolationEnabled())
+		{
+			SSnapshot snapshot;
+			snapshot.time = serverTime;
+			snapshot.position = SVec3f(position.x, position.y, position.z);
+			snapshot.velocity = SVec3f(velocity.x, velocity.y, velocity.z);
+			snapshot.isTeleport = isTeleport;
+			m_snapshots.Push(snapshot, gEnv->pTimer->GetCurrTime());
+		}
+		else if (!gEnv->bServer)
+		{
+			m_pEntity->SetPos(position);
+			m_playbackVelocity = velocity;
+		}
+	}
+
+	void CPlayerComponent::ReconcileWithServer()
+	{
+		const Vec3 currentPosition = m_pEntity->GetWorldPos();
+
+		if (m_pCharacterControllerComponnet->IsOnGround())
+		{
+			m_lastGroundHeight = currentPosition.z;
+		}
+
+		// The physics step of the previous frame has consumed every command sent since the last result, several of
+		// them when the input tick rate is above the frame rate. The step is spread over them by their tick lengths,
+		// so that an acknowledgement of any of them can be checked against its own position.
+		const uint32 lastSequence = m_nextInputSequence - 1;
+		uint32 firstSequence = lastSequence + 1;
+		float unresolvedTime = 0.f;
+		for (uint32 sequence = lastSequence; sequence > 0; --sequence)
+		{
+			const SPredictedMove* pMove = m_predictionHistory.Find(sequence);
+			if (pMove == nullptr || pMove->hasResult)
+			{
+				break;
+			}
+			firstSequence = sequence;
+			unresolvedTime += pMove->command.frameTime;
+		}
+
+		if (firstSequence <= lastSequence)
+		{
+			const SPredictedMove* pPreviousMove = m_predictionHistory.Find(firstSequence - 1);
+			const Vec3 startPosition = pPreviousMove != nullptr && pPreviousMove->hasResult ? pPreviousMove->position : currentPosition;
+
+			float elapsedTime = 0.f;
+			for (uint32 sequence = firstSequence; sequence <= lastSequence; ++sequence)
+			{
+				SPredictedMove* pMove = m_predictionHistory.Find(sequence);
+				elapsedTime += pMove->command.frameTime;
+				pMove->position = sequence == lastSequence || unresolvedTime <= 0.f ? currentPosition : Vec3::CreateLerp(startPosition, currentPosition, elapsedTime / unresolvedTime);
+				pMove->hasResult = true;
+			}
+		}
+		else if (SPredictedMove* pLastMove = m_predictionHistory.Find(lastSequence))
+		{
+			// No tick ended last frame, the last command kept moving the player
+			pLastMove->position = currentPosition;
+		}
+
+		if (!m_hasPendingServerState)
+		{
+			return;
+		}
+
+		m_hasPendingServerState = false;
+
+		if (m_serverMovementSequence <= m_lastAcknowledgedSequence)
+		{
+			return;
+		}
+
+		m_lastAcknowledgedSequence = m_serverMovementSequence;
+
+		const Vec3 serverPosition(m_serverMovementState.position.x, m_serverMovementState.position.y, m_serverMovementState.position.z);
+		const SPredictedMove* pAcknowledgedMove = m_predictionHistory.Find(m_serverMovementSequence);
+		if (pAcknowledgedMove != nullptr && pAcknowledgedMove->hasResult && pAcknowledgedMove->position.GetDistance(serverPosition) <= g_predictionErrorThreshold)
+		{
+			return;
+		}
+
+		// Mispredicted: rewind to the server state and replay all commands the server has not applied yet
+		SPlayerMovementState state = m_serverMovementState;
+		state.groundHeight = state.isOnGround ? state.position.z : m_lastGroundHeight;
+
+		const SPlayerMovementParams params = GetMovementParams();
+		for (uint32 sequence = m_serverMovementSequence + 1; sequence < m_nextInputSequence; ++sequence)
+		{
+			if (SPredictedMove* pMove = m_predictionHistory.Find(sequence))
+			{
+				StepPlayerMovement(state, pMove->command, params);
+				pMove->position = Vec3(state.position.x, state.position.y, state.position.z);
+			}
+		}
+
+		m_pEntity->SetPos(Vec3(state.position.x, state.position.y, state.position.z));
+
+		// The controller would otherwise keep the mispredicted velocity and carry the player off the corrected position
+		// again. In the air it takes the replayed velocity as is, on the ground it only steers towards it.
+		const Vec3 velocity(state.velocity.x, state.velocity.y, state.velocity.z);
+		if (state.isOnGround)
+		{
+			m_pCharacterControllerComponnet->SetVelocity(Vec3(velocity.x, velocity.y, 0.f));
+		}
+		else
+		{
+			m_pCharacterControllerComponnet->ChangeVelocity(velocity, Cry::DefaultComponents::CCharacterControllerComponent::EChangeVelocityMode::Jump);
+		}
+		m_lastGroundHeight = state.groundHeight;
+	}
 }
 
 
@@ -1,6 +1,22 @@
 // Copyright 2017-2019 Crytek GmbH / Crytek Group. All rights reserved.
 #pragma once
 
+#include "Core/AnimationLod.h"
+#include "Core/Dormancy.h"
+#include "Core/FixedTimestep.h"
+#include "Core/InputCommandCodec.h"
+#include "Core/InputEventQueue.h"
+#include "Core/Locomotion.h"
+#include "Core/PlayerBatch.h"
+#include "Core/PlayerLook.h"
+#include "Core/PlayerMovement.h"
+#include "Core/SequenceBuffer.h"
+#include "Core/SnapshotInterpolation.h"
+#include "Core/SpatialGrid.h"
+#include "Systems/ResourceHandles.h"
+
+#include <ICryMannequin.h>
+
 ////////////////////////////////////////////////////////
 // Represents a player participating in gameplay
 ////////////////////////////////////////////////////////
@@ -31,15 +47,46 @@ namespace Game
 			Jump = 1 << 1
 		};
 
+		// Server to client: authoritative position and the last input command the server applied
+		static constexpr EEntityAspects kMovementAspect = eEA_GameServerA;
+
+		// Movement snapshots a remote player keeps for interpolation, a second at 30 Hz
+		using TSnapshotInterpolator = CSnapshotInterpolator<32>;
+
+		// Client to server: the newest input commands packed by InputCommandCodec, see SvRequestInput
+		struct SInputPacketParams
+		{
+			uint8 size = 0;
+			uint8 data[InputCommandCodec::kMaxPacketBytes];
+			// Server time of the remote players as the client showed them, 0 if it doesn't interpolate them
+			float viewTime = 0.f;
+
+			void SerializeWith(TSerialize ser)
+			{
+				ser.Value("viewTime", viewTime);
+				ser.Value("size", size, 'ui8');
+				size = min(size, static_cast<uint8>(InputCommandCodec::kMaxPacketBytes));
+
+				for (uint8 i = 0; i < size; ++i)
+				{
+					ser.Value("data", data[i], 'ui8');
+				}
+			}
+		};
+
 
 		CPlayerComponent() = default;
 		virtual ~CPlayerComponent() = default;
 
 		virtual void Initialize() override;
+		virtual void OnShutDown() override;
 
 		virtual Cry::Entity::EventFlags GetEventMask() const override;
 		virtual void ProcessEvent(const SEntityEvent& event) override;
 
+		virtual bool NetSerialize(TSerialize ser, EEntityAspects aspect, uint8 profile, int flags) override;
+		virtual NetworkAspectType GetNetSerializeAspectMask() const override { return kMovementAspect; }
+
 		// Reflect type to set a unique identifier for this component
 		static void ReflectType(Schematyc::CTypeDesc<CPlayerComponent>& desc)
 		{
@@ -53,14 +100,97 @@ namespace Game
 			desc.AddMember(&CPlayerComponent::m_JumpHeight, 'pjm', "playerjumpheight", "Player Jump Height", "Sets the Player jump height", 5.0f);
 		}
 
+		static void RegisterCVars();
+		static void UnregisterCVars();
+
+		// Applies a remote client's input on the server
+		bool SvRequestInput(SInputPacketParams&& params, INetChannel* pNetChannel);
+
+		// Frame update driven by CPlayerSystem, replaces the entity update event while batching is enabled
+		// Prepare runs before the batch is computed and Apply after it, both on the main thread.
+		void PrepareBatchedUpdate(CPlayerBatch& batch, size_t index, float frameTime);
+		void ApplyBatchedUpdate(const CPlayerBatch& batch, size_t index);
+
+		// World space camera position and view direction
+		Vec3 GetEyePosition() const { return m_pEntity->GetWorldTM().TransformPoint(m_cameraDefaultPos); }
+		Vec3 GetViewDirection() const;
+		Vec3 GetVelocity() const;
+
+		// Server time at which the owning client last showed the other players, 0 if it didn't report one
+		float GetViewTime() const { return m_viewTime; }
+
+		// Whether this is another client's player on a client, i.e. movement is played back from server snapshots
+		bool IsRemote() const;
+		// Snapshots of a remote player, sampled by CPlayerSystem in one pass over all remote players
+		TSnapshotInterpolator& GetSnapshots() { return m_snapshots; }
+		const TSnapshotInterpolator& GetSnapshots() const { return m_snapshots; }
+		void ApplySnapshotSample(const SSnapshotSample& sample);
+		// Moves the player without passing the way in between, e.g. to a spawn point
+		void Teleport(const Matrix34& transform);
+
+		// Driven by CGameRecorder while it replays a recording and by CBotDriver for bots
+		void ApplyExternalInput(const SPlayerInputCommand& command) { ApplyInputCommand(command); }
+		void ReplayShot(const QuatTS& muzzle) { m_pWeaponComponent->Shoot(muzzle); }
+		// Shoots from the muzzle of the weapon, fails while the character isn't loaded
+		bool Fire();
+
+		// Bots are spawned by CBotDriver, they never read input and are steered through ApplyExternalInput
+		bool IsBot() const { return m_isBot; }
+		// Makes this player's camera the view again, e.g. after bots were spawned with their own cameras
+		void ActivateView();
+
+		// A dormant player stands still without input and receives no updates, see CPlayerSystem
+		// Input, a transform change, a collision or Wake bring it back into the update.
+		bool IsDormant() const { return m_dormancy.isDormant; }
+		void Wake();
+
+		// Scheduled by CCharacterAnimation
+		SAnimationLodState& GetAnimationLod() { return m_animationLod; }
+		// Advances the character's animation by deltaTime and drives its locomotion, 0 keeps the pose for this frame
+		void UpdateAnimation(float deltaTime, float frameTime);
+
 	protected:
 
 	private:
+		// Input command that was applied locally and sent to the server, but not yet acknowledged
+		struct SPredictedMove
+		{
+			SPlayerInputCommand command;
+			// Position after the physics step that consumed the command
+			Vec3 position = ZERO;
+			bool hasResult = false;
+		};
+
 		void InitializeInput();
+		void InitializeAnimation();
+		void PushInputEvent(EInputEventType type, float value);
+		// Drains the input queue once per input tick, integrates the look angles and sends a command per tick
+		void UpdateInput(float frameTime);
+		// Parts of the frame update before and after movement and look
+		void BeginFrameUpdate(float frameTime);
+		void EndFrameUpdate();
 		void UpdatePlayerMovement();
 		void UpdateCameraRotation();
+		// Puts the player to sleep once it has been quiescent for long enough, at the end of its update
+		void CheckDormancy();
+		void ApplyMovement(const SVec3f& velocity, bool isJumping);
+		void ApplyLookRotation(const SLookRotation& rotation);
 		void HandleInputFlagChange(const EInputFlag inputFlags, const EInputFlagType inputType, int activationMode);
 		bool IsInputFlagActive(const EInputFlag inputFlag) const;
+		void SetInputFlags(uint8 flags);
+
+		// Whether input for this player is read on this machine
+		bool IsLocallyControlled() const;
+		// Whether this is the local player on a client that is not the server, i.e. movement has to be predicted
+		bool IsPredictingMovement() const;
+
+		SPlayerMovementParams GetMovementParams() const;
+		SPlayerLookParams GetLookParams() const;
+		SPlayerInputCommand CreateInputCommand(float frameTime) const;
+		void SendInputCommand(float frameTime);
+		void ApplyInputCommand(const SPlayerInputCommand& command);
+		void OnServerMovementState(uint32 sequence, float serverTime, const Vec3& position, const Vec3& velocity, bool isOnGround, bool isTeleport);
+		void ReconcileWithServer();
 
 	private:
 		Cry::DefaultComponents::CCameraComponent* m_pCameraComponent = nullptr;
@@ -69,12 +199,22 @@ namespace Game
 		Cry::DefaultComponents::CAdvancedAnimationComponent* m_pAdvancedAnimationComponent = nullptr;
 		CWeaponComponent* m_pWeaponComponent = nullptr;
 
-		Quat m_lookOrientation;
+		// Look direction, yaw in [-pi, pi) and pitch within the rotation limits
+		float m_lookYaw = 0.f;
+		float m_lookPitch = 0.f;
 
 		Vec3 m_cameraDefaultPos;
 
+		// Input of the current tick
 		Vec2 m_movementDelta;
-		Vec2 m_mouseDeltaRotation;
+		CEnumFlags<EInputFlag> m_inputFlags;
+
+		// Raw input, filled by the input callbacks and drained by UpdateInput
+		CInputEventQueue<256> m_inputQueue;
+		CFixedTimestep m_inputTimestep;
+		// Flags as the keys are currently held, sent with every change
+		CEnumFlags<EInputFlag> m_pressedInputFlags;
+		uint32 m_droppedInputEventCount = 0;
 
 		float m_walkSpeed = 0.0f;
 		float m_movementSpeed = 0.0f;
@@ -84,7 +224,54 @@ namespace Game
 		float m_rotationLimitsMinPitch = 0.0f;
 		float m_rotationLimitsMaxPitch = 0.0f;
 
-		CEnumFlags<EInputFlag> m_inputFlags;
+		// Client prediction
+		CSequenceBuffer<SPredictedMove, 128> m_predictionHistory;
+		uint32 m_nextInputSequence = 1;
+		uint32 m_lastAcknowledgedSequence = 0;
+		float m_lastGroundHeight = 0.f;
+		SPlayerMovementState m_serverMovementState;
+		uint32 m_serverMovementSequence = 0;
+		bool m_hasPendingServerState = false;
+
+		// Remote players on clients
+		TSnapshotInterpolator m_snapshots;
+		// Remote players are moved by position, locomotion uses the velocity of the last applied snapshot
+		Vec3 m_playbackVelocity = ZERO;
+		// Teleports so far, counted on the server and compared against the received count on clients
+		uint8 m_teleportCount = 0;
+
+		// Locomotion fragments and parameters, see Animations/Mannequin/ADB/FirstPerson.adb
+		SLocomotionState m_locomotion;
+		SAnimationLodState m_animationLod;
+		FragmentID m_idleFragmentId = FRAGMENT_ID_INVALID;
+		FragmentID m_walkFragmentId = FRAGMENT_ID_INVALID;
+		FragmentID m_activeFragmentId = FRAGMENT_ID_INVALID;
+		TagID m_rotateTagId = TAG_ID_INVALID;
+		// Ground alignment as set up on the animation component, it only runs at the full animation LOD
+		bool m_isGroundAlignmentConfigured = false;
+		bool m_isGroundAlignmentActive = false;
+
+		CSpatialGrid::THandle m_spatialHandle = CSpatialGrid::kInvalidHandle;
+
+		// Muzzle of the weapon, looked up again only when the character instance changes
+		TAttachmentHandle m_barrelAttachmentHandle;
+		SCachedAttachment m_barrelAttachment;
+
+		// Server: commands received from a remote client, baselines for the delta encoding of the following packets
+		CSequenceBuffer<SPlayerInputCommand, 128> m_receivedCommands;
+		// Server: last input command applied for a remote client
+		uint32 m_lastProcessedSequence = 0;
+		// Server: view time sent with the newest input packet
+		float m_viewTime = 0.f;
+
+		bool m_isBot = false;
+		int m_lastJumpFrameId = -1;
+
+		SDormancyState m_dormancy;
+		float m_updateFrameTime = 0.f;
+		// Look angles at the last dormancy check, turning keeps the player awake
+		float m_dormancyLookYaw = 0.f;
+		float m_dormancyLookPitch = 0.f;
 	};
 }
 
@@ -1,6 +1,9 @@
 // Copyright 2017-2019 Crytek GmbH / Crytek Group. All rights reserved.
 #include "StdAfx.h"
 #include "SpawnPoint.h"
+#include "GamePlugin.h"
+#include "Systems/SpatialIndex.h"
+#include "Systems/SpawnPointRegistry.h"
 
 #include <CrySchematyc/Reflection/TypeDesc.h>
 #include <CrySchematyc/Utils/EnumFlags.h>
@@ -25,4 +28,38 @@ static void RegisterSpawnPointComponent(Schematyc::IEnvRegistrar& registrar)
 	}
 }
 
-CRY_STATIC_AUTO_REGISTER_FUNCTION(&RegisterSpawnPointComponent)
\ No newline at end of file
+CRY_STATIC_AUTO_REGISTER_FUNCTION(&RegisterSpawnPointComponent)
+
+void CSpawnPointComponent::Initialize()
+{
+	CGamePlugin::GetInstance()->GetSpawnPointRegistry().Register(*this);
+
+	m_spatialHandle = CGamePlugin::GetInstance()->GetSpatialIndex().Register(GetEntityId(), Game::eSpatialType_SpawnPoint, GetWorldTransformMatrix().GetTranslation(), 0.f);
+}
+
+void CSpawnPointComponent::OnShutDown()
+{
+	CGamePlugin::GetInstance()->GetSpawnPointRegistry().Unregister(*this);
+
+	CGamePlugin::GetInstance()->GetSpatialIndex().Unregister(m_spatialHandle);
+	m_spatialHandle = Game::CSpatialIndex::kInvalidHandle;
+}
+
+void CSpawnPointComponent::ProcessEvent(const SEntityEvent& event)
+{
+	// Spawn points only move while they are edited
+	if (event.event == Cry::Entity::EEvent::TransformChanged)
+	{
+		CGamePlugin::GetInstance()->GetSpatialIndex().Move(m_spatialHandle, GetWorldTransformMatrix().GetTranslation());
+	}
+}
+
+Matrix34 CSpawnPointComponent::GetFirstSpawnPointTransform()
+{
+	if (CSpawnPointComponent* pSpawner = CGamePlugin::GetInstance()->GetSpawnPointRegistry().Select(Game::ESpawnSelectionPolicy::First))
+	{
+		return pSpawner->GetWorldTransformMatrix();
+	}
+
+	return IDENTITY;
+}
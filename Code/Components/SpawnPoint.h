@@ -4,6 +4,8 @@
 
 #include <CryEntitySystem/IEntitySystem.h>
 
+#include "Core/SpatialGrid.h"
+
 ////////////////////////////////////////////////////////
 // Spawn point
 ////////////////////////////////////////////////////////
@@ -24,22 +26,18 @@ public:
 		desc.SetComponentFlags({ IEntityComponent::EFlags::Transform, IEntityComponent::EFlags::Socket, IEntityComponent::EFlags::Attach });
 	}
 	
-	static Matrix34 GetFirstSpawnPointTransform()
-	{
-		// Spawn at first default spawner
-		IEntityItPtr pEntityIterator = gEnv->pEntitySystem->GetEntityIterator();
-		pEntityIterator->MoveFirst();
-
-		while (!pEntityIterator->IsEnd())
-		{
-			IEntity *pEntity = pEntityIterator->Next();
-
-			if (CSpawnPointComponent* pSpawner = pEntity->GetComponent<CSpawnPointComponent>())
-			{
-				return pSpawner->GetWorldTransformMatrix();
-			}
-		}
-		
-		return IDENTITY;
-	}
+	// IEntityComponent
+	virtual void Initialize() override;
+	virtual void OnShutDown() override;
+
+	virtual Cry::Entity::EventFlags GetEventMask() const override { return Cry::Entity::EEvent::TransformChanged; }
+	virtual void ProcessEvent(const SEntityEvent& event) override;
+	// ~IEntityComponent
+
+	// Spawn at first default spawner
+	// Spawn points are looked up in Game::CSpawnPointRegistry, use it directly for other selection policies
+	static Matrix34 GetFirstSpawnPointTransform();
+
+private:
+	Game::CSpatialGrid::THandle m_spatialHandle = Game::CSpatialGrid::kInvalidHandle;
 };
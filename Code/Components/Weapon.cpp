@@ -2,6 +2,12 @@
 #include "StdAfx.h"
 #include "Weapon.h"
 #include "Bullet.h"
+#include "GamePlugin.h"
+#include "Systems/GameProfiler.h"
+#include "Systems/GameRecorder.h"
+#include "Systems/ProjectileSystem.h"
+
+#include "Core/Ballistics.h"
 
 #include <CrySchematyc/Env/IEnvRegistrar.h>
 
@@ -22,20 +28,34 @@ namespace Game
 
 	void CWeaponComponent::Shoot(QuatTS initialPosition)
 	{
-		SEntitySpawnParams spawnParams;
-		spawnParams.pClass = gEnv->pEntitySystem->GetClassRegistry()->GetDefaultClass();
+		GAME_PROFILE_SCOPE("CWeaponComponent::Shoot");
+		GAME_PROFILE_COUNTER("Weapon::ShotsFired", 1);
 
-		spawnParams.vPosition = initialPosition.t;
-		spawnParams.qRotation = initialPosition.q;
+		CGamePlugin::GetInstance()->GetGameRecorder().RecordShot(GetEntityId(), initialPosition);
 
-		const float bulletScale = 0.05f;
-		spawnParams.vScale = Vec3(bulletScale);
+		// Rounds travel along the forward axis of the barrel, the same way bullets are propelled in Bullet.h
+		const SVec3f forward = GetForwardFromRotation(initialPosition.q.v.x, initialPosition.q.v.y, initialPosition.q.v.z, initialPosition.q.w);
+		const Vec3 direction(forward.x, forward.y, forward.z);
 
-		// Spawn the entity
-		if (IEntity* pEntity = gEnv->pEntitySystem->SpawnEntity(spawnParams))
+		switch (m_projectileMode)
+		{
+		case EProjectileMode::Physical:
+		{
+			// Bullet entities are recycled by the level's pool instead of being spawned per shot
+			CGamePlugin::GetInstance()->GetBulletPool().Fire(initialPosition);
+			break;
+		}
+		case EProjectileMode::Simulated:
 		{
-			// See Bullet.cpp, bullet is propelled in  the rotation and position the entity was spawned with
-			pEntity->CreateComponentClass<CBulletComponent>();
+			const SProjectileLaunch launch = ComputeProjectileLaunch(SVec3f(initialPosition.t.x, initialPosition.t.y, initialPosition.t.z), forward, m_muzzleVelocity);
+			CGamePlugin::GetInstance()->GetProjectileSystem().Spawn(Vec3(launch.position.x, launch.position.y, launch.position.z), Vec3(launch.velocity.x, launch.velocity.y, launch.velocity.z), GetEntityId());
+			break;
+		}
+		case EProjectileMode::Hitscan:
+		{
+			CGamePlugin::GetInstance()->GetProjectileSystem().FireHitscan(initialPosition.t, direction, m_hitscanRange, GetEntityId());
+			break;
+		}
 		}
 	}
 
@@ -6,6 +6,28 @@
 
 namespace Game
 {
+	// How the rounds of a weapon are simulated
+	enum class EProjectileMode
+	{
+		// Every round is a physicalized bullet entity, see Bullet.h
+		Physical = 0,
+		// Rounds are plain data advanced by CProjectileSystem, with ray queries along the ballistic path
+		Simulated,
+		// Rounds hit instantly along the barrel direction
+		Hitscan
+	};
+
+	static void ReflectType(Schematyc::CTypeDesc<EProjectileMode>& desc)
+	{
+		desc.SetGUID("{4D3C2A0E-7B36-4E4B-9C57-3E2F1D8A6B90}"_cry_guid);
+		desc.SetLabel("Projectile Mode");
+		desc.SetDescription("Determines how the rounds of a weapon are simulated");
+		desc.SetDefaultValue(EProjectileMode::Physical);
+		desc.AddConstant(EProjectileMode::Physical, "Physical", "Physicalized Bullet");
+		desc.AddConstant(EProjectileMode::Simulated, "Simulated", "Simulated Projectile");
+		desc.AddConstant(EProjectileMode::Hitscan, "Hitscan", "Hitscan");
+	}
+
 	class CWeaponComponent final : public IEntityComponent
 	{
 	public:
@@ -20,11 +42,17 @@ namespace Game
 			desc.SetEditorCategory("Game");
 			desc.SetLabel("WeaponComponent");
 			desc.SetDescription("This spawn point can be used to spawn entities");
+			desc.AddMember(&CWeaponComponent::m_projectileMode, 'pmod', "projectilemode", "Projectile Mode", "Determines how the rounds of this weapon are simulated", EProjectileMode::Physical);
+			desc.AddMember(&CWeaponComponent::m_muzzleVelocity, 'mvel', "muzzlevelocity", "Muzzle Velocity", "Initial speed of simulated projectiles", 1000.f);
+			desc.AddMember(&CWeaponComponent::m_hitscanRange, 'hrng', "hitscanrange", "Hitscan Range", "Maximum distance a hitscan round can travel", 1000.f);
 		}
 
 		void Shoot(QuatTS initialPosition);
 
 	private:
+		EProjectileMode m_projectileMode = EProjectileMode::Physical;
+		float m_muzzleVelocity = 1000.f;
+		float m_hitscanRange = 1000.f;
 	};
 }
 
@@ -0,0 +1,82 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+#pragma once
+
+// Engine independent animation level of detail: how often a character is animated and whether it runs IK
+
+#include <cstdint>
+
+namespace Game
+{
+	enum class EAnimationLod : uint8_t
+	{
+		// Every frame, with IK
+		Full,
+		// Reduced rate without IK
+		Reduced,
+		// Lowest rate without IK, far away or off-screen
+		Minimal
+	};
+
+	struct SAnimationLodParams
+	{
+		float reducedDistance = 15.f;
+		float minimalDistance = 40.f;
+		// Seconds between two animation updates at each LOD, Full is every frame
+		float reducedInterval = 1.f / 30.f;
+		float minimalInterval = 1.f / 10.f;
+	};
+
+	struct SAnimationLodState
+	{
+		EAnimationLod lod = EAnimationLod::Full;
+		// Time since the last animation update
+		float pendingTime = 0.f;
+	};
+
+	inline EAnimationLod SelectAnimationLod(float distance, bool isVisible, const SAnimationLodParams& params)
+	{
+		if (!isVisible || distance >= params.minimalDistance)
+		{
+			return EAnimationLod::Minimal;
+		}
+		return distance >= params.reducedDistance ? EAnimationLod::Reduced : EAnimationLod::Full;
+	}
+
+	inline float GetAnimationUpdateInterval(EAnimationLod lod, const SAnimationLodParams& params)
+	{
+		switch (lod)
+		{
+		case EAnimationLod::Reduced:
+			return params.reducedInterval;
+		case EAnimationLod::Minimal:
+			return params.minimalInterval;
+		default:
+			return 0.f;
+		}
+	}
+
+	// Spreads the updates of characters at the same LOD over the frames of one interval, phase is in [0, 1)
+	inline void InitializeAnimationLod(SAnimationLodState& state, float phase, const SAnimationLodParams& params)
+	{
+		state.lod = EAnimationLod::Full;
+		state.pendingTime = phase * params.minimalInterval;
+	}
+
+	// Returns the time the character's animation has to advance by this frame, or 0 if it skips the frame
+	inline float ScheduleAnimationUpdate(SAnimationLodState& state, EAnimationLod lod, float frameTime, const SAnimationLodParams& params)
+	{
+		state.lod = lod;
+		state.pendingTime += frameTime;
+
+		// Half a frame early rather than a whole frame late, otherwise the rate beats with the frame rate
+		if (state.pendingTime + 0.5f * frameTime < GetAnimationUpdateInterval(lod, params))
+		{
+			return 0.f;
+		}
+
+		const float deltaTime = state.pendingTime;
+		state.pendingTime = 0.f;
+		return deltaTime;
+	}
+}
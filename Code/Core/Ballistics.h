@@ -0,0 +1,45 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+#pragma once
+
+// Engine independent projectile launch and flight, shared by the weapon, bullet and projectile code and offline tools
+
+#include "CoreMath.h"
+
+namespace Game
+{
+	// Physicalized bullets, see CBulletComponent
+	constexpr float kBulletMass = 20000.f;
+	constexpr float kBulletLaunchImpulse = 1000.f;
+
+	struct SProjectileLaunch
+	{
+		SVec3f position;
+		SVec3f velocity;
+	};
+
+	// Forward (+Y) axis of a rotation given as a unit quaternion, the direction rounds leave the barrel in
+	// Same as Quat::GetColumn1
+	inline SVec3f GetForwardFromRotation(float x, float y, float z, float w)
+	{
+		return SVec3f(2.f * (x * y - w * z), 1.f - 2.f * (x * x + z * z), 2.f * (y * z + w * x));
+	}
+
+	// Simulated projectiles start at the muzzle with the full muzzle speed along the barrel
+	inline SProjectileLaunch ComputeProjectileLaunch(const SVec3f& muzzlePosition, const SVec3f& forward, float muzzleSpeed)
+	{
+		return SProjectileLaunch { muzzlePosition, forward * muzzleSpeed };
+	}
+
+	// Speed a physicalized bullet leaves the muzzle with after its launch impulse
+	constexpr float GetBulletLaunchSpeed()
+	{
+		return kBulletLaunchImpulse / kBulletMass;
+	}
+
+	// Closed form position under constant acceleration, CProjectileStore::Integrate steps exactly along this curve
+	inline SVec3f GetBallisticPosition(const SVec3f& position, const SVec3f& velocity, const SVec3f& gravity, float time)
+	{
+		return position + velocity * time + gravity * (0.5f * time * time);
+	}
+}
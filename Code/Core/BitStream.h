@@ -0,0 +1,127 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Game
+{
+	////////////////////////////////////////////////////////
+	// Writes values with arbitrary bit widths into a caller-owned byte buffer, least significant bit first
+	// Writing past the end of the buffer sets the overflow flag instead of touching memory.
+	////////////////////////////////////////////////////////
+	class CBitWriter
+	{
+	public:
+		CBitWriter(uint8_t* pBuffer, std::size_t capacity)
+			: m_pBuffer(pBuffer)
+			, m_capacityBits(capacity * 8)
+		{
+			for (std::size_t i = 0; i < capacity; ++i)
+			{
+				m_pBuffer[i] = 0;
+			}
+		}
+
+		void WriteBits(uint32_t value, uint32_t bitCount)
+		{
+			if (m_bitPosition + bitCount > m_capacityBits)
+			{
+				m_hasOverflowed = true;
+				return;
+			}
+
+			for (uint32_t i = 0; i < bitCount; ++i, ++m_bitPosition)
+			{
+				if (value & (1u << i))
+				{
+					m_pBuffer[m_bitPosition >> 3] |= static_cast<uint8_t>(1u << (m_bitPosition & 7));
+				}
+			}
+		}
+
+		void WriteBool(bool value) { WriteBits(value ? 1u : 0u, 1); }
+
+		// Small values are cheap: 4 bit groups, each followed by a continuation bit
+		void WriteVarUInt(uint32_t value)
+		{
+			do
+			{
+				WriteBits(value & 0xF, 4);
+				value >>= 4;
+				WriteBool(value != 0);
+			}
+			while (value != 0);
+		}
+
+		std::size_t GetBitCount() const { return m_bitPosition; }
+		std::size_t GetByteCount() const { return (m_bitPosition + 7) >> 3; }
+		bool HasOverflowed() const { return m_hasOverflowed; }
+
+	private:
+		uint8_t* m_pBuffer;
+		std::size_t m_capacityBits;
+		std::size_t m_bitPosition = 0;
+		bool m_hasOverflowed = false;
+	};
+
+	////////////////////////////////////////////////////////
+	// Reads values written by CBitWriter
+	// Reading past the end returns zeros and sets the overflow flag, callers check it once at the end.
+	////////////////////////////////////////////////////////
+	class CBitReader
+	{
+	public:
+		CBitReader(const uint8_t* pBuffer, std::size_t size)
+			: m_pBuffer(pBuffer)
+			, m_sizeBits(size * 8)
+		{}
+
+		uint32_t ReadBits(uint32_t bitCount)
+		{
+			if (m_bitPosition + bitCount > m_sizeBits)
+			{
+				m_hasOverflowed = true;
+				return 0;
+			}
+
+			uint32_t value = 0;
+			for (uint32_t i = 0; i < bitCount; ++i, ++m_bitPosition)
+			{
+				if (m_pBuffer[m_bitPosition >> 3] & (1u << (m_bitPosition & 7)))
+				{
+					value |= 1u << i;
+				}
+			}
+			return value;
+		}
+
+		bool ReadBool() { return ReadBits(1) != 0; }
+
+		uint32_t ReadVarUInt()
+		{
+			uint32_t value = 0;
+			for (uint32_t shift = 0; shift < 32; shift += 4)
+			{
+				value |= ReadBits(4) << shift;
+				if (!ReadBool())
+				{
+					return value;
+				}
+			}
+
+			// More groups than fit into 32 bits, the data is corrupt
+			m_hasOverflowed = true;
+			return value;
+		}
+
+		bool HasOverflowed() const { return m_hasOverflowed; }
+
+	private:
+		const uint8_t* m_pBuffer;
+		std::size_t m_sizeBits;
+		std::size_t m_bitPosition = 0;
+		bool m_hasOverflowed = false;
+	};
+}
@@ -0,0 +1,169 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+#pragma once
+
+// Scripted and random input for bots that put load on a server
+// A bot produces the same input commands a client sends: movement axes, look angles and the walk and jump flags,
+// plus the number of shots it fires. Input is held for a while and changes like a human's would, so that the
+// server sees realistic movement, animation and replication instead of every bot jittering in place.
+
+#include "PlayerLook.h"
+#include "PlayerMovement.h"
+
+#include <cstdint>
+
+namespace Game
+{
+	enum class EBotBehavior : uint8_t
+	{
+		// Random movement held for a random time, random turns, jumps and walk toggles
+		Wander = 0,
+		// Strafes left and right while facing the same direction
+		Strafe,
+		// Runs forward and turns at a constant rate
+		Circle,
+		// Stands and turns, only the shots cost anything
+		Stand,
+
+		Count
+	};
+
+	struct SBotInputParams
+	{
+		EBotBehavior behavior = EBotBehavior::Wander;
+		// Range of the time a movement direction is held
+		float minHoldTime = 0.5f;
+		float maxHoldTime = 2.f;
+		float jumpsPerSecond = 0.25f;
+		float walkTogglesPerSecond = 0.1f;
+		// Largest turn rate in radians per second, and the pitch the bots look up and down to
+		float maxTurnRate = 1.5f;
+		float maxPitch = 0.4f;
+		// Time between two shots, 0 never fires
+		float fireInterval = 0.1f;
+	};
+
+	struct SBotInputState
+	{
+		uint32_t random = 1;
+		float moveX = 0.f;
+		float moveY = 0.f;
+		float turnRate = 0.f;
+		float holdTimeLeft = 0.f;
+		float yaw = 0.f;
+		float pitch = 0.f;
+		bool isWalking = false;
+		float fireTime = 0.f;
+	};
+
+	namespace BotInput
+	{
+		// Shots per update are capped so that a hitch doesn't fire a burst
+		constexpr uint32_t kMaxShotsPerUpdate = 4;
+
+		// xorshift32, cheap and identical on every platform
+		inline uint32_t NextRandom(SBotInputState& state)
+		{
+			uint32_t value = state.random;
+			value ^= value << 13;
+			value ^= value >> 17;
+			value ^= value << 5;
+			return state.random = value;
+		}
+
+		// Uniform in [0, 1)
+		inline float NextUnit(SBotInputState& state)
+		{
+			return static_cast<float>(NextRandom(state) >> 8) / static_cast<float>(1 << 24);
+		}
+
+		// Whether an event with the given rate per second happens within deltaTime
+		inline bool NextChance(SBotInputState& state, float ratePerSecond, float deltaTime)
+		{
+			return NextUnit(state) < ratePerSecond * deltaTime;
+		}
+	}
+
+	// Bots with different seeds start facing different directions and fire on different frames
+	inline void InitializeBotInput(SBotInputState& state, uint32_t seed, const SBotInputParams& params)
+	{
+		state = SBotInputState();
+		state.random = (seed * 0x9E3779B9u) ^ 0x2545F491u;
+		state.random = state.random != 0 ? state.random : 1;
+		state.yaw = WrapAngle(BotInput::NextUnit(state) * 2.f * kPi);
+		state.fireTime = BotInput::NextUnit(state) * params.fireInterval;
+	}
+
+	// Advances the bot by deltaTime and returns its input command, outShotCount is the number of shots fired within it
+	inline SPlayerInputCommand UpdateBotInput(SBotInputState& state, const SBotInputParams& params, float deltaTime, uint32_t& outShotCount)
+	{
+		state.holdTimeLeft -= deltaTime;
+		if (state.holdTimeLeft <= 0.f)
+		{
+			state.holdTimeLeft = params.minHoldTime + BotInput::NextUnit(state) * (params.maxHoldTime - params.minHoldTime);
+
+			switch (params.behavior)
+			{
+			case EBotBehavior::Wander:
+			{
+				// Random numbers are drawn in separate statements, the evaluation order of arguments differs between compilers
+				const int32_t moveX = static_cast<int32_t>(BotInput::NextRandom(state) % 3) - 1;
+				const int32_t moveY = static_cast<int32_t>(BotInput::NextRandom(state) % 3) - 1;
+				state.moveX = static_cast<float>(moveX);
+				state.moveY = static_cast<float>(moveY);
+				state.turnRate = (BotInput::NextUnit(state) * 2.f - 1.f) * params.maxTurnRate;
+				break;
+			}
+			case EBotBehavior::Strafe:
+				state.moveX = state.moveX > 0.f ? -1.f : 1.f;
+				state.moveY = 0.f;
+				state.turnRate = 0.f;
+				break;
+			case EBotBehavior::Circle:
+				state.moveX = 0.f;
+				state.moveY = 1.f;
+				state.turnRate = params.maxTurnRate * 0.5f;
+				break;
+			default:
+				state.moveX = 0.f;
+				state.moveY = 0.f;
+				state.turnRate = (BotInput::NextUnit(state) * 2.f - 1.f) * params.maxTurnRate;
+				break;
+			}
+
+			state.pitch = (BotInput::NextUnit(state) * 2.f - 1.f) * params.maxPitch;
+		}
+
+		state.yaw = WrapAngle(state.yaw + state.turnRate * deltaTime);
+
+		const bool isMoving = state.moveX != 0.f || state.moveY != 0.f;
+		if (isMoving && BotInput::NextChance(state, params.walkTogglesPerSecond, deltaTime))
+		{
+			state.isWalking = !state.isWalking;
+		}
+		const bool isJumping = isMoving && BotInput::NextChance(state, params.jumpsPerSecond, deltaTime);
+
+		SPlayerInputCommand command;
+		command.frameTime = deltaTime;
+		command.moveX = state.moveX;
+		command.moveY = state.moveY;
+		command.yaw = state.yaw;
+		command.pitch = state.pitch;
+		command.flags = static_cast<uint8_t>((isJumping ? ePlayerInputFlag_Jump : 0) | (state.isWalking ? ePlayerInputFlag_Walk : 0));
+
+		// Continuous fire, the shot times carry over between updates so that the rate doesn't depend on the frame rate
+		outShotCount = 0;
+		if (params.fireInterval > 0.f)
+		{
+			state.fireTime -= deltaTime;
+			if (state.fireTime <= 0.f)
+			{
+				const uint32_t shotCount = 1 + static_cast<uint32_t>(-state.fireTime / params.fireInterval);
+				state.fireTime += static_cast<float>(shotCount) * params.fireInterval;
+				outShotCount = shotCount < BotInput::kMaxShotsPerUpdate ? shotCount : BotInput::kMaxShotsPerUpdate;
+			}
+		}
+
+		return command;
+	}
+}
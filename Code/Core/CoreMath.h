@@ -0,0 +1,38 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+#pragma once
+
+// Minimal vector math for the engine independent gameplay code in Core/
+// Converts to and from CryMath types by component, e.g. Vec3(v.x, v.y, v.z)
+
+#include <cmath>
+
+namespace Game
+{
+	struct SVec3f
+	{
+		float x = 0.f;
+		float y = 0.f;
+		float z = 0.f;
+
+		constexpr SVec3f() = default;
+		constexpr SVec3f(float x_, float y_, float z_) : x(x_), y(y_), z(z_) {}
+
+		constexpr SVec3f operator+(const SVec3f& other) const { return SVec3f(x + other.x, y + other.y, z + other.z); }
+		constexpr SVec3f operator-(const SVec3f& other) const { return SVec3f(x - other.x, y - other.y, z - other.z); }
+		constexpr SVec3f operator*(float scale) const { return SVec3f(x * scale, y * scale, z * scale); }
+		SVec3f& operator+=(const SVec3f& other) { x += other.x; y += other.y; z += other.z; return *this; }
+		SVec3f& operator-=(const SVec3f& other) { x -= other.x; y -= other.y; z -= other.z; return *this; }
+		SVec3f& operator*=(float scale) { x *= scale; y *= scale; z *= scale; return *this; }
+
+		constexpr float Dot(const SVec3f& other) const { return x * other.x + y * other.y + z * other.z; }
+		constexpr float GetLengthSquared() const { return Dot(*this); }
+		float GetLength() const { return std::sqrt(GetLengthSquared()); }
+	};
+
+	template<typename T>
+	constexpr T ClampValue(T value, T minValue, T maxValue)
+	{
+		return value < minValue ? minValue : (value > maxValue ? maxValue : value);
+	}
+}
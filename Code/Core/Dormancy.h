@@ -0,0 +1,58 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+#pragma once
+
+// Dormancy of entities whose state doesn't change while nothing acts on them
+// An entity that stayed quiescent for the settle time stops updating. Whatever can change its state again, input,
+// physics or gameplay, wakes it, so that a dormant entity costs nothing per frame. The settle time keeps entities
+// that only pause for a moment, e.g. between two key presses, from flapping in and out of the update.
+
+#include "PlayerMovement.h"
+
+namespace Game
+{
+	struct SDormancyParams
+	{
+		// Seconds an entity has to stay quiescent before it goes dormant
+		float settleTime = 0.5f;
+		// Speed below which a grounded player counts as standing still
+		float maxSpeed = 0.05f;
+	};
+
+	struct SDormancyState
+	{
+		float quietTime = 0.f;
+		bool isDormant = false;
+	};
+
+	// Advances the quiet time by deltaTime, returns whether the entity went dormant in this update
+	inline bool UpdateDormancy(SDormancyState& state, bool isQuiescent, float deltaTime, const SDormancyParams& params)
+	{
+		if (!isQuiescent || state.isDormant)
+		{
+			state.quietTime = 0.f;
+			return false;
+		}
+
+		state.quietTime += deltaTime;
+		state.isDormant = state.quietTime >= params.settleTime;
+		return state.isDormant;
+	}
+
+	// Returns whether the entity was dormant
+	inline bool WakeFromDormancy(SDormancyState& state)
+	{
+		const bool wasDormant = state.isDormant;
+		state.isDormant = false;
+		state.quietTime = 0.f;
+		return wasDormant;
+	}
+
+	// A player is quiescent while it gets no movement or jump input, doesn't turn, stands on the ground and doesn't move
+	// Walking is a held flag that doesn't move the player by itself.
+	inline bool IsPlayerQuiescent(float moveX, float moveY, uint8_t flags, bool hasLookChanged, bool isOnGround, const SVec3f& velocity, const SDormancyParams& params)
+	{
+		return moveX == 0.f && moveY == 0.f && (flags & ePlayerInputFlag_Jump) == 0 && !hasLookChanged
+			&& isOnGround && velocity.GetLengthSquared() <= params.maxSpeed * params.maxSpeed;
+	}
+}
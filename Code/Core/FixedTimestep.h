@@ -0,0 +1,83 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+#pragma once
+
+// Splits variable frame times into simulation ticks of a fixed length
+
+#include <cstdint>
+
+namespace Game
+{
+	////////////////////////////////////////////////////////
+	// Fixed timestep accumulator
+	// Advance adds the real time of a frame and returns how many ticks are due. With a rate of zero every frame
+	// is exactly one tick of the frame's length, i.e. the simulation follows the frame rate.
+	////////////////////////////////////////////////////////
+	class CFixedTimestep
+	{
+	public:
+		void SetRate(float ticksPerSecond)
+		{
+			const float step = ticksPerSecond > 0.f ? 1.f / ticksPerSecond : 0.f;
+			if (step != m_step)
+			{
+				m_step = step;
+				m_accumulator = 0.0;
+			}
+		}
+
+		// Returns the number of ticks to run this frame, a backlog above maxTicks is dropped instead of
+		// making the next frames even slower
+		uint32_t Advance(float frameTime, uint32_t maxTicks)
+		{
+			if (m_step <= 0.f)
+			{
+				m_frameTime = frameTime;
+				m_accumulator = 0.0;
+				return 1;
+			}
+
+			m_accumulator += frameTime;
+
+			uint32_t tickCount = static_cast<uint32_t>(m_accumulator / m_step);
+			if (tickCount > maxTicks)
+			{
+				m_accumulator -= static_cast<double>(tickCount - maxTicks) * m_step;
+				tickCount = maxTicks;
+			}
+
+			m_frameTime = frameTime;
+			m_ticksThisFrame = tickCount;
+			m_accumulator -= static_cast<double>(tickCount) * m_step;
+			return tickCount;
+		}
+
+		bool IsFixed() const { return m_step > 0.f; }
+
+		// Length of every tick of the current frame
+		float GetTickLength() const { return IsFixed() ? m_step : m_frameTime; }
+
+		// How long before the end of the frame the given tick of the current frame ended, in seconds
+		// Maps ticks back onto the real time line, e.g. to hand each tick the input that arrived during it.
+		double GetTickEndOffset(uint32_t tickIndex) const
+		{
+			if (!IsFixed())
+			{
+				return 0.0;
+			}
+
+			return m_accumulator + static_cast<double>(m_ticksThisFrame - 1 - tickIndex) * m_step;
+		}
+
+		// Fraction of a tick that has passed since the last tick, for interpolating presentation
+		float GetAlpha() const { return IsFixed() ? static_cast<float>(m_accumulator / m_step) : 1.f; }
+
+		void Reset() { m_accumulator = 0.0; }
+
+	private:
+		float m_step = 0.f;
+		float m_frameTime = 0.f;
+		double m_accumulator = 0.0;
+		uint32_t m_ticksThisFrame = 0;
+	};
+}
@@ -0,0 +1,762 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+#pragma once
+
+// Compact recording of a match for offline analysis and bug reproduction
+// A recording is a file header followed by chunks of consecutive ticks. Chunks are only ever appended, and each one
+// is self-contained: every value is delta encoded against the previous value of the same entity within the chunk and
+// stored as a variable length integer. A reader can therefore start decoding at any chunk, and a file cut short by a
+// crash only loses the chunk that was being written.
+// Input commands are stored exactly, transforms with a resolution of 1/1024 m and 1/32767 per quaternion component.
+// Headers are stored in the byte order of the recording machine, like the state streams in StateStream.h.
+
+#include "MappedFile.h"
+#include "PlayerMovement.h"
+#include "StateStream.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace Game
+{
+	struct SRecordedInput
+	{
+		uint32_t entityId = 0;
+		SPlayerInputCommand command;
+	};
+
+	struct SRecordedTransform
+	{
+		uint32_t entityId = 0;
+		SVec3f position;
+		// Quaternion as x, y, z, w
+		float rotation[4] = { 0.f, 0.f, 0.f, 1.f };
+	};
+
+	// A shot is the muzzle transform that was passed to CWeaponComponent::Shoot, entityId is the shooter
+	using SRecordedShot = SRecordedTransform;
+
+	struct SRecordedSpawn
+	{
+		uint32_t entityId = 0;
+		uint32_t spawnPointId = 0;
+	};
+
+	// Everything recorded during one tick, in the order it was recorded within each kind
+	struct SRecordedTick
+	{
+		uint64_t tick = 0;
+		float frameTime = 0.f;
+		std::vector<SRecordedInput> inputs;
+		std::vector<SRecordedTransform> transforms;
+		std::vector<SRecordedShot> shots;
+		std::vector<SRecordedSpawn> spawns;
+
+		// Keeps the capacity, so that reading tick after tick doesn't allocate
+		void Clear()
+		{
+			inputs.clear();
+			transforms.clear();
+			shots.clear();
+			spawns.clear();
+		}
+	};
+
+	namespace GameRecording
+	{
+		constexpr uint32_t kFileMagic = MakeStateTag('G', 'R', 'E', 'C');
+		constexpr uint32_t kChunkMagic = MakeStateTag('G', 'R', 'C', 'K');
+		constexpr uint32_t kVersion = 1;
+
+		constexpr float kPositionScale = 1024.f;
+		constexpr float kRotationScale = 32767.f;
+
+		struct SFileHeader
+		{
+			uint32_t magic;
+			uint32_t version;
+		};
+
+		struct SChunkHeader
+		{
+			uint32_t magic;
+			uint32_t payloadSize;
+			uint64_t firstTick;
+			uint32_t tickCount;
+			uint32_t reserved;
+		};
+
+		enum ERecord : uint8_t
+		{
+			eRecord_EndTick = 0,
+			eRecord_Input,
+			eRecord_Transform,
+			eRecord_Shot,
+			eRecord_Spawn
+		};
+
+		// Fields of an input command, in the order of their bits in the change mask
+		constexpr uint32_t kInputFieldCount = 7;
+		// Position followed by rotation
+		constexpr uint32_t kTransformFieldCount = 7;
+		// Type, entity number and id, change mask and seven fields
+		constexpr std::size_t kMaxRecordBytes = 1 + 5 + 5 + 1 + 7 * 5;
+
+		namespace Detail
+		{
+			inline uint32_t FloatBits(float value)
+			{
+				uint32_t bits;
+				std::memcpy(&bits, &value, sizeof(bits));
+				return bits;
+			}
+
+			inline float BitsToFloat(uint32_t bits)
+			{
+				float value;
+				std::memcpy(&value, &bits, sizeof(value));
+				return value;
+			}
+
+			inline uint32_t ZigZag(int32_t value) { return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31); }
+			inline int32_t UnZigZag(uint32_t value) { return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1); }
+
+			// 7 bits per byte, the high bit marks that another byte follows
+			inline void AppendVarUInt(uint8_t*& pOut, uint32_t value)
+			{
+				while (value >= 0x80)
+				{
+					*pOut++ = static_cast<uint8_t>(value | 0x80);
+					value >>= 7;
+				}
+				*pOut++ = static_cast<uint8_t>(value);
+			}
+
+			inline int32_t QuantizeValue(float value, float scale)
+			{
+				const float scaled = std::round(value * scale);
+				return static_cast<int32_t>(ClampValue(scaled, -2147483520.f, 2147483520.f));
+			}
+
+			inline void QuantizeTransform(const SRecordedTransform& transform, uint32_t (&outFields)[kTransformFieldCount])
+			{
+				outFields[0] = static_cast<uint32_t>(QuantizeValue(transform.position.x, kPositionScale));
+				outFields[1] = static_cast<uint32_t>(QuantizeValue(transform.position.y, kPositionScale));
+				outFields[2] = static_cast<uint32_t>(QuantizeValue(transform.position.z, kPositionScale));
+				for (int i = 0; i < 4; ++i)
+				{
+					outFields[3 + i] = static_cast<uint32_t>(QuantizeValue(transform.rotation[i], kRotationScale));
+				}
+			}
+
+			inline void DequantizeTransform(const uint32_t (&fields)[kTransformFieldCount], SRecordedTransform& outTransform)
+			{
+				outTransform.position = SVec3f(static_cast<float>(static_cast<int32_t>(fields[0])) / kPositionScale,
+					static_cast<float>(static_cast<int32_t>(fields[1])) / kPositionScale, static_cast<float>(static_cast<int32_t>(fields[2])) / kPositionScale);
+				for (int i = 0; i < 4; ++i)
+				{
+					outTransform.rotation[i] = static_cast<float>(static_cast<int32_t>(fields[3 + i])) / kRotationScale;
+				}
+			}
+
+			inline void GetInputFields(const SPlayerInputCommand& command, uint32_t (&outFields)[kInputFieldCount])
+			{
+				outFields[0] = command.sequence;
+				outFields[1] = FloatBits(command.frameTime);
+				outFields[2] = FloatBits(command.moveX);
+				outFields[3] = FloatBits(command.moveY);
+				outFields[4] = FloatBits(command.yaw);
+				outFields[5] = FloatBits(command.pitch);
+				outFields[6] = command.flags;
+			}
+
+			inline void SetInputFields(const uint32_t (&fields)[kInputFieldCount], SPlayerInputCommand& outCommand)
+			{
+				outCommand.sequence = fields[0];
+				outCommand.frameTime = BitsToFloat(fields[1]);
+				outCommand.moveX = BitsToFloat(fields[2]);
+				outCommand.moveY = BitsToFloat(fields[3]);
+				outCommand.yaw = BitsToFloat(fields[4]);
+				outCommand.pitch = BitsToFloat(fields[5]);
+				outCommand.flags = static_cast<uint8_t>(fields[6]);
+			}
+
+			// Last values of an entity within the current chunk, the baselines of its next records
+			struct SEntityBaseline
+			{
+				uint32_t entityId = 0;
+				uint32_t input[kInputFieldCount] = {};
+				uint32_t transform[kTransformFieldCount] = {};
+			};
+
+			// Entities are numbered in the order they first appear in a chunk, records refer to them by that number
+			class CEntityTable
+			{
+			public:
+				void Clear()
+				{
+					m_entities.clear();
+					m_nextSlot = 0;
+				}
+
+				std::size_t GetCount() const { return m_entities.size(); }
+				SEntityBaseline& Get(std::size_t slot) { return m_entities[slot]; }
+
+				// Entities are usually recorded in the same order every tick, so the slot after the last one is tried first
+				std::size_t Find(uint32_t entityId)
+				{
+					const std::size_t count = m_entities.size();
+					if (m_nextSlot < count && m_entities[m_nextSlot].entityId == entityId)
+					{
+						return m_nextSlot++;
+					}
+
+					for (std::size_t slot = 0; slot < count; ++slot)
+					{
+						if (m_entities[slot].entityId == entityId)
+						{
+							m_nextSlot = slot + 1;
+							return slot;
+						}
+					}
+					return count;
+				}
+
+				std::size_t Add(uint32_t entityId)
+				{
+					SEntityBaseline baseline;
+					baseline.entityId = entityId;
+					// Identity rotation, so that entities that never turn cost nothing
+					baseline.transform[6] = static_cast<uint32_t>(QuantizeValue(1.f, kRotationScale));
+					m_entities.push_back(baseline);
+					m_nextSlot = m_entities.size();
+					return m_entities.size() - 1;
+				}
+
+			private:
+				std::vector<SEntityBaseline> m_entities;
+				std::size_t m_nextSlot = 0;
+			};
+
+			class CReadCursor
+			{
+			public:
+				CReadCursor() = default;
+				CReadCursor(const uint8_t* pBegin, const uint8_t* pEnd)
+					: m_pCurrent(pBegin)
+					, m_pEnd(pEnd)
+				{}
+
+				bool IsAtEnd() const { return m_pCurrent >= m_pEnd; }
+				bool HasFailed() const { return m_hasFailed; }
+
+				uint8_t ReadByte()
+				{
+					if (m_pCurrent >= m_pEnd)
+					{
+						m_hasFailed = true;
+						return 0;
+					}
+					return *m_pCurrent++;
+				}
+
+				uint32_t ReadVarUInt()
+				{
+					uint32_t value = 0;
+					for (uint32_t shift = 0; shift < 35; shift += 7)
+					{
+						const uint8_t byte = ReadByte();
+						value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+						if ((byte & 0x80) == 0)
+						{
+							return value;
+						}
+					}
+
+					// More bytes than fit into 32 bits, the data is corrupt
+					m_hasFailed = true;
+					return 0;
+				}
+
+			private:
+				const uint8_t* m_pCurrent = nullptr;
+				const uint8_t* m_pEnd = nullptr;
+				bool m_hasFailed = false;
+			};
+		}
+	}
+
+	////////////////////////////////////////////////////////
+	// Appends ticks to a recording
+	// Records of a tick can be written in any order and are closed by EndTick, ticks are numbered from zero.
+	// A chunk is kept in memory until it holds chunkTickCount ticks and then written with a single call.
+	////////////////////////////////////////////////////////
+	class CGameRecordingWriter
+	{
+	public:
+		~CGameRecordingWriter() { Close(); }
+
+		bool Open(const char* szPath, uint32_t chunkTickCount = 64)
+		{
+			Close();
+			m_pFile = std::fopen(szPath, "wb");
+			if (m_pFile == nullptr)
+			{
+				return false;
+			}
+
+			m_chunkTickCount = chunkTickCount > 0 ? chunkTickCount : 1;
+			m_tickCount = 0;
+			m_byteCount = 0;
+			m_chunkCount = 0;
+			m_payload.resize(64 * 1024);
+			BeginChunk();
+
+			const GameRecording::SFileHeader header = { GameRecording::kFileMagic, GameRecording::kVersion };
+			if (std::fwrite(&header, sizeof(header), 1, m_pFile) != 1)
+			{
+				Close();
+				return false;
+			}
+			m_byteCount += sizeof(header);
+			return true;
+		}
+
+		// Writes the ticks of the unfinished chunk
+		void Close()
+		{
+			if (m_pFile != nullptr)
+			{
+				WriteChunk();
+				std::fclose(m_pFile);
+				m_pFile = nullptr;
+			}
+		}
+
+		bool IsOpen() const { return m_pFile != nullptr; }
+
+		void WriteInput(uint32_t entityId, const SPlayerInputCommand& command)
+		{
+			using namespace GameRecording;
+
+			uint32_t fields[kInputFieldCount];
+			Detail::GetInputFields(command, fields);
+
+			uint8_t* pOut = BeginRecord();
+			Detail::SEntityBaseline& baseline = WriteRecordHeader(pOut, eRecord_Input, entityId);
+			// Sequence numbers count up by one per command
+			uint32_t predicted[kInputFieldCount];
+			std::copy(std::begin(baseline.input), std::end(baseline.input), predicted);
+			++predicted[0];
+
+			WriteFields(pOut, fields, predicted, kInputFieldCount);
+			std::copy(std::begin(fields), std::end(fields), baseline.input);
+			EndRecord(pOut);
+		}
+
+		void WriteTransform(const SRecordedTransform& transform)
+		{
+			using namespace GameRecording;
+
+			uint32_t fields[kTransformFieldCount];
+			Detail::QuantizeTransform(transform, fields);
+
+			uint8_t* pOut = BeginRecord();
+			Detail::SEntityBaseline& baseline = WriteRecordHeader(pOut, eRecord_Transform, transform.entityId);
+			WriteFields(pOut, fields, baseline.transform, kTransformFieldCount);
+			std::copy(std::begin(fields), std::end(fields), baseline.transform);
+			EndRecord(pOut);
+		}
+
+		// Delta encoded against the shooter's transform, which stays the baseline of its next transform
+		void WriteShot(const SRecordedShot& shot)
+		{
+			using namespace GameRecording;
+
+			uint32_t fields[kTransformFieldCount];
+			Detail::QuantizeTransform(shot, fields);
+
+			uint8_t* pOut = BeginRecord();
+			const Detail::SEntityBaseline& baseline = WriteRecordHeader(pOut, eRecord_Shot, shot.entityId);
+			WriteFields(pOut, fields, baseline.transform, kTransformFieldCount);
+			EndRecord(pOut);
+		}
+
+		void WriteSpawn(const SRecordedSpawn& spawn)
+		{
+			uint8_t* pOut = BeginRecord();
+			WriteRecordHeader(pOut, GameRecording::eRecord_Spawn, spawn.entityId);
+			GameRecording::Detail::AppendVarUInt(pOut, spawn.spawnPointId);
+			EndRecord(pOut);
+		}
+
+		void EndTick(float frameTime)
+		{
+			using namespace GameRecording;
+
+			const uint32_t frameTimeBits = Detail::FloatBits(frameTime);
+			uint8_t* pOut = BeginRecord();
+			*pOut++ = eRecord_EndTick;
+			Detail::AppendVarUInt(pOut, Detail::ZigZag(static_cast<int32_t>(frameTimeBits - m_lastFrameTimeBits)));
+			EndRecord(pOut);
+			m_lastFrameTimeBits = frameTimeBits;
+
+			++m_tickCount;
+			if (++m_chunkTicks >= m_chunkTickCount)
+			{
+				WriteChunk();
+			}
+		}
+
+		uint64_t GetTickCount() const { return m_tickCount; }
+		uint32_t GetChunkCount() const { return m_chunkCount; }
+		// Bytes written to the file so far, not counting the unfinished chunk
+		uint64_t GetByteCount() const { return m_byteCount; }
+
+	private:
+		void BeginChunk()
+		{
+			m_payloadSize = 0;
+			m_entities.Clear();
+			m_chunkTicks = 0;
+			m_lastFrameTimeBits = 0;
+		}
+
+		void WriteChunk()
+		{
+			if (m_chunkTicks > 0 && m_pFile != nullptr)
+			{
+				GameRecording::SChunkHeader header;
+				header.magic = GameRecording::kChunkMagic;
+				header.payloadSize = static_cast<uint32_t>(m_payloadSize);
+				header.firstTick = m_tickCount - m_chunkTicks;
+				header.tickCount = m_chunkTicks;
+				header.reserved = 0;
+
+				if (std::fwrite(&header, sizeof(header), 1, m_pFile) == 1 && std::fwrite(m_payload.data(), 1, m_payloadSize, m_pFile) == m_payloadSize)
+				{
+					m_byteCount += sizeof(header) + m_payloadSize;
+					++m_chunkCount;
+				}
+			}
+			BeginChunk();
+		}
+
+		// Records are encoded in place at the end of the payload, which always has room for the largest one
+		uint8_t* BeginRecord()
+		{
+			if (m_payload.size() - m_payloadSize < GameRecording::kMaxRecordBytes)
+			{
+				m_payload.resize(m_payload.size() * 2);
+			}
+			return m_payload.data() + m_payloadSize;
+		}
+
+		void EndRecord(const uint8_t* pEnd)
+		{
+			m_payloadSize = static_cast<std::size_t>(pEnd - m_payload.data());
+		}
+
+		GameRecording::Detail::SEntityBaseline& WriteRecordHeader(uint8_t*& pOut, GameRecording::ERecord record, uint32_t entityId)
+		{
+			*pOut++ = record;
+
+			std::size_t slot = m_entities.Find(entityId);
+			GameRecording::Detail::AppendVarUInt(pOut, static_cast<uint32_t>(slot));
+			// The number one past the last entity introduces a new one
+			if (slot == m_entities.GetCount())
+			{
+				GameRecording::Detail::AppendVarUInt(pOut, entityId);
+				slot = m_entities.Add(entityId);
+			}
+			return m_entities.Get(slot);
+		}
+
+		// A mask of the fields that differ from their baseline, followed by the differences
+		void WriteFields(uint8_t*& pOut, const uint32_t* pFields, const uint32_t* pBaseline, uint32_t count)
+		{
+			uint8_t mask = 0;
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				mask |= pFields[i] != pBaseline[i] ? static_cast<uint8_t>(1u << i) : 0;
+			}
+
+			*pOut++ = mask;
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				if (mask & (1u << i))
+				{
+					GameRecording::Detail::AppendVarUInt(pOut, GameRecording::Detail::ZigZag(static_cast<int32_t>(pFields[i] - pBaseline[i])));
+				}
+			}
+		}
+
+	private:
+		std::FILE* m_pFile = nullptr;
+		// Encoded ticks of the current chunk, m_payloadSize bytes of it are used
+		std::vector<uint8_t> m_payload;
+		std::size_t m_payloadSize = 0;
+		GameRecording::Detail::CEntityTable m_entities;
+		uint32_t m_chunkTickCount = 64;
+		uint32_t m_chunkTicks = 0;
+		uint32_t m_lastFrameTimeBits = 0;
+		uint64_t m_tickCount = 0;
+		uint64_t m_byteCount = 0;
+		uint32_t m_chunkCount = 0;
+	};
+
+	////////////////////////////////////////////////////////
+	// Reads a recording straight from a memory mapping of the file
+	// Opening only walks the chunk headers. Seek jumps to the chunk holding a tick and decodes forward from its start,
+	// so random access costs at most one chunk no matter how long the recording is.
+	////////////////////////////////////////////////////////
+	class CGameRecordingReader
+	{
+	public:
+		// Fails for missing files and for files of another format or version
+		bool Open(const char* szPath)
+		{
+			Close();
+			return m_file.Open(szPath) && Parse(m_file.GetData(), m_file.GetSize());
+		}
+
+		// Reads a recording in memory owned by the caller, which has to outlive the reader
+		bool Open(const uint8_t* pData, std::size_t size)
+		{
+			Close();
+			return Parse(pData, size);
+		}
+
+		void Close()
+		{
+			m_file.Close();
+			m_chunks.clear();
+			m_tickCount = 0;
+			m_nextTick = 0;
+			m_chunkIndex = 0;
+			m_chunkTicksLeft = 0;
+		}
+
+		uint64_t GetTickCount() const { return m_tickCount; }
+		std::size_t GetChunkCount() const { return m_chunks.size(); }
+		uint64_t GetNextTick() const { return m_nextTick; }
+
+		// The next ReadTick returns the given tick
+		bool Seek(uint64_t tick)
+		{
+			if (tick >= m_tickCount)
+			{
+				return false;
+			}
+
+			const auto it = std::upper_bound(m_chunks.begin(), m_chunks.end(), tick, [](uint64_t value, const SChunk& chunk) { return value < chunk.firstTick; });
+			BeginChunk(static_cast<std::size_t>(it - m_chunks.begin()) - 1);
+
+			while (m_nextTick < tick)
+			{
+				if (!ReadTick(m_skippedTick))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		// Returns false at the end of the recording or if the data is corrupt
+		bool ReadTick(SRecordedTick& outTick)
+		{
+			using namespace GameRecording;
+
+			outTick.Clear();
+
+			if (m_chunkTicksLeft == 0)
+			{
+				if (m_chunkIndex + 1 >= m_chunks.size())
+				{
+					return false;
+				}
+				BeginChunk(m_chunkIndex + 1);
+			}
+
+			for (;;)
+			{
+				const uint8_t record = m_cursor.ReadByte();
+				if (m_cursor.HasFailed())
+				{
+					return false;
+				}
+
+				if (record == eRecord_EndTick)
+				{
+					m_lastFrameTimeBits += static_cast<uint32_t>(Detail::UnZigZag(m_cursor.ReadVarUInt()));
+					outTick.frameTime = Detail::BitsToFloat(m_lastFrameTimeBits);
+					break;
+				}
+
+				Detail::SEntityBaseline* pBaseline = ReadEntity();
+				if (pBaseline == nullptr)
+				{
+					return false;
+				}
+
+				switch (record)
+				{
+				case eRecord_Input:
+				{
+					uint32_t predicted[kInputFieldCount];
+					std::copy(std::begin(pBaseline->input), std::end(pBaseline->input), predicted);
+					++predicted[0];
+					ReadFields(predicted, pBaseline->input, kInputFieldCount);
+
+					SRecordedInput input;
+					input.entityId = pBaseline->entityId;
+					Detail::SetInputFields(pBaseline->input, input.command);
+					outTick.inputs.push_back(input);
+					break;
+				}
+				case eRecord_Transform:
+				{
+					ReadFields(pBaseline->transform, pBaseline->transform, kTransformFieldCount);
+
+					SRecordedTransform transform;
+					transform.entityId = pBaseline->entityId;
+					Detail::DequantizeTransform(pBaseline->transform, transform);
+					outTick.transforms.push_back(transform);
+					break;
+				}
+				case eRecord_Shot:
+				{
+					uint32_t fields[kTransformFieldCount];
+					ReadFields(pBaseline->transform, fields, kTransformFieldCount);
+
+					SRecordedShot shot;
+					shot.entityId = pBaseline->entityId;
+					Detail::DequantizeTransform(fields, shot);
+					outTick.shots.push_back(shot);
+					break;
+				}
+				case eRecord_Spawn:
+				{
+					SRecordedSpawn spawn;
+					spawn.entityId = pBaseline->entityId;
+					spawn.spawnPointId = m_cursor.ReadVarUInt();
+					outTick.spawns.push_back(spawn);
+					break;
+				}
+				default:
+					return false;
+				}
+			}
+
+			if (m_cursor.HasFailed())
+			{
+				return false;
+			}
+
+			outTick.tick = m_nextTick++;
+			--m_chunkTicksLeft;
+			return true;
+		}
+
+	private:
+		struct SChunk
+		{
+			uint64_t firstTick;
+			uint32_t tickCount;
+			const uint8_t* pPayload;
+			uint32_t payloadSize;
+		};
+
+		bool Parse(const uint8_t* pData, std::size_t size)
+		{
+			using namespace GameRecording;
+
+			SFileHeader header;
+			if (pData == nullptr || size < sizeof(header))
+			{
+				return false;
+			}
+
+			std::memcpy(&header, pData, sizeof(header));
+			if (header.magic != kFileMagic || header.version != kVersion)
+			{
+				return false;
+			}
+
+			// Chunks are found by walking their headers, a truncated or damaged tail ends the recording
+			std::size_t offset = sizeof(header);
+			while (size - offset >= sizeof(SChunkHeader))
+			{
+				SChunkHeader chunkHeader;
+				std::memcpy(&chunkHeader, pData + offset, sizeof(chunkHeader));
+				offset += sizeof(chunkHeader);
+
+				if (chunkHeader.magic != kChunkMagic || chunkHeader.firstTick != m_tickCount || chunkHeader.tickCount == 0 || chunkHeader.payloadSize > size - offset)
+				{
+					break;
+				}
+
+				m_chunks.push_back(SChunk { chunkHeader.firstTick, chunkHeader.tickCount, pData + offset, chunkHeader.payloadSize });
+				m_tickCount += chunkHeader.tickCount;
+				offset += chunkHeader.payloadSize;
+			}
+
+			if (!m_chunks.empty())
+			{
+				BeginChunk(0);
+			}
+			return true;
+		}
+
+		void BeginChunk(std::size_t index)
+		{
+			const SChunk& chunk = m_chunks[index];
+			m_chunkIndex = index;
+			m_chunkTicksLeft = chunk.tickCount;
+			m_nextTick = chunk.firstTick;
+			m_cursor = GameRecording::Detail::CReadCursor(chunk.pPayload, chunk.pPayload + chunk.payloadSize);
+			m_entities.Clear();
+			m_lastFrameTimeBits = 0;
+		}
+
+		GameRecording::Detail::SEntityBaseline* ReadEntity()
+		{
+			const std::size_t slot = m_cursor.ReadVarUInt();
+			if (slot < m_entities.GetCount())
+			{
+				return &m_entities.Get(slot);
+			}
+			if (slot == m_entities.GetCount())
+			{
+				const uint32_t entityId = m_cursor.ReadVarUInt();
+				return &m_entities.Get(m_entities.Add(entityId));
+			}
+			return nullptr;
+		}
+
+		void ReadFields(const uint32_t* pBaseline, uint32_t* pOutFields, uint32_t count)
+		{
+			const uint8_t mask = m_cursor.ReadByte();
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				pOutFields[i] = pBaseline[i] + ((mask & (1u << i)) ? static_cast<uint32_t>(GameRecording::Detail::UnZigZag(m_cursor.ReadVarUInt())) : 0);
+			}
+		}
+
+	private:
+		CMappedFile m_file;
+		std::vector<SChunk> m_chunks;
+		uint64_t m_tickCount = 0;
+
+		std::size_t m_chunkIndex = 0;
+		uint32_t m_chunkTicksLeft = 0;
+		uint64_t m_nextTick = 0;
+		GameRecording::Detail::CReadCursor m_cursor;
+		GameRecording::Detail::CEntityTable m_entities;
+		uint32_t m_lastFrameTimeBits = 0;
+		SRecordedTick m_skippedTick;
+	};
+}
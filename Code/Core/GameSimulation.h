@@ -0,0 +1,442 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+#pragma once
+
+// Headless gameplay simulation built only from the engine independent cores
+// Runs players, look rotation, firing, projectile flight, hit detection and respawning at a fixed timestep
+// without renderer, physics or entity system, so that gameplay cost can be measured and compared on any machine.
+// The result only depends on the parameters: with the same build, the same seed always produces the same checksum.
+
+#include "Ballistics.h"
+#include "HitboxHistory.h"
+#include "LinearArena.h"
+#include "PlayerLook.h"
+#include "PlayerMovement.h"
+#include "ProjectileStore.h"
+#include "Relevancy.h"
+#include "SpatialGrid.h"
+#include "SpawnSelection.h"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace Game
+{
+	struct SGameSimulationParams
+	{
+		SGameSimulationParams()
+		{
+			movement.movementSpeed = 5.f;
+			movement.walkSpeed = 2.f;
+			movement.jumpVelocity = 5.f;
+			look.rotationSpeed = 0.002f;
+		}
+
+		uint32_t playerCount = 64;
+		uint32_t spawnPointCount = 32;
+		uint32_t seed = 1;
+		float tickRate = 60.f;
+		// Side length of the square arena around the origin that players are kept in
+		float arenaSize = 200.f;
+		// Players are hit as spheres standing on the ground
+		float playerRadius = 0.9f;
+		float eyeHeight = 1.6f;
+		// Time between two shots of the same player
+		float fireInterval = 0.1f;
+		// Defaults of CWeaponComponent and g_projectileLifetime
+		float muzzleSpeed = 1000.f;
+		float projectileLifetime = 5.f;
+		// Default of g_spawnEnemySearchRadius
+		float spawnEnemySearchRadius = 100.f;
+		// Arena for the projectiles and the spatial grid, what doesn't fit is allocated on the heap
+		std::size_t memoryBudget = 16 * 1024 * 1024;
+
+		SPlayerMovementParams movement;
+		SPlayerLookParams look;
+	};
+
+	struct SGameSimulationStatistics
+	{
+		uint64_t ticks = 0;
+		uint64_t shotsFired = 0;
+		uint64_t hits = 0;
+		uint64_t respawns = 0;
+	};
+
+	struct SGameSimulationHit
+	{
+		uint32_t shooter;
+		uint32_t victim;
+	};
+
+	struct SGameSimulationShot
+	{
+		uint32_t shooter;
+		SVec3f muzzle;
+		float yaw;
+		float pitch;
+	};
+
+	struct SGameSimulationSpawn
+	{
+		uint32_t player;
+		uint32_t spawnPoint;
+	};
+
+	////////////////////////////////////////////////////////
+	// Fixed timestep match between bots with random input
+	// Every tick each player samples input, turns, moves and possibly fires. Projectiles are integrated in the
+	// structure-of-arrays store and tested against the players in the spatial grid, hit players respawn at the
+	// spawn point farthest from their enemies.
+	////////////////////////////////////////////////////////
+	class CGameSimulation
+	{
+	public:
+		static constexpr uint32_t kPlayerTypeMask = 1;
+
+		explicit CGameSimulation(const SGameSimulationParams& params)
+			: m_params(params)
+			, m_timeStep(1.f / params.tickRate)
+			, m_arena(params.memoryBudget)
+			, m_projectiles(&m_arena)
+			, m_grid(8.f, &m_arena)
+		{
+			const uint32_t spawnPointCount = params.spawnPointCount > 0 ? params.spawnPointCount : 1;
+			const float spawnRingRadius = params.arenaSize * 0.4f;
+
+			// Evenly spread on a ring around the center of the arena
+			m_spawnPoints.resize(spawnPointCount);
+			for (uint32_t i = 0; i < spawnPointCount; ++i)
+			{
+				const float angle = 2.f * kPi * static_cast<float>(i) / static_cast<float>(spawnPointCount);
+				m_spawnPoints[i].position = SVec3f(std::cos(angle) * spawnRingRadius, std::sin(angle) * spawnRingRadius, 0.f);
+			}
+
+			// Everything that would otherwise grow during the match is sized up front
+			const float shotsInFlight = params.projectileLifetime / (params.fireInterval > 0.f ? params.fireInterval : m_timeStep);
+			m_projectiles.Reserve(static_cast<std::size_t>(static_cast<float>(params.playerCount) * shotsInFlight) + 1);
+
+			m_players.resize(params.playerCount);
+			m_tickHits.reserve(params.playerCount);
+			m_tickInputs.resize(params.playerCount);
+			m_tickShots.reserve(params.playerCount);
+			m_tickSpawns.reserve(params.playerCount);
+			for (uint32_t i = 0; i < params.playerCount; ++i)
+			{
+				SPlayer& player = m_players[i];
+				player.random = (params.seed * 0x9E3779B9u) ^ (i * 0x85EBCA6Bu) ^ 0x2545F491u;
+				player.random = player.random != 0 ? player.random : 1;
+				player.nextFireTime = static_cast<float>(NextRandom(player) % 1000) / 1000.f * params.fireInterval;
+
+				const std::size_t spawnIndex = SelectSpawnPoint(ESpawnSelectionPolicy::RoundRobin, i);
+				player.movement.position = m_spawnPoints[spawnIndex].position;
+				player.yaw = WrapAngle(static_cast<float>(NextRandom(player) % 6283) / 1000.f);
+
+				SSpatialObject object;
+				object.position = GetHitCenter(player);
+				object.radius = params.playerRadius;
+				object.userId = i;
+				object.typeMask = kPlayerTypeMask;
+				player.spatialHandle = m_grid.Insert(object);
+			}
+
+			m_grid.Commit();
+		}
+
+		// pInputs replaces the bots' input with one command per player, e.g. from a recording
+		void Tick(const SPlayerInputCommand* pInputs = nullptr)
+		{
+			const float time = static_cast<float>(m_statistics.ticks) * m_timeStep;
+			m_tickHits.clear();
+			m_tickShots.clear();
+			m_tickSpawns.clear();
+
+			for (uint32_t i = 0, n = static_cast<uint32_t>(m_players.size()); i < n; ++i)
+			{
+				UpdatePlayer(i, time, pInputs);
+			}
+
+			UpdateProjectiles();
+
+			m_grid.Commit();
+			++m_statistics.ticks;
+		}
+
+		// Hash over the state of all players and projectiles, identical for identical runs
+		uint64_t GetChecksum() const
+		{
+			uint64_t hash = 14695981039346656037ull;
+			const auto mix = [&hash](float value)
+			{
+				uint32_t bits;
+				std::memcpy(&bits, &value, sizeof(bits));
+				hash = (hash ^ bits) * 1099511628211ull;
+			};
+
+			for (const SPlayer& player : m_players)
+			{
+				mix(player.movement.position.x);
+				mix(player.movement.position.y);
+				mix(player.movement.position.z);
+				mix(player.yaw);
+				mix(player.pitch);
+			}
+
+			for (std::size_t i = 0, n = m_projectiles.Size(); i < n; ++i)
+			{
+				mix(m_projectiles.GetPositionX(i));
+				mix(m_projectiles.GetPositionY(i));
+				mix(m_projectiles.GetPositionZ(i));
+			}
+
+			return hash;
+		}
+
+		const SGameSimulationStatistics& GetStatistics() const { return m_statistics; }
+		std::size_t GetProjectileCount() const { return m_projectiles.Size(); }
+		float GetTimeStep() const { return m_timeStep; }
+		float GetTime() const { return static_cast<float>(m_statistics.ticks) * m_timeStep; }
+
+		uint32_t GetPlayerCount() const { return static_cast<uint32_t>(m_players.size()); }
+		// Eye position and look direction of a player, the userId matches the player's object in the grid
+		SRelevancyViewer GetPlayerViewer(uint32_t index) const
+		{
+			const SPlayer& player = m_players[index];
+
+			SRelevancyViewer viewer;
+			viewer.userId = index;
+			viewer.position = player.movement.position + SVec3f(0.f, 0.f, m_params.eyeHeight);
+			viewer.forward = GetLookDirection(player.yaw, player.pitch);
+			return viewer;
+		}
+
+		const SPlayerMovementState& GetPlayerMovement(uint32_t index) const { return m_players[index].movement; }
+		float GetPlayerYaw(uint32_t index) const { return m_players[index].yaw; }
+
+		const CSpatialGrid& GetGrid() const { return m_grid; }
+		const CProjectileStore& GetProjectiles() const { return m_projectiles; }
+		SLinearArenaStatistics GetArenaStatistics() const { return m_arena.GetStatistics(); }
+		// Hits of the last tick
+		const std::vector<SGameSimulationHit>& GetTickHits() const { return m_tickHits; }
+		// Input of every player, shots and respawns of the last tick
+		const std::vector<SPlayerInputCommand>& GetTickInputs() const { return m_tickInputs; }
+		const std::vector<SGameSimulationShot>& GetTickShots() const { return m_tickShots; }
+		const std::vector<SGameSimulationSpawn>& GetTickSpawns() const { return m_tickSpawns; }
+
+	private:
+		struct SPlayer
+		{
+			SPlayerMovementState movement;
+			float yaw = 0.f;
+			float pitch = 0.f;
+			float nextFireTime = 0.f;
+			// Input is held for a while, like a human would
+			float moveX = 0.f;
+			float moveY = 0.f;
+			uint32_t inputTicksLeft = 0;
+			uint32_t random = 1;
+			CSpatialGrid::THandle spatialHandle = CSpatialGrid::kInvalidHandle;
+		};
+
+		// xorshift32, cheap and identical on every platform
+		static uint32_t NextRandom(SPlayer& player)
+		{
+			uint32_t value = player.random;
+			value ^= value << 13;
+			value ^= value >> 17;
+			value ^= value << 5;
+			return player.random = value;
+		}
+
+		// Uniform in [-1, 1]
+		static float NextSignedUnit(SPlayer& player)
+		{
+			return static_cast<float>(NextRandom(player) % 2001) / 1000.f - 1.f;
+		}
+
+		SVec3f GetHitCenter(const SPlayer& player) const
+		{
+			return player.movement.position + SVec3f(0.f, 0.f, m_params.playerRadius);
+		}
+
+		SPlayerInputCommand SampleInput(SPlayer& player)
+		{
+			if (player.inputTicksLeft == 0)
+			{
+				player.moveX = static_cast<float>(static_cast<int32_t>(NextRandom(player) % 3) - 1);
+				player.moveY = static_cast<float>(static_cast<int32_t>(NextRandom(player) % 3) - 1);
+				player.inputTicksLeft = 15 + NextRandom(player) % 60;
+			}
+			--player.inputTicksLeft;
+
+			SPlayerInputCommand command;
+			command.frameTime = m_timeStep;
+			command.moveX = player.moveX;
+			command.moveY = player.moveY;
+
+			// Random numbers are drawn in separate statements, the evaluation order of arguments differs between compilers
+			const bool isJumping = NextRandom(player) % 120 == 0;
+			const bool isWalking = NextRandom(player) % 4 == 0;
+			command.flags = static_cast<uint8_t>((isJumping ? ePlayerInputFlag_Jump : 0) | (isWalking ? ePlayerInputFlag_Walk : 0));
+
+			// Mouse deltas in pixels
+			const float mouseDeltaX = NextSignedUnit(player) * 20.f;
+			const float mouseDeltaY = NextSignedUnit(player) * 10.f;
+			ApplyLookInput(player.yaw, player.pitch, mouseDeltaX, mouseDeltaY, m_params.look);
+			command.yaw = player.yaw;
+			command.pitch = player.pitch;
+			return command;
+		}
+
+		void UpdatePlayer(uint32_t index, float time, const SPlayerInputCommand* pInputs)
+		{
+			SPlayer& player = m_players[index];
+
+			const SPlayerInputCommand command = pInputs != nullptr ? pInputs[index] : SampleInput(player);
+			if (pInputs != nullptr)
+			{
+				player.yaw = command.yaw;
+				player.pitch = command.pitch;
+			}
+			m_tickInputs[index] = command;
+			StepPlayerMovement(player.movement, command, m_params.movement);
+
+			const float halfSize = m_params.arenaSize * 0.5f;
+			player.movement.position.x = ClampValue(player.movement.position.x, -halfSize, halfSize);
+			player.movement.position.y = ClampValue(player.movement.position.y, -halfSize, halfSize);
+
+			m_grid.Move(player.spatialHandle, GetHitCenter(player));
+
+			if (m_params.fireInterval > 0.f && time >= player.nextFireTime)
+			{
+				player.nextFireTime = time + m_params.fireInterval;
+
+				const SVec3f muzzle = player.movement.position + SVec3f(0.f, 0.f, m_params.eyeHeight);
+				const SProjectileLaunch launch = ComputeProjectileLaunch(muzzle, GetLookDirection(player.yaw, player.pitch), m_params.muzzleSpeed);
+				m_projectiles.Add(launch.position.x, launch.position.y, launch.position.z, launch.velocity.x, launch.velocity.y, launch.velocity.z, m_params.projectileLifetime, index);
+				m_tickShots.push_back(SGameSimulationShot { index, muzzle, player.yaw, player.pitch });
+				++m_statistics.shotsFired;
+			}
+		}
+
+		void UpdateProjectiles()
+		{
+			m_projectiles.Integrate(m_timeStep, 0.f, 0.f, m_params.movement.gravity);
+
+			// Walk backwards so that swap-removal only moves projectiles that were already tested
+			for (std::size_t i = m_projectiles.Size(); i-- > 0;)
+			{
+				const SVec3f from(m_projectiles.GetPreviousX(i), m_projectiles.GetPreviousY(i), m_projectiles.GetPreviousZ(i));
+				const SVec3f to(m_projectiles.GetPositionX(i), m_projectiles.GetPositionY(i), m_projectiles.GetPositionZ(i));
+				const uint32_t owner = m_projectiles.GetOwner(i);
+
+				const uint32_t victim = TraceProjectile(from, to, owner);
+				if (victim != kNoPlayer)
+				{
+					m_tickHits.push_back(SGameSimulationHit { owner, victim });
+					++m_statistics.hits;
+					Respawn(victim);
+				}
+
+				// The ground is an infinite plane at zero height
+				if (victim != kNoPlayer || to.z < 0.f || m_projectiles.GetLifetime(i) <= 0.f)
+				{
+					m_projectiles.RemoveSwap(i);
+				}
+			}
+		}
+
+		// Returns the first player other than the owner along the segment
+		uint32_t TraceProjectile(const SVec3f& from, const SVec3f& to, uint32_t owner) const
+		{
+			const SVec3f delta = to - from;
+			const float length = delta.GetLength();
+			if (length <= 0.f)
+			{
+				return kNoPlayer;
+			}
+
+			const SVec3f direction = delta * (1.f / length);
+			const SVec3f boxMin(std::fmin(from.x, to.x), std::fmin(from.y, to.y), std::fmin(from.z, to.z));
+			const SVec3f boxMax(std::fmax(from.x, to.x), std::fmax(from.y, to.y), std::fmax(from.z, to.z));
+
+			uint32_t victim = kNoPlayer;
+			float closestDistance = length;
+			m_grid.QueryBox(boxMin, boxMax, kPlayerTypeMask, [&](const SSpatialObject& object)
+			{
+				if (object.userId == owner)
+				{
+					return;
+				}
+
+				const float distance = IntersectRaySphere(from, direction, object.position, object.radius);
+				// Ties go to the lower index so that the result doesn't depend on the iteration order of the grid
+				if (distance >= 0.f && (distance < closestDistance || (distance == closestDistance && object.userId < victim)))
+				{
+					closestDistance = distance;
+					victim = object.userId;
+				}
+			});
+
+			return victim;
+		}
+
+		void Respawn(uint32_t index)
+		{
+			SPlayer& player = m_players[index];
+
+			const std::size_t spawnIndex = SelectSpawnPoint(ESpawnSelectionPolicy::FarthestFromEnemies, index);
+			player.movement = SPlayerMovementState();
+			player.movement.position = m_spawnPoints[spawnIndex].position;
+			m_grid.Move(player.spatialHandle, GetHitCenter(player));
+			m_tickSpawns.push_back(SGameSimulationSpawn { index, static_cast<uint32_t>(spawnIndex) });
+
+			++m_statistics.respawns;
+		}
+
+		std::size_t SelectSpawnPoint(ESpawnSelectionPolicy policy, uint32_t spawningIndex)
+		{
+			const float searchRadius = m_params.spawnEnemySearchRadius;
+
+			const std::size_t index = SelectSpawnCandidate(policy, m_spawnPoints.data(), m_spawnPoints.size(), m_nextRoundRobinIndex,
+				[&](const SVec3f& position)
+				{
+					float closestDistanceSquared = searchRadius * searchRadius;
+					m_grid.QueryRadius(position, searchRadius, kPlayerTypeMask, [&](const SSpatialObject& object)
+					{
+						if (object.userId != spawningIndex)
+						{
+							closestDistanceSquared = std::fmin(closestDistanceSquared, (object.position - position).GetLengthSquared());
+						}
+					});
+					return closestDistanceSquared;
+				},
+				[](std::size_t count) { return count - 1; });
+
+			m_spawnPoints[index].lastUsedTime = static_cast<float>(m_statistics.ticks) * m_timeStep;
+			return index;
+		}
+
+	private:
+		static constexpr uint32_t kNoPlayer = ~0u;
+
+		SGameSimulationParams m_params;
+		float m_timeStep;
+
+		std::vector<SPlayer> m_players;
+		std::vector<SSpawnCandidate> m_spawnPoints;
+		std::size_t m_nextRoundRobinIndex = 0;
+
+		// Declared before its users so that it outlives them
+		CLinearArena m_arena;
+		CProjectileStore m_projectiles;
+		CSpatialGrid m_grid;
+
+		SGameSimulationStatistics m_statistics;
+		std::vector<SGameSimulationHit> m_tickHits;
+		std::vector<SPlayerInputCommand> m_tickInputs;
+		std::vector<SGameSimulationShot> m_tickShots;
+		std::vector<SGameSimulationSpawn> m_tickSpawns;
+	};
+}
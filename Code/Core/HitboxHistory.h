@@ -0,0 +1,295 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+#pragma once
+
+// Rewindable hitbox poses for server-side hit validation
+// The server records where every player's hitboxes were at each tick, so that a shot can be tested
+// against the poses the shooter actually saw instead of the current ones.
+
+#include "CoreMath.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace Game
+{
+	// Line segment swept by a sphere, in world space
+	struct SHitboxCapsule
+	{
+		SVec3f start;
+		SVec3f end;
+		float radius = 0.f;
+	};
+
+	constexpr std::size_t kMaxHitboxesPerPose = 12;
+
+	struct SHitboxPose
+	{
+		float time = 0.f;
+		uint32_t count = 0;
+		// Sphere around all capsules, rays that miss it skip the capsule tests
+		SVec3f boundsCenter;
+		float boundsRadius = 0.f;
+		std::array<SHitboxCapsule, kMaxHitboxesPerPose> capsules;
+
+		// Capsules with a zero radius are placeholders for hitboxes that don't exist and are ignored
+		void UpdateBounds()
+		{
+			bool hasBounds = false;
+			SVec3f minimum;
+			SVec3f maximum;
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				if (capsules[i].radius <= 0.f)
+				{
+					continue;
+				}
+
+				for (const SVec3f& point : { capsules[i].start, capsules[i].end })
+				{
+					minimum = hasBounds ? SVec3f(std::fmin(minimum.x, point.x), std::fmin(minimum.y, point.y), std::fmin(minimum.z, point.z)) : point;
+					maximum = hasBounds ? SVec3f(std::fmax(maximum.x, point.x), std::fmax(maximum.y, point.y), std::fmax(maximum.z, point.z)) : point;
+					hasBounds = true;
+				}
+			}
+
+			boundsCenter = (minimum + maximum) * 0.5f;
+			boundsRadius = 0.f;
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				if (capsules[i].radius > 0.f)
+				{
+					const float startDistance = (capsules[i].start - boundsCenter).GetLength();
+					const float endDistance = (capsules[i].end - boundsCenter).GetLength();
+					boundsRadius = std::fmax(boundsRadius, std::fmax(startDistance, endDistance) + capsules[i].radius);
+				}
+			}
+		}
+	};
+
+	// Distance along a normalized ray to the first intersection with the sphere, negative if there is none
+	// A ray that starts inside the sphere hits it at distance zero.
+	inline float IntersectRaySphere(const SVec3f& origin, const SVec3f& direction, const SVec3f& center, float radius)
+	{
+		const SVec3f offset = origin - center;
+		const float b = offset.Dot(direction);
+		const float c = offset.GetLengthSquared() - radius * radius;
+		if (c <= 0.f)
+		{
+			return 0.f;
+		}
+
+		const float discriminant = b * b - c;
+		if (b > 0.f || discriminant < 0.f)
+		{
+			return -1.f;
+		}
+
+		return -b - std::sqrt(discriminant);
+	}
+
+	// Distance along a normalized ray to the first intersection with the capsule, negative if there is none
+	inline float IntersectRayCapsule(const SVec3f& origin, const SVec3f& direction, const SHitboxCapsule& capsule)
+	{
+		float closest = -1.f;
+		const auto consider = [&closest](float distance)
+		{
+			if (distance >= 0.f && (closest < 0.f || distance < closest))
+			{
+				closest = distance;
+			}
+		};
+
+		// Cylindrical body, only where the closest point on the axis lies between the end points
+		const SVec3f axis = capsule.end - capsule.start;
+		const SVec3f offset = origin - capsule.start;
+		const float axisLengthSquared = axis.GetLengthSquared();
+		const float axisDotDirection = axis.Dot(direction);
+		const float axisDotOffset = axis.Dot(offset);
+
+		const float a = axisLengthSquared - axisDotDirection * axisDotDirection;
+		if (a > 1e-6f * axisLengthSquared)
+		{
+			const float b = axisLengthSquared * offset.Dot(direction) - axisDotOffset * axisDotDirection;
+			const float c = axisLengthSquared * offset.GetLengthSquared() - axisDotOffset * axisDotOffset - capsule.radius * capsule.radius * axisLengthSquared;
+			const float discriminant = b * b - a * c;
+			if (discriminant >= 0.f)
+			{
+				const float distance = (-b - std::sqrt(discriminant)) / a;
+				const float axisPosition = axisDotOffset + distance * axisDotDirection;
+				if (axisPosition > 0.f && axisPosition < axisLengthSquared)
+				{
+					consider(distance);
+				}
+			}
+		}
+
+		// Hemispherical caps
+		consider(IntersectRaySphere(origin, direction, capsule.start, capsule.radius));
+		consider(IntersectRaySphere(origin, direction, capsule.end, capsule.radius));
+
+		return closest;
+	}
+
+	inline SHitboxCapsule LerpCapsule(const SHitboxCapsule& from, const SHitboxCapsule& to, float t)
+	{
+		SHitboxCapsule result;
+		result.start = from.start + (to.start - from.start) * t;
+		result.end = from.end + (to.end - from.end) * t;
+		result.radius = from.radius + (to.radius - from.radius) * t;
+		return result;
+	}
+
+	////////////////////////////////////////////////////////
+	// Fixed-capacity ring of hitbox poses of one player, ordered by time
+	// Recording never allocates. Looking up a time is a binary search over the ring followed by
+	// an interpolation between the two poses around it.
+	////////////////////////////////////////////////////////
+	template<std::size_t Capacity>
+	class CHitboxHistory
+	{
+	public:
+		// Poses closer together than this replace each other, so high frame rates don't shorten the history
+		static constexpr float kMinSampleInterval = 1.f / 120.f;
+
+		void Record(float time, const SHitboxCapsule* pCapsules, uint32_t count)
+		{
+			if (m_count > 0 && time < GetNewest().time + kMinSampleInterval)
+			{
+				if (time < GetNewest().time)
+				{
+					return;
+				}
+
+				// Keep the most recent pose of a burst of short frames
+				--m_count;
+			}
+
+			SHitboxPose& pose = m_poses[(m_first + m_count) % Capacity];
+			if (m_count < Capacity)
+			{
+				++m_count;
+			}
+			else
+			{
+				m_first = (m_first + 1) % Capacity;
+			}
+
+			pose.time = time;
+			pose.count = count < kMaxHitboxesPerPose ? count : static_cast<uint32_t>(kMaxHitboxesPerPose);
+			for (uint32_t i = 0; i < pose.count; ++i)
+			{
+				pose.capsules[i] = pCapsules[i];
+			}
+			pose.UpdateBounds();
+		}
+
+		// Pose at the given time, clamped to the recorded range
+		// Capsules are matched by index, so every pose of a player has to list its hitboxes in the same order.
+		bool Sample(float time, SHitboxPose& outPose) const
+		{
+			if (m_count == 0)
+			{
+				return false;
+			}
+
+			if (time <= GetPose(0).time || m_count == 1)
+			{
+				outPose = GetPose(0);
+				return true;
+			}
+
+			if (time >= GetNewest().time)
+			{
+				outPose = GetNewest();
+				return true;
+			}
+
+			// First pose that is newer than the requested time, the one before it is older or equal
+			std::size_t low = 1;
+			std::size_t high = m_count - 1;
+			while (low < high)
+			{
+				const std::size_t middle = (low + high) / 2;
+				if (GetPose(middle).time > time)
+				{
+					high = middle;
+				}
+				else
+				{
+					low = middle + 1;
+				}
+			}
+
+			const SHitboxPose& from = GetPose(low - 1);
+			const SHitboxPose& to = GetPose(low);
+			const float t = (time - from.time) / (to.time - from.time);
+
+			outPose.time = time;
+			outPose.count = from.count < to.count ? from.count : to.count;
+			for (uint32_t i = 0; i < outPose.count; ++i)
+			{
+				outPose.capsules[i] = LerpCapsule(from.capsules[i], to.capsules[i], t);
+			}
+			outPose.UpdateBounds();
+			return true;
+		}
+
+		void Clear()
+		{
+			m_first = 0;
+			m_count = 0;
+		}
+
+		bool IsEmpty() const { return m_count == 0; }
+		std::size_t GetCount() const { return m_count; }
+		float GetOldestTime() const { return m_count > 0 ? GetPose(0).time : 0.f; }
+		float GetNewestTime() const { return m_count > 0 ? GetNewest().time : 0.f; }
+
+		static constexpr std::size_t GetCapacity() { return Capacity; }
+
+	private:
+		// Index 0 is the oldest pose
+		const SHitboxPose& GetPose(std::size_t index) const { return m_poses[(m_first + index) % Capacity]; }
+		const SHitboxPose& GetNewest() const { return GetPose(m_count - 1); }
+
+	private:
+		std::array<SHitboxPose, Capacity> m_poses;
+		std::size_t m_first = 0;
+		std::size_t m_count = 0;
+	};
+
+	// Distance to the closest hitbox of the pose that the ray hits within maxDistance, negative if none
+	inline float IntersectRayPose(const SVec3f& origin, const SVec3f& direction, float maxDistance, const SHitboxPose& pose, uint32_t& outHitboxIndex)
+	{
+		if (pose.boundsRadius <= 0.f)
+		{
+			return -1.f;
+		}
+
+		const float boundsDistance = IntersectRaySphere(origin, direction, pose.boundsCenter, pose.boundsRadius);
+		if (boundsDistance < 0.f || boundsDistance > maxDistance)
+		{
+			return -1.f;
+		}
+
+		float closest = -1.f;
+		for (uint32_t i = 0; i < pose.count; ++i)
+		{
+			if (pose.capsules[i].radius <= 0.f)
+			{
+				continue;
+			}
+
+			const float distance = IntersectRayCapsule(origin, direction, pose.capsules[i]);
+			if (distance >= 0.f && distance <= maxDistance && (closest < 0.f || distance < closest))
+			{
+				closest = distance;
+				outHitboxIndex = i;
+			}
+		}
+
+		return closest;
+	}
+}
@@ -0,0 +1,246 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+#pragma once
+
+// Impacts of one frame, collected from every projectile and resolved to effects in one pass
+// The effect of an impact only depends on the surfaces that touched, so it is looked up in a table built once per
+// level instead of asking the material effects for every impact. Impacts that play the same effect in the same
+// place within a frame are merged, and the effects that remain are limited to a rate the audio and particle
+// systems can keep up with.
+
+#include "CoreMath.h"
+#include "ObjectPool.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Game
+{
+	struct SImpact
+	{
+		SVec3f position;
+		SVec3f normal;
+		int32_t targetSurfaceId = 0;
+		// Bullet or shooter and the entity that was hit, passed through to the effect
+		uint32_t sourceId = 0;
+		uint32_t targetId = 0;
+	};
+
+	struct SResolvedImpact
+	{
+		// Index into the impacts of the frame
+		uint32_t impactIndex = 0;
+		uint32_t effectId = 0;
+		// Impacts merged into this one, itself included
+		uint32_t count = 1;
+	};
+
+	////////////////////////////////////////////////////////
+	// Effect of every target surface for one source surface
+	// Surface ids are small and dense, so the table is a flat array indexed by the target surface id.
+	////////////////////////////////////////////////////////
+	class CSurfaceEffectTable
+	{
+	public:
+		static constexpr uint32_t kNoEffect = 0;
+
+		void Clear() { m_effects.clear(); }
+		void Set(int32_t targetSurfaceId, uint32_t effectId)
+		{
+			if (targetSurfaceId < 0)
+			{
+				return;
+			}
+			if (static_cast<std::size_t>(targetSurfaceId) >= m_effects.size())
+			{
+				m_effects.resize(static_cast<std::size_t>(targetSurfaceId) + 1, kNoEffect);
+			}
+			m_effects[static_cast<std::size_t>(targetSurfaceId)] = effectId;
+		}
+
+		uint32_t Get(int32_t targetSurfaceId) const
+		{
+			return targetSurfaceId >= 0 && static_cast<std::size_t>(targetSurfaceId) < m_effects.size() ? m_effects[static_cast<std::size_t>(targetSurfaceId)] : kNoEffect;
+		}
+
+		bool IsEmpty() const { return m_effects.empty(); }
+		std::size_t GetSurfaceCount() const { return m_effects.size(); }
+
+	private:
+		std::vector<uint32_t> m_effects;
+	};
+
+	////////////////////////////////////////////////////////
+	// Token bucket, allows bursts up to its capacity and the given rate on average
+	////////////////////////////////////////////////////////
+	class CRateLimiter
+	{
+	public:
+		void Refill(float deltaTime, float ratePerSecond, float capacity)
+		{
+			m_tokens += deltaTime * ratePerSecond;
+			m_tokens = m_tokens < capacity ? m_tokens : capacity;
+		}
+
+		bool TryTake()
+		{
+			if (m_tokens < 1.f)
+			{
+				return false;
+			}
+			m_tokens -= 1.f;
+			return true;
+		}
+
+		void Reset(float tokens) { m_tokens = tokens; }
+
+	private:
+		float m_tokens = 0.f;
+	};
+
+	////////////////////////////////////////////////////////
+	// Impact buffer of one frame
+	// The impacts are kept in a pool that takes its storage from the arena, Reserve up front and Release before the
+	// arena is reset. Push does not allocate, impacts over the reserved capacity are dropped.
+	////////////////////////////////////////////////////////
+	class CImpactBuffer
+	{
+	public:
+		CImpactBuffer() = default;
+		explicit CImpactBuffer(CLinearArena* pArena) : m_impacts(pArena) {}
+
+		// Does nothing while the buffer has storage
+		void Reserve(std::size_t capacity)
+		{
+			m_impacts.Reserve(capacity);
+			m_resolved.reserve(capacity);
+		}
+
+		// Gives the storage of the impacts back
+		void Release()
+		{
+			Clear();
+			m_impacts.Release();
+		}
+
+		// Returns false if the buffer is full
+		bool Push(const SImpact& impact) { return m_impacts.Create(impact) != nullptr; }
+
+		// Looks up the effect of every impact and merges impacts of the same effect whose positions fall into the same
+		// cell of mergeDistance. Impacts without an effect are dropped. Returns the number of impacts that remain.
+		std::size_t Resolve(const CSurfaceEffectTable& table, float mergeDistance)
+		{
+			m_resolved.clear();
+
+			const std::size_t impactCount = m_impacts.GetUsedSlotCount();
+			const std::size_t bucketCount = GetBucketCount(impactCount);
+			if (m_buckets.size() < bucketCount)
+			{
+				m_buckets.resize(bucketCount);
+			}
+			for (std::size_t i = 0; i < bucketCount; ++i)
+			{
+				m_buckets[i] = kEmptyBucket;
+			}
+
+			const float inverseCellSize = mergeDistance > 0.f ? 1.f / mergeDistance : 0.f;
+
+			for (std::size_t i = 0; i < impactCount; ++i)
+			{
+				const SImpact& impact = m_impacts.Get(i);
+				const uint32_t effectId = table.Get(impact.targetSurfaceId);
+				if (effectId == CSurfaceEffectTable::kNoEffect)
+				{
+					continue;
+				}
+
+				if (inverseCellSize > 0.f)
+				{
+					const int32_t cellX = static_cast<int32_t>(std::floor(impact.position.x * inverseCellSize));
+					const int32_t cellY = static_cast<int32_t>(std::floor(impact.position.y * inverseCellSize));
+					const int32_t cellZ = static_cast<int32_t>(std::floor(impact.position.z * inverseCellSize));
+
+					// Linear probing, the table is at most half full
+					std::size_t bucket = Hash(effectId, cellX, cellY, cellZ) & (bucketCount - 1);
+					bool isMerged = false;
+					while (m_buckets[bucket] != kEmptyBucket)
+					{
+						SResolvedImpact& resolved = m_resolved[m_buckets[bucket]];
+						const SImpact& other = m_impacts.Get(resolved.impactIndex);
+						if (resolved.effectId == effectId
+							&& static_cast<int32_t>(std::floor(other.position.x * inverseCellSize)) == cellX
+							&& static_cast<int32_t>(std::floor(other.position.y * inverseCellSize)) == cellY
+							&& static_cast<int32_t>(std::floor(other.position.z * inverseCellSize)) == cellZ)
+						{
+							++resolved.count;
+							isMerged = true;
+							break;
+						}
+						bucket = (bucket + 1) & (bucketCount - 1);
+					}
+
+					if (isMerged)
+					{
+						++m_mergedCount;
+						continue;
+					}
+					m_buckets[bucket] = static_cast<uint32_t>(m_resolved.size());
+				}
+
+				SResolvedImpact resolved;
+				resolved.impactIndex = static_cast<uint32_t>(i);
+				resolved.effectId = effectId;
+				m_resolved.push_back(resolved);
+			}
+
+			return m_resolved.size();
+		}
+
+		// Empties the buffer for the next frame, keeping its memory
+		void Clear()
+		{
+			m_impacts.DestroyAll();
+			m_resolved.clear();
+			m_mergedCount = 0;
+		}
+
+		// Impacts are only ever removed all at once, so they sit at the pool slots in the order they were pushed
+		std::size_t GetCount() const { return m_impacts.GetLiveCount(); }
+		const SImpact& GetImpact(std::size_t index) const { return m_impacts.Get(index); }
+		const std::vector<SResolvedImpact>& GetResolved() const { return m_resolved; }
+		// Impacts merged into another one by the last Resolve
+		std::size_t GetMergedCount() const { return m_mergedCount; }
+		// Live impacts are the ones of the current frame, failed ones were dropped because the buffer was full
+		SObjectPoolStatistics GetStatistics() const { return m_impacts.GetStatistics(); }
+
+	private:
+		static constexpr uint32_t kEmptyBucket = ~0u;
+
+		static std::size_t GetBucketCount(std::size_t impactCount)
+		{
+			std::size_t bucketCount = 16;
+			while (bucketCount < impactCount * 2)
+			{
+				bucketCount *= 2;
+			}
+			return bucketCount;
+		}
+
+		static std::size_t Hash(uint32_t effectId, int32_t cellX, int32_t cellY, int32_t cellZ)
+		{
+			uint32_t hash = effectId * 0x9E3779B1u;
+			hash ^= static_cast<uint32_t>(cellX) * 0x85EBCA77u;
+			hash ^= static_cast<uint32_t>(cellY) * 0xC2B2AE3Du;
+			hash ^= static_cast<uint32_t>(cellZ) * 0x27D4EB2Fu;
+			return static_cast<std::size_t>(hash ^ (hash >> 15));
+		}
+
+	private:
+		CObjectPool<SImpact> m_impacts;
+		std::vector<SResolvedImpact> m_resolved;
+		std::vector<uint32_t> m_buckets;
+		std::size_t m_mergedCount = 0;
+	};
+}
@@ -0,0 +1,275 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+#pragma once
+
+// Compact wire format for SPlayerInputCommand
+// A packet carries the newest few commands with consecutive sequence numbers, so that a lost packet is
+// covered by the next one without retransmission. Every command is delta encoded against its predecessor,
+// the oldest one against the last command the receiver acknowledged.
+
+#include "BitStream.h"
+#include "PlayerMovement.h"
+
+namespace Game
+{
+	// Same meaning as the min/max/nbits of an axis of a QuantizedVec3 policy in Scripts/network/CompressionPolicy.xml
+	struct SQuantizationParams
+	{
+		float minValue;
+		float maxValue;
+		uint32_t bitCount;
+
+		// One code is left unused so that the number of steps is even and the midpoint of the range, e.g. zero, is exact
+		constexpr uint32_t GetStepCount() const { return (1u << bitCount) - 2; }
+	};
+
+	inline uint32_t Quantize(float value, const SQuantizationParams& params)
+	{
+		const float normalized = ClampValue((value - params.minValue) / (params.maxValue - params.minValue), 0.f, 1.f);
+		return static_cast<uint32_t>(normalized * static_cast<float>(params.GetStepCount()) + 0.5f);
+	}
+
+	inline float Dequantize(uint32_t quantized, const SQuantizationParams& params)
+	{
+		return params.minValue + (params.maxValue - params.minValue) * (static_cast<float>(quantized) / static_cast<float>(params.GetStepCount()));
+	}
+
+	namespace InputCommandCodec
+	{
+		constexpr SQuantizationParams kMoveAxis = { -1.f, 1.f, 6 };
+		constexpr SQuantizationParams kYaw = { -3.14159265f, 3.14159265f, 16 };
+		constexpr SQuantizationParams kPitch = { -1.57079633f, 1.57079633f, 14 };
+		constexpr uint32_t kFlagBits = 8;
+		// Look changes within +-63 steps, i.e. regular mouse movement at 60 Hz, are sent as a small signed delta
+		constexpr uint32_t kLookDeltaBits = 7;
+		constexpr uint32_t kCountBits = 3;
+		// Once a baseline exists only the low bits of the sequence are sent, see ExpandSequence
+		constexpr uint32_t kShortSequenceBits = 16;
+
+		constexpr uint32_t kMaxCommandsPerPacket = 1u << kCountBits;
+		constexpr std::size_t kMaxPacketBytes = 96;
+
+		struct SQuantizedCommand
+		{
+			uint32_t moveX = 0;
+			uint32_t moveY = 0;
+			uint32_t yaw = 0;
+			uint32_t pitch = 0;
+			uint32_t flags = 0;
+		};
+
+		inline SQuantizedCommand QuantizeCommand(const SPlayerInputCommand& command)
+		{
+			SQuantizedCommand quantized;
+			quantized.moveX = Quantize(command.moveX, kMoveAxis);
+			quantized.moveY = Quantize(command.moveY, kMoveAxis);
+			quantized.yaw = Quantize(command.yaw, kYaw);
+			quantized.pitch = Quantize(command.pitch, kPitch);
+			quantized.flags = command.flags;
+			return quantized;
+		}
+
+		inline void DequantizeCommand(const SQuantizedCommand& quantized, SPlayerInputCommand& command)
+		{
+			command.moveX = Dequantize(quantized.moveX, kMoveAxis);
+			command.moveY = Dequantize(quantized.moveY, kMoveAxis);
+			command.yaw = Dequantize(quantized.yaw, kYaw);
+			command.pitch = Dequantize(quantized.pitch, kPitch);
+			command.flags = static_cast<uint8_t>(quantized.flags);
+		}
+
+		// The command exactly as the receiver will decode it
+		// Senders predict with this version, so that client and server simulate identical input.
+		inline SPlayerInputCommand RoundTripCommand(const SPlayerInputCommand& command)
+		{
+			SPlayerInputCommand result = command;
+			DequantizeCommand(QuantizeCommand(command), result);
+			return result;
+		}
+
+		namespace Detail
+		{
+			inline void WriteField(CBitWriter& writer, uint32_t value, uint32_t previous, uint32_t bitCount)
+			{
+				writer.WriteBool(value != previous);
+				if (value != previous)
+				{
+					writer.WriteBits(value, bitCount);
+				}
+			}
+
+			inline uint32_t ReadField(CBitReader& reader, uint32_t previous, uint32_t bitCount)
+			{
+				return reader.ReadBool() ? reader.ReadBits(bitCount) : previous;
+			}
+
+			inline void WriteLookField(CBitWriter& writer, uint32_t value, uint32_t previous, uint32_t bitCount)
+			{
+				writer.WriteBool(value != previous);
+				if (value == previous)
+				{
+					return;
+				}
+
+				const int32_t delta = static_cast<int32_t>(value) - static_cast<int32_t>(previous);
+				const int32_t deltaLimit = (1 << (kLookDeltaBits - 1)) - 1;
+				const bool isSmall = delta >= -deltaLimit && delta <= deltaLimit;
+
+				writer.WriteBool(isSmall);
+				if (isSmall)
+				{
+					writer.WriteBits(static_cast<uint32_t>(delta + deltaLimit), kLookDeltaBits);
+				}
+				else
+				{
+					writer.WriteBits(value, bitCount);
+				}
+			}
+
+			inline uint32_t ReadLookField(CBitReader& reader, uint32_t previous, uint32_t bitCount)
+			{
+				if (!reader.ReadBool())
+				{
+					return previous;
+				}
+
+				if (reader.ReadBool())
+				{
+					const int32_t deltaLimit = (1 << (kLookDeltaBits - 1)) - 1;
+					const int32_t delta = static_cast<int32_t>(reader.ReadBits(kLookDeltaBits)) - deltaLimit;
+					return static_cast<uint32_t>(static_cast<int32_t>(previous) + delta);
+				}
+
+				return reader.ReadBits(bitCount);
+			}
+
+			inline void WriteCommand(CBitWriter& writer, const SQuantizedCommand& command, const SQuantizedCommand& previous)
+			{
+				WriteField(writer, command.moveX, previous.moveX, kMoveAxis.bitCount);
+				WriteField(writer, command.moveY, previous.moveY, kMoveAxis.bitCount);
+				WriteLookField(writer, command.yaw, previous.yaw, kYaw.bitCount);
+				WriteLookField(writer, command.pitch, previous.pitch, kPitch.bitCount);
+				WriteField(writer, command.flags, previous.flags, kFlagBits);
+			}
+
+			inline SQuantizedCommand ReadCommand(CBitReader& reader, const SQuantizedCommand& previous)
+			{
+				SQuantizedCommand command;
+				command.moveX = ReadField(reader, previous.moveX, kMoveAxis.bitCount);
+				command.moveY = ReadField(reader, previous.moveY, kMoveAxis.bitCount);
+				command.yaw = ReadLookField(reader, previous.yaw, kYaw.bitCount);
+				command.pitch = ReadLookField(reader, previous.pitch, kPitch.bitCount);
+				command.flags = ReadField(reader, previous.flags, kFlagBits);
+				return command;
+			}
+
+			// Corrupt data can decode to codes past the end of a range, e.g. a look delta that wraps below zero
+			inline bool IsInRange(const SQuantizedCommand& command)
+			{
+				return command.moveX <= kMoveAxis.GetStepCount() && command.moveY <= kMoveAxis.GetStepCount()
+					&& command.yaw <= kYaw.GetStepCount() && command.pitch <= kPitch.GetStepCount();
+			}
+
+			// Reconstructs a full sequence number from its low bits, picking the candidate closest to the reference
+			inline uint32_t ExpandSequence(uint32_t shortSequence, uint32_t referenceSequence)
+			{
+				const uint32_t mask = (1u << kShortSequenceBits) - 1;
+				const int32_t difference = static_cast<int16_t>(static_cast<uint16_t>((shortSequence - referenceSequence) & mask));
+				return referenceSequence + static_cast<uint32_t>(difference);
+			}
+		}
+
+		// Encodes commands with consecutive sequence numbers, oldest first
+		// pBaseline is the newest command the receiver has acknowledged, or nullptr if there is none yet.
+		// Returns the number of bytes written, or 0 if the packet did not fit.
+		inline std::size_t EncodePacket(const SPlayerInputCommand* pCommands, std::size_t count, const SPlayerInputCommand* pBaseline, uint8_t* pBuffer, std::size_t capacity)
+		{
+			if (count == 0 || count > kMaxCommandsPerPacket)
+			{
+				return 0;
+			}
+
+			CBitWriter writer(pBuffer, capacity);
+
+			const uint32_t newestSequence = pCommands[count - 1].sequence;
+			const bool hasBaseline = pBaseline != nullptr && pBaseline->sequence < pCommands[0].sequence;
+
+			writer.WriteBool(hasBaseline);
+			if (hasBaseline)
+			{
+				writer.WriteBits(newestSequence & ((1u << kShortSequenceBits) - 1), kShortSequenceBits);
+				writer.WriteVarUInt(newestSequence - pBaseline->sequence);
+			}
+			else
+			{
+				writer.WriteBits(newestSequence, 32);
+			}
+			writer.WriteBits(static_cast<uint32_t>(count - 1), kCountBits);
+
+			SQuantizedCommand previous = QuantizeCommand(hasBaseline ? *pBaseline : SPlayerInputCommand());
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				const SQuantizedCommand quantized = QuantizeCommand(pCommands[i]);
+				Detail::WriteCommand(writer, quantized, previous);
+				previous = quantized;
+			}
+
+			return writer.HasOverflowed() ? 0 : writer.GetByteCount();
+		}
+
+		// Decodes a packet written by EncodePacket into pOutCommands, oldest first
+		// latestReceivedSequence is the newest sequence the receiver has seen so far and anchors short sequence numbers.
+		// lookupBaseline(sequence) returns the previously received command with that sequence, or nullptr.
+		// Returns the number of decoded commands, 0 if the packet is corrupt or its baseline is unknown. Never reads past size.
+		template<typename TBaselineLookup>
+		std::size_t DecodePacket(const uint8_t* pData, std::size_t size, uint32_t latestReceivedSequence, TBaselineLookup&& lookupBaseline, SPlayerInputCommand* pOutCommands, std::size_t capacity)
+		{
+			CBitReader reader(pData, size);
+
+			const bool hasBaseline = reader.ReadBool();
+			uint32_t newestSequence = 0;
+			const SPlayerInputCommand* pBaseline = nullptr;
+
+			if (hasBaseline)
+			{
+				newestSequence = Detail::ExpandSequence(reader.ReadBits(kShortSequenceBits), latestReceivedSequence);
+				const uint32_t baselineDistance = reader.ReadVarUInt();
+
+				pBaseline = lookupBaseline(newestSequence - baselineDistance);
+				if (pBaseline == nullptr)
+				{
+					return 0;
+				}
+			}
+			else
+			{
+				newestSequence = reader.ReadBits(32);
+			}
+
+			const std::size_t count = reader.ReadBits(kCountBits) + 1;
+			if (count > capacity || reader.HasOverflowed())
+			{
+				return 0;
+			}
+
+			SQuantizedCommand previous = QuantizeCommand(hasBaseline ? *pBaseline : SPlayerInputCommand());
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				const SQuantizedCommand quantized = Detail::ReadCommand(reader, previous);
+				if (!Detail::IsInRange(quantized))
+				{
+					return 0;
+				}
+
+				SPlayerInputCommand& command = pOutCommands[i];
+				command = SPlayerInputCommand();
+				command.sequence = newestSequence - static_cast<uint32_t>(count - 1 - i);
+				DequantizeCommand(quantized, command);
+
+				previous = quantized;
+			}
+
+			return reader.HasOverflowed() ? 0 : count;
+		}
+	}
+}
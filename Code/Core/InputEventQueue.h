@@ -0,0 +1,143 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+#pragma once
+
+// Timestamped raw input between the input callbacks and the simulation tick
+// Every event is kept until a tick consumes it, so mouse motion adds up exactly no matter how many events
+// arrive per frame and how many ticks run per frame.
+
+#include "SpscRing.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace Game
+{
+	enum class EInputEventType : uint8_t
+	{
+		// Relative mouse motion, summed per tick
+		LookX,
+		LookY,
+		// Absolute axis values in [0, 1], held until the next event of the same type
+		MoveForward,
+		MoveBack,
+		MoveRight,
+		MoveLeft,
+		// New state of all input flags, see EPlayerInputFlags
+		Flags
+	};
+
+	struct SInputEvent
+	{
+		// Seconds on the clock the consumer passes to Drain
+		double time = 0.0;
+		EInputEventType type = EInputEventType::LookX;
+		uint8_t flags = 0;
+		float value = 0.f;
+	};
+
+	// Input of one simulation tick
+	struct SAccumulatedInput
+	{
+		float lookDeltaX = 0.f;
+		float lookDeltaY = 0.f;
+		// Movement axes in [-1, 1], opposite keys cancel out
+		float moveX = 0.f;
+		float moveY = 0.f;
+		// Flags that were set at any time during the tick, so that a tap shorter than a tick still counts
+		uint8_t flags = 0;
+		uint32_t eventCount = 0;
+	};
+
+	////////////////////////////////////////////////////////
+	// Single producer, single consumer input queue
+	// The input callbacks push events, the simulation drains everything up to the end of each tick. Events
+	// that belong to a later tick stay queued. A full queue drops new events and counts them.
+	////////////////////////////////////////////////////////
+	template<std::size_t Capacity>
+	class CInputEventQueue
+	{
+	public:
+		// Producer thread only
+		void Push(const SInputEvent& event)
+		{
+			if (!m_ring.TryPush(event))
+			{
+				m_droppedCount.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+
+		// Consumer thread only, consumes all events with a time up to and including endTime
+		SAccumulatedInput Drain(double endTime)
+		{
+			SAccumulatedInput input;
+			input.flags = m_flags;
+
+			while (m_hasPendingEvent || m_ring.TryPop(m_pendingEvent))
+			{
+				if (m_pendingEvent.time > endTime)
+				{
+					m_hasPendingEvent = true;
+					break;
+				}
+
+				m_hasPendingEvent = false;
+				Apply(m_pendingEvent, input);
+				++input.eventCount;
+			}
+
+			input.moveX = m_moveRight - m_moveLeft;
+			input.moveY = m_moveForward - m_moveBack;
+			return input;
+		}
+
+		// Forgets queued events and held state, consumer thread only
+		void Reset()
+		{
+			SInputEvent event;
+			while (m_ring.TryPop(event)) {}
+
+			m_hasPendingEvent = false;
+			m_moveForward = m_moveBack = m_moveRight = m_moveLeft = 0.f;
+			m_flags = 0;
+		}
+
+		uint32_t GetDroppedCount() const { return m_droppedCount.load(std::memory_order_relaxed); }
+
+	private:
+		void Apply(const SInputEvent& event, SAccumulatedInput& input)
+		{
+			switch (event.type)
+			{
+			case EInputEventType::LookX:       input.lookDeltaX += event.value; break;
+			case EInputEventType::LookY:       input.lookDeltaY += event.value; break;
+			case EInputEventType::MoveForward: m_moveForward = event.value; break;
+			case EInputEventType::MoveBack:    m_moveBack = event.value; break;
+			case EInputEventType::MoveRight:   m_moveRight = event.value; break;
+			case EInputEventType::MoveLeft:    m_moveLeft = event.value; break;
+			case EInputEventType::Flags:
+			{
+				m_flags = event.flags;
+				input.flags |= event.flags;
+				break;
+			}
+			}
+		}
+
+	private:
+		CSpscRing<SInputEvent, Capacity> m_ring;
+		std::atomic<uint32_t> m_droppedCount { 0 };
+
+		// First event of a later tick, taken out of the ring but not consumed yet
+		SInputEvent m_pendingEvent;
+		bool m_hasPendingEvent = false;
+
+		// Held state, carried over from tick to tick
+		float m_moveForward = 0.f;
+		float m_moveBack = 0.f;
+		float m_moveRight = 0.f;
+		float m_moveLeft = 0.f;
+		uint8_t m_flags = 0;
+	};
+}
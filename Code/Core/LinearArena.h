@@ -0,0 +1,162 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+#pragma once
+
+// Engine independent, only depends on the standard library so that it can be built and profiled outside of the game module
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+
+namespace Game
+{
+	struct SLinearArenaStatistics
+	{
+		std::size_t capacity = 0;
+		std::size_t usedBytes = 0;
+		// Highest usage since construction, survives Reset
+		std::size_t peakBytes = 0;
+		uint64_t allocationCount = 0;
+		// Requests that did not fit and went to the heap instead
+		uint64_t overflowCount = 0;
+		std::size_t overflowBytes = 0;
+		uint32_t generation = 0;
+	};
+
+	////////////////////////////////////////////////////////
+	// Bump allocator over one block that is allocated up front
+	// Allocation moves an offset forward, individual frees are no-ops and Reset releases everything at once by
+	// rewinding the offset, without touching the memory. Users have to drop their pointers before the Reset.
+	// Not thread safe, allocate from the owning thread only.
+	////////////////////////////////////////////////////////
+	class CLinearArena
+	{
+	public:
+		explicit CLinearArena(std::size_t capacity)
+			: m_pBlock(capacity > 0 ? static_cast<uint8_t*>(::operator new(capacity, std::align_val_t(kBlockAlignment))) : nullptr)
+			, m_capacity(capacity)
+		{
+		}
+
+		~CLinearArena()
+		{
+			if (m_pBlock != nullptr)
+			{
+				::operator delete(m_pBlock, std::align_val_t(kBlockAlignment));
+			}
+		}
+
+		CLinearArena(const CLinearArena&) = delete;
+		CLinearArena& operator=(const CLinearArena&) = delete;
+
+		// Returns nullptr if the arena is full, alignment has to be a power of two no larger than kBlockAlignment
+		void* Allocate(std::size_t size, std::size_t alignment)
+		{
+			const std::size_t offset = (m_offset + alignment - 1) & ~(alignment - 1);
+			if (offset + size > m_capacity || alignment > kBlockAlignment)
+			{
+				return nullptr;
+			}
+
+			m_offset = offset + size;
+			m_peakBytes = std::max(m_peakBytes, m_offset);
+			++m_allocationCount;
+			return m_pBlock + offset;
+		}
+
+		// Releases all allocations in O(1)
+		void Reset()
+		{
+			m_offset = 0;
+			++m_generation;
+		}
+
+		bool Owns(const void* pMemory) const
+		{
+			const uint8_t* pByte = static_cast<const uint8_t*>(pMemory);
+			return pByte >= m_pBlock && pByte < m_pBlock + m_capacity;
+		}
+
+		// Counts an allocation that was served by the heap because the arena was full
+		void NoteOverflow(std::size_t size)
+		{
+			++m_overflowCount;
+			m_overflowBytes += size;
+		}
+
+		SLinearArenaStatistics GetStatistics() const
+		{
+			SLinearArenaStatistics statistics;
+			statistics.capacity = m_capacity;
+			statistics.usedBytes = m_offset;
+			statistics.peakBytes = m_peakBytes;
+			statistics.allocationCount = m_allocationCount;
+			statistics.overflowCount = m_overflowCount;
+			statistics.overflowBytes = m_overflowBytes;
+			statistics.generation = m_generation;
+			return statistics;
+		}
+
+		static constexpr std::size_t kBlockAlignment = 64;
+
+	private:
+		uint8_t* const m_pBlock;
+		const std::size_t m_capacity;
+		std::size_t m_offset = 0;
+		std::size_t m_peakBytes = 0;
+		uint64_t m_allocationCount = 0;
+		uint64_t m_overflowCount = 0;
+		std::size_t m_overflowBytes = 0;
+		uint32_t m_generation = 0;
+	};
+
+	// Standard allocator taking its storage from a CLinearArena, or from the heap without one
+	// Requests that don't fit into the arena fall back to the heap as well, so a too small arena costs speed, not
+	// correctness. Containers using it have to release their storage before the arena is reset.
+	template<typename T, std::size_t Alignment = alignof(T)>
+	struct SArenaAllocator
+	{
+		using value_type = T;
+
+		template<typename U>
+		struct rebind { using other = SArenaAllocator<U, Alignment>; };
+
+		SArenaAllocator() = default;
+		explicit SArenaAllocator(CLinearArena* pArena_) : pArena(pArena_) {}
+		template<typename U>
+		SArenaAllocator(const SArenaAllocator<U, Alignment>& other) : pArena(other.pArena) {}
+
+		T* allocate(std::size_t count)
+		{
+			const std::size_t size = count * sizeof(T);
+			const std::size_t alignment = std::max(Alignment, alignof(T));
+
+			if (pArena != nullptr)
+			{
+				if (void* pMemory = pArena->Allocate(size, alignment))
+				{
+					return static_cast<T*>(pMemory);
+				}
+				pArena->NoteOverflow(size);
+			}
+			return static_cast<T*>(::operator new(size, std::align_val_t(alignment)));
+		}
+
+		void deallocate(T* pData, std::size_t)
+		{
+			if (pArena == nullptr || !pArena->Owns(pData))
+			{
+				::operator delete(pData, std::align_val_t(std::max(Alignment, alignof(T))));
+			}
+		}
+
+		template<typename U>
+		bool operator==(const SArenaAllocator<U, Alignment>& other) const { return pArena == other.pArena; }
+		template<typename U>
+		bool operator!=(const SArenaAllocator<U, Alignment>& other) const { return pArena != other.pArena; }
+
+		CLinearArena* pArena = nullptr;
+	};
+}
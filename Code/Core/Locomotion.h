@@ -0,0 +1,79 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+#pragma once
+
+// Engine independent locomotion parameters, derived from the movement state for the animation blend spaces
+// Angles follow the movement code: yaw turns around +Z starting from +Y, travel and turn angles are positive to the left.
+
+#include "CoreMath.h"
+#include "PlayerLook.h"
+
+#include <cstdint>
+
+namespace Game
+{
+	// Fragments of Animations/Mannequin/ADB/FirstPerson.adb
+	enum class ELocomotionFragment : uint8_t
+	{
+		Idle,
+		Walk
+	};
+
+	struct SLocomotionParams
+	{
+		// Below this horizontal speed the character stands, the lower end of the MoveSpeed dimension of the move blend space
+		float moveSpeedThreshold = 0.2f;
+		// Turn rate in rad/s above which the Rotate tag plays the step rotation blend space while standing
+		float turnRateThreshold = 0.174f;
+		// The step rotations take about a second, the turn angle is the rate extrapolated over that time
+		float turnDuration = 1.f;
+		// Time constant of the turn rate smoothing in seconds, mouse input arrives in bursts
+		float turnRateSmoothing = 0.1f;
+	};
+
+	struct SLocomotionState
+	{
+		// Motion parameters: horizontal speed, direction of travel relative to the body and expected turn
+		float travelSpeed = 0.f;
+		float travelAngle = 0.f;
+		float turnAngle = 0.f;
+
+		float turnRate = 0.f;
+		float lastYaw = 0.f;
+		bool hasLastYaw = false;
+
+		bool isTurning = false;
+		ELocomotionFragment fragment = ELocomotionFragment::Idle;
+	};
+
+	// Advances the locomotion state by deltaTime, which may span several frames for characters at a reduced animation LOD
+	inline void UpdateLocomotion(SLocomotionState& state, const SVec3f& velocity, float bodyYaw, float deltaTime, const SLocomotionParams& params)
+	{
+		// Into the body frame, the inverse of the rotation in ComputeDesiredVelocity
+		const float sinYaw = std::sin(bodyYaw);
+		const float cosYaw = std::cos(bodyYaw);
+		const float localX = velocity.x * cosYaw + velocity.y * sinYaw;
+		const float localY = velocity.y * cosYaw - velocity.x * sinYaw;
+
+		state.travelSpeed = std::sqrt(localX * localX + localY * localY);
+		const bool isMoving = state.travelSpeed > params.moveSpeedThreshold;
+		// Keep the last direction while standing, so that starting and stopping don't snap the blend
+		if (isMoving)
+		{
+			state.travelAngle = std::atan2(-localX, localY);
+		}
+
+		if (deltaTime > 0.f)
+		{
+			const float rate = state.hasLastYaw ? WrapAngle(bodyYaw - state.lastYaw) / deltaTime : 0.f;
+			const float blend = params.turnRateSmoothing > 0.f ? 1.f - std::exp(-deltaTime / params.turnRateSmoothing) : 1.f;
+			state.turnRate += (rate - state.turnRate) * blend;
+		}
+		state.lastYaw = bodyYaw;
+		state.hasLastYaw = true;
+
+		state.isTurning = std::fabs(state.turnRate) > params.turnRateThreshold;
+		state.turnAngle = state.isTurning ? ClampValue(state.turnRate * params.turnDuration, -kPi, kPi) : 0.f;
+		state.fragment = isMoving ? ELocomotionFragment::Walk : ELocomotionFragment::Idle;
+	}
+}
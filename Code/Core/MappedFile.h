@@ -0,0 +1,154 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+#pragma once
+
+// Read-only memory mapping of a whole file
+// Pages are loaded by the operating system on first access, so opening a large file is cheap and reading from it
+// needs no intermediate buffer.
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(_WIN32)
+	#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+namespace Game
+{
+	class CMappedFile
+	{
+	public:
+		CMappedFile() = default;
+		~CMappedFile() { Close(); }
+
+		CMappedFile(const CMappedFile&) = delete;
+		CMappedFile& operator=(const CMappedFile&) = delete;
+
+		// Fails for missing files, empty files can be opened but have no data
+		bool Open(const char* szPath)
+		{
+			Close();
+
+#if defined(_WIN32)
+			m_file = CreateFileA(szPath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+			if (m_file == INVALID_HANDLE_VALUE)
+			{
+				return false;
+			}
+
+			LARGE_INTEGER size;
+			if (!GetFileSizeEx(m_file, &size))
+			{
+				Close();
+				return false;
+			}
+
+			m_size = static_cast<std::size_t>(size.QuadPart);
+			if (m_size == 0)
+			{
+				return true;
+			}
+
+			m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (m_mapping == nullptr)
+			{
+				Close();
+				return false;
+			}
+
+			m_pData = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+			m_file = open(szPath, O_RDONLY);
+			if (m_file < 0)
+			{
+				return false;
+			}
+
+			struct stat status;
+			if (fstat(m_file, &status) != 0)
+			{
+				Close();
+				return false;
+			}
+
+			m_size = static_cast<std::size_t>(status.st_size);
+			if (m_size == 0)
+			{
+				return true;
+			}
+
+			void* pData = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_file, 0);
+			m_pData = pData != MAP_FAILED ? static_cast<const uint8_t*>(pData) : nullptr;
+#endif
+
+			if (m_pData == nullptr)
+			{
+				Close();
+				return false;
+			}
+			return true;
+		}
+
+		void Close()
+		{
+#if defined(_WIN32)
+			if (m_pData != nullptr)
+			{
+				UnmapViewOfFile(m_pData);
+			}
+			if (m_mapping != nullptr)
+			{
+				CloseHandle(m_mapping);
+				m_mapping = nullptr;
+			}
+			if (m_file != INVALID_HANDLE_VALUE)
+			{
+				CloseHandle(m_file);
+				m_file = INVALID_HANDLE_VALUE;
+			}
+#else
+			if (m_pData != nullptr)
+			{
+				munmap(const_cast<uint8_t*>(m_pData), m_size);
+			}
+			if (m_file >= 0)
+			{
+				close(m_file);
+				m_file = -1;
+			}
+#endif
+			m_pData = nullptr;
+			m_size = 0;
+		}
+
+		bool IsOpen() const
+		{
+#if defined(_WIN32)
+			return m_file != INVALID_HANDLE_VALUE;
+#else
+			return m_file >= 0;
+#endif
+		}
+
+		const uint8_t* GetData() const { return m_pData; }
+		std::size_t GetSize() const { return m_size; }
+
+	private:
+#if defined(_WIN32)
+		HANDLE m_file = INVALID_HANDLE_VALUE;
+		HANDLE m_mapping = nullptr;
+#else
+		int m_file = -1;
+#endif
+		const uint8_t* m_pData = nullptr;
+		std::size_t m_size = 0;
+	};
+}
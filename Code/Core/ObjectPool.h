@@ -0,0 +1,155 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+#pragma once
+
+// Fixed capacity pools of one object type, with their storage taken from a CLinearArena
+// Objects are created into free slots and destroyed back into them, so a pool never allocates after Reserve and
+// keeps count of its live objects. Engine independent, see LinearArena.h.
+
+#include "LinearArena.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace Game
+{
+	struct SObjectPoolStatistics
+	{
+		std::size_t capacity = 0;
+		std::size_t liveCount = 0;
+		// Highest live count since construction, survives Release
+		std::size_t peakLiveCount = 0;
+		// Objects that were not created because the pool was full or had no storage
+		uint64_t failedCount = 0;
+	};
+
+	////////////////////////////////////////////////////////
+	// Pool of up to a fixed number of objects of type T
+	// Free slots are kept in a list threaded through the slots themselves. Slots that were never used are handed
+	// out in order, so until an object is destroyed the objects sit at the slot indices they were created in and the
+	// pool can be walked like an array, see Get. The storage has to be released before the arena is reset.
+	////////////////////////////////////////////////////////
+	template<typename T>
+	class CObjectPool
+	{
+	public:
+		CObjectPool() = default;
+		explicit CObjectPool(CLinearArena* pArena) : m_allocator(pArena) {}
+
+		~CObjectPool()
+		{
+			Release();
+		}
+
+		CObjectPool(const CObjectPool&) = delete;
+		CObjectPool& operator=(const CObjectPool&) = delete;
+
+		// Takes the storage for capacity objects, from the heap if the arena is full. Does nothing while the pool has storage.
+		void Reserve(std::size_t capacity)
+		{
+			if (m_pSlots == nullptr && capacity > 0)
+			{
+				m_pSlots = m_allocator.allocate(capacity);
+				m_capacity = capacity;
+			}
+		}
+
+		// Gives the storage back, all objects have to be destroyed before
+		void Release()
+		{
+			if (m_pSlots != nullptr)
+			{
+				m_allocator.deallocate(m_pSlots, m_capacity);
+			}
+			m_pSlots = nullptr;
+			m_pFreeSlot = nullptr;
+			m_capacity = 0;
+			m_usedSlotCount = 0;
+			m_liveCount = 0;
+		}
+
+		bool HasStorage() const { return m_pSlots != nullptr; }
+
+		// Returns nullptr if the pool is full
+		template<typename... TArgs>
+		T* Create(TArgs&&... args)
+		{
+			SSlot* pSlot = m_pFreeSlot;
+			if (pSlot != nullptr)
+			{
+				m_pFreeSlot = pSlot->pNextFree;
+			}
+			else if (m_usedSlotCount < m_capacity)
+			{
+				pSlot = &m_pSlots[m_usedSlotCount++];
+			}
+			else
+			{
+				++m_failedCount;
+				return nullptr;
+			}
+
+			++m_liveCount;
+			m_peakLiveCount = m_liveCount > m_peakLiveCount ? m_liveCount : m_peakLiveCount;
+			return new (pSlot->storage) T(std::forward<TArgs>(args)...);
+		}
+
+		void Destroy(T* pObject)
+		{
+			pObject->~T();
+
+			SSlot* pSlot = reinterpret_cast<SSlot*>(pObject);
+			pSlot->pNextFree = m_pFreeSlot;
+			m_pFreeSlot = pSlot;
+			--m_liveCount;
+		}
+
+		// Destroys every object in O(1) and hands the slots out in order again, only for types without a destructor
+		void DestroyAll()
+		{
+			static_assert(std::is_trivially_destructible<T>::value, "Objects with a destructor have to be destroyed one by one");
+			m_pFreeSlot = nullptr;
+			m_usedSlotCount = 0;
+			m_liveCount = 0;
+		}
+
+		// Object in the given slot, only valid for slots below GetUsedSlotCount that hold a live object
+		T& Get(std::size_t index) { return *std::launder(reinterpret_cast<T*>(m_pSlots[index].storage)); }
+		const T& Get(std::size_t index) const { return *std::launder(reinterpret_cast<const T*>(m_pSlots[index].storage)); }
+		// Slots handed out so far, equal to the live count while nothing was destroyed one by one
+		std::size_t GetUsedSlotCount() const { return m_usedSlotCount; }
+
+		std::size_t GetLiveCount() const { return m_liveCount; }
+		std::size_t GetCapacity() const { return m_capacity; }
+
+		SObjectPoolStatistics GetStatistics() const
+		{
+			SObjectPoolStatistics statistics;
+			statistics.capacity = m_capacity;
+			statistics.liveCount = m_liveCount;
+			statistics.peakLiveCount = m_peakLiveCount;
+			statistics.failedCount = m_failedCount;
+			return statistics;
+		}
+
+	private:
+		union SSlot
+		{
+			SSlot* pNextFree;
+			alignas(T) unsigned char storage[sizeof(T)];
+		};
+
+	private:
+		SArenaAllocator<SSlot> m_allocator;
+		SSlot* m_pSlots = nullptr;
+		SSlot* m_pFreeSlot = nullptr;
+		std::size_t m_capacity = 0;
+		std::size_t m_usedSlotCount = 0;
+		std::size_t m_liveCount = 0;
+		std::size_t m_peakLiveCount = 0;
+		uint64_t m_failedCount = 0;
+	};
+}
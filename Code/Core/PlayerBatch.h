@@ -0,0 +1,216 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+#pragma once
+
+// Per-frame movement and look math of many players in contiguous arrays
+// Filled on the main thread, updated in independent ranges from any number of threads, read back on the main thread.
+
+#include "PlayerLook.h"
+#include "PlayerMovement.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define GAME_PLAYER_BATCH_SSE 1
+#endif
+
+namespace Game
+{
+	////////////////////////////////////////////////////////
+	// Structure-of-arrays input and output of the player frame update
+	// Each index is one player, Update only touches the given range so that ranges can run on different threads.
+	////////////////////////////////////////////////////////
+	class CPlayerBatch
+	{
+	public:
+		void Resize(std::size_t count)
+		{
+			for (std::vector<float>* pArray : { &m_moveX, &m_moveY, &m_bodyYaw, &m_mouseDeltaX, &m_mouseDeltaY, &m_lookYaw, &m_lookPitch,
+			                                    &m_movementSpeed, &m_walkSpeed, &m_rotationSpeed, &m_minPitch, &m_maxPitch, &m_velocityX, &m_velocityY,
+			                                    &m_yawZ, &m_yawW, &m_pitchX, &m_pitchW })
+			{
+				pArray->resize(count);
+			}
+			m_flags.resize(count);
+			m_isOnGround.resize(count);
+			m_isJumping.resize(count);
+		}
+
+		std::size_t Size() const { return m_flags.size(); }
+
+		// bodyYaw is the current yaw of the entity, movement follows it and not the look direction of this frame
+		void SetInput(std::size_t index, float moveX, float moveY, float bodyYaw, uint8_t flags, bool isOnGround, const SPlayerMovementParams& movementParams)
+		{
+			m_moveX[index] = moveX;
+			m_moveY[index] = moveY;
+			m_bodyYaw[index] = bodyYaw;
+			m_flags[index] = flags;
+			m_isOnGround[index] = isOnGround ? 1 : 0;
+			m_movementSpeed[index] = movementParams.movementSpeed;
+			m_walkSpeed[index] = movementParams.walkSpeed;
+		}
+
+		void SetLookInput(std::size_t index, float yaw, float pitch, float mouseDeltaX, float mouseDeltaY, const SPlayerLookParams& lookParams)
+		{
+			m_lookYaw[index] = yaw;
+			m_lookPitch[index] = pitch;
+			m_mouseDeltaX[index] = mouseDeltaX;
+			m_mouseDeltaY[index] = mouseDeltaY;
+			m_rotationSpeed[index] = lookParams.rotationSpeed;
+			m_minPitch[index] = lookParams.minPitch;
+			m_maxPitch[index] = lookParams.maxPitch;
+		}
+
+		// Same results as calling ComputeDesiredVelocity, ShouldJump, ApplyLookInput and ComputeLookRotation per player
+		void Update(std::size_t first, std::size_t last)
+		{
+			SPlayerMovementParams movementParams;
+
+			for (std::size_t i = first; i < last; ++i)
+			{
+				movementParams.movementSpeed = m_movementSpeed[i];
+				movementParams.walkSpeed = m_walkSpeed[i];
+
+				const SVec3f velocity = ComputeDesiredVelocity(m_moveX[i], m_moveY[i], m_bodyYaw[i], (m_flags[i] & ePlayerInputFlag_Walk) != 0, movementParams);
+				m_velocityX[i] = velocity.x;
+				m_velocityY[i] = velocity.y;
+				m_isJumping[i] = ShouldJump(m_isOnGround[i] != 0, m_flags[i]) ? 1 : 0;
+			}
+
+			UpdateLook(first, last);
+		}
+
+		// Look angles and rotations only, four players at a time where SSE is available
+		// The vector path approximates the half angle sine and cosine by polynomials, which stay within 1e-6 of
+		// ComputeLookRotation over the whole range of wrapped yaw and clamped pitch.
+		void UpdateLook(std::size_t first, std::size_t last)
+		{
+			std::size_t i = first;
+
+#if defined(GAME_PLAYER_BATCH_SSE)
+			for (; i + 4 <= last; i += 4)
+			{
+				UpdateLookSSE(i);
+			}
+#endif
+
+			SPlayerLookParams lookParams;
+			for (; i < last; ++i)
+			{
+				lookParams.rotationSpeed = m_rotationSpeed[i];
+				lookParams.minPitch = m_minPitch[i];
+				lookParams.maxPitch = m_maxPitch[i];
+				ApplyLookInput(m_lookYaw[i], m_lookPitch[i], m_mouseDeltaX[i], m_mouseDeltaY[i], lookParams);
+
+				const SLookRotation rotation = ComputeLookRotation(m_lookYaw[i], m_lookPitch[i]);
+				m_yawZ[i] = rotation.yawZ;
+				m_yawW[i] = rotation.yawW;
+				m_pitchX[i] = rotation.pitchX;
+				m_pitchW[i] = rotation.pitchW;
+			}
+		}
+
+		SVec3f GetVelocity(std::size_t index) const { return SVec3f(m_velocityX[index], m_velocityY[index], 0.f); }
+		bool IsJumping(std::size_t index) const { return m_isJumping[index] != 0; }
+		float GetLookYaw(std::size_t index) const { return m_lookYaw[index]; }
+		float GetLookPitch(std::size_t index) const { return m_lookPitch[index]; }
+		SLookRotation GetLookRotation(std::size_t index) const
+		{
+			SLookRotation rotation;
+			rotation.yawZ = m_yawZ[index];
+			rotation.yawW = m_yawW[index];
+			rotation.pitchX = m_pitchX[index];
+			rotation.pitchW = m_pitchW[index];
+			return rotation;
+		}
+
+	private:
+#if defined(GAME_PLAYER_BATCH_SSE)
+		// Taylor series up to the eleventh and tenth power, the half angles stay within [-pi/2, pi/2]
+		static void SinCosSSE(__m128 x, __m128& outSin, __m128& outCos)
+		{
+			const __m128 x2 = _mm_mul_ps(x, x);
+
+			__m128 sinPoly = _mm_set1_ps(-1.f / 39916800.f);
+			sinPoly = _mm_add_ps(_mm_mul_ps(sinPoly, x2), _mm_set1_ps(1.f / 362880.f));
+			sinPoly = _mm_add_ps(_mm_mul_ps(sinPoly, x2), _mm_set1_ps(-1.f / 5040.f));
+			sinPoly = _mm_add_ps(_mm_mul_ps(sinPoly, x2), _mm_set1_ps(1.f / 120.f));
+			sinPoly = _mm_add_ps(_mm_mul_ps(sinPoly, x2), _mm_set1_ps(-1.f / 6.f));
+			sinPoly = _mm_add_ps(_mm_mul_ps(sinPoly, x2), _mm_set1_ps(1.f));
+			outSin = _mm_mul_ps(sinPoly, x);
+
+			__m128 cosPoly = _mm_set1_ps(-1.f / 3628800.f);
+			cosPoly = _mm_add_ps(_mm_mul_ps(cosPoly, x2), _mm_set1_ps(1.f / 40320.f));
+			cosPoly = _mm_add_ps(_mm_mul_ps(cosPoly, x2), _mm_set1_ps(-1.f / 720.f));
+			cosPoly = _mm_add_ps(_mm_mul_ps(cosPoly, x2), _mm_set1_ps(1.f / 24.f));
+			cosPoly = _mm_add_ps(_mm_mul_ps(cosPoly, x2), _mm_set1_ps(-0.5f));
+			outCos = _mm_add_ps(_mm_mul_ps(cosPoly, x2), _mm_set1_ps(1.f));
+		}
+
+		void UpdateLookSSE(std::size_t i)
+		{
+			const __m128 pi = _mm_set1_ps(kPi);
+			const __m128 twoPi = _mm_set1_ps(2.f * kPi);
+			const __m128 one = _mm_set1_ps(1.f);
+			const __m128 half = _mm_set1_ps(0.5f);
+
+			const __m128 rotationSpeed = _mm_loadu_ps(&m_rotationSpeed[i]);
+			__m128 yaw = _mm_add_ps(_mm_loadu_ps(&m_lookYaw[i]), _mm_mul_ps(_mm_loadu_ps(&m_mouseDeltaX[i]), rotationSpeed));
+			__m128 pitch = _mm_add_ps(_mm_loadu_ps(&m_lookPitch[i]), _mm_mul_ps(_mm_loadu_ps(&m_mouseDeltaY[i]), rotationSpeed));
+
+			// WrapAngle, SSE2 has no floor: truncate and step down where truncation rounded up
+			const __m128 turns = _mm_div_ps(_mm_add_ps(yaw, pi), twoPi);
+			__m128 floored = _mm_cvtepi32_ps(_mm_cvttps_epi32(turns));
+			floored = _mm_sub_ps(floored, _mm_and_ps(_mm_cmpgt_ps(floored, turns), one));
+			yaw = _mm_sub_ps(yaw, _mm_mul_ps(twoPi, floored));
+
+			pitch = _mm_min_ps(_mm_max_ps(pitch, _mm_loadu_ps(&m_minPitch[i])), _mm_loadu_ps(&m_maxPitch[i]));
+
+			_mm_storeu_ps(&m_lookYaw[i], yaw);
+			_mm_storeu_ps(&m_lookPitch[i], pitch);
+
+			__m128 sinValue, cosValue;
+			SinCosSSE(_mm_mul_ps(yaw, half), sinValue, cosValue);
+			_mm_storeu_ps(&m_yawZ[i], sinValue);
+			_mm_storeu_ps(&m_yawW[i], cosValue);
+
+			SinCosSSE(_mm_mul_ps(pitch, half), sinValue, cosValue);
+			_mm_storeu_ps(&m_pitchX[i], sinValue);
+			_mm_storeu_ps(&m_pitchW[i], cosValue);
+		}
+#endif
+
+	private:
+		// Input
+		std::vector<float> m_moveX;
+		std::vector<float> m_moveY;
+		std::vector<float> m_bodyYaw;
+		std::vector<float> m_mouseDeltaX;
+		std::vector<float> m_mouseDeltaY;
+		std::vector<uint8_t> m_flags;
+		std::vector<uint8_t> m_isOnGround;
+
+		// Per-player settings, players are configured individually in the editor
+		std::vector<float> m_movementSpeed;
+		std::vector<float> m_walkSpeed;
+		std::vector<float> m_rotationSpeed;
+		std::vector<float> m_minPitch;
+		std::vector<float> m_maxPitch;
+
+		// Updated in place
+		std::vector<float> m_lookYaw;
+		std::vector<float> m_lookPitch;
+
+		// Output
+		std::vector<float> m_velocityX;
+		std::vector<float> m_velocityY;
+		std::vector<uint8_t> m_isJumping;
+		std::vector<float> m_yawZ;
+		std::vector<float> m_yawW;
+		std::vector<float> m_pitchX;
+		std::vector<float> m_pitchW;
+	};
+}
@@ -0,0 +1,65 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+#pragma once
+
+// Engine independent look rotation, shared by CPlayerComponent and offline tools
+// Angles follow the CCamera yaw/pitch convention: yaw turns around +Z starting from +Y, pitch tilts up around +X.
+
+#include "CoreMath.h"
+
+namespace Game
+{
+	struct SPlayerLookParams
+	{
+		// Radians per unit of mouse input
+		float rotationSpeed = 0.f;
+		float minPitch = -0.85f;
+		float maxPitch = 1.5f;
+	};
+
+	constexpr float kPi = 3.14159265358979323846f;
+
+	// Wraps an angle into [-pi, pi)
+	inline float WrapAngle(float angle)
+	{
+		const float twoPi = 2.f * kPi;
+		return angle - twoPi * std::floor((angle + kPi) / twoPi);
+	}
+
+	// Applies one frame of mouse input, yaw is unbounded and wrapped, pitch is clamped to the limits
+	inline void ApplyLookInput(float& yaw, float& pitch, float mouseDeltaX, float mouseDeltaY, const SPlayerLookParams& params)
+	{
+		yaw = WrapAngle(yaw + mouseDeltaX * params.rotationSpeed);
+		pitch = ClampValue(pitch + mouseDeltaY * params.rotationSpeed, params.minPitch, params.maxPitch);
+	}
+
+	// Rotations built from the look angles, as quaternion components
+	// The entity only turns around Z and the camera only tilts around its local X, so each rotation has two
+	// non-zero components: the sine and cosine of the half angle.
+	struct SLookRotation
+	{
+		// Entity rotation, Quat(yawW, 0, 0, yawZ)
+		float yawZ = 0.f;
+		float yawW = 1.f;
+		// Camera rotation relative to the entity, Quat(pitchW, pitchX, 0, 0)
+		float pitchX = 0.f;
+		float pitchW = 1.f;
+	};
+
+	inline SLookRotation ComputeLookRotation(float yaw, float pitch)
+	{
+		SLookRotation rotation;
+		rotation.yawZ = std::sin(yaw * 0.5f);
+		rotation.yawW = std::cos(yaw * 0.5f);
+		rotation.pitchX = std::sin(pitch * 0.5f);
+		rotation.pitchW = std::cos(pitch * 0.5f);
+		return rotation;
+	}
+
+	// Unit view direction for the angles, the same as CCamera::CreateViewdir
+	inline SVec3f GetLookDirection(float yaw, float pitch)
+	{
+		const float cosPitch = std::cos(pitch);
+		return SVec3f(-std::sin(yaw) * cosPitch, std::cos(yaw) * cosPitch, std::sin(pitch));
+	}
+}
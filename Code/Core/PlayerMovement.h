@@ -0,0 +1,112 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+#pragma once
+
+// Engine independent player movement, shared by CPlayerComponent and offline tools
+// Everything in here has to stay deterministic: the same state and commands always produce the same result.
+
+#include "CoreMath.h"
+
+#include <cstdint>
+
+namespace Game
+{
+	// Bit values match CPlayerComponent::EInputFlag
+	enum EPlayerInputFlags : uint8_t
+	{
+		ePlayerInputFlag_Walk = 1 << 0,
+		ePlayerInputFlag_Jump = 1 << 1
+	};
+
+	// Input of a single player for one simulation tick
+	struct SPlayerInputCommand
+	{
+		uint32_t sequence = 0;
+		// Length of the tick on the machine that produced the command, never sent over the network
+		float frameTime = 0.f;
+		// Movement axes in the player's local space, in the range [-1, 1]
+		float moveX = 0.f;
+		float moveY = 0.f;
+		// Look direction after the tick, in radians
+		float yaw = 0.f;
+		float pitch = 0.f;
+		uint8_t flags = 0;
+	};
+
+	struct SPlayerMovementParams
+	{
+		float movementSpeed = 0.f;
+		float walkSpeed = 0.f;
+		// Vertical velocity added when jumping off the ground
+		float jumpVelocity = 0.f;
+		float gravity = -9.81f;
+	};
+
+	struct SPlayerMovementState
+	{
+		SVec3f position;
+		SVec3f velocity;
+		// Height of the ground the player last stood on, the offline step treats it as an infinite plane
+		float groundHeight = 0.f;
+		bool isOnGround = true;
+	};
+
+	// Requested horizontal velocity in world space
+	// Same math as the character controller path: normalized input scaled by walk or run speed, rotated by yaw
+	inline SVec3f ComputeDesiredVelocity(float moveX, float moveY, float yaw, bool isWalking, const SPlayerMovementParams& params)
+	{
+		const float lengthSquared = moveX * moveX + moveY * moveY;
+		if (lengthSquared <= 0.f)
+		{
+			return SVec3f();
+		}
+
+		const float scale = (isWalking ? params.walkSpeed : params.movementSpeed) / std::sqrt(lengthSquared);
+		const float localX = moveX * scale;
+		const float localY = moveY * scale;
+
+		const float sinYaw = std::sin(yaw);
+		const float cosYaw = std::cos(yaw);
+		return SVec3f(localX * cosYaw - localY * sinYaw, localX * sinYaw + localY * cosYaw, 0.f);
+	}
+
+	inline bool ShouldJump(bool isOnGround, uint8_t flags)
+	{
+		return isOnGround && (flags & ePlayerInputFlag_Jump) != 0;
+	}
+
+	inline bool ShouldJump(const SPlayerMovementState& state, uint8_t flags)
+	{
+		return ShouldJump(state.isOnGround, flags);
+	}
+
+	// Advances the state by one command
+	// Used to replay unacknowledged commands on top of a server correction, so it only models what the
+	// character controller does on flat ground: horizontal velocity follows input, vertical velocity follows gravity.
+	inline void StepPlayerMovement(SPlayerMovementState& state, const SPlayerInputCommand& command, const SPlayerMovementParams& params)
+	{
+		const SVec3f desiredVelocity = ComputeDesiredVelocity(command.moveX, command.moveY, command.yaw, (command.flags & ePlayerInputFlag_Walk) != 0, params);
+		state.velocity.x = desiredVelocity.x;
+		state.velocity.y = desiredVelocity.y;
+
+		if (ShouldJump(state, command.flags))
+		{
+			state.velocity.z += params.jumpVelocity;
+			state.isOnGround = false;
+		}
+
+		if (!state.isOnGround)
+		{
+			state.velocity.z += params.gravity * command.frameTime;
+		}
+
+		state.position += state.velocity * command.frameTime;
+
+		if (state.position.z <= state.groundHeight && state.velocity.z <= 0.f)
+		{
+			state.position.z = state.groundHeight;
+			state.velocity.z = 0.f;
+			state.isOnGround = true;
+		}
+	}
+}
@@ -0,0 +1,238 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+#pragma once
+
+// Engine independent, only depends on the standard library so that it can be built and profiled outside of the game module
+
+#include "LinearArena.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(__AVX__)
+	#include <immintrin.h>
+	#define GAME_PROJECTILE_STORE_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define GAME_PROJECTILE_STORE_SSE 1
+#endif
+
+namespace Game
+{
+	////////////////////////////////////////////////////////
+	// Structure-of-arrays storage for in-flight projectiles
+	// Position, velocity, lifetime and owner live in separate contiguous arrays so that the integration
+	// step streams through memory and can be vectorized. Removal swaps with the last element, so indices
+	// are only stable until the next RemoveSwap.
+	////////////////////////////////////////////////////////
+	class CProjectileStore
+	{
+	public:
+		// Aligned for the widest vector width used by the integration kernel
+		using TFloatArray = std::vector<float, SArenaAllocator<float, 32>>;
+		using TOwnerArray = std::vector<uint32_t, SArenaAllocator<uint32_t>>;
+
+		CProjectileStore() = default;
+		// Takes the storage from the arena, see Release
+		explicit CProjectileStore(CLinearArena* pArena)
+			: m_posX(TFloatArray::allocator_type(pArena)), m_posY(TFloatArray::allocator_type(pArena)), m_posZ(TFloatArray::allocator_type(pArena))
+			, m_prevX(TFloatArray::allocator_type(pArena)), m_prevY(TFloatArray::allocator_type(pArena)), m_prevZ(TFloatArray::allocator_type(pArena))
+			, m_velX(TFloatArray::allocator_type(pArena)), m_velY(TFloatArray::allocator_type(pArena)), m_velZ(TFloatArray::allocator_type(pArena))
+			, m_lifetime(TFloatArray::allocator_type(pArena))
+			, m_owner(TOwnerArray::allocator_type(pArena))
+		{
+		}
+
+		void Reserve(std::size_t capacity)
+		{
+			for (TFloatArray* pArray : { &m_posX, &m_posY, &m_posZ, &m_prevX, &m_prevY, &m_prevZ, &m_velX, &m_velY, &m_velZ, &m_lifetime })
+			{
+				pArray->reserve(capacity);
+			}
+			m_owner.reserve(capacity);
+		}
+
+		std::size_t Add(float posX, float posY, float posZ, float velX, float velY, float velZ, float lifetime, uint32_t owner)
+		{
+			m_posX.push_back(posX);
+			m_posY.push_back(posY);
+			m_posZ.push_back(posZ);
+			m_prevX.push_back(posX);
+			m_prevY.push_back(posY);
+			m_prevZ.push_back(posZ);
+			m_velX.push_back(velX);
+			m_velY.push_back(velY);
+			m_velZ.push_back(velZ);
+			m_lifetime.push_back(lifetime);
+			m_owner.push_back(owner);
+
+			return m_owner.size() - 1;
+		}
+
+		void RemoveSwap(std::size_t index)
+		{
+			const std::size_t last = m_owner.size() - 1;
+			for (TFloatArray* pArray : { &m_posX, &m_posY, &m_posZ, &m_prevX, &m_prevY, &m_prevZ, &m_velX, &m_velY, &m_velZ, &m_lifetime })
+			{
+				(*pArray)[index] = (*pArray)[last];
+				pArray->pop_back();
+			}
+			m_owner[index] = m_owner[last];
+			m_owner.pop_back();
+		}
+
+		void Clear()
+		{
+			for (TFloatArray* pArray : { &m_posX, &m_posY, &m_posZ, &m_prevX, &m_prevY, &m_prevZ, &m_velX, &m_velY, &m_velZ, &m_lifetime })
+			{
+				pArray->clear();
+			}
+			m_owner.clear();
+		}
+
+		// Clears and gives up the storage, has to be called before the arena the store allocates from is reset
+		void Release()
+		{
+			for (TFloatArray* pArray : { &m_posX, &m_posY, &m_posZ, &m_prevX, &m_prevY, &m_prevZ, &m_velX, &m_velY, &m_velZ, &m_lifetime })
+			{
+				TFloatArray(pArray->get_allocator()).swap(*pArray);
+			}
+			TOwnerArray(m_owner.get_allocator()).swap(m_owner);
+		}
+
+		std::size_t Size() const { return m_owner.size(); }
+		bool Empty() const { return m_owner.empty(); }
+		std::size_t Capacity() const { return m_owner.capacity(); }
+
+		// Advances all projectiles by one step under constant acceleration
+		// The position before the step is kept, so that callers can query the travelled segment afterwards.
+		void Integrate(float timeStep, float gravityX, float gravityY, float gravityZ)
+		{
+			const std::size_t count = Size();
+			std::size_t first = 0;
+
+#if defined(GAME_PROJECTILE_STORE_AVX)
+			first = IntegrateAVX(timeStep, gravityX, gravityY, gravityZ, count);
+#elif defined(GAME_PROJECTILE_STORE_SSE)
+			first = IntegrateSSE(timeStep, gravityX, gravityY, gravityZ, count);
+#endif
+
+			IntegrateScalarRange(timeStep, gravityX, gravityY, gravityZ, first, count);
+		}
+
+		// Reference implementation, the vectorized kernels must produce the same results
+		void IntegrateScalar(float timeStep, float gravityX, float gravityY, float gravityZ)
+		{
+			IntegrateScalarRange(timeStep, gravityX, gravityY, gravityZ, 0, Size());
+		}
+
+		float GetPositionX(std::size_t index) const { return m_posX[index]; }
+		float GetPositionY(std::size_t index) const { return m_posY[index]; }
+		float GetPositionZ(std::size_t index) const { return m_posZ[index]; }
+		float GetPreviousX(std::size_t index) const { return m_prevX[index]; }
+		float GetPreviousY(std::size_t index) const { return m_prevY[index]; }
+		float GetPreviousZ(std::size_t index) const { return m_prevZ[index]; }
+		float GetVelocityX(std::size_t index) const { return m_velX[index]; }
+		float GetVelocityY(std::size_t index) const { return m_velY[index]; }
+		float GetVelocityZ(std::size_t index) const { return m_velZ[index]; }
+		float GetLifetime(std::size_t index) const { return m_lifetime[index]; }
+		uint32_t GetOwner(std::size_t index) const { return m_owner[index]; }
+
+	private:
+		void IntegrateScalarRange(float timeStep, float gravityX, float gravityY, float gravityZ, std::size_t first, std::size_t last)
+		{
+			const float halfStepSquared = 0.5f * timeStep * timeStep;
+
+			for (std::size_t i = first; i < last; ++i)
+			{
+				m_prevX[i] = m_posX[i];
+				m_prevY[i] = m_posY[i];
+				m_prevZ[i] = m_posZ[i];
+
+				m_posX[i] = m_posX[i] + m_velX[i] * timeStep + gravityX * halfStepSquared;
+				m_posY[i] = m_posY[i] + m_velY[i] * timeStep + gravityY * halfStepSquared;
+				m_posZ[i] = m_posZ[i] + m_velZ[i] * timeStep + gravityZ * halfStepSquared;
+
+				m_velX[i] = m_velX[i] + gravityX * timeStep;
+				m_velY[i] = m_velY[i] + gravityY * timeStep;
+				m_velZ[i] = m_velZ[i] + gravityZ * timeStep;
+
+				m_lifetime[i] = m_lifetime[i] - timeStep;
+			}
+		}
+
+#if defined(GAME_PROJECTILE_STORE_AVX)
+		static void IntegrateAxisAVX(float* pPos, float* pPrev, float* pVel, __m256 step, __m256 gravityStep, __m256 gravityOffset, std::size_t i)
+		{
+			const __m256 pos = _mm256_load_ps(pPos + i);
+			const __m256 vel = _mm256_load_ps(pVel + i);
+			_mm256_store_ps(pPrev + i, pos);
+			_mm256_store_ps(pPos + i, _mm256_add_ps(_mm256_add_ps(pos, _mm256_mul_ps(vel, step)), gravityOffset));
+			_mm256_store_ps(pVel + i, _mm256_add_ps(vel, gravityStep));
+		}
+
+		std::size_t IntegrateAVX(float timeStep, float gravityX, float gravityY, float gravityZ, std::size_t count)
+		{
+			const float halfStepSquared = 0.5f * timeStep * timeStep;
+			const __m256 step = _mm256_set1_ps(timeStep);
+			const __m256 gravityStepX = _mm256_set1_ps(gravityX * timeStep);
+			const __m256 gravityStepY = _mm256_set1_ps(gravityY * timeStep);
+			const __m256 gravityStepZ = _mm256_set1_ps(gravityZ * timeStep);
+			const __m256 gravityOffsetX = _mm256_set1_ps(gravityX * halfStepSquared);
+			const __m256 gravityOffsetY = _mm256_set1_ps(gravityY * halfStepSquared);
+			const __m256 gravityOffsetZ = _mm256_set1_ps(gravityZ * halfStepSquared);
+			const std::size_t vectorCount = count & ~std::size_t(7);
+
+			for (std::size_t i = 0; i < vectorCount; i += 8)
+			{
+				IntegrateAxisAVX(m_posX.data(), m_prevX.data(), m_velX.data(), step, gravityStepX, gravityOffsetX, i);
+				IntegrateAxisAVX(m_posY.data(), m_prevY.data(), m_velY.data(), step, gravityStepY, gravityOffsetY, i);
+				IntegrateAxisAVX(m_posZ.data(), m_prevZ.data(), m_velZ.data(), step, gravityStepZ, gravityOffsetZ, i);
+				_mm256_store_ps(m_lifetime.data() + i, _mm256_sub_ps(_mm256_load_ps(m_lifetime.data() + i), step));
+			}
+
+			return vectorCount;
+		}
+#elif defined(GAME_PROJECTILE_STORE_SSE)
+		static void IntegrateAxisSSE(float* pPos, float* pPrev, float* pVel, __m128 step, __m128 gravityStep, __m128 gravityOffset, std::size_t i)
+		{
+			const __m128 pos = _mm_load_ps(pPos + i);
+			const __m128 vel = _mm_load_ps(pVel + i);
+			_mm_store_ps(pPrev + i, pos);
+			_mm_store_ps(pPos + i, _mm_add_ps(_mm_add_ps(pos, _mm_mul_ps(vel, step)), gravityOffset));
+			_mm_store_ps(pVel + i, _mm_add_ps(vel, gravityStep));
+		}
+
+		std::size_t IntegrateSSE(float timeStep, float gravityX, float gravityY, float gravityZ, std::size_t count)
+		{
+			const float halfStepSquared = 0.5f * timeStep * timeStep;
+			const __m128 step = _mm_set1_ps(timeStep);
+			const __m128 gravityStepX = _mm_set1_ps(gravityX * timeStep);
+			const __m128 gravityStepY = _mm_set1_ps(gravityY * timeStep);
+			const __m128 gravityStepZ = _mm_set1_ps(gravityZ * timeStep);
+			const __m128 gravityOffsetX = _mm_set1_ps(gravityX * halfStepSquared);
+			const __m128 gravityOffsetY = _mm_set1_ps(gravityY * halfStepSquared);
+			const __m128 gravityOffsetZ = _mm_set1_ps(gravityZ * halfStepSquared);
+			const std::size_t vectorCount = count & ~std::size_t(3);
+
+			for (std::size_t i = 0; i < vectorCount; i += 4)
+			{
+				IntegrateAxisSSE(m_posX.data(), m_prevX.data(), m_velX.data(), step, gravityStepX, gravityOffsetX, i);
+				IntegrateAxisSSE(m_posY.data(), m_prevY.data(), m_velY.data(), step, gravityStepY, gravityOffsetY, i);
+				IntegrateAxisSSE(m_posZ.data(), m_prevZ.data(), m_velZ.data(), step, gravityStepZ, gravityOffsetZ, i);
+				_mm_store_ps(m_lifetime.data() + i, _mm_sub_ps(_mm_load_ps(m_lifetime.data() + i), step));
+			}
+
+			return vectorCount;
+		}
+#endif
+
+	private:
+		TFloatArray m_posX, m_posY, m_posZ;
+		TFloatArray m_prevX, m_prevY, m_prevZ;
+		TFloatArray m_velX, m_velY, m_velZ;
+		TFloatArray m_lifetime;
+		TOwnerArray m_owner;
+	};
+}
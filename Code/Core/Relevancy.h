@@ -0,0 +1,333 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+#pragma once
+
+// Per-client relevancy of replicated objects
+// Every viewer (the player of a client) scores the objects around it by distance, view cone, recent interaction and
+// class priority. The score turns into an update rate, objects scoring too low are culled for that viewer. Only
+// objects the spatial grid returns within the relevancy distance are visited, so the cost grows with the number of
+// objects near each viewer and not with the number of objects in the level.
+
+#include "SpatialGrid.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace Game
+{
+	struct SRelevancyParams
+	{
+		// Objects farther away than this are culled
+		float maxDistance = 150.f;
+		// Objects closer than this keep the full distance score, no matter where the viewer looks
+		float fullScoreDistance = 10.f;
+		// Cosine of half the view cone angle
+		float viewConeCos = 0.5f;
+		// Score factor of objects outside the view cone
+		float outOfViewFactor = 0.3f;
+		// Seconds an interaction keeps an object at the full score of its class
+		float interactionDuration = 5.f;
+		// Update rates in Hz at a score of one and at the cull score
+		float maxRate = 30.f;
+		float minRate = 2.f;
+		// Objects scoring below this are not updated at all
+		float cullScore = 0.02f;
+	};
+
+	struct SRelevancyViewer
+	{
+		// userId of the viewer's own object in the grid, which is always relevant at the maximum rate
+		uint32_t userId = 0;
+		SVec3f position;
+		// Unit view direction
+		SVec3f forward;
+	};
+
+	////////////////////////////////////////////////////////
+	// Schedules object updates per viewer
+	// Remembers when each object is due next for each viewer. An object that leaves the relevant set is forgotten,
+	// so it is updated right away when it becomes relevant again.
+	////////////////////////////////////////////////////////
+	class CRelevancyScheduler
+	{
+	public:
+		static constexpr std::size_t kMaxClasses = 32;
+
+		CRelevancyScheduler() { m_classPriorities.fill(1.f); }
+
+		void SetParams(const SRelevancyParams& params) { m_params = params; }
+		const SRelevancyParams& GetParams() const { return m_params; }
+
+		// Sets the priority in [0, 1] of every class in typeMask, objects use the highest priority of their classes
+		void SetClassPriority(uint32_t typeMask, float priority)
+		{
+			for (std::size_t i = 0; i < kMaxClasses; ++i)
+			{
+				if (typeMask & (1u << i))
+				{
+					m_classPriorities[i] = priority;
+				}
+			}
+		}
+
+		float GetClassPriority(uint32_t typeMask) const
+		{
+			float priority = 0.f;
+			for (std::size_t i = 0; i < kMaxClasses; ++i)
+			{
+				if (typeMask & (1u << i))
+				{
+					priority = std::max(priority, m_classPriorities[i]);
+				}
+			}
+			return priority;
+		}
+
+		// Raises the object to the full score of its class for the viewer, e.g. after one has shot the other
+		// Only objects within maxDistance are visited, the interaction doesn't extend the range.
+		void NoteInteraction(uint32_t viewerId, uint32_t objectId, float time)
+		{
+			std::vector<SInteraction>& interactions = m_viewers[viewerId].interactions;
+
+			for (SInteraction& interaction : interactions)
+			{
+				if (interaction.objectId == objectId)
+				{
+					interaction.time = time;
+					return;
+				}
+			}
+
+			interactions.push_back(SInteraction { objectId, time });
+		}
+
+		void RemoveViewer(uint32_t viewerId) { m_viewers.erase(viewerId); }
+		void Clear() { m_viewers.clear(); }
+
+		// Score in [0, 1], zero when the object is out of range
+		float ComputeScore(const SRelevancyViewer& viewer, const SSpatialObject& object, float time) const
+		{
+			const auto it = m_viewers.find(viewer.userId);
+			return ComputeScore(viewer, it != m_viewers.end() ? &it->second : nullptr, object, time);
+		}
+
+		// Seconds between two updates of an object with the score
+		float GetUpdateInterval(float score) const
+		{
+			const float t = ClampValue(score, 0.f, 1.f);
+			return 1.f / (m_params.minRate + (m_params.maxRate - m_params.minRate) * t);
+		}
+
+		// Calls callback(const SRelevancyViewer&, const SSpatialObject&, float score) for every object of typeMask
+		// that is due for one of the viewers at the given time
+		template<typename TCallback>
+		void Update(const SRelevancyViewer* pViewers, std::size_t viewerCount, const CSpatialGrid& grid, uint32_t typeMask, float time, TCallback&& callback)
+		{
+			for (std::size_t i = 0; i < viewerCount; ++i)
+			{
+				const SRelevancyViewer& viewer = pViewers[i];
+				SViewerState& state = m_viewers[viewer.userId];
+
+				PruneInteractions(state, time);
+
+				// Last update's schedule is sorted by object, this update's is rebuilt from what the grid returns
+				state.previousSchedule.swap(state.schedule);
+				state.schedule.clear();
+
+				grid.QueryRadius(viewer.position, m_params.maxDistance, typeMask, [&](const SSpatialObject& object)
+				{
+					const float score = ComputeScore(viewer, &state, object, time);
+					if (score < m_params.cullScore)
+					{
+						return;
+					}
+
+					if (Schedule(state.previousSchedule, state.schedule, object.userId, score, time))
+					{
+						callback(viewer, object, score);
+					}
+				});
+
+				SortSchedule(state.schedule);
+			}
+		}
+
+		// Calls callback(const SSpatialObject&, float score) for every object of typeMask that is due at the given time,
+		// scheduled at the rate of the viewer it is most relevant to
+		// For replication that can only mark an object for all clients at once.
+		template<typename TCallback>
+		void UpdateObjects(const SRelevancyViewer* pViewers, std::size_t viewerCount, const CSpatialGrid& grid, uint32_t typeMask, float time, TCallback&& callback)
+		{
+			m_candidates.clear();
+
+			for (std::size_t i = 0; i < viewerCount; ++i)
+			{
+				const SRelevancyViewer& viewer = pViewers[i];
+				const auto it = m_viewers.find(viewer.userId);
+				SViewerState* pState = it != m_viewers.end() ? &it->second : nullptr;
+				if (pState != nullptr)
+				{
+					PruneInteractions(*pState, time);
+				}
+
+				grid.QueryRadius(viewer.position, m_params.maxDistance, typeMask, [&](const SSpatialObject& object)
+				{
+					const float score = ComputeScore(viewer, pState, object, time);
+					if (score >= m_params.cullScore)
+					{
+						m_candidates.push_back(SCandidate { object, score });
+					}
+				});
+			}
+
+			// Highest score of every object first
+			std::sort(m_candidates.begin(), m_candidates.end(), [](const SCandidate& a, const SCandidate& b)
+			{
+				return a.object.userId != b.object.userId ? a.object.userId < b.object.userId : a.score > b.score;
+			});
+
+			m_previousObjectSchedule.swap(m_objectSchedule);
+			m_objectSchedule.clear();
+
+			for (std::size_t i = 0; i < m_candidates.size(); ++i)
+			{
+				const SCandidate& candidate = m_candidates[i];
+				if (i > 0 && m_candidates[i - 1].object.userId == candidate.object.userId)
+				{
+					continue;
+				}
+
+				if (Schedule(m_previousObjectSchedule, m_objectSchedule, candidate.object.userId, candidate.score, time))
+				{
+					callback(candidate.object, candidate.score);
+				}
+			}
+		}
+
+		// Number of objects currently relevant to the viewer, see Update
+		std::size_t GetRelevantCount(uint32_t viewerId) const
+		{
+			const auto it = m_viewers.find(viewerId);
+			return it != m_viewers.end() ? it->second.schedule.size() : 0;
+		}
+
+		// Number of objects relevant to at least one viewer, see UpdateObjects
+		std::size_t GetRelevantObjectCount() const { return m_objectSchedule.size(); }
+
+	private:
+		struct SScheduleEntry
+		{
+			uint32_t objectId;
+			float nextTime;
+		};
+
+		struct SInteraction
+		{
+			uint32_t objectId;
+			float time;
+		};
+
+		struct SViewerState
+		{
+			std::vector<SScheduleEntry> schedule;
+			std::vector<SScheduleEntry> previousSchedule;
+			std::vector<SInteraction> interactions;
+		};
+
+		struct SCandidate
+		{
+			SSpatialObject object;
+			float score;
+		};
+
+		// Carries the object over from the previous, sorted schedule into the current one and returns whether it is due
+		bool Schedule(const std::vector<SScheduleEntry>& previousSchedule, std::vector<SScheduleEntry>& schedule, uint32_t objectId, float score, float time) const
+		{
+			const auto it = std::lower_bound(previousSchedule.begin(), previousSchedule.end(), objectId,
+				[](const SScheduleEntry& entry, uint32_t id) { return entry.objectId < id; });
+			float nextTime = it != previousSchedule.end() && it->objectId == objectId ? it->nextTime : time;
+
+			const bool isDue = time >= nextTime;
+			if (isDue)
+			{
+				nextTime = time + GetUpdateInterval(score);
+			}
+
+			schedule.push_back(SScheduleEntry { objectId, nextTime });
+			return isDue;
+		}
+
+		static void SortSchedule(std::vector<SScheduleEntry>& schedule)
+		{
+			std::sort(schedule.begin(), schedule.end(), [](const SScheduleEntry& a, const SScheduleEntry& b) { return a.objectId < b.objectId; });
+		}
+
+		float ComputeScore(const SRelevancyViewer& viewer, const SViewerState* pState, const SSpatialObject& object, float time) const
+		{
+			if (object.userId == viewer.userId)
+			{
+				return 1.f;
+			}
+
+			const float classPriority = GetClassPriority(object.typeMask);
+			if (pState != nullptr && HasInteracted(*pState, object.userId, time))
+			{
+				return classPriority;
+			}
+
+			const SVec3f offset = object.position - viewer.position;
+			const float distance = offset.GetLength();
+			if (distance >= m_params.maxDistance)
+			{
+				return 0.f;
+			}
+
+			if (distance <= m_params.fullScoreDistance)
+			{
+				return classPriority;
+			}
+
+			// Quadratic falloff, distant objects lose relevancy quickly
+			const float falloff = 1.f - (distance - m_params.fullScoreDistance) / (m_params.maxDistance - m_params.fullScoreDistance);
+			const float distanceScore = falloff * falloff;
+
+			const float viewCos = offset.Dot(viewer.forward) / distance;
+			const float viewScore = viewCos >= m_params.viewConeCos ? 1.f : m_params.outOfViewFactor;
+
+			return classPriority * distanceScore * viewScore;
+		}
+
+		void PruneInteractions(SViewerState& state, float time) const
+		{
+			state.interactions.erase(std::remove_if(state.interactions.begin(), state.interactions.end(),
+				[this, time](const SInteraction& interaction) { return time - interaction.time > m_params.interactionDuration; }),
+				state.interactions.end());
+		}
+
+		bool HasInteracted(const SViewerState& state, uint32_t objectId, float time) const
+		{
+			for (const SInteraction& interaction : state.interactions)
+			{
+				if (interaction.objectId == objectId && time - interaction.time <= m_params.interactionDuration)
+				{
+					return true;
+				}
+			}
+			return false;
+		}
+
+	private:
+		SRelevancyParams m_params;
+		std::array<float, kMaxClasses> m_classPriorities;
+		std::unordered_map<uint32_t, SViewerState> m_viewers;
+
+		// UpdateObjects, objects are visited in order so the schedule is sorted as it is built
+		std::vector<SCandidate> m_candidates;
+		std::vector<SScheduleEntry> m_objectSchedule;
+		std::vector<SScheduleEntry> m_previousObjectSchedule;
+	};
+}
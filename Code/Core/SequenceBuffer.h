@@ -0,0 +1,63 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace Game
+{
+	////////////////////////////////////////////////////////
+	// Fixed-capacity ring buffer addressed by a monotonically increasing sequence number
+	// Writing sequence N overwrites sequence N - Capacity, lookups of overwritten or never written
+	// sequences fail. Never allocates after construction.
+	////////////////////////////////////////////////////////
+	template<typename T, std::size_t Capacity>
+	class CSequenceBuffer
+	{
+		static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+	public:
+		T& Insert(uint32_t sequence, const T& value)
+		{
+			SSlot& slot = m_slots[sequence & (Capacity - 1)];
+			slot.sequence = sequence;
+			slot.isValid = true;
+			slot.value = value;
+			return slot.value;
+		}
+
+		T* Find(uint32_t sequence)
+		{
+			SSlot& slot = m_slots[sequence & (Capacity - 1)];
+			return slot.isValid && slot.sequence == sequence ? &slot.value : nullptr;
+		}
+
+		const T* Find(uint32_t sequence) const
+		{
+			const SSlot& slot = m_slots[sequence & (Capacity - 1)];
+			return slot.isValid && slot.sequence == sequence ? &slot.value : nullptr;
+		}
+
+		void Clear()
+		{
+			for (SSlot& slot : m_slots)
+			{
+				slot.isValid = false;
+			}
+		}
+
+		static constexpr std::size_t GetCapacity() { return Capacity; }
+
+	private:
+		struct SSlot
+		{
+			T value {};
+			uint32_t sequence = 0;
+			bool isValid = false;
+		};
+
+		std::array<SSlot, Capacity> m_slots;
+	};
+}
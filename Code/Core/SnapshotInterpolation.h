@@ -0,0 +1,281 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+#pragma once
+
+// Playback of replicated movement snapshots at an adaptive delay
+// Remote entities are rendered slightly in the past, between two received snapshots, so that motion stays smooth
+// when snapshots arrive at a low rate or with jitter. The delay follows the measured snapshot interval and jitter,
+// extrapolation covers short gaps when a snapshot is late anyway. Teleports and respawns are not played back as
+// movement: the entity holds its place until the render time reaches a snapshot flagged as a teleport and jumps there,
+// dropping the history before it. A gap between two snapshots that their velocities can't have covered is snapped
+// across the same way, for teleports the sender didn't flag.
+
+#include "CoreMath.h"
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace Game
+{
+	struct SSnapshot
+	{
+		// Sender clock
+		float time = 0.f;
+		SVec3f position;
+		SVec3f velocity;
+		// Moved to the position without passing the way in between, e.g. respawned
+		bool isTeleport = false;
+	};
+
+	struct SPlayoutParams
+	{
+		// Bounds of the playout delay in seconds
+		float minDelay = 0.05f;
+		float maxDelay = 0.5f;
+		// Multiples of the measured jitter added to the snapshot interval
+		float jitterScale = 2.f;
+		// Seconds of delay change per second, the delay grows faster than it shrinks so that late snapshots are caught
+		// up with quickly while a calm connection slowly trades the margin back for latency
+		float delayIncreaseRate = 0.2f;
+		float delayDecreaseRate = 0.05f;
+		// Longest time to extrapolate past the newest snapshot, the entity holds its position afterwards
+		float maxExtrapolation = 0.25f;
+		// Meters two snapshots may be further apart than their velocities cover in the time between them before the
+		// gap counts as a teleport and is snapped across instead of interpolated
+		float snapDistance = 1.f;
+	};
+
+	enum class ESnapshotSampleResult
+	{
+		// No snapshot received yet
+		Empty,
+		// Between two snapshots
+		Interpolated,
+		// Past the newest snapshot
+		Extrapolated,
+		// Before the oldest snapshot or past the extrapolation limit
+		Held,
+		// Between two snapshots too far apart to have moved from one to the other
+		Snapped
+	};
+
+	struct SSnapshotSample
+	{
+		SVec3f position;
+		SVec3f velocity;
+		ESnapshotSampleResult result = ESnapshotSampleResult::Empty;
+	};
+
+	// Cubic Hermite curve through both snapshots with their velocities as tangents, t in [0, 1]
+	inline SSnapshotSample InterpolateSnapshots(const SSnapshot& from, const SSnapshot& to, float t)
+	{
+		const float duration = to.time - from.time;
+		const float t2 = t * t;
+		const float t3 = t2 * t;
+
+		const float h00 = 2.f * t3 - 3.f * t2 + 1.f;
+		const float h10 = t3 - 2.f * t2 + t;
+		const float h01 = -2.f * t3 + 3.f * t2;
+		const float h11 = t3 - t2;
+
+		const float d00 = 6.f * t2 - 6.f * t;
+		const float d10 = 3.f * t2 - 4.f * t + 1.f;
+		const float d11 = 3.f * t2 - 2.f * t;
+
+		SSnapshotSample sample;
+		sample.position = from.position * h00 + from.velocity * (h10 * duration) + to.position * h01 + to.velocity * (h11 * duration);
+		sample.velocity = (to.position - from.position) * (-d00 / duration) + from.velocity * d10 + to.velocity * d11;
+		sample.result = ESnapshotSampleResult::Interpolated;
+		return sample;
+	}
+
+	// Whether the entity can't have moved from one snapshot to the other in the time between them
+	// Speed changes monotonically over a short interval, so the faster of the two velocities bounds the distance.
+	inline bool IsSnapshotGap(const SSnapshot& from, const SSnapshot& to, float snapDistance)
+	{
+		const float duration = to.time - from.time;
+		const float speedSquared = std::fmax(from.velocity.GetLengthSquared(), to.velocity.GetLengthSquared());
+		const float maxDistance = std::sqrt(speedSquared) * duration + snapDistance;
+		return (to.position - from.position).GetLengthSquared() > maxDistance * maxDistance;
+	}
+
+	////////////////////////////////////////////////////////
+	// Snapshot history and playout clock of one remote entity
+	// Keeps the last Capacity snapshots in a ring and estimates the offset of the sender clock, the snapshot interval
+	// and the jitter from the arrival times. Never allocates after construction.
+	////////////////////////////////////////////////////////
+	template<std::size_t Capacity>
+	class CSnapshotInterpolator
+	{
+		static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two of at least two");
+
+	public:
+		// Adds a snapshot received at receiveTime on the local clock, snapshots not newer than the newest are dropped
+		bool Push(const SSnapshot& snapshot, float receiveTime)
+		{
+			if (m_count > 0 && snapshot.time <= GetNewest().time)
+			{
+				return false;
+			}
+
+			const float transit = receiveTime - snapshot.time;
+			if (m_count == 0)
+			{
+				m_offset = transit;
+				m_jitter = 0.f;
+				m_hasInterval = false;
+			}
+			else
+			{
+				// The fastest delivery is the best estimate of the clock offset, the slow rise follows clock drift and
+				// lasting increases of the latency
+				m_offset = transit < m_offset ? transit : m_offset + (transit - m_offset) * kOffsetRecovery;
+
+				// Mean deviation of the transit time as in RFC 3550
+				m_jitter += (std::fabs(transit - m_lastTransit) - m_jitter) * kJitterGain;
+
+				const float interval = snapshot.time - GetNewest().time;
+				m_interval = m_hasInterval ? m_interval + (interval - m_interval) * kIntervalGain : interval;
+				m_hasInterval = true;
+			}
+			m_lastTransit = transit;
+
+			m_snapshots[m_head] = snapshot;
+			m_head = (m_head + 1) & (Capacity - 1);
+			m_count = m_count < Capacity ? m_count + 1 : Capacity;
+			return true;
+		}
+
+		// Moves the playout delay towards its target and samples the snapshots at localTime minus the delay
+		SSnapshotSample Update(float localTime, float frameTime, const SPlayoutParams& params)
+		{
+			if (m_count == 0)
+			{
+				return SSnapshotSample();
+			}
+
+			const float targetDelay = GetTargetDelay(params);
+			if (!m_hasDelay)
+			{
+				m_delay = targetDelay;
+				m_hasDelay = true;
+			}
+			else if (targetDelay > m_delay)
+			{
+				m_delay = std::fmin(targetDelay, m_delay + params.delayIncreaseRate * frameTime);
+			}
+			else
+			{
+				m_delay = std::fmax(targetDelay, m_delay - params.delayDecreaseRate * frameTime);
+			}
+
+			const float renderTime = GetRenderTime(localTime);
+			DropBeforeTeleport(renderTime);
+			return Sample(renderTime, params);
+		}
+
+		// Samples the snapshots at renderTime on the sender clock
+		SSnapshotSample Sample(float renderTime, const SPlayoutParams& params) const
+		{
+			SSnapshotSample sample;
+			if (m_count == 0)
+			{
+				return sample;
+			}
+
+			const SSnapshot& newest = GetNewest();
+			if (renderTime >= newest.time)
+			{
+				const float extrapolation = renderTime - newest.time;
+				sample.position = newest.position + newest.velocity * std::fmin(extrapolation, params.maxExtrapolation);
+				sample.velocity = extrapolation <= params.maxExtrapolation ? newest.velocity : SVec3f();
+				sample.result = extrapolation <= params.maxExtrapolation ? ESnapshotSampleResult::Extrapolated : ESnapshotSampleResult::Held;
+				return sample;
+			}
+
+			// Usually the render time is close behind the newest snapshot, search from there
+			for (std::size_t i = m_count - 1; i > 0; --i)
+			{
+				const SSnapshot& from = Get(i - 1);
+				if (renderTime >= from.time)
+				{
+					const SSnapshot& to = Get(i);
+					const float t = (renderTime - from.time) / (to.time - from.time);
+					if (to.isTeleport || IsSnapshotGap(from, to, params.snapDistance))
+					{
+						// Where the teleport happened between the two is unknown unless it was flagged
+						const SSnapshot& nearest = to.isTeleport || t < 0.5f ? from : to;
+						sample.position = nearest.position;
+						sample.velocity = nearest.velocity;
+						sample.result = ESnapshotSampleResult::Snapped;
+						return sample;
+					}
+					return InterpolateSnapshots(from, to, t);
+				}
+			}
+
+			sample.position = Get(0).position;
+			sample.result = ESnapshotSampleResult::Held;
+			return sample;
+		}
+
+		// Drops the snapshots before the newest teleport the render time has reached, the clock estimates carry over
+		void DropBeforeTeleport(float renderTime)
+		{
+			for (std::size_t i = m_count - 1; i > 0; --i)
+			{
+				const SSnapshot& snapshot = Get(i);
+				if (snapshot.isTeleport && renderTime >= snapshot.time)
+				{
+					m_count -= i;
+					return;
+				}
+			}
+		}
+
+		void Reset()
+		{
+			m_head = 0;
+			m_count = 0;
+			m_hasDelay = false;
+		}
+
+		// Local time converted to the sender clock and moved back by the playout delay
+		float GetRenderTime(float localTime) const { return localTime - m_offset - m_delay; }
+
+		float GetTargetDelay(const SPlayoutParams& params) const
+		{
+			const float interval = m_hasInterval ? m_interval : 0.f;
+			return ClampValue(interval + m_jitter * params.jitterScale, params.minDelay, params.maxDelay);
+		}
+
+		float GetDelay() const { return m_delay; }
+		float GetJitter() const { return m_jitter; }
+		float GetInterval() const { return m_hasInterval ? m_interval : 0.f; }
+		std::size_t GetCount() const { return m_count; }
+
+	private:
+		// Oldest snapshot at index zero
+		const SSnapshot& Get(std::size_t index) const { return m_snapshots[(m_head + Capacity - m_count + index) & (Capacity - 1)]; }
+		const SSnapshot& GetNewest() const { return Get(m_count - 1); }
+
+		static constexpr float kOffsetRecovery = 0.01f;
+		static constexpr float kJitterGain = 1.f / 16.f;
+		static constexpr float kIntervalGain = 1.f / 8.f;
+
+	private:
+		std::array<SSnapshot, Capacity> m_snapshots;
+		std::size_t m_head = 0;
+		std::size_t m_count = 0;
+
+		float m_offset = 0.f;
+		float m_lastTransit = 0.f;
+		float m_jitter = 0.f;
+		float m_interval = 0.f;
+		float m_delay = 0.f;
+		bool m_hasInterval = false;
+		bool m_hasDelay = false;
+	};
+}
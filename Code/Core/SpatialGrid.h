@@ -0,0 +1,592 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+#pragma once
+
+// Loose uniform grid for gameplay proximity queries
+// Objects are bucketed by the cell containing their center in a hashed, unbounded grid. Queries widen their
+// search by the largest registered radius, so objects never have to be inserted into more than one cell.
+
+#include "CoreMath.h"
+#include "LinearArena.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+namespace Game
+{
+	struct SSpatialObject
+	{
+		SVec3f position;
+		// Extent for radius, box and ray queries, zero for points
+		float radius = 0.f;
+		uint32_t userId = 0;
+		// Queries only return objects whose type mask overlaps the requested one
+		uint32_t typeMask = 0;
+	};
+
+	struct SSpatialRayHit
+	{
+		SSpatialObject object;
+		float distance = 0.f;
+	};
+
+	////////////////////////////////////////////////////////
+	// Double-buffered spatial hash
+	// Insert, Move and Remove are recorded by the owning thread and published by Commit. Queries read the
+	// last published buffer without taking locks, so they may run from job threads. The published buffer stays
+	// untouched until the Commit after next, i.e. queries must not outlive the frame they were started in.
+	////////////////////////////////////////////////////////
+	class CSpatialGrid
+	{
+	public:
+		using THandle = uint32_t;
+		static constexpr THandle kInvalidHandle = ~0u;
+
+		// Cells and pending changes are allocated from the arena if there is one, it has to outlive the grid
+		explicit CSpatialGrid(float cellSize = 8.f, CLinearArena* pArena = nullptr)
+			: m_cellSize(cellSize)
+			, m_inverseCellSize(1.f / cellSize)
+			, m_pArena(pArena)
+			, m_buffers { SBuffer(pArena), SBuffer(pArena) }
+			, m_pendingOperations(TOperationArray::allocator_type(pArena))
+			, m_previousOperations(TOperationArray::allocator_type(pArena))
+			, m_freeHandles(THandleArray::allocator_type(pArena))
+		{
+			m_pPublished.store(&m_buffers[0], std::memory_order_relaxed);
+		}
+
+		CSpatialGrid(const CSpatialGrid&) = delete;
+		CSpatialGrid& operator=(const CSpatialGrid&) = delete;
+
+		// Writer side, owning thread only
+
+		THandle Insert(const SSpatialObject& object)
+		{
+			THandle handle;
+			if (!m_freeHandles.empty())
+			{
+				handle = m_freeHandles.back();
+				m_freeHandles.pop_back();
+			}
+			else
+			{
+				handle = m_handleCount++;
+			}
+
+			m_pendingOperations.push_back(SOperation { EOperation::Insert, handle, object });
+			return handle;
+		}
+
+		void Move(THandle handle, const SVec3f& position)
+		{
+			SOperation operation { EOperation::Move, handle, SSpatialObject() };
+			operation.object.position = position;
+			m_pendingOperations.push_back(operation);
+		}
+
+		void Remove(THandle handle)
+		{
+			m_pendingOperations.push_back(SOperation { EOperation::Remove, handle, SSpatialObject() });
+			m_freeHandles.push_back(handle);
+		}
+
+		// Publishes all changes since the previous commit
+		void Commit()
+		{
+			SBuffer* pPublished = m_pPublished.load(std::memory_order_relaxed);
+			SBuffer& back = pPublished == &m_buffers[0] ? m_buffers[1] : m_buffers[0];
+
+			// The back buffer has missed the changes of the previous commit as well
+			for (const SOperation& operation : m_previousOperations)
+			{
+				Apply(back, operation);
+			}
+			for (const SOperation& operation : m_pendingOperations)
+			{
+				Apply(back, operation);
+			}
+
+			m_pPublished.store(&back, std::memory_order_release);
+
+			m_previousOperations.swap(m_pendingOperations);
+			m_pendingOperations.clear();
+		}
+
+		float GetCellSize() const { return m_cellSize; }
+
+		// Reader side, any thread
+
+		std::size_t GetCount() const { return GetPublished().count; }
+
+		// Calls callback(const SSpatialObject&) for every object whose sphere overlaps the query sphere
+		template<typename TCallback>
+		void QueryRadius(const SVec3f& center, float radius, uint32_t typeMask, TCallback&& callback) const
+		{
+			const SBuffer& buffer = GetPublished();
+			const SVec3f extent(radius, radius, radius);
+
+			ForEachCandidate(buffer, center - extent, center + extent, typeMask, [&](const SSpatialObject& object)
+			{
+				const float reach = radius + object.radius;
+				if ((object.position - center).GetLengthSquared() <= reach * reach)
+				{
+					callback(object);
+				}
+			});
+		}
+
+		// Calls callback(const SSpatialObject&) for every object whose sphere overlaps the box
+		template<typename TCallback>
+		void QueryBox(const SVec3f& boxMin, const SVec3f& boxMax, uint32_t typeMask, TCallback&& callback) const
+		{
+			const SBuffer& buffer = GetPublished();
+
+			ForEachCandidate(buffer, boxMin, boxMax, typeMask, [&](const SSpatialObject& object)
+			{
+				const SVec3f closest(ClampValue(object.position.x, boxMin.x, boxMax.x), ClampValue(object.position.y, boxMin.y, boxMax.y), ClampValue(object.position.z, boxMin.z, boxMax.z));
+				if ((object.position - closest).GetLengthSquared() <= object.radius * object.radius)
+				{
+					callback(object);
+				}
+			});
+		}
+
+		// Closest object sphere hit by the ray, the direction has to be normalized
+		bool Raycast(const SVec3f& origin, const SVec3f& direction, float maxDistance, uint32_t typeMask, SSpatialRayHit& outHit) const
+		{
+			const SBuffer& buffer = GetPublished();
+			if (buffer.count == 0)
+			{
+				return false;
+			}
+
+			// Objects reach into neighbouring cells by up to their radius, clamped before the cast like the rings of QueryNearest
+			constexpr double kMaxReach = static_cast<double>(1 << kCellKeyBits);
+			const double reach = std::ceil(static_cast<double>(buffer.maxRadius) * m_inverseCellSize);
+			const int32_t reachCells = reach < kMaxReach ? static_cast<int32_t>(reach) : static_cast<int32_t>(kMaxReach);
+			// Cells looked up per step of the walk, see the occupied-cell scan below
+			const double reachExtent = 2.0 * reachCells + 1.0;
+			const double cellsPerStep = reachExtent * reachExtent * reachExtent;
+
+			int32_t cell[3] = { ToCell(origin.x), ToCell(origin.y), ToCell(origin.z) };
+			const float originComponents[3] = { origin.x, origin.y, origin.z };
+			const float directionComponents[3] = { direction.x, direction.y, direction.z };
+
+			int32_t step[3];
+			float nextBoundary[3];
+			float boundaryInterval[3];
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				const float component = directionComponents[axis];
+				step[axis] = component > 0.f ? 1 : (component < 0.f ? -1 : 0);
+
+				if (step[axis] == 0)
+				{
+					nextBoundary[axis] = maxDistance + 1.f;
+					boundaryInterval[axis] = 0.f;
+					continue;
+				}
+
+				const float boundary = static_cast<float>(cell[axis] + (step[axis] > 0 ? 1 : 0)) * m_cellSize;
+				nextBoundary[axis] = (boundary - originComponents[axis]) / component;
+				boundaryInterval[axis] = m_cellSize / std::fabs(component);
+			}
+
+			bool hasHit = false;
+			float cellEntry = 0.f;
+
+			const auto test = [&](const SSpatialObject& object)
+			{
+				const float distance = IntersectRay(origin, direction, object);
+				if (distance >= 0.f && distance <= maxDistance && (!hasHit || distance < outHit.distance))
+				{
+					hasHit = true;
+					outHit.object = object;
+					outHit.distance = distance;
+				}
+			};
+
+			for (double visitedCells = 0.0; cellEntry <= maxDistance; visitedCells += cellsPerStep)
+			{
+				// Any object hit before this cell was reachable from a cell visited earlier
+				if (hasHit && outHit.distance <= cellEntry)
+				{
+					break;
+				}
+
+				// Once the walk would look up more cells than are occupied, e.g. for FLT_MAX or a ray leaving the level, scan the occupied cells instead
+				if (visitedCells + cellsPerStep > static_cast<double>(buffer.cells.size()))
+				{
+					ForEachOccupied(buffer, typeMask, test);
+					break;
+				}
+
+				ForEachInCellRange(buffer, cell[0] - reachCells, cell[1] - reachCells, cell[2] - reachCells, cell[0] + reachCells, cell[1] + reachCells, cell[2] + reachCells, typeMask, test);
+
+				const int axis = nextBoundary[0] < nextBoundary[1] ? (nextBoundary[0] < nextBoundary[2] ? 0 : 2) : (nextBoundary[1] < nextBoundary[2] ? 1 : 2);
+				cellEntry = nextBoundary[axis];
+				nextBoundary[axis] += boundaryInterval[axis];
+				cell[axis] += step[axis];
+			}
+
+			return hasHit;
+		}
+
+		// Up to count objects closest to the point, nearest first, ignoring radii
+		std::size_t QueryNearest(const SVec3f& point, std::size_t count, float maxDistance, uint32_t typeMask, std::vector<SSpatialObject>& outObjects) const
+		{
+			outObjects.clear();
+
+			const SBuffer& buffer = GetPublished();
+			if (count == 0 || buffer.count == 0)
+			{
+				return 0;
+			}
+
+			struct SCandidate
+			{
+				float distanceSquared;
+				SSpatialObject object;
+
+				bool operator<(const SCandidate& other) const { return distanceSquared < other.distanceSquared; }
+			};
+
+			// Max-heap of the best candidates so far, thread_local so that concurrent queries don't allocate
+			static thread_local std::vector<SCandidate> candidates;
+			candidates.clear();
+
+			const float maxDistanceSquared = maxDistance * maxDistance;
+			const int32_t centerCell[3] = { ToCell(point.x), ToCell(point.y), ToCell(point.z) };
+			// Clamped before the cast, FLT_MAX or infinity ask for an unbounded search; the occupied-cell scan below ends it early
+			constexpr double kMaxRing = static_cast<double>(std::numeric_limits<int32_t>::max() - 1);
+			const double ringCount = std::ceil(static_cast<double>(maxDistance) * m_inverseCellSize) + 1.0;
+			const int32_t maxRing = ringCount < kMaxRing ? static_cast<int32_t>(ringCount) : static_cast<int32_t>(kMaxRing);
+
+			const auto consider = [&](const SSpatialObject& object)
+			{
+				const float distanceSquared = (object.position - point).GetLengthSquared();
+				if (distanceSquared > maxDistanceSquared)
+				{
+					return;
+				}
+
+				if (candidates.size() < count)
+				{
+					candidates.push_back(SCandidate { distanceSquared, object });
+					std::push_heap(candidates.begin(), candidates.end());
+				}
+				else if (distanceSquared < candidates.front().distanceSquared)
+				{
+					std::pop_heap(candidates.begin(), candidates.end());
+					candidates.back() = SCandidate { distanceSquared, object };
+					std::push_heap(candidates.begin(), candidates.end());
+				}
+			};
+
+			for (int32_t ring = 0; ring <= maxRing; ++ring)
+			{
+				// Once the rings cover more cells than are occupied, e.g. for sparse types, scan the occupied cells instead
+				const double ringExtent = 2.0 * ring + 1.0;
+				if (ringExtent * ringExtent * ringExtent > static_cast<double>(buffer.cells.size()))
+				{
+					candidates.clear();
+					ForEachOccupied(buffer, typeMask, consider);
+					break;
+				}
+
+				ForEachInRing(buffer, centerCell, ring, typeMask, consider);
+
+				// Cells of the next ring are at least this far away from the point
+				const float nextRingDistance = static_cast<float>(ring) * m_cellSize;
+				if (candidates.size() == count && candidates.front().distanceSquared <= nextRingDistance * nextRingDistance)
+				{
+					break;
+				}
+			}
+
+			std::sort_heap(candidates.begin(), candidates.end());
+			for (const SCandidate& candidate : candidates)
+			{
+				outObjects.push_back(candidate.object);
+			}
+
+			return outObjects.size();
+		}
+
+	private:
+		enum class EOperation : uint8_t
+		{
+			Insert,
+			Move,
+			Remove
+		};
+
+		struct SOperation
+		{
+			EOperation type;
+			THandle handle;
+			SSpatialObject object;
+		};
+
+		struct SCellEntry
+		{
+			SSpatialObject object;
+			THandle handle;
+		};
+
+		struct SSlot
+		{
+			uint64_t cellKey = 0;
+			uint32_t indexInCell = 0;
+			bool isUsed = false;
+		};
+
+		using TCell = std::vector<SCellEntry, SArenaAllocator<SCellEntry>>;
+		using TCellMap = std::unordered_map<uint64_t, TCell, std::hash<uint64_t>, std::equal_to<uint64_t>, SArenaAllocator<std::pair<const uint64_t, TCell>>>;
+		using TOperationArray = std::vector<SOperation, SArenaAllocator<SOperation>>;
+		using THandleArray = std::vector<THandle, SArenaAllocator<THandle>>;
+
+		struct SBuffer
+		{
+			explicit SBuffer(CLinearArena* pArena)
+				: slots(std::vector<SSlot, SArenaAllocator<SSlot>>::allocator_type(pArena))
+				, cells(TCellMap::allocator_type(pArena))
+			{
+			}
+
+			std::vector<SSlot, SArenaAllocator<SSlot>> slots;
+			TCellMap cells;
+			// Only grows, shrinking would require a scan over all objects
+			float maxRadius = 0.f;
+			std::size_t count = 0;
+		};
+
+		static constexpr int32_t kCellKeyBits = 21;
+		static constexpr int32_t kCellKeyOffset = 1 << (kCellKeyBits - 1);
+
+		const SBuffer& GetPublished() const { return *m_pPublished.load(std::memory_order_acquire); }
+
+		int32_t ToCell(float value) const { return static_cast<int32_t>(std::floor(value * m_inverseCellSize)); }
+
+		static uint64_t MakeCellKey(int32_t x, int32_t y, int32_t z)
+		{
+			const uint64_t mask = (1ull << kCellKeyBits) - 1;
+			return (static_cast<uint64_t>(x + kCellKeyOffset) & mask)
+				| ((static_cast<uint64_t>(y + kCellKeyOffset) & mask) << kCellKeyBits)
+				| ((static_cast<uint64_t>(z + kCellKeyOffset) & mask) << (kCellKeyBits * 2));
+		}
+
+		uint64_t GetCellKey(const SVec3f& position) const
+		{
+			return MakeCellKey(ToCell(position.x), ToCell(position.y), ToCell(position.z));
+		}
+
+		static float IntersectRay(const SVec3f& origin, const SVec3f& direction, const SSpatialObject& object)
+		{
+			const SVec3f offset = origin - object.position;
+			const float b = offset.Dot(direction);
+			const float c = offset.GetLengthSquared() - object.radius * object.radius;
+			if (c <= 0.f)
+			{
+				return 0.f;
+			}
+
+			const float discriminant = b * b - c;
+			return b > 0.f || discriminant < 0.f ? -1.f : -b - std::sqrt(discriminant);
+		}
+
+		void AddToCell(SBuffer& buffer, THandle handle, const SSpatialObject& object)
+		{
+			SSlot& slot = buffer.slots[handle];
+			slot.cellKey = GetCellKey(object.position);
+
+			auto it = buffer.cells.find(slot.cellKey);
+			if (it == buffer.cells.end())
+			{
+				it = buffer.cells.emplace(slot.cellKey, TCell(TCell::allocator_type(m_pArena))).first;
+			}
+
+			TCell& cell = it->second;
+			slot.indexInCell = static_cast<uint32_t>(cell.size());
+			cell.push_back(SCellEntry { object, handle });
+		}
+
+		SSpatialObject RemoveFromCell(SBuffer& buffer, THandle handle)
+		{
+			const SSlot& slot = buffer.slots[handle];
+			TCell& cell = buffer.cells.find(slot.cellKey)->second;
+
+			const SSpatialObject object = cell[slot.indexInCell].object;
+			if (slot.indexInCell + 1 != cell.size())
+			{
+				cell[slot.indexInCell] = cell.back();
+				buffer.slots[cell[slot.indexInCell].handle].indexInCell = slot.indexInCell;
+			}
+			cell.pop_back();
+
+			// Empty cells are kept, objects tend to come back and the vector keeps its capacity
+			return object;
+		}
+
+		void Apply(SBuffer& buffer, const SOperation& operation)
+		{
+			if (operation.handle >= buffer.slots.size())
+			{
+				buffer.slots.resize(operation.handle + 1);
+			}
+
+			SSlot& slot = buffer.slots[operation.handle];
+
+			switch (operation.type)
+			{
+			case EOperation::Insert:
+			{
+				slot.isUsed = true;
+				AddToCell(buffer, operation.handle, operation.object);
+				buffer.maxRadius = std::max(buffer.maxRadius, operation.object.radius);
+				++buffer.count;
+				break;
+			}
+			case EOperation::Move:
+			{
+				if (!slot.isUsed)
+				{
+					break;
+				}
+
+				// Moving within the cell only touches the stored position
+				if (GetCellKey(operation.object.position) == slot.cellKey)
+				{
+					buffer.cells.find(slot.cellKey)->second[slot.indexInCell].object.position = operation.object.position;
+					break;
+				}
+
+				SSpatialObject object = RemoveFromCell(buffer, operation.handle);
+				object.position = operation.object.position;
+				AddToCell(buffer, operation.handle, object);
+				break;
+			}
+			case EOperation::Remove:
+			{
+				if (slot.isUsed)
+				{
+					RemoveFromCell(buffer, operation.handle);
+					slot.isUsed = false;
+					--buffer.count;
+				}
+				break;
+			}
+			}
+		}
+
+		template<typename TCallback>
+		void ForEachInCellRange(const SBuffer& buffer, int32_t minX, int32_t minY, int32_t minZ, int32_t maxX, int32_t maxY, int32_t maxZ, uint32_t typeMask, TCallback&& callback) const
+		{
+			for (int32_t z = minZ; z <= maxZ; ++z)
+			{
+				for (int32_t y = minY; y <= maxY; ++y)
+				{
+					for (int32_t x = minX; x <= maxX; ++x)
+					{
+						const auto it = buffer.cells.find(MakeCellKey(x, y, z));
+						if (it == buffer.cells.end())
+						{
+							continue;
+						}
+
+						for (const SCellEntry& entry : it->second)
+						{
+							if (entry.object.typeMask & typeMask)
+							{
+								callback(entry.object);
+							}
+						}
+					}
+				}
+			}
+		}
+
+		template<typename TCallback>
+		static void ForEachOccupied(const SBuffer& buffer, uint32_t typeMask, TCallback&& callback)
+		{
+			for (const auto& cell : buffer.cells)
+			{
+				for (const SCellEntry& entry : cell.second)
+				{
+					if (entry.object.typeMask & typeMask)
+					{
+						callback(entry.object);
+					}
+				}
+			}
+		}
+
+		// Objects in cells that may overlap the box once the largest radius is taken into account
+		template<typename TCallback>
+		void ForEachCandidate(const SBuffer& buffer, const SVec3f& boxMin, const SVec3f& boxMax, uint32_t typeMask, TCallback&& callback) const
+		{
+			const float margin = buffer.maxRadius;
+			const int32_t minX = ToCell(boxMin.x - margin), minY = ToCell(boxMin.y - margin), minZ = ToCell(boxMin.z - margin);
+			const int32_t maxX = ToCell(boxMax.x + margin), maxY = ToCell(boxMax.y + margin), maxZ = ToCell(boxMax.z + margin);
+
+			// Huge queries are cheaper as a walk over the occupied cells
+			const double rangeCellCount = static_cast<double>(maxX - minX + 1) * (maxY - minY + 1) * (maxZ - minZ + 1);
+			if (rangeCellCount > static_cast<double>(buffer.cells.size()))
+			{
+				ForEachOccupied(buffer, typeMask, callback);
+				return;
+			}
+
+			ForEachInCellRange(buffer, minX, minY, minZ, maxX, maxY, maxZ, typeMask, callback);
+		}
+
+		// Cells at exactly the given Chebyshev distance from the center cell
+		template<typename TCallback>
+		void ForEachInRing(const SBuffer& buffer, const int32_t* pCenterCell, int32_t ring, uint32_t typeMask, TCallback&& callback) const
+		{
+			const int32_t minX = pCenterCell[0] - ring, maxX = pCenterCell[0] + ring;
+			const int32_t minY = pCenterCell[1] - ring, maxY = pCenterCell[1] + ring;
+			const int32_t minZ = pCenterCell[2] - ring, maxZ = pCenterCell[2] + ring;
+
+			for (int32_t z = minZ; z <= maxZ; ++z)
+			{
+				const bool isZFace = z == minZ || z == maxZ;
+				for (int32_t y = minY; y <= maxY; ++y)
+				{
+					const bool isYFace = y == minY || y == maxY;
+					if (isZFace || isYFace)
+					{
+						ForEachInCellRange(buffer, minX, y, z, maxX, y, z, typeMask, callback);
+					}
+					else
+					{
+						ForEachInCellRange(buffer, minX, y, z, minX, y, z, typeMask, callback);
+						if (maxX != minX)
+						{
+							ForEachInCellRange(buffer, maxX, y, z, maxX, y, z, typeMask, callback);
+						}
+					}
+				}
+			}
+		}
+
+	private:
+		const float m_cellSize;
+		const float m_inverseCellSize;
+		CLinearArena* const m_pArena;
+
+		SBuffer m_buffers[2];
+		std::atomic<SBuffer*> m_pPublished;
+
+		TOperationArray m_pendingOperations;
+		TOperationArray m_previousOperations;
+		THandleArray m_freeHandles;
+		THandle m_handleCount = 0;
+	};
+}
@@ -0,0 +1,141 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+#pragma once
+
+// Engine independent spawn point selection, used by CSpawnPointRegistry and offline tools
+
+#include "CoreMath.h"
+
+#include <cstddef>
+
+namespace Game
+{
+	enum class ESpawnSelectionPolicy
+	{
+		// The first spawn point that was registered
+		First = 0,
+		// Cycles through all spawn points in registration order
+		RoundRobin,
+		// Uniformly random spawn point
+		Random,
+		// The spawn point with the largest distance to the closest other player
+		FarthestFromEnemies,
+		// The spawn point that has not been used for the longest time
+		LeastRecentlyUsed
+	};
+
+	struct SSpawnCandidate
+	{
+		SVec3f position;
+		float lastUsedTime = 0.f;
+		// Already handed out in the current batch, never selected while unclaimed candidates are left
+		bool isClaimed = false;
+	};
+
+	// Returns the index of the selected candidate, count has to be at least one
+	// getClosestEnemyDistanceSquared(const SVec3f&) is only called by FarthestFromEnemies, getRandomIndex(size_t n)
+	// has to return a value in [0, n) and is only called by Random. Neither the candidates nor the clock are modified,
+	// marking the selection as used is up to the caller.
+	template<typename TGetClosestEnemyDistanceSquared, typename TGetRandomIndex>
+	std::size_t SelectSpawnCandidate(ESpawnSelectionPolicy policy, const SSpawnCandidate* pCandidates, std::size_t count, std::size_t& nextRoundRobinIndex,
+	                                 TGetClosestEnemyDistanceSquared&& getClosestEnemyDistanceSquared, TGetRandomIndex&& getRandomIndex)
+	{
+		switch (policy)
+		{
+		case ESpawnSelectionPolicy::First:
+		{
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				if (!pCandidates[i].isClaimed)
+				{
+					return i;
+				}
+			}
+			break;
+		}
+		case ESpawnSelectionPolicy::RoundRobin:
+		{
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				const std::size_t index = (nextRoundRobinIndex + i) % count;
+				if (!pCandidates[index].isClaimed)
+				{
+					nextRoundRobinIndex = (index + 1) % count;
+					return index;
+				}
+			}
+			break;
+		}
+		case ESpawnSelectionPolicy::Random:
+		{
+			std::size_t availableCount = 0;
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				availableCount += pCandidates[i].isClaimed ? 0 : 1;
+			}
+
+			if (availableCount == 0)
+			{
+				break;
+			}
+
+			std::size_t remaining = getRandomIndex(availableCount);
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				if (!pCandidates[i].isClaimed && remaining-- == 0)
+				{
+					return i;
+				}
+			}
+			break;
+		}
+		case ESpawnSelectionPolicy::FarthestFromEnemies:
+		{
+			std::size_t bestIndex = count;
+			float bestDistanceSquared = -1.f;
+
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				if (pCandidates[i].isClaimed)
+				{
+					continue;
+				}
+
+				const float distanceSquared = getClosestEnemyDistanceSquared(pCandidates[i].position);
+
+				// Ties, e.g. several spawn points without any enemy in range, go to the least recently used one
+				if (bestIndex == count || distanceSquared > bestDistanceSquared || (distanceSquared == bestDistanceSquared && pCandidates[i].lastUsedTime < pCandidates[bestIndex].lastUsedTime))
+				{
+					bestIndex = i;
+					bestDistanceSquared = distanceSquared;
+				}
+			}
+
+			if (bestIndex != count)
+			{
+				return bestIndex;
+			}
+			break;
+		}
+		case ESpawnSelectionPolicy::LeastRecentlyUsed:
+		{
+			std::size_t bestIndex = count;
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				if (!pCandidates[i].isClaimed && (bestIndex == count || pCandidates[i].lastUsedTime < pCandidates[bestIndex].lastUsedTime))
+				{
+					bestIndex = i;
+				}
+			}
+
+			if (bestIndex != count)
+			{
+				return bestIndex;
+			}
+			break;
+		}
+		}
+
+		return 0;
+	}
+}
@@ -0,0 +1,61 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace Game
+{
+	////////////////////////////////////////////////////////
+	// Bounded lock-free queue for exactly one producer thread and one consumer thread
+	// Pushing into a full ring fails instead of blocking or allocating, the caller decides what to drop.
+	////////////////////////////////////////////////////////
+	template<typename T, std::size_t Capacity>
+	class CSpscRing
+	{
+		static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+	public:
+		// Producer thread only
+		bool TryPush(const T& value)
+		{
+			const std::size_t head = m_head.load(std::memory_order_relaxed);
+			if (head - m_tail.load(std::memory_order_acquire) == Capacity)
+			{
+				return false;
+			}
+
+			m_items[head & (Capacity - 1)] = value;
+			m_head.store(head + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Consumer thread only
+		bool TryPop(T& outValue)
+		{
+			const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+			if (tail == m_head.load(std::memory_order_acquire))
+			{
+				return false;
+			}
+
+			outValue = m_items[tail & (Capacity - 1)];
+			m_tail.store(tail + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Exact only when called from one of the two threads while the other one is idle
+		std::size_t GetSize() const { return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire); }
+		bool IsEmpty() const { return GetSize() == 0; }
+
+		static constexpr std::size_t GetCapacity() { return Capacity; }
+
+	private:
+		// Kept on separate cache lines so that producer and consumer don't invalidate each other's index
+		alignas(64) std::atomic<std::size_t> m_head { 0 };
+		alignas(64) std::atomic<std::size_t> m_tail { 0 };
+		std::array<T, Capacity> m_items;
+	};
+}
@@ -0,0 +1,151 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+#pragma once
+
+// Recorded entity state for offline analysis of the network compression policies
+// The game writes one sample per replicated field and frame, tools read them back. Samples are fixed size and
+// stored in the byte order of the recording machine.
+
+#include <cstdint>
+#include <cstdio>
+
+namespace Game
+{
+	constexpr uint32_t MakeStateTag(char a, char b, char c, char d)
+	{
+		return static_cast<uint32_t>(static_cast<uint8_t>(a)) | static_cast<uint32_t>(static_cast<uint8_t>(b)) << 8
+			| static_cast<uint32_t>(static_cast<uint8_t>(c)) << 16 | static_cast<uint32_t>(static_cast<uint8_t>(d)) << 24;
+	}
+
+	// Recorded fields, the values are laid out as in the matching policy
+	enum EStateField : uint32_t
+	{
+		eStateField_PlayerPosition = MakeStateTag('p', 'p', 'o', 's'),
+		eStateField_PlayerVelocity = MakeStateTag('p', 'v', 'e', 'l'),
+		// Quaternion as x, y, z, w
+		eStateField_PlayerRotation = MakeStateTag('p', 'r', 'o', 't'),
+		eStateField_BulletPosition = MakeStateTag('b', 'p', 'o', 's'),
+		eStateField_BulletVelocity = MakeStateTag('b', 'v', 'e', 'l'),
+		eStateField_BulletRotation = MakeStateTag('b', 'r', 'o', 't'),
+		eStateField_ProjectilePosition = MakeStateTag('j', 'p', 'o', 's'),
+		eStateField_ProjectileVelocity = MakeStateTag('j', 'v', 'e', 'l')
+	};
+
+	struct SStateSample
+	{
+		float time = 0.f;
+		uint32_t entityId = 0;
+		EStateField field = eStateField_PlayerPosition;
+		// Compression policy the field is serialized with today, e.g. 'wrld', zero if it isn't replicated
+		uint32_t policy = 0;
+		uint32_t componentCount = 0;
+		float values[4] = {};
+	};
+
+	// Writes the four characters of a tag and a terminator into buffer
+	inline const char* GetStateTagName(uint32_t tag, char (&buffer)[5])
+	{
+		for (int i = 0; i < 4; ++i)
+		{
+			const char c = static_cast<char>((tag >> (i * 8)) & 0xFF);
+			buffer[i] = c != 0 ? c : ' ';
+		}
+		buffer[4] = '\0';
+		return buffer;
+	}
+
+	////////////////////////////////////////////////////////
+	// Sequential writer and reader of state samples
+	////////////////////////////////////////////////////////
+	class CStateStreamWriter
+	{
+	public:
+		~CStateStreamWriter() { Close(); }
+
+		bool Open(const char* szPath)
+		{
+			Close();
+			m_pFile = std::fopen(szPath, "wb");
+			if (m_pFile == nullptr)
+			{
+				return false;
+			}
+
+			const uint32_t header[2] = { kMagic, kVersion };
+			return std::fwrite(header, sizeof(header), 1, m_pFile) == 1;
+		}
+
+		void Close()
+		{
+			if (m_pFile != nullptr)
+			{
+				std::fclose(m_pFile);
+				m_pFile = nullptr;
+			}
+		}
+
+		bool IsOpen() const { return m_pFile != nullptr; }
+
+		bool Write(const SStateSample& sample)
+		{
+			if (m_pFile == nullptr || std::fwrite(&sample, sizeof(sample), 1, m_pFile) != 1)
+			{
+				return false;
+			}
+			++m_sampleCount;
+			return true;
+		}
+
+		uint64_t GetSampleCount() const { return m_sampleCount; }
+
+		static constexpr uint32_t kMagic = MakeStateTag('G', 'S', 'S', 'T');
+		static constexpr uint32_t kVersion = 1;
+
+	private:
+		std::FILE* m_pFile = nullptr;
+		uint64_t m_sampleCount = 0;
+	};
+
+	class CStateStreamReader
+	{
+	public:
+		~CStateStreamReader() { Close(); }
+
+		// Fails for missing files and for files of another format or version
+		bool Open(const char* szPath)
+		{
+			Close();
+			m_pFile = std::fopen(szPath, "rb");
+			if (m_pFile == nullptr)
+			{
+				return false;
+			}
+
+			uint32_t header[2];
+			if (std::fread(header, sizeof(header), 1, m_pFile) != 1 || header[0] != CStateStreamWriter::kMagic || header[1] != CStateStreamWriter::kVersion)
+			{
+				Close();
+				return false;
+			}
+			return true;
+		}
+
+		void Close()
+		{
+			if (m_pFile != nullptr)
+			{
+				std::fclose(m_pFile);
+				m_pFile = nullptr;
+			}
+		}
+
+		// Returns false at the end of the stream
+		bool Read(SStateSample& outSample)
+		{
+			return m_pFile != nullptr && std::fread(&outSample, sizeof(outSample), 1, m_pFile) == 1 && outSample.componentCount <= 4;
+		}
+
+	private:
+		std::FILE* m_pFile = nullptr;
+	};
+}
@@ -0,0 +1,198 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+#pragma once
+
+// Runs the simulation in ticks of a fixed length, independent of the frame rate
+// Tasks are registered in the order they run within a tick. Every task has a time budget: a deferrable task
+// that overran its budget, or that would start after the tick already used up its own budget, skips ticks and
+// catches up with their summed length once it runs again. Tasks that can't be deferred run every tick.
+
+#include "FixedTimestep.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace Game
+{
+	struct STickTaskStatistics
+	{
+		uint64_t runs = 0;
+		uint64_t overruns = 0;
+		uint64_t deferrals = 0;
+		uint64_t totalNs = 0;
+		uint64_t maxNs = 0;
+	};
+
+	struct STickStatistics
+	{
+		uint64_t frames = 0;
+		uint64_t ticks = 0;
+		// Ticks beyond the catch-up limit, their time is lost to the simulation
+		uint64_t droppedTicks = 0;
+		// Ticks whose tasks took longer than the tick budget
+		uint64_t overBudgetTicks = 0;
+		uint32_t maxTicksPerFrame = 0;
+		uint64_t maxTickNs = 0;
+	};
+
+	////////////////////////////////////////////////////////
+	// Fixed rate tick scheduler with per-task time budgets
+	// Tasks are plain function pointers with a context, so that running them doesn't allocate and the scheduler
+	// doesn't need to know the systems it runs.
+	////////////////////////////////////////////////////////
+	class CTickScheduler
+	{
+	public:
+		using TTaskFunction = void (*)(void* pContext, float deltaTime);
+
+		static constexpr std::size_t kMaxTasks = 16;
+		static constexpr std::size_t kInvalidTask = kMaxTasks;
+
+		// maxDeferredTicks is how many ticks in a row the task may skip, 0 runs it every tick
+		std::size_t AddTask(const char* szName, TTaskFunction pFunction, void* pContext, uint64_t budgetNs, uint32_t maxDeferredTicks)
+		{
+			if (m_taskCount == kMaxTasks)
+			{
+				return kInvalidTask;
+			}
+
+			STask& task = m_tasks[m_taskCount];
+			task = STask();
+			task.szName = szName;
+			task.pFunction = pFunction;
+			task.pContext = pContext;
+			task.budgetNs = budgetNs;
+			task.maxDeferredTicks = maxDeferredTicks;
+			return m_taskCount++;
+		}
+
+		// A rate of zero runs one tick of the frame's length per frame
+		void SetRate(float ticksPerSecond) { m_timestep.SetRate(ticksPerSecond); }
+		// Frames that fall further behind drop the rest of their backlog
+		void SetMaxTicksPerFrame(uint32_t maxTicks) { m_maxTicksPerFrame = maxTicks > 0 ? maxTicks : 1; }
+		// Time the tasks of one tick may take together before deferrable tasks are skipped, 0 is the tick length
+		void SetTickBudget(uint64_t budgetNs) { m_tickBudgetNs = budgetNs; }
+		void SetTaskBudget(std::size_t index, uint64_t budgetNs) { m_tasks[index].budgetNs = budgetNs; }
+
+		// Runs the ticks that are due after a frame of the given length and returns their number
+		uint32_t Update(float frameTime)
+		{
+			const uint32_t dueTickCount = m_timestep.Advance(frameTime, ~0u);
+			const uint32_t tickCount = dueTickCount < m_maxTicksPerFrame ? dueTickCount : m_maxTicksPerFrame;
+
+			++m_statistics.frames;
+			m_statistics.droppedTicks += dueTickCount - tickCount;
+			m_statistics.maxTicksPerFrame = tickCount > m_statistics.maxTicksPerFrame ? tickCount : m_statistics.maxTicksPerFrame;
+
+			const float tickLength = m_timestep.GetTickLength();
+			const uint64_t tickBudgetNs = m_tickBudgetNs > 0 ? m_tickBudgetNs : static_cast<uint64_t>(static_cast<double>(tickLength) * 1e9);
+
+			for (uint32_t tick = 0; tick < tickCount; ++tick)
+			{
+				RunTick(tickLength, tickBudgetNs);
+			}
+			return tickCount;
+		}
+
+		bool IsFixed() const { return m_timestep.IsFixed(); }
+		float GetTickLength() const { return m_timestep.GetTickLength(); }
+		// Fraction of a tick that has passed since the last tick, for interpolating presentation
+		float GetAlpha() const { return m_timestep.GetAlpha(); }
+
+		std::size_t GetTaskCount() const { return m_taskCount; }
+		const char* GetTaskName(std::size_t index) const { return m_tasks[index].szName; }
+		uint64_t GetTaskBudget(std::size_t index) const { return m_tasks[index].budgetNs; }
+		const STickTaskStatistics& GetTaskStatistics(std::size_t index) const { return m_tasks[index].statistics; }
+		const STickStatistics& GetStatistics() const { return m_statistics; }
+
+		void ResetStatistics()
+		{
+			m_statistics = STickStatistics();
+			for (std::size_t i = 0; i < m_taskCount; ++i)
+			{
+				m_tasks[i].statistics = STickTaskStatistics();
+			}
+		}
+
+		// Forgets the backlog and the deferred time, e.g. when a level is unloaded
+		void Reset()
+		{
+			m_timestep.Reset();
+			for (std::size_t i = 0; i < m_taskCount; ++i)
+			{
+				m_tasks[i].pendingTime = 0.f;
+				m_tasks[i].deferredTicks = 0;
+				m_tasks[i].lastNs = 0;
+			}
+		}
+
+		static uint64_t GetTimeNs()
+		{
+			return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+		}
+
+	private:
+		struct STask
+		{
+			const char* szName = nullptr;
+			TTaskFunction pFunction = nullptr;
+			void* pContext = nullptr;
+			uint64_t budgetNs = 0;
+			uint32_t maxDeferredTicks = 0;
+			// Length of the ticks skipped since the last run
+			float pendingTime = 0.f;
+			uint32_t deferredTicks = 0;
+			uint64_t lastNs = 0;
+			STickTaskStatistics statistics;
+		};
+
+		void RunTick(float tickLength, uint64_t tickBudgetNs)
+		{
+			const uint64_t tickStartNs = GetTimeNs();
+			uint64_t nowNs = tickStartNs;
+
+			for (std::size_t i = 0; i < m_taskCount; ++i)
+			{
+				STask& task = m_tasks[i];
+				task.pendingTime += tickLength;
+
+				const bool isOverBudget = task.lastNs > task.budgetNs || nowNs - tickStartNs > tickBudgetNs;
+				if (isOverBudget && task.deferredTicks < task.maxDeferredTicks)
+				{
+					++task.deferredTicks;
+					++task.statistics.deferrals;
+					continue;
+				}
+
+				task.pFunction(task.pContext, task.pendingTime);
+
+				const uint64_t endNs = GetTimeNs();
+				const uint64_t durationNs = endNs - nowNs;
+				nowNs = endNs;
+
+				task.pendingTime = 0.f;
+				task.deferredTicks = 0;
+				task.lastNs = durationNs;
+
+				++task.statistics.runs;
+				task.statistics.overruns += durationNs > task.budgetNs ? 1 : 0;
+				task.statistics.totalNs += durationNs;
+				task.statistics.maxNs = durationNs > task.statistics.maxNs ? durationNs : task.statistics.maxNs;
+			}
+
+			const uint64_t tickNs = nowNs - tickStartNs;
+			++m_statistics.ticks;
+			m_statistics.overBudgetTicks += tickNs > tickBudgetNs ? 1 : 0;
+			m_statistics.maxTickNs = tickNs > m_statistics.maxTickNs ? tickNs : m_statistics.maxTickNs;
+		}
+
+	private:
+		CFixedTimestep m_timestep;
+		uint32_t m_maxTicksPerFrame = 4;
+		uint64_t m_tickBudgetNs = 0;
+		STask m_tasks[kMaxTasks];
+		std::size_t m_taskCount = 0;
+		STickStatistics m_statistics;
+	};
+}
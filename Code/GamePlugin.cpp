@@ -1,6 +1,24 @@
 // Copyright 2016-2019 Crytek GmbH / Crytek Group. All rights reserved.
 #include "StdAfx.h"
 #include "GamePlugin.h"
+#include "Components/Player.h"
+#include "Systems/AssetPreloader.h"
+#include "Systems/BotDriver.h"
+#include "Systems/BulletPool.h"
+#include "Systems/CharacterAnimation.h"
+#include "Systems/GameRecorder.h"
+#include "Systems/GameProfiler.h"
+#include "Systems/ImpactSystem.h"
+#include "Systems/LagCompensation.h"
+#include "Systems/LevelMemory.h"
+#include "Systems/NetRelevancy.h"
+#include "Systems/PlayerSystem.h"
+#include "Systems/ProjectileSystem.h"
+#include "Systems/ResourceHandles.h"
+#include "Systems/ServerTick.h"
+#include "Systems/SpatialIndex.h"
+#include "Systems/SpawnPointRegistry.h"
+#include "Systems/StateRecorder.h"
 
 #include <CrySchematyc/Env/IEnvRegistry.h>
 #include <CrySchematyc/Env/EnvPackage.h>
@@ -17,6 +35,8 @@ CGamePlugin::~CGamePlugin()
 
 	gEnv->pSystem->GetISystemEventDispatcher()->RemoveListener(this);
 
+	Game::CPlayerComponent::UnregisterCVars();
+
 	if (gEnv->pSchematyc)
 	{
 		gEnv->pSchematyc->GetEnvRegistry().DeregisterPackage(CGamePlugin::GetCID());
@@ -27,10 +47,52 @@ bool CGamePlugin::Initialize(SSystemGlobalEnvironment& env, const SSystemInitPar
 {
 	// Register for engine system events, in our case we need ESYSTEM_EVENT_GAME_POST_INIT to load the map
 	gEnv->pSystem->GetISystemEventDispatcher()->RegisterListener(this, "CGamePlugin");
+
+	Game::CPlayerComponent::RegisterCVars();
+
+	m_pProfiler = stl::make_unique<Game::CGameProfiler>();
+	m_pLevelMemory = stl::make_unique<Game::CLevelMemory>();
+	m_pSpatialIndex = stl::make_unique<Game::CSpatialIndex>();
+	m_pBulletPool = stl::make_unique<Game::CBulletPool>();
+	m_pLagCompensation = stl::make_unique<Game::CLagCompensation>();
+	m_pPlayerSystem = stl::make_unique<Game::CPlayerSystem>();
+	m_pProjectileSystem = stl::make_unique<Game::CProjectileSystem>();
+	m_pSpawnPointRegistry = stl::make_unique<Game::CSpawnPointRegistry>();
+	m_pNetRelevancy = stl::make_unique<Game::CNetRelevancy>();
+	m_pStateRecorder = stl::make_unique<Game::CStateRecorder>();
+	m_pGameRecorder = stl::make_unique<Game::CGameRecorder>();
+	m_pAssetPreloader = stl::make_unique<Game::CAssetPreloader>();
+	m_pResourceHandles = stl::make_unique<Game::CResourceHandles>();
+	m_pCharacterAnimation = stl::make_unique<Game::CCharacterAnimation>();
+	m_pBotDriver = stl::make_unique<Game::CBotDriver>();
+	m_pImpactSystem = stl::make_unique<Game::CImpactSystem>();
+	m_pServerTick = stl::make_unique<Game::CServerTick>();
+
+	// Gameplay systems that are not owned by an entity are ticked from the plug-in
+	EnableUpdate(EUpdateStep::MainUpdate, true);
 	
 	return true;
 }
 
+void CGamePlugin::MainUpdate(float frameTime)
+{
+	// Everything recorded since the previous main update counts as one frame
+	m_pProfiler->EndFrame();
+
+	GAME_PROFILE_SCOPE("CGamePlugin::MainUpdate");
+
+	m_pAssetPreloader->Update();
+
+	// Replayed input has to be in place before the players read it
+	m_pGameRecorder->UpdateReplay(frameTime);
+	// Bot input takes the place of client input packets, also before the players read it
+	m_pBotDriver->Update(frameTime);
+	// Players, animation, bullets, projectiles, impacts, lag compensation and relevancy, at the server tick rate
+	m_pServerTick->Update(frameTime);
+	m_pStateRecorder->Update();
+	m_pGameRecorder->UpdateRecording(frameTime);
+}
+
 void CGamePlugin::OnSystemEvent(ESystemEvent event, UINT_PTR wparam, UINT_PTR lparam)
 {
 	switch (event)
@@ -38,6 +100,9 @@ void CGamePlugin::OnSystemEvent(ESystemEvent event, UINT_PTR wparam, UINT_PTR lp
 		// Called when the game framework has initialized and we are ready for game logic to start
 		case ESYSTEM_EVENT_GAME_POST_INIT:
 		{
+			// The map command is deferred to the next frame, the preload reads run alongside the level load
+			m_pAssetPreloader->Start();
+
 			// Don't need to load the map in editor
 			if (!gEnv->IsEditor())
 			{
@@ -71,11 +136,62 @@ void CGamePlugin::OnSystemEvent(ESystemEvent event, UINT_PTR wparam, UINT_PTR lp
 		}
 		break;
 		
+		case ESYSTEM_EVENT_LEVEL_LOAD_START:
+		{
+			m_pAssetPreloader->Start();
+		}
+		break;
+
+		case ESYSTEM_EVENT_LEVEL_GAMEPLAY_START:
+		{
+			// No gameplay asset may be loaded on the main thread after this point
+			m_pAssetPreloader->Flush();
+			// Resolve the handles of hot gameplay paths once, while the preloaded resources are at hand
+			m_pResourceHandles->Resolve();
+
+			// Spawn the bullet entities up front so that the first shots don't pay for it
+			m_pBulletPool->Prewarm();
+			// Impact effects are looked up by surface type, which are all known by now
+			m_pImpactSystem->OnGameplayStarted();
+
+			m_pBotDriver->OnGameplayStarted();
+		}
+		break;
+
+		case ESYSTEM_EVENT_EDITOR_GAME_MODE_CHANGED:
+		{
+			// Entities spawned during game mode are removed again when the editor returns to edit mode
+			if (wparam == 0)
+			{
+				ResetLevelState();
+			}
+		}
+		break;
+		
 		case ESYSTEM_EVENT_LEVEL_UNLOAD:
 		{
+			ResetLevelState();
 		}
 		break;
 	}
 }
 
+void CGamePlugin::ResetLevelState()
+{
+	m_pBotDriver->Clear();
+	m_pBulletPool->Clear();
+	m_pProjectileSystem->Clear();
+	m_pImpactSystem->Clear();
+	m_pLagCompensation->Clear();
+	m_pNetRelevancy->Clear();
+	m_pStateRecorder->Stop();
+	m_pGameRecorder->StopRecording();
+	m_pGameRecorder->StopReplay();
+	m_pResourceHandles->Invalidate();
+	m_pServerTick->Reset();
+	m_pAssetPreloader->Reset();
+	// After the systems above released their level storage
+	m_pLevelMemory->Reset();
+}
+
 CRYREGISTER_SINGLETON_CLASS(CGamePlugin)
\ No newline at end of file
@@ -4,6 +4,27 @@
 #include <CrySystem/ICryPlugin.h>
 #include <CryEntitySystem/IEntityClass.h>
 
+namespace Game
+{
+	class CAssetPreloader;
+	class CBotDriver;
+	class CBulletPool;
+	class CCharacterAnimation;
+	class CGameRecorder;
+	class CGameProfiler;
+	class CImpactSystem;
+	class CLagCompensation;
+	class CLevelMemory;
+	class CNetRelevancy;
+	class CPlayerSystem;
+	class CProjectileSystem;
+	class CResourceHandles;
+	class CServerTick;
+	class CSpawnPointRegistry;
+	class CSpatialIndex;
+	class CStateRecorder;
+}
+
 // The entry-point of the application
 // An instance of CGamePlugin is automatically created when the library is loaded
 // We then construct the local player entity and CPlayerComponent instance when OnClientConnectionReceived is first called.
@@ -20,6 +41,7 @@ public:
 	// Cry::IEnginePlugin
 	virtual const char* GetCategory() const override { return "Game"; }
 	virtual bool Initialize(SSystemGlobalEnvironment& env, const SSystemInitParams& initParams) override;
+	virtual void MainUpdate(float frameTime) override;
 	// ~Cry::IEnginePlugin
 
 	// ISystemEventListener
@@ -32,4 +54,48 @@ public:
 	{
 		return cryinterface_cast<CGamePlugin>(CGamePlugin::s_factory.CreateClassInstance().get());
 	}
+
+	Game::CAssetPreloader& GetAssetPreloader() const { return *m_pAssetPreloader; }
+	Game::CBotDriver& GetBotDriver() const { return *m_pBotDriver; }
+	Game::CBulletPool& GetBulletPool() const { return *m_pBulletPool; }
+	Game::CCharacterAnimation& GetCharacterAnimation() const { return *m_pCharacterAnimation; }
+	Game::CGameProfiler& GetProfiler() const { return *m_pProfiler; }
+	Game::CGameRecorder& GetGameRecorder() const { return *m_pGameRecorder; }
+	Game::CImpactSystem& GetImpactSystem() const { return *m_pImpactSystem; }
+	Game::CLagCompensation& GetLagCompensation() const { return *m_pLagCompensation; }
+	Game::CLevelMemory& GetLevelMemory() const { return *m_pLevelMemory; }
+	Game::CNetRelevancy& GetNetRelevancy() const { return *m_pNetRelevancy; }
+	Game::CPlayerSystem& GetPlayerSystem() const { return *m_pPlayerSystem; }
+	Game::CProjectileSystem& GetProjectileSystem() const { return *m_pProjectileSystem; }
+	Game::CResourceHandles& GetResourceHandles() const { return *m_pResourceHandles; }
+	Game::CServerTick& GetServerTick() const { return *m_pServerTick; }
+	Game::CSpawnPointRegistry& GetSpawnPointRegistry() const { return *m_pSpawnPointRegistry; }
+	Game::CSpatialIndex& GetSpatialIndex() const { return *m_pSpatialIndex; }
+	Game::CStateRecorder& GetStateRecorder() const { return *m_pStateRecorder; }
+
+private:
+	// Releases everything the systems hold for the current level, on unload and when the editor leaves game mode
+	void ResetLevelState();
+
+protected:
+	std::unique_ptr<Game::CGameProfiler> m_pProfiler;
+	// Declared before the systems that allocate from it, so that it outlives them
+	std::unique_ptr<Game::CLevelMemory> m_pLevelMemory;
+	// Declared before the systems that register into it, so that it outlives them
+	std::unique_ptr<Game::CSpatialIndex> m_pSpatialIndex;
+	std::unique_ptr<Game::CBulletPool> m_pBulletPool;
+	std::unique_ptr<Game::CLagCompensation> m_pLagCompensation;
+	std::unique_ptr<Game::CPlayerSystem> m_pPlayerSystem;
+	std::unique_ptr<Game::CProjectileSystem> m_pProjectileSystem;
+	std::unique_ptr<Game::CSpawnPointRegistry> m_pSpawnPointRegistry;
+	std::unique_ptr<Game::CNetRelevancy> m_pNetRelevancy;
+	std::unique_ptr<Game::CStateRecorder> m_pStateRecorder;
+	std::unique_ptr<Game::CGameRecorder> m_pGameRecorder;
+	std::unique_ptr<Game::CAssetPreloader> m_pAssetPreloader;
+	std::unique_ptr<Game::CResourceHandles> m_pResourceHandles;
+	std::unique_ptr<Game::CCharacterAnimation> m_pCharacterAnimation;
+	std::unique_ptr<Game::CBotDriver> m_pBotDriver;
+	std::unique_ptr<Game::CImpactSystem> m_pImpactSystem;
+	// Declared after the systems it runs
+	std::unique_ptr<Game::CServerTick> m_pServerTick;
 };
\ No newline at end of file
@@ -0,0 +1,388 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+#include "StdAfx.h"
+#include "AssetPreloader.h"
+
+#include "GamePlugin.h"
+#include "GameProfiler.h"
+
+#include <CryAnimation/ICryAnimation.h>
+#include <CryGame/IGameFramework.h>
+#include <ICryMannequin.h>
+
+#include <algorithm>
+
+namespace Game
+{
+	namespace
+	{
+		constexpr const char* kManifestPath = "Scripts/Preload.xml";
+
+		float g_preloadFrameBudget = 4.f;
+
+		struct SNamedValue
+		{
+			const char* szName;
+			int value;
+		};
+
+		constexpr SNamedValue kTypeNames[] =
+		{
+			{ "Geometry", static_cast<int>(CAssetPreloader::EType::Geometry) },
+			{ "Material", static_cast<int>(CAssetPreloader::EType::Material) },
+			{ "Character", static_cast<int>(CAssetPreloader::EType::Character) },
+			{ "Skin", static_cast<int>(CAssetPreloader::EType::Skin) },
+			{ "AnimationDatabase", static_cast<int>(CAssetPreloader::EType::AnimationDatabase) },
+			{ "ControllerDefinition", static_cast<int>(CAssetPreloader::EType::ControllerDefinition) }
+		};
+
+		constexpr SNamedValue kPriorityNames[] =
+		{
+			{ "Critical", static_cast<int>(CAssetPreloader::EPriority::Critical) },
+			{ "High", static_cast<int>(CAssetPreloader::EPriority::High) },
+			{ "Normal", static_cast<int>(CAssetPreloader::EPriority::Normal) }
+		};
+
+		template<size_t Count>
+		bool FindValue(const SNamedValue (&values)[Count], const char* szName, int& outValue)
+		{
+			for (const SNamedValue& value : values)
+			{
+				if (stricmp(value.szName, szName) == 0)
+				{
+					outValue = value.value;
+					return true;
+				}
+			}
+			return false;
+		}
+
+		template<size_t Count>
+		const char* FindName(const SNamedValue (&values)[Count], int value)
+		{
+			for (const SNamedValue& namedValue : values)
+			{
+				if (namedValue.value == value)
+				{
+					return namedValue.szName;
+				}
+			}
+			return "Unknown";
+		}
+
+		float GetElapsedMs(const std::chrono::steady_clock::time_point& start)
+		{
+			return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+	}
+
+	CAssetPreloader::CAssetPreloader()
+		: m_startupTime(std::chrono::steady_clock::now())
+	{
+		REGISTER_CVAR2("g_preloadFrameBudget", &g_preloadFrameBudget, g_preloadFrameBudget, VF_NULL, "Milliseconds per frame the asset preloader may spend creating resources on the main thread");
+		REGISTER_COMMAND("g_preloadInfo", LogInfo, VF_NULL, "Logs the state of every asset in the preload manifest and the main thread loads that missed it");
+	}
+
+	CAssetPreloader::~CAssetPreloader()
+	{
+		Reset();
+
+		if (IConsole* pConsole = gEnv->pConsole)
+		{
+			pConsole->UnregisterVariable("g_preloadFrameBudget", true);
+			pConsole->RemoveCommand("g_preloadInfo");
+		}
+	}
+
+	void CAssetPreloader::Start()
+	{
+		if (m_isStarted)
+		{
+			return;
+		}
+
+		m_isStarted = true;
+		m_preloadStartTime = std::chrono::steady_clock::now();
+		m_lastLoggedProgress = -1;
+
+		if (!LoadManifest())
+		{
+			return;
+		}
+
+		// The stream engine serves the reads by priority, so the player's assets arrive first
+		IStreamEngine* pStreamEngine = gEnv->pSystem->GetStreamEngine();
+		for (SEntry& entry : m_entries)
+		{
+			StreamReadParams params;
+			params.ePriority = entry.priority == EPriority::Critical ? estpUrgent : (entry.priority == EPriority::High ? estpAboveNormal : estpNormal);
+
+			// Materials are referred to without their extension
+			const string fileName = entry.type == EType::Material && PathUtil::GetExt(entry.path)[0] == '\0' ? PathUtil::ReplaceExtension(entry.path, "mtl") : entry.path;
+			entry.pStream = pStreamEngine != nullptr ? pStreamEngine->StartRead(eStreamTaskTypeReadAhead, fileName.c_str(), nullptr, &params) : nullptr;
+			entry.state = entry.pStream != nullptr ? EState::Reading : EState::Read;
+		}
+
+		CryLogAlways("[AssetPreloader] Preloading %" PRISIZE_T " assets", m_entries.size());
+	}
+
+	bool CAssetPreloader::LoadManifest()
+	{
+		m_entries.clear();
+		m_loadedCount = 0;
+
+		const XmlNodeRef root = gEnv->pSystem->LoadXmlFromFile(kManifestPath);
+		if (!root)
+		{
+			CryWarning(VALIDATOR_MODULE_GAME, VALIDATOR_WARNING, "[AssetPreloader] Failed to load the preload manifest %s", kManifestPath);
+			return false;
+		}
+
+		for (int i = 0, n = root->getChildCount(); i < n; ++i)
+		{
+			const XmlNodeRef node = root->getChild(i);
+			if (!node->isTag("Asset"))
+			{
+				continue;
+			}
+
+			int type;
+			int priority = static_cast<int>(EPriority::Normal);
+			const char* szPath = node->getAttr("path");
+			if (!FindValue(kTypeNames, node->getAttr("type"), type) || szPath[0] == '\0' || (node->haveAttr("priority") && !FindValue(kPriorityNames, node->getAttr("priority"), priority)))
+			{
+				CryWarning(VALIDATOR_MODULE_GAME, VALIDATOR_WARNING, "[AssetPreloader] Invalid asset in %s at line %d", kManifestPath, node->getLine());
+				continue;
+			}
+
+			SEntry entry;
+			entry.type = static_cast<EType>(type);
+			entry.priority = static_cast<EPriority>(priority);
+			entry.path = szPath;
+			m_entries.push_back(entry);
+		}
+
+		std::stable_sort(m_entries.begin(), m_entries.end(), [](const SEntry& a, const SEntry& b) { return a.priority < b.priority; });
+		return true;
+	}
+
+	void CAssetPreloader::Update()
+	{
+		if (!m_isStarted || IsComplete())
+		{
+			return;
+		}
+
+		GAME_PROFILE_SCOPE("CAssetPreloader::Update");
+
+		const auto start = std::chrono::steady_clock::now();
+		for (SEntry& entry : m_entries)
+		{
+			if (entry.state == EState::Reading && entry.pStream->IsFinished())
+			{
+				// Failed reads are left to the resource loading, which reports the missing file properly
+				entry.pStream = nullptr;
+				entry.state = EState::Read;
+			}
+
+			if (entry.state == EState::Read)
+			{
+				Load(entry);
+
+				if (GetElapsedMs(start) >= g_preloadFrameBudget)
+				{
+					break;
+				}
+			}
+		}
+
+		LogProgress();
+	}
+
+	void CAssetPreloader::Flush()
+	{
+		Start();
+
+		GAME_PROFILE_SCOPE("CAssetPreloader::Flush");
+
+		const auto start = std::chrono::steady_clock::now();
+		size_t flushedCount = 0;
+		for (SEntry& entry : m_entries)
+		{
+			if (entry.state == EState::Reading || entry.state == EState::Read)
+			{
+				entry.pStream = nullptr;
+				Load(entry);
+				++flushedCount;
+			}
+		}
+
+		if (flushedCount > 0)
+		{
+			CryLogAlways("[AssetPreloader] %" PRISIZE_T " assets were not loaded in time and took %.1f ms at gameplay start", flushedCount, GetElapsedMs(start));
+		}
+
+		LogProgress();
+
+		if (!m_hasReportedPlayable)
+		{
+			m_hasReportedPlayable = true;
+			CryLogAlways("[AssetPreloader] Playable %.2f s after startup, the preload ran for %.2f s", GetElapsedMs(m_startupTime) / 1000.f, GetElapsedMs(m_preloadStartTime) / 1000.f);
+		}
+	}
+
+	void CAssetPreloader::Reset()
+	{
+		for (SEntry& entry : m_entries)
+		{
+			Release(entry);
+		}
+
+		m_entries.clear();
+		m_loadedCount = 0;
+		m_isStarted = false;
+
+		// The next level warns again about its own misses
+		m_mainThreadLoadCount = 0;
+		m_missedPaths.clear();
+	}
+
+	void CAssetPreloader::Load(SEntry& entry)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		const char* szPath = entry.path.c_str();
+
+		bool isLoaded = false;
+		switch (entry.type)
+		{
+		case EType::Geometry:
+			entry.pGeometry = gEnv->p3DEngine->LoadStatObj(szPath, nullptr, nullptr, false);
+			isLoaded = entry.pGeometry != nullptr;
+			break;
+		case EType::Material:
+			entry.pMaterial = gEnv->p3DEngine->GetMaterialManager()->LoadMaterial(szPath);
+			isLoaded = entry.pMaterial != nullptr;
+			break;
+		case EType::Character:
+			entry.pCharacter = gEnv->pCharacterManager->CreateInstance(szPath);
+			isLoaded = entry.pCharacter != nullptr;
+			break;
+		case EType::Skin:
+			gEnv->pCharacterManager->StreamKeepCharacterResourcesResident(szPath, 0, true, true);
+			isLoaded = true;
+			break;
+		case EType::AnimationDatabase:
+			isLoaded = gEnv->pGameFramework->GetMannequinInterface().GetAnimationDatabaseManager().Load(szPath) != nullptr;
+			break;
+		case EType::ControllerDefinition:
+			isLoaded = gEnv->pGameFramework->GetMannequinInterface().GetAnimationDatabaseManager().LoadControllerDef(szPath) != nullptr;
+			break;
+		}
+
+		entry.loadMs = GetElapsedMs(start);
+		entry.state = isLoaded ? EState::Loaded : EState::Failed;
+		++m_loadedCount;
+
+		if (!isLoaded)
+		{
+			CryWarning(VALIDATOR_MODULE_GAME, VALIDATOR_WARNING, "[AssetPreloader] Failed to load %s", szPath);
+		}
+	}
+
+	void CAssetPreloader::Release(SEntry& entry)
+	{
+		if (entry.pStream != nullptr)
+		{
+			entry.pStream->Abort();
+			entry.pStream = nullptr;
+		}
+
+		if (entry.type == EType::Skin && entry.state == EState::Loaded && gEnv->pCharacterManager != nullptr)
+		{
+			gEnv->pCharacterManager->StreamKeepCharacterResourcesResident(entry.path.c_str(), 0, false);
+		}
+
+		entry.pGeometry = nullptr;
+		entry.pMaterial = nullptr;
+		entry.pCharacter = nullptr;
+	}
+
+	IStatObj* CAssetPreloader::GetGeometry(const char* szPath)
+	{
+		const SEntry* pEntry = Find(EType::Geometry, szPath);
+		if (pEntry == nullptr || pEntry->pGeometry == nullptr)
+		{
+			NoteMainThreadLoad(szPath);
+			return nullptr;
+		}
+		return pEntry->pGeometry;
+	}
+
+	IMaterial* CAssetPreloader::GetMaterial(const char* szPath)
+	{
+		const SEntry* pEntry = Find(EType::Material, szPath);
+		if (pEntry == nullptr || pEntry->pMaterial == nullptr)
+		{
+			NoteMainThreadLoad(szPath);
+			return nullptr;
+		}
+		return pEntry->pMaterial;
+	}
+
+	CAssetPreloader::SEntry* CAssetPreloader::Find(EType type, const char* szPath)
+	{
+		for (SEntry& entry : m_entries)
+		{
+			if (entry.type == type && stricmp(entry.path.c_str(), szPath) == 0)
+			{
+				return &entry;
+			}
+		}
+		return nullptr;
+	}
+
+	void CAssetPreloader::NoteMainThreadLoad(const char* szPath)
+	{
+		++m_mainThreadLoadCount;
+
+		// Once per asset, pooled entities ask for the same assets many times
+		if (std::find(m_missedPaths.begin(), m_missedPaths.end(), szPath) != m_missedPaths.end())
+		{
+			return;
+		}
+
+		m_missedPaths.push_back(szPath);
+		CryWarning(VALIDATOR_MODULE_GAME, VALIDATOR_WARNING, "[AssetPreloader] %s is not preloaded and is loaded on the main thread, add it to %s", szPath, kManifestPath);
+	}
+
+	float CAssetPreloader::GetProgress() const
+	{
+		return m_entries.empty() ? 1.f : static_cast<float>(m_loadedCount) / static_cast<float>(m_entries.size());
+	}
+
+	void CAssetPreloader::LogProgress()
+	{
+		// In steps of a quarter, every frame would flood the log
+		const int progress = static_cast<int>(GetProgress() * 4.f);
+		if (progress == m_lastLoggedProgress)
+		{
+			return;
+		}
+
+		m_lastLoggedProgress = progress;
+		CryLogAlways("[AssetPreloader] %" PRISIZE_T "/%" PRISIZE_T " assets loaded after %.2f s", m_loadedCount, m_entries.size(), GetElapsedMs(m_preloadStartTime) / 1000.f);
+	}
+
+	void CAssetPreloader::LogInfo(IConsoleCmdArgs* pArgs)
+	{
+		const CAssetPreloader& preloader = CGamePlugin::GetInstance()->GetAssetPreloader();
+
+		const char* stateNames[] = { "Reading", "Read", "Loaded", "Failed" };
+		for (const SEntry& entry : preloader.m_entries)
+		{
+			CryLogAlways("[AssetPreloader] %-8s %-20s %-8s %6.2f ms  %s", FindName(kPriorityNames, static_cast<int>(entry.priority)), FindName(kTypeNames, static_cast<int>(entry.type)),
+				stateNames[static_cast<int>(entry.state)], entry.loadMs, entry.path.c_str());
+		}
+
+		CryLogAlways("[AssetPreloader] %" PRISIZE_T "/%" PRISIZE_T " assets loaded, %u gameplay loads missed the manifest", preloader.m_loadedCount, preloader.m_entries.size(), preloader.m_mainThreadLoadCount);
+	}
+}
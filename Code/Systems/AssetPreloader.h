@@ -0,0 +1,114 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+#pragma once
+
+#include <CrySystem/IStreamEngine.h>
+
+#include <chrono>
+#include <vector>
+
+struct IStatObj;
+struct IMaterial;
+struct ICharacterInstance;
+
+namespace Game
+{
+	////////////////////////////////////////////////////////
+	// Loads the assets of the preload manifest while the level loads
+	// Every file of Scripts/Preload.xml is read ahead on the streaming threads, most urgent first, and the engine
+	// resources are created from the warm cache within a per-frame budget on the main thread. Whatever is left when
+	// gameplay starts is completed right there, so gameplay code finds its assets in memory. Gameplay code asks for
+	// the preloaded resources instead of loading them, a lookup that misses is logged as a main thread load.
+	////////////////////////////////////////////////////////
+	class CAssetPreloader
+	{
+	public:
+		enum class EPriority
+		{
+			// Needed to spawn the player
+			Critical = 0,
+			// Needed by the gameplay start
+			High,
+			Normal
+		};
+
+		enum class EType
+		{
+			Geometry,
+			Material,
+			// .cdf or .chr, instantiated once and kept alive
+			Character,
+			// Kept resident in the character manager
+			Skin,
+			AnimationDatabase,
+			ControllerDefinition
+		};
+
+		CAssetPreloader();
+		~CAssetPreloader();
+
+		// Reads the manifest and starts reading all of its files, does nothing while a preload is running
+		void Start();
+		// Creates the resources of finished reads within g_preloadFrameBudget
+		void Update();
+		// Creates all remaining resources right away, called when gameplay starts
+		void Flush();
+		// Releases all resources, e.g. when the level is unloaded
+		void Reset();
+
+		// Preloaded resources, nullptr if the asset is not in the manifest or not loaded yet
+		// A miss counts as a load on the main thread, the caller is expected to load the asset itself.
+		IStatObj* GetGeometry(const char* szPath);
+		IMaterial* GetMaterial(const char* szPath);
+
+		bool IsComplete() const { return m_loadedCount == m_entries.size(); }
+		// Share of the manifest that is loaded, in [0, 1]
+		float GetProgress() const;
+
+	private:
+		enum class EState
+		{
+			Reading,
+			Read,
+			Loaded,
+			Failed
+		};
+
+		struct SEntry
+		{
+			EType type;
+			EPriority priority;
+			string path;
+			EState state = EState::Reading;
+			IReadStreamPtr pStream;
+			float loadMs = 0.f;
+
+			_smart_ptr<IStatObj> pGeometry;
+			_smart_ptr<IMaterial> pMaterial;
+			_smart_ptr<ICharacterInstance> pCharacter;
+		};
+
+		bool LoadManifest();
+		void Load(SEntry& entry);
+		void Release(SEntry& entry);
+		SEntry* Find(EType type, const char* szPath);
+		void NoteMainThreadLoad(const char* szPath);
+		void LogProgress();
+		static void LogInfo(IConsoleCmdArgs* pArgs);
+
+	private:
+		// Sorted by priority
+		std::vector<SEntry> m_entries;
+		size_t m_loadedCount = 0;
+		bool m_isStarted = false;
+
+		// Startup to playable, measured from the construction at plug-in initialization to the first gameplay start
+		std::chrono::steady_clock::time_point m_startupTime;
+		std::chrono::steady_clock::time_point m_preloadStartTime;
+		bool m_hasReportedPlayable = false;
+
+		uint32 m_mainThreadLoadCount = 0;
+		std::vector<string> m_missedPaths;
+		int m_lastLoggedProgress = -1;
+	};
+}
@@ -0,0 +1,411 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+#include "StdAfx.h"
+#include "BotDriver.h"
+
+#include "BulletPool.h"
+#include "GamePlugin.h"
+#include "GameProfiler.h"
+#include "GameRecorder.h"
+#include "PlayerSystem.h"
+#include "ProjectileSystem.h"
+#include "SpawnPointRegistry.h"
+
+#include "Components/Player.h"
+
+#include <CryEntitySystem/IEntitySystem.h>
+#include <CryNetwork/INetwork.h>
+
+#include <algorithm>
+
+namespace Game
+{
+	namespace
+	{
+		int   g_bots = 0;
+		int   g_botBehavior = -1;
+		float g_botFireInterval = 0.1f;
+
+		// Spawning and level streaming settle before the load test measures
+		constexpr float kLoadTestWarmup = 2.f;
+
+		void SpawnBots(IConsoleCmdArgs* pArgs)
+		{
+			const int count = pArgs->GetArgCount() > 1 ? max(1, atoi(pArgs->GetArg(1))) : 16;
+			CGamePlugin::GetInstance()->GetBotDriver().Spawn(static_cast<size_t>(count));
+		}
+
+		void RemoveBots(IConsoleCmdArgs* pArgs)
+		{
+			CGamePlugin::GetInstance()->GetBotDriver().RemoveAll();
+		}
+
+		void StartBotLoadTest(IConsoleCmdArgs* pArgs)
+		{
+			const float duration = pArgs->GetArgCount() > 1 ? max(1.f, static_cast<float>(atof(pArgs->GetArg(1)))) : 60.f;
+			const char* szFileName = pArgs->GetArgCount() > 2 ? pArgs->GetArg(2) : "%USER%/Profiling/BotLoad.json";
+			CGamePlugin::GetInstance()->GetBotDriver().StartLoadTest(duration, szFileName);
+		}
+
+		void GetBytesSent(uint64& outBytes, uint64& outPackets)
+		{
+			SBandwidthStats stats;
+			gEnv->pNetwork->GetBandwidthStatistics(&stats);
+			outBytes = stats.m_total.m_totalBandwidthSent;
+			outPackets = static_cast<uint64>(stats.m_total.m_totalPacketsSent);
+		}
+
+		template<typename T>
+		T GetPercentile(std::vector<T>& values, float percentile)
+		{
+			const size_t index = min(static_cast<size_t>(percentile * static_cast<float>(values.size())), values.size() - 1);
+			std::nth_element(values.begin(), values.begin() + index, values.end());
+			return values[index];
+		}
+
+		SBotInputParams GetInputParams(EBotBehavior behavior)
+		{
+			SBotInputParams params;
+			params.behavior = behavior;
+			params.fireInterval = max(0.f, g_botFireInterval);
+			return params;
+		}
+	}
+
+	CBotDriver::CBotDriver()
+	{
+		REGISTER_CVAR2("sv_bots", &g_bots, g_bots, VF_NULL, "Number of bots the server spawns when gameplay starts, e.g. +sv_bots 32 on the command line of a dedicated server");
+		REGISTER_CVAR2("sv_botBehavior", &g_botBehavior, g_botBehavior, VF_NULL, "Input of bots spawned from now on\n-1 = mixed, 0 = wander, 1 = strafe, 2 = circle, 3 = stand");
+		REGISTER_CVAR2("sv_botFireInterval", &g_botFireInterval, g_botFireInterval, VF_NULL, "Seconds between two shots of a bot, bots fire continuously\n0 = bots don't fire");
+		REGISTER_COMMAND("sv_botsSpawn", SpawnBots, VF_NULL, "Spawns bots at the spawn points, copies of the first player placed in the level\nUsage: sv_botsSpawn [count]");
+		REGISTER_COMMAND("sv_botsRemove", RemoveBots, VF_NULL, "Removes all bots");
+		REGISTER_COMMAND("sv_botTest", StartBotLoadTest, VF_NULL, "Measures frame times, entities, bullets in flight and bytes sent to clients with the current bots and writes a JSON report\nUsage: sv_botTest [seconds] [file]");
+	}
+
+	CBotDriver::~CBotDriver()
+	{
+		if (IConsole* pConsole = gEnv->pConsole)
+		{
+			pConsole->UnregisterVariable("sv_bots", true);
+			pConsole->UnregisterVariable("sv_botBehavior", true);
+			pConsole->UnregisterVariable("sv_botFireInterval", true);
+			pConsole->RemoveCommand("sv_botsSpawn");
+			pConsole->RemoveCommand("sv_botsRemove");
+			pConsole->RemoveCommand("sv_botTest");
+		}
+	}
+
+	CPlayerComponent* CBotDriver::FindTemplatePlayer() const
+	{
+		for (CPlayerComponent* pPlayer : CGamePlugin::GetInstance()->GetPlayerSystem().GetPlayers())
+		{
+			if (!pPlayer->IsBot())
+			{
+				return pPlayer;
+			}
+		}
+		return nullptr;
+	}
+
+	size_t CBotDriver::Spawn(size_t count)
+	{
+		if (!gEnv->bServer)
+		{
+			CryLogAlways("[BotDriver] Bots can only be spawned on the server");
+			return 0;
+		}
+
+		// The player placed in the level carries the character, animation and movement setup of the game mode
+		CPlayerComponent* pTemplate = FindTemplatePlayer();
+		if (pTemplate == nullptr)
+		{
+			CryWarning(VALIDATOR_MODULE_GAME, VALIDATOR_WARNING, "[BotDriver] The level has no player to copy bots from");
+			return 0;
+		}
+
+		std::vector<Matrix34> transforms;
+		transforms.reserve(count);
+		const size_t transformCount = CGamePlugin::GetInstance()->GetSpawnPointRegistry().SelectMany(ESpawnSelectionPolicy::FarthestFromEnemies, count, transforms);
+		if (transformCount == 0)
+		{
+			CryWarning(VALIDATOR_MODULE_GAME, VALIDATOR_WARNING, "[BotDriver] The level has no spawn points");
+			return 0;
+		}
+
+		IEntity* pTemplateEntity = pTemplate->GetEntity();
+		XmlNodeRef templateNode = gEnv->pSystem->CreateXmlNode("Entity");
+		pTemplateEntity->SerializeXML(templateNode, false);
+
+		m_bots.reserve(m_bots.size() + transformCount);
+		for (size_t i = 0; i < transformCount; ++i)
+		{
+			const uint32 botIndex = m_nextBotIndex++;
+
+			char name[32];
+			cry_sprintf(name, "Bot%u", botIndex);
+
+			SEntitySpawnParams spawnParams;
+			spawnParams.pClass = pTemplateEntity->GetClass();
+			spawnParams.sName = name;
+			spawnParams.entityNode = templateNode;
+			spawnParams.nFlags = pTemplateEntity->GetFlags() & ~ENTITY_FLAG_LOCAL_PLAYER;
+			spawnParams.vPosition = transforms[i].GetTranslation();
+			spawnParams.qRotation = Quat(Matrix33(transforms[i]));
+
+			m_isSpawningBot = true;
+			IEntity* pEntity = gEnv->pEntitySystem->SpawnEntity(spawnParams);
+			CPlayerComponent* pPlayer = pEntity != nullptr ? pEntity->GetOrCreateComponent<CPlayerComponent>() : nullptr;
+			m_isSpawningBot = false;
+
+			if (pPlayer == nullptr)
+			{
+				continue;
+			}
+
+			const EBotBehavior behavior = g_botBehavior >= 0 && g_botBehavior < static_cast<int>(EBotBehavior::Count)
+				? static_cast<EBotBehavior>(g_botBehavior)
+				: static_cast<EBotBehavior>(botIndex % static_cast<uint32>(EBotBehavior::Count));
+
+			SBot bot;
+			bot.entityId = pEntity->GetId();
+			bot.behavior = behavior;
+			InitializeBotInput(bot.input, botIndex + 1, GetInputParams(behavior));
+			m_bots.push_back(bot);
+		}
+
+		// Every bot brings a camera that activates itself when it is created
+		pTemplate->ActivateView();
+
+		CryLogAlways("[BotDriver] Spawned %" PRISIZE_T " bots, %" PRISIZE_T " in total", transformCount, m_bots.size());
+		return transformCount;
+	}
+
+	void CBotDriver::RemoveAll()
+	{
+		for (const SBot& bot : m_bots)
+		{
+			gEnv->pEntitySystem->RemoveEntity(bot.entityId);
+		}
+
+		if (!m_bots.empty())
+		{
+			CryLogAlways("[BotDriver] Removed %" PRISIZE_T " bots", m_bots.size());
+		}
+		m_bots.clear();
+	}
+
+	void CBotDriver::OnGameplayStarted()
+	{
+		if (g_bots > 0 && gEnv->bServer)
+		{
+			Spawn(static_cast<size_t>(g_bots));
+		}
+	}
+
+	void CBotDriver::Clear()
+	{
+		if (m_isTesting)
+		{
+			CryLogAlways("[BotDriver] Load test aborted, the level was unloaded");
+			m_isTesting = false;
+		}
+
+		m_bots.clear();
+		m_nextBotIndex = 0;
+	}
+
+	void CBotDriver::Update(float frameTime)
+	{
+		if (m_isTesting)
+		{
+			SampleLoadTest();
+		}
+
+		if (m_bots.empty() || frameTime <= 0.f)
+		{
+			return;
+		}
+
+		GAME_PROFILE_SCOPE("CBotDriver::Update");
+
+		CGameRecorder& recorder = CGamePlugin::GetInstance()->GetGameRecorder();
+		SBotInputParams params = GetInputParams(EBotBehavior::Wander);
+		uint32 shotCount = 0;
+
+		for (size_t i = 0; i < m_bots.size();)
+		{
+			SBot& bot = m_bots[i];
+
+			// Bots may be removed like any other entity
+			IEntity* pEntity = gEnv->pEntitySystem->GetEntity(bot.entityId);
+			CPlayerComponent* pPlayer = pEntity != nullptr ? pEntity->GetComponent<CPlayerComponent>() : nullptr;
+			if (pPlayer == nullptr)
+			{
+				m_bots[i] = m_bots.back();
+				m_bots.pop_back();
+				continue;
+			}
+
+			params.behavior = bot.behavior;
+			uint32 botShotCount;
+			const SPlayerInputCommand command = UpdateBotInput(bot.input, params, frameTime, botShotCount);
+
+			// Applied like the command of a client, recorded like one too
+			pPlayer->ApplyExternalInput(command);
+			recorder.RecordInput(bot.entityId, command);
+
+			for (uint32 shot = 0; shot < botShotCount; ++shot)
+			{
+				shotCount += pPlayer->Fire() ? 1 : 0;
+			}
+
+			++i;
+		}
+
+		m_shotCount += shotCount;
+		GAME_PROFILE_COUNTER("BotDriver::Shots", static_cast<int64>(shotCount));
+	}
+
+	bool CBotDriver::StartLoadTest(float duration, const char* szFileName)
+	{
+		if (!gEnv->bServer || gEnv->pNetwork == nullptr)
+		{
+			CryLogAlways("[BotDriver] The load test can only run on the server");
+			return false;
+		}
+
+		m_isTesting = true;
+		m_testDuration = duration;
+		m_testTime = -kLoadTestWarmup;
+		m_reportFileName = szFileName;
+		m_samples.clear();
+		// Generously above any tick rate a server runs at
+		m_samples.reserve(static_cast<size_t>(duration * 240.f) + 1);
+
+		CryLogAlways("[BotDriver] Load test with %" PRISIZE_T " bots and %" PRISIZE_T " players, measuring for %.0f s after %.0f s", m_bots.size(), CGamePlugin::GetInstance()->GetPlayerSystem().GetCount(), duration, kLoadTestWarmup);
+		return true;
+	}
+
+	void CBotDriver::SampleLoadTest()
+	{
+		const bool wasWarmingUp = m_testTime < 0.f;
+		m_testTime += gEnv->pTimer->GetRealFrameTime();
+
+		if (m_testTime < 0.f)
+		{
+			return;
+		}
+
+		if (wasWarmingUp)
+		{
+			// The first frame after the warmup only sets the baselines
+			m_shotCount = 0;
+			GetBytesSent(m_startBytesSent, m_startPacketsSent);
+			m_testTime = 0.f;
+			return;
+		}
+
+		SLoadSample sample;
+		// The whole frame of the server as it ticks, including the time it sleeps to keep its rate
+		sample.frameTime = gEnv->pTimer->GetRealFrameTime();
+		sample.entityCount = gEnv->pEntitySystem->GetNumEntities();
+		sample.bulletCount = static_cast<uint32>(CGamePlugin::GetInstance()->GetBulletPool().GetActiveCount() + CGamePlugin::GetInstance()->GetProjectileSystem().GetLiveCount());
+		m_samples.push_back(sample);
+
+		if (m_testTime >= m_testDuration)
+		{
+			m_isTesting = false;
+			WriteReport();
+		}
+	}
+
+	void CBotDriver::WriteReport()
+	{
+		if (m_samples.empty())
+		{
+			return;
+		}
+
+		uint64 bytesSent, packetsSent;
+		GetBytesSent(bytesSent, packetsSent);
+		bytesSent -= min(bytesSent, m_startBytesSent);
+		packetsSent -= min(packetsSent, m_startPacketsSent);
+
+		std::vector<float> frameTimes;
+		frameTimes.reserve(m_samples.size());
+		double frameTimeSum = 0.0, entitySum = 0.0, bulletSum = 0.0;
+		uint32 maxEntities = 0, maxBullets = 0;
+		for (const SLoadSample& sample : m_samples)
+		{
+			frameTimes.push_back(sample.frameTime * 1000.f);
+			frameTimeSum += sample.frameTime;
+			entitySum += sample.entityCount;
+			bulletSum += sample.bulletCount;
+			maxEntities = max(maxEntities, sample.entityCount);
+			maxBullets = max(maxBullets, sample.bulletCount);
+		}
+
+		const double frameCount = static_cast<double>(m_samples.size());
+		const double seconds = max(frameTimeSum, 0.001);
+		const float p50 = GetPercentile(frameTimes, 0.5f);
+		const float p95 = GetPercentile(frameTimes, 0.95f);
+		const float p99 = GetPercentile(frameTimes, 0.99f);
+		const float maxFrameTime = *std::max_element(frameTimes.begin(), frameTimes.end());
+
+		// Frames that took longer than the tick interval the dedicated server aims for
+		const ICVar* pMaxRate = gEnv->pConsole->GetCVar("sv_DedicatedMaxRate");
+		const float tickRate = pMaxRate != nullptr ? pMaxRate->GetFVal() : 0.f;
+		const float tickInterval = tickRate > 0.f ? 1000.f / tickRate : 0.f;
+		const size_t overrunCount = tickInterval > 0.f ? std::count_if(frameTimes.begin(), frameTimes.end(), [tickInterval](float frameTime) { return frameTime > tickInterval * 1.1f; }) : 0;
+
+		const size_t botCount = m_bots.size();
+		const size_t playerCount = CGamePlugin::GetInstance()->GetPlayerSystem().GetCount();
+
+		string json;
+		json.Format(
+			"{\n"
+			"\t\"bots\": %" PRISIZE_T ",\n"
+			"\t\"players\": %" PRISIZE_T ",\n"
+			"\t\"seconds\": %.2f,\n"
+			"\t\"frames\": %" PRISIZE_T ",\n"
+			"\t\"frameTimeMs\": { \"mean\": %.3f, \"p50\": %.3f, \"p95\": %.3f, \"p99\": %.3f, \"max\": %.3f },\n"
+			"\t\"tickRate\": %.1f,\n"
+			"\t\"overruns\": %" PRISIZE_T ",\n"
+			"\t\"entities\": { \"mean\": %.1f, \"max\": %u },\n"
+			"\t\"bulletsInFlight\": { \"mean\": %.1f, \"max\": %u },\n"
+			"\t\"shotsFired\": %u,\n"
+			"\t\"replication\": { \"bytesSent\": %" PRIu64 ", \"bytesPerSecond\": %.0f, \"packetsSent\": %" PRIu64 " }\n"
+			"}\n",
+			botCount, playerCount, seconds, m_samples.size(),
+			frameTimeSum * 1000.0 / frameCount, p50, p95, p99, maxFrameTime,
+			tickRate, overrunCount,
+			entitySum / frameCount, maxEntities,
+			bulletSum / frameCount, maxBullets,
+			m_shotCount,
+			bytesSent, static_cast<double>(bytesSent) / seconds, packetsSent);
+
+		CryLogAlways("[BotDriver] %" PRISIZE_T " bots, %" PRISIZE_T " players, %" PRISIZE_T " frames in %.1f s", botCount, playerCount, m_samples.size(), seconds);
+		CryLogAlways("[BotDriver] Frame time mean %.2f ms, p50 %.2f ms, p95 %.2f ms, p99 %.2f ms, max %.2f ms, %" PRISIZE_T " frames over the tick interval",
+			frameTimeSum * 1000.0 / frameCount, p50, p95, p99, maxFrameTime, overrunCount);
+		CryLogAlways("[BotDriver] Entities mean %.0f max %u, bullets in flight mean %.0f max %u, %u shots", entitySum / frameCount, maxEntities, bulletSum / frameCount, maxBullets, m_shotCount);
+		CryLogAlways("[BotDriver] Sent %" PRIu64 " KB in %" PRIu64 " packets, %.1f KB/s", bytesSent / 1024, packetsSent, static_cast<double>(bytesSent) / 1024.0 / seconds);
+
+		char adjustedFileName[ICryPak::g_nMaxPath];
+		const char* szPath = gEnv->pCryPak->AdjustFileName(m_reportFileName.c_str(), adjustedFileName, ICryPak::FLAGS_FOR_WRITING);
+		gEnv->pCryPak->MakeDir(PathUtil::GetPathWithoutFilename(szPath));
+
+		FILE* pFile = gEnv->pCryPak->FOpen(szPath, "wb");
+		if (pFile == nullptr)
+		{
+			CryLogAlways("[BotDriver] Could not open %s for writing", szPath);
+			return;
+		}
+
+		gEnv->pCryPak->FWrite(json.c_str(), json.length(), 1, pFile);
+		gEnv->pCryPak->FClose(pFile);
+
+		CryLogAlways("[BotDriver] Wrote the report to %s", szPath);
+
+		m_samples.clear();
+		m_samples.shrink_to_fit();
+	}
+}
@@ -0,0 +1,78 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+#pragma once
+
+#include "Core/BotInput.h"
+
+#include <vector>
+
+namespace Game
+{
+	class CPlayerComponent;
+
+	////////////////////////////////////////////////////////
+	// Server-side bots that put player load on a server without clients
+	// Bots are copies of a player placed in the level, spawned at the spawn points a respawn would pick. They run the
+	// same movement, animation, weapon and replication code as players of clients, only their input commands come
+	// from Core/BotInput.h. sv_botTest measures the server with them and writes a report, see WriteReport.
+	////////////////////////////////////////////////////////
+	class CBotDriver
+	{
+	public:
+		CBotDriver();
+		~CBotDriver();
+
+		// Server only, returns the number of bots spawned
+		size_t Spawn(size_t count);
+		void RemoveAll();
+
+		// Steers the bots and samples the load test, before the players update
+		void Update(float frameTime);
+
+		// Spawns sv_bots bots, e.g. from the command line of a dedicated server
+		void OnGameplayStarted();
+		// Forgets the bots and aborts the load test, the entities go with the level
+		void Clear();
+
+		// Measures for the given number of seconds once the server has settled and writes the report to szFileName
+		bool StartLoadTest(float duration, const char* szFileName);
+
+		// Whether a bot is being spawned right now, CPlayerComponent checks it while it is initialized
+		bool IsSpawningBot() const { return m_isSpawningBot; }
+		size_t GetCount() const { return m_bots.size(); }
+
+	private:
+		struct SBot
+		{
+			EntityId entityId;
+			SBotInputState input;
+			EBotBehavior behavior;
+		};
+
+		struct SLoadSample
+		{
+			float frameTime;
+			uint32 entityCount;
+			uint32 bulletCount;
+		};
+
+		CPlayerComponent* FindTemplatePlayer() const;
+		void SampleLoadTest();
+		void WriteReport();
+
+	private:
+		std::vector<SBot> m_bots;
+		uint32 m_nextBotIndex = 0;
+		bool m_isSpawningBot = false;
+
+		// Load test, the samples are reserved up front so that the test doesn't allocate while it measures
+		bool m_isTesting = false;
+		float m_testDuration = 0.f;
+		float m_testTime = 0.f;
+		string m_reportFileName;
+		std::vector<SLoadSample> m_samples;
+		uint32 m_shotCount = 0;
+		uint64 m_startBytesSent = 0;
+		uint64 m_startPacketsSent = 0;
+	};
+}
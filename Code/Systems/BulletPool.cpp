@@ -0,0 +1,288 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+#include "StdAfx.h"
+#include "BulletPool.h"
+#include "GamePlugin.h"
+#include "GameProfiler.h"
+#include "ImpactSystem.h"
+#include "SpatialIndex.h"
+
+#include "Components/Bullet.h"
+
+#include <CryEntitySystem/IEntitySystem.h>
+
+#include <algorithm>
+
+namespace Game
+{
+	namespace
+	{
+		int   g_bulletPoolCapacity = 64;
+		int   g_bulletPoolGrowth = 16;
+		int   g_bulletPoolMaxCapacity = 512;
+		float g_bulletLifetime = 5.f;
+
+		constexpr float kBulletScale = 0.05f;
+
+		void DumpBulletPoolStatistics(IConsoleCmdArgs* pArgs)
+		{
+			CBulletPool& pool = CGamePlugin::GetInstance()->GetBulletPool();
+			const CBulletPool::SStatistics& stats = pool.GetStatistics();
+
+			CryLogAlways("[BulletPool] capacity=%" PRISIZE_T " active=%" PRISIZE_T " free=%" PRISIZE_T, pool.GetCapacity(), pool.GetActiveCount(), pool.GetFreeCount());
+			CryLogAlways("[BulletPool] hits=%u misses=%u grown=%u recycled=%u dropped=%u", stats.hits, stats.misses, stats.grownEntities, stats.recycled, stats.dropped);
+			CryLogAlways("[BulletPool] collisions=%u timeouts=%u", stats.collisions, stats.timeouts);
+
+			if (pArgs->GetArgCount() > 1 && strcmp(pArgs->GetArg(1), "reset") == 0)
+			{
+				pool.ResetStatistics();
+			}
+		}
+	}
+
+	CBulletPool::CBulletPool()
+	{
+		REGISTER_CVAR2("g_bulletPoolCapacity", &g_bulletPoolCapacity, g_bulletPoolCapacity, VF_NULL, "Number of bullet entities spawned up front when gameplay starts");
+		REGISTER_CVAR2("g_bulletPoolGrowth", &g_bulletPoolGrowth, g_bulletPoolGrowth, VF_NULL, "Number of bullet entities spawned when the pool runs dry\n0 = never grow, recycle the oldest bullet in flight instead");
+		REGISTER_CVAR2("g_bulletPoolMaxCapacity", &g_bulletPoolMaxCapacity, g_bulletPoolMaxCapacity, VF_NULL, "Upper bound for the number of pooled bullet entities");
+		REGISTER_CVAR2("g_bulletLifetime", &g_bulletLifetime, g_bulletLifetime, VF_NULL, "Seconds a bullet may fly before it is returned to the pool without hitting anything");
+		REGISTER_COMMAND("g_bulletPoolStats", DumpBulletPoolStatistics, VF_NULL, "Logs bullet pool usage counters, pass 'reset' to clear them afterwards");
+	}
+
+	CBulletPool::~CBulletPool()
+	{
+		if (IConsole* pConsole = gEnv->pConsole)
+		{
+			pConsole->UnregisterVariable("g_bulletPoolCapacity", true);
+			pConsole->UnregisterVariable("g_bulletPoolGrowth", true);
+			pConsole->UnregisterVariable("g_bulletPoolMaxCapacity", true);
+			pConsole->UnregisterVariable("g_bulletLifetime", true);
+			pConsole->RemoveCommand("g_bulletPoolStats");
+		}
+	}
+
+	void CBulletPool::Prewarm()
+	{
+		const size_t capacity = static_cast<size_t>(max(0, min(g_bulletPoolCapacity, g_bulletPoolMaxCapacity)));
+		if (m_spawnedCount < capacity)
+		{
+			SpawnBullets(capacity - m_spawnedCount);
+		}
+	}
+
+	void CBulletPool::Clear()
+	{
+		CSpatialIndex& spatialIndex = CGamePlugin::GetInstance()->GetSpatialIndex();
+		for (const SActiveBullet& activeBullet : m_active)
+		{
+			spatialIndex.Unregister(activeBullet.spatialHandle);
+		}
+
+		m_free.clear();
+		m_active.clear();
+		m_pendingRelease.clear();
+		m_spawnedCount = 0;
+	}
+
+	void CBulletPool::Update(float frameTime)
+	{
+		GAME_PROFILE_SCOPE("CBulletPool::Update");
+
+		const float currentTime = gEnv->pTimer->GetCurrTime();
+		CSpatialIndex& spatialIndex = CGamePlugin::GetInstance()->GetSpatialIndex();
+
+		for (const SActiveBullet& activeBullet : m_active)
+		{
+			if (!IsAlive(activeBullet.bullet))
+			{
+				// Dropped from the active list without being counted as a timeout
+				m_pendingRelease.push_back(activeBullet.bullet.id);
+				continue;
+			}
+
+			if (activeBullet.expiryTime <= currentTime && activeBullet.bullet.pComponent->IsActive())
+			{
+				Release(activeBullet.bullet.id, EReleaseReason::Timeout);
+			}
+
+			spatialIndex.Move(activeBullet.spatialHandle, activeBullet.bullet.pComponent->GetEntity()->GetWorldPos());
+		}
+
+		// Releases are deferred so that bullets are never hidden or disabled from inside their own physics callback
+		for (const EntityId releasedId : m_pendingRelease)
+		{
+			for (size_t i = 0, n = m_active.size(); i < n; ++i)
+			{
+				if (m_active[i].bullet.id == releasedId)
+				{
+					ReturnToFreeList(i);
+					break;
+				}
+			}
+		}
+
+		m_pendingRelease.clear();
+	}
+
+	bool CBulletPool::Fire(const QuatTS& muzzle)
+	{
+		GAME_PROFILE_SCOPE("CBulletPool::Fire");
+
+		SPooledBullet bullet;
+		if (!Acquire(bullet))
+		{
+			GAME_PROFILE_COUNTER("BulletPool::Dropped", 1);
+			++m_statistics.dropped;
+			return false;
+		}
+
+		bullet.pComponent->Launch(muzzle.t, muzzle.q);
+
+		SActiveBullet activeBullet;
+		activeBullet.bullet = bullet;
+		activeBullet.expiryTime = gEnv->pTimer->GetCurrTime() + g_bulletLifetime;
+		activeBullet.spatialHandle = CGamePlugin::GetInstance()->GetSpatialIndex().Register(bullet.id, eSpatialType_Projectile, muzzle.t, 0.f);
+		m_active.push_back(activeBullet);
+
+		return true;
+	}
+
+	void CBulletPool::Release(EntityId bulletId, EReleaseReason reason)
+	{
+		switch (reason)
+		{
+		case EReleaseReason::Collision:
+			++m_statistics.collisions;
+			break;
+		case EReleaseReason::Timeout:
+			++m_statistics.timeouts;
+			break;
+		}
+
+		m_pendingRelease.push_back(bulletId);
+	}
+
+	bool CBulletPool::SpawnBullets(size_t count)
+	{
+		SEntitySpawnParams spawnParams;
+		spawnParams.pClass = gEnv->pEntitySystem->GetClassRegistry()->GetDefaultClass();
+		spawnParams.sName = "PooledBullet";
+		spawnParams.vScale = Vec3(kBulletScale);
+
+		m_free.reserve(m_free.size() + count);
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			GAME_PROFILE_COUNTER("BulletPool::Spawned", 1);
+
+			IEntity* pEntity = gEnv->pEntitySystem->SpawnEntity(spawnParams);
+			if (pEntity == nullptr)
+			{
+				return false;
+			}
+
+			SPooledBullet bullet;
+			bullet.id = pEntity->GetId();
+			bullet.pComponent = pEntity->CreateComponentClass<CBulletComponent>();
+			bullet.pComponent->SetOwningPool(this);
+			bullet.pComponent->Deactivate();
+
+			m_free.push_back(bullet);
+			++m_spawnedCount;
+		}
+
+		return true;
+	}
+
+	bool CBulletPool::IsAlive(const SPooledBullet& bullet) const
+	{
+		// Entity ids are salted, so a removed bullet can never alias a newer entity
+		return gEnv->pEntitySystem->GetEntity(bullet.id) != nullptr;
+	}
+
+	bool CBulletPool::Acquire(SPooledBullet& bullet)
+	{
+		while (!m_free.empty())
+		{
+			bullet = m_free.back();
+			m_free.pop_back();
+
+			if (IsAlive(bullet))
+			{
+				++m_statistics.hits;
+				return true;
+			}
+
+			// The entity was removed behind our back, e.g. by a level reload
+			--m_spawnedCount;
+		}
+
+		++m_statistics.misses;
+
+		const size_t maxCapacity = static_cast<size_t>(max(0, g_bulletPoolMaxCapacity));
+		if (g_bulletPoolGrowth > 0 && m_spawnedCount < maxCapacity)
+		{
+			const size_t growCount = min(static_cast<size_t>(g_bulletPoolGrowth), maxCapacity - m_spawnedCount);
+			const size_t previousCount = m_spawnedCount;
+
+			SpawnBullets(growCount);
+			m_statistics.grownEntities += static_cast<uint32>(m_spawnedCount - previousCount);
+
+			if (!m_free.empty())
+			{
+				bullet = m_free.back();
+				m_free.pop_back();
+				return true;
+			}
+		}
+
+		// Steal the bullet that has been in flight the longest
+		size_t oldestIndex = m_active.size();
+		for (size_t i = 0, n = m_active.size(); i < n; ++i)
+		{
+			if (IsAlive(m_active[i].bullet) && (oldestIndex == m_active.size() || m_active[i].expiryTime < m_active[oldestIndex].expiryTime))
+			{
+				oldestIndex = i;
+			}
+		}
+
+		if (oldestIndex == m_active.size())
+		{
+			return false;
+		}
+
+		bullet = m_active[oldestIndex].bullet;
+		bullet.pComponent->Deactivate();
+		CGamePlugin::GetInstance()->GetSpatialIndex().Unregister(m_active[oldestIndex].spatialHandle);
+		m_active[oldestIndex] = m_active.back();
+		m_active.pop_back();
+
+		// The stolen bullet may already be queued for release, it must not be returned again once relaunched
+		m_pendingRelease.erase(std::remove(m_pendingRelease.begin(), m_pendingRelease.end(), bullet.id), m_pendingRelease.end());
+		// Including a collision release that CImpactSystem is still holding back
+		CGamePlugin::GetInstance()->GetImpactSystem().CancelRelease(bullet.id);
+
+		++m_statistics.recycled;
+		return true;
+	}
+
+	void CBulletPool::ReturnToFreeList(size_t activeIndex)
+	{
+		GAME_PROFILE_COUNTER("BulletPool::Returned", 1);
+
+		const SPooledBullet bullet = m_active[activeIndex].bullet;
+		CGamePlugin::GetInstance()->GetSpatialIndex().Unregister(m_active[activeIndex].spatialHandle);
+
+		m_active[activeIndex] = m_active.back();
+		m_active.pop_back();
+
+		if (IsAlive(bullet))
+		{
+			bullet.pComponent->Deactivate();
+			m_free.push_back(bullet);
+		}
+		else
+		{
+			--m_spawnedCount;
+		}
+	}
+}
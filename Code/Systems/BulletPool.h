@@ -0,0 +1,93 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+#pragma once
+
+#include "Core/SpatialGrid.h"
+
+#include <vector>
+
+class CBulletComponent;
+
+namespace Game
+{
+	////////////////////////////////////////////////////////
+	// Level-wide pool of pre-spawned bullet entities
+	// Bullets are hidden and put to sleep when returned, and re-launched on the next shot instead of
+	// going through SpawnEntity / RemoveEntity for every round fired
+	////////////////////////////////////////////////////////
+	class CBulletPool
+	{
+	public:
+		enum class EReleaseReason
+		{
+			Collision = 0,
+			Timeout
+		};
+
+		struct SStatistics
+		{
+			// Shots served straight from the free list
+			uint32 hits = 0;
+			// Shots that found the free list empty
+			uint32 misses = 0;
+			// Bullet entities spawned after the initial prewarm
+			uint32 grownEntities = 0;
+			// Active bullets reclaimed early because the pool was not allowed to grow
+			uint32 recycled = 0;
+			// Shots dropped because no bullet could be provided at all
+			uint32 dropped = 0;
+			uint32 collisions = 0;
+			uint32 timeouts = 0;
+		};
+
+		CBulletPool();
+		~CBulletPool();
+
+		// Spawns bullets until the pool holds g_bulletPoolCapacity entities
+		void Prewarm();
+		// Forgets all pooled entities, the entity system removes them together with the level
+		void Clear();
+		// Expires bullets that outlived g_bulletLifetime and returns released bullets to the free list
+		void Update(float frameTime);
+
+		// Launches a bullet from the muzzle transform, returns false if the shot had to be dropped
+		bool Fire(const QuatTS& muzzle);
+		// Hands an active bullet back to the pool, it is deactivated during the next Update
+		void Release(EntityId bulletId, EReleaseReason reason);
+
+		const SStatistics& GetStatistics() const { return m_statistics; }
+		void ResetStatistics() { m_statistics = SStatistics(); }
+
+		size_t GetCapacity() const { return m_spawnedCount; }
+		size_t GetActiveCount() const { return m_active.size(); }
+		size_t GetFreeCount() const { return m_free.size(); }
+		EntityId GetActiveId(size_t index) const { return m_active[index].bullet.id; }
+
+	private:
+		struct SPooledBullet
+		{
+			EntityId id = INVALID_ENTITYID;
+			CBulletComponent* pComponent = nullptr;
+		};
+
+		struct SActiveBullet
+		{
+			SPooledBullet bullet;
+			float expiryTime = 0.f;
+			CSpatialGrid::THandle spatialHandle = CSpatialGrid::kInvalidHandle;
+		};
+
+		bool SpawnBullets(size_t count);
+		bool IsAlive(const SPooledBullet& bullet) const;
+		bool Acquire(SPooledBullet& bullet);
+		void ReturnToFreeList(size_t activeIndex);
+
+	private:
+		std::vector<SPooledBullet> m_free;
+		std::vector<SActiveBullet> m_active;
+		std::vector<EntityId> m_pendingRelease;
+
+		size_t m_spawnedCount = 0;
+		SStatistics m_statistics;
+	};
+}
@@ -0,0 +1,236 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+#include "StdAfx.h"
+#include "CharacterAnimation.h"
+
+#include "GamePlugin.h"
+#include "GameProfiler.h"
+#include "LagCompensation.h"
+#include "PlayerSystem.h"
+
+#include "Components/Player.h"
+
+#include <CryAnimation/ICryAnimation.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+namespace Game
+{
+	namespace
+	{
+		int   g_animationLod = 1;
+		float g_animationLodReducedDistance = 15.f;
+		float g_animationLodMinimalDistance = 40.f;
+		float g_animationLodReducedRate = 30.f;
+		float g_animationLodMinimalRate = 10.f;
+
+		// Roughly the character controller capsule, centered at hip height
+		constexpr float kCharacterRadius = 0.9f;
+
+		const char* GetLodName(EAnimationLod lod)
+		{
+			switch (lod)
+			{
+			case EAnimationLod::Full:
+				return "Full";
+			case EAnimationLod::Reduced:
+				return "Reduced";
+			default:
+				return "Minimal";
+			}
+		}
+	}
+
+	CCharacterAnimation::CCharacterAnimation()
+	{
+		REGISTER_CVAR2("g_animationLod", &g_animationLod, g_animationLod, VF_NULL, "Animates characters at a rate depending on their distance to the camera and whether they are on screen\n0 = every character every frame, with IK");
+		REGISTER_CVAR2("g_animationLodReducedDistance", &g_animationLodReducedDistance, g_animationLodReducedDistance, VF_NULL, "Distance from the camera beyond which characters are animated at g_animationLodReducedRate and without IK");
+		REGISTER_CVAR2("g_animationLodMinimalDistance", &g_animationLodMinimalDistance, g_animationLodMinimalDistance, VF_NULL, "Distance from the camera beyond which characters, like those off-screen, are animated at g_animationLodMinimalRate");
+		REGISTER_CVAR2("g_animationLodReducedRate", &g_animationLodReducedRate, g_animationLodReducedRate, VF_NULL, "Animation updates per second of characters at medium distance");
+		REGISTER_CVAR2("g_animationLodMinimalRate", &g_animationLodMinimalRate, g_animationLodMinimalRate, VF_NULL, "Animation updates per second of distant and off-screen characters");
+		REGISTER_COMMAND("g_animationLodInfo", LogInfo, VF_NULL, "Logs how many characters were at each animation LOD last frame and how many of them were animated");
+		REGISTER_COMMAND("g_animationLodBench", Benchmark, VF_NULL, "Animates 64 characters spread from 2 to 100 m, half of them off-screen, every frame and by animation LOD, and logs ms/frame of both\nUsage: g_animationLodBench [frames] [character]");
+	}
+
+	CCharacterAnimation::~CCharacterAnimation()
+	{
+		if (IConsole* pConsole = gEnv->pConsole)
+		{
+			pConsole->UnregisterVariable("g_animationLod", true);
+			pConsole->UnregisterVariable("g_animationLodReducedDistance", true);
+			pConsole->UnregisterVariable("g_animationLodMinimalDistance", true);
+			pConsole->UnregisterVariable("g_animationLodReducedRate", true);
+			pConsole->UnregisterVariable("g_animationLodMinimalRate", true);
+			pConsole->RemoveCommand("g_animationLodInfo");
+			pConsole->RemoveCommand("g_animationLodBench");
+		}
+	}
+
+	bool CCharacterAnimation::IsLodEnabled()
+	{
+		return g_animationLod != 0;
+	}
+
+	SAnimationLodParams CCharacterAnimation::GetLodParams()
+	{
+		SAnimationLodParams params;
+		params.reducedDistance = max(0.f, g_animationLodReducedDistance);
+		params.minimalDistance = max(params.reducedDistance, g_animationLodMinimalDistance);
+		params.reducedInterval = 1.f / max(1.f, g_animationLodReducedRate);
+		params.minimalInterval = 1.f / clamp_tpl(g_animationLodMinimalRate, 1.f, max(1.f, g_animationLodReducedRate));
+		return params;
+	}
+
+	void CCharacterAnimation::Update(float frameTime)
+	{
+		const std::vector<CPlayerComponent*>& players = CGamePlugin::GetInstance()->GetPlayerSystem().GetPlayers();
+
+		std::fill(std::begin(m_lodCounts), std::end(m_lodCounts), 0);
+		m_updatedCount = 0;
+
+		if (players.empty())
+		{
+			return;
+		}
+
+		GAME_PROFILE_SCOPE("CCharacterAnimation::Update");
+
+		const SAnimationLodParams params = GetLodParams();
+		const CCamera& camera = gEnv->pSystem->GetViewCamera();
+		// The server records hitboxes from the animated poses, they have to be current, see CLagCompensation
+		const bool isLodAllowed = IsLodEnabled() && !(gEnv->bServer && CGamePlugin::GetInstance()->GetLagCompensation().IsEnabled());
+
+		for (CPlayerComponent* pPlayer : players)
+		{
+			EAnimationLod lod = EAnimationLod::Full;
+			// The local player is at the camera and always gets the full LOD
+			if (isLodAllowed)
+			{
+				const Vec3 center = pPlayer->GetEntity()->GetWorldPos() + Vec3(0.f, 0.f, kCharacterRadius);
+				const bool isVisible = camera.IsSphereVisible_F(Sphere(center, kCharacterRadius));
+				lod = SelectAnimationLod(camera.GetPosition().GetDistance(center), isVisible, params);
+			}
+
+			const float deltaTime = ScheduleAnimationUpdate(pPlayer->GetAnimationLod(), lod, frameTime, params);
+			pPlayer->UpdateAnimation(deltaTime, frameTime);
+
+			++m_lodCounts[static_cast<size_t>(lod)];
+			m_updatedCount += deltaTime > 0.f ? 1 : 0;
+		}
+
+		const int64 playerCount = static_cast<int64>(players.size());
+		GAME_PROFILE_COUNTER("CharacterAnimation::Updated", static_cast<int64>(m_updatedCount));
+		GAME_PROFILE_COUNTER("CharacterAnimation::Skipped", playerCount - static_cast<int64>(m_updatedCount));
+		GAME_PROFILE_COUNTER("CharacterAnimation::WithoutIk", playerCount - static_cast<int64>(m_lodCounts[static_cast<size_t>(EAnimationLod::Full)]));
+	}
+
+	void CCharacterAnimation::LogInfo(IConsoleCmdArgs* pArgs)
+	{
+		const CCharacterAnimation& characterAnimation = CGamePlugin::GetInstance()->GetCharacterAnimation();
+		const SAnimationLodParams params = GetLodParams();
+
+		CryLogAlways("[CharacterAnimation] LOD %s, reduced beyond %.0f m at %.0f Hz, minimal beyond %.0f m or off-screen at %.0f Hz",
+			IsLodEnabled() ? "enabled" : "disabled", params.reducedDistance, 1.f / params.reducedInterval, params.minimalDistance, 1.f / params.minimalInterval);
+
+		uint32 characterCount = 0;
+		for (const EAnimationLod lod : { EAnimationLod::Full, EAnimationLod::Reduced, EAnimationLod::Minimal })
+		{
+			const uint32 count = characterAnimation.m_lodCounts[static_cast<size_t>(lod)];
+			CryLogAlways("[CharacterAnimation] %-8s %u characters", GetLodName(lod), count);
+			characterCount += count;
+		}
+		CryLogAlways("[CharacterAnimation] %u of %u characters animated last frame", characterAnimation.m_updatedCount, characterCount);
+	}
+
+	void CCharacterAnimation::Benchmark(IConsoleCmdArgs* pArgs)
+	{
+		const int frameCount = pArgs->GetArgCount() > 1 ? max(1, atoi(pArgs->GetArg(1))) : 300;
+		const char* szCharacter = pArgs->GetArgCount() > 2 ? pArgs->GetArg(2) : "Objects/Characters/SampleCharacter/thirdperson.cdf";
+
+		constexpr size_t kCharacterCount = 64;
+		constexpr float kFrameTime = 1.f / 60.f;
+
+		std::vector<_smart_ptr<ICharacterInstance>> characters;
+		characters.reserve(kCharacterCount);
+		for (size_t i = 0; i < kCharacterCount; ++i)
+		{
+			ICharacterInstance* pCharacter = gEnv->pCharacterManager->CreateInstance(szCharacter);
+			if (pCharacter == nullptr)
+			{
+				CryLogAlways("[CharacterAnimation] Could not load %s", szCharacter);
+				return;
+			}
+
+			// The move blend space of the Walk fragment, the most expensive locomotion state
+			CryCharAnimationParams animationParams;
+			animationParams.m_nFlags = CA_LOOP_ANIMATION;
+			pCharacter->GetISkeletonAnim()->StartAnimation("2DONE-BSpace_MoveStrafeRIFLE", animationParams);
+			pCharacter->GetISkeletonAnim()->SetDesiredMotionParam(eMotionParamID_TravelSpeed, 1.5f, 0.f);
+			pCharacter->GetISkeletonAnim()->SetDesiredMotionParam(eMotionParamID_TravelAngle, 0.f, 0.f);
+
+			characters.push_back(pCharacter);
+		}
+
+		const SAnimationLodParams params = GetLodParams();
+
+		const auto run = [&](bool useLod, uint32& outUpdateCount, uint32& outFullCount)
+		{
+			std::vector<SAnimationLodState> states(kCharacterCount);
+			std::vector<size_t> processing;
+			processing.reserve(kCharacterCount);
+			for (size_t i = 0; i < kCharacterCount; ++i)
+			{
+				InitializeAnimationLod(states[i], static_cast<float>(i) / static_cast<float>(kCharacterCount), params);
+			}
+
+			outUpdateCount = 0;
+			outFullCount = 0;
+
+			const auto start = std::chrono::steady_clock::now();
+			for (int frame = 0; frame < frameCount; ++frame)
+			{
+				processing.clear();
+				for (size_t i = 0; i < kCharacterCount; ++i)
+				{
+					// Spread like players in a match, every other character behind the camera
+					const float distance = 2.f + 98.f * static_cast<float>(i) / static_cast<float>(kCharacterCount - 1);
+					const EAnimationLod lod = useLod ? SelectAnimationLod(distance, i % 2 == 0, params) : EAnimationLod::Full;
+					outFullCount += lod == EAnimationLod::Full ? 1 : 0;
+
+					const float deltaTime = ScheduleAnimationUpdate(states[i], lod, kFrameTime, params);
+					if (deltaTime <= 0.f)
+					{
+						continue;
+					}
+
+					SAnimationProcessParams processParams;
+					processParams.locationAnimation = QuatTS(IDENTITY, Vec3(0.f, distance, 0.f));
+					processParams.zoomAdjustedDistanceFromCamera = distance;
+					processParams.overrideDeltaTime = deltaTime;
+					characters[i]->StartAnimationProcessing(processParams);
+					processing.push_back(i);
+				}
+
+				for (const size_t i : processing)
+				{
+					characters[i]->FinishAnimationComputations();
+				}
+				outUpdateCount += static_cast<uint32>(processing.size());
+			}
+
+			const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+			return elapsed.count() / static_cast<double>(frameCount);
+		};
+
+		uint32 fullUpdateCount, fullIkCount, lodUpdateCount, lodIkCount;
+		const double fullMs = run(false, fullUpdateCount, fullIkCount);
+		const double lodMs = run(true, lodUpdateCount, lodIkCount);
+
+		const double frames = static_cast<double>(frameCount);
+		CryLogAlways("[CharacterAnimation] %" PRISIZE_T " characters, %d frames at 60 Hz", kCharacterCount, frameCount);
+		CryLogAlways("[CharacterAnimation] Every frame: %.3f ms/frame, %.1f updates/frame, %.1f with IK", fullMs, fullUpdateCount / frames, fullIkCount / frames);
+		CryLogAlways("[CharacterAnimation] By LOD:      %.3f ms/frame, %.1f updates/frame, %.1f with IK", lodMs, lodUpdateCount / frames, lodIkCount / frames);
+		CryLogAlways("[CharacterAnimation] Saved %.3f ms/frame (%.0f%%)", fullMs - lodMs, fullMs > 0.0 ? 100.0 * (fullMs - lodMs) / fullMs : 0.0);
+	}
+}
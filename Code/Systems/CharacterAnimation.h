@@ -0,0 +1,36 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+#pragma once
+
+#include "Core/AnimationLod.h"
+
+namespace Game
+{
+	////////////////////////////////////////////////////////
+	// Locomotion animation and animation LOD of all players
+	// Once per frame, after movement, every player's character is given an animation LOD by its distance to the view
+	// camera and whether it is on screen. Characters that are due advance by the time since their last update and get
+	// their locomotion parameters and fragment from the movement state, the others keep their pose for the frame.
+	// Only the closest characters run IK. While g_animationLod is off, every character is animated every frame.
+	////////////////////////////////////////////////////////
+	class CCharacterAnimation
+	{
+	public:
+		CCharacterAnimation();
+		~CCharacterAnimation();
+
+		void Update(float frameTime);
+
+		static bool IsLodEnabled();
+		static SAnimationLodParams GetLodParams();
+
+	private:
+		static void LogInfo(IConsoleCmdArgs* pArgs);
+		static void Benchmark(IConsoleCmdArgs* pArgs);
+
+	private:
+		// Characters per LOD in the last frame, and how many of them were animated
+		uint32 m_lodCounts[3] = {};
+		uint32 m_updatedCount = 0;
+	};
+}
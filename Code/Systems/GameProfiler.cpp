@@ -0,0 +1,320 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+#include "StdAfx.h"
+#include "GameProfiler.h"
+#include "GamePlugin.h"
+
+#include "Core/SpscRing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+
+namespace Game
+{
+	namespace
+	{
+		int g_profiler = 0;
+
+		struct SRecord
+		{
+			const char* szName;
+			uint64_t startNs;
+			// Duration in nanoseconds for timers, the added amount for counters
+			int64_t value;
+			bool isCounter;
+		};
+
+		// One second of heavy instrumentation at 60 fps, records that don't fit are dropped and counted
+		constexpr size_t kThreadRingCapacity = 8192;
+
+		struct SThreadBuffer
+		{
+			CSpscRing<SRecord, kThreadRingCapacity> ring;
+			uint32_t threadIndex = 0;
+			std::atomic<uint32_t> droppedRecords { 0 };
+		};
+
+		// Threads register once on their first record, after that recording never takes the lock
+		std::mutex s_threadBufferMutex;
+		std::vector<std::unique_ptr<SThreadBuffer>> s_threadBuffers;
+		thread_local SThreadBuffer* t_pThreadBuffer = nullptr;
+
+		SThreadBuffer& GetThreadBuffer()
+		{
+			if (t_pThreadBuffer == nullptr)
+			{
+				std::lock_guard<std::mutex> lock(s_threadBufferMutex);
+				s_threadBuffers.push_back(std::unique_ptr<SThreadBuffer>(new SThreadBuffer()));
+				t_pThreadBuffer = s_threadBuffers.back().get();
+				t_pThreadBuffer->threadIndex = static_cast<uint32_t>(s_threadBuffers.size() - 1);
+			}
+
+			return *t_pThreadBuffer;
+		}
+
+		void Record(const SRecord& record)
+		{
+			SThreadBuffer& buffer = GetThreadBuffer();
+			if (!buffer.ring.TryPush(record))
+			{
+				buffer.droppedRecords.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+
+		template<typename T>
+		T GetPercentile(std::vector<T>& values, float percentile)
+		{
+			const size_t index = min(static_cast<size_t>(percentile * static_cast<float>(values.size())), values.size() - 1);
+			std::nth_element(values.begin(), values.begin() + index, values.end());
+			return values[index];
+		}
+
+		void LogProfilerStatistics(IConsoleCmdArgs* pArgs)
+		{
+			CGameProfiler& profiler = CGamePlugin::GetInstance()->GetProfiler();
+			profiler.LogStatistics();
+
+			if (pArgs->GetArgCount() > 1 && strcmp(pArgs->GetArg(1), "reset") == 0)
+			{
+				profiler.ResetStatistics();
+			}
+		}
+
+		void CaptureProfilerTrace(IConsoleCmdArgs* pArgs)
+		{
+			const int frameCount = pArgs->GetArgCount() > 1 ? max(1, atoi(pArgs->GetArg(1))) : 60;
+			const char* szFileName = pArgs->GetArgCount() > 2 ? pArgs->GetArg(2) : "%USER%/Profiling/GameTrace.json";
+
+			CGamePlugin::GetInstance()->GetProfiler().StartTraceCapture(static_cast<uint32_t>(frameCount), szFileName);
+		}
+	}
+
+	std::atomic<bool> CGameProfiler::s_isRecording { false };
+
+	CGameProfiler::CGameProfiler()
+	{
+		REGISTER_CVAR2("g_profiler", &g_profiler, g_profiler, VF_NULL, "Records gameplay timers and counters for g_profilerStats");
+		REGISTER_COMMAND("g_profilerStats", LogProfilerStatistics, VF_NULL, "Logs p50/p95/p99 per frame of all gameplay timers and counters, pass 'reset' to clear them afterwards");
+		REGISTER_COMMAND("g_profilerTrace", CaptureProfilerTrace, VF_NULL, "Captures gameplay timers and counters as Chrome trace JSON\nUsage: g_profilerTrace [frames] [file]");
+	}
+
+	CGameProfiler::~CGameProfiler()
+	{
+		s_isRecording.store(false, std::memory_order_relaxed);
+
+		if (IConsole* pConsole = gEnv->pConsole)
+		{
+			pConsole->UnregisterVariable("g_profiler", true);
+			pConsole->RemoveCommand("g_profilerStats");
+			pConsole->RemoveCommand("g_profilerTrace");
+		}
+	}
+
+	uint64_t CGameProfiler::GetTimeNs()
+	{
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+
+	void CGameProfiler::RecordScope(const char* szName, uint64_t startNs, uint64_t durationNs)
+	{
+		Record(SRecord { szName, startNs, static_cast<int64_t>(durationNs), false });
+	}
+
+	void CGameProfiler::AddToCounter(const char* szName, int64_t value)
+	{
+		if (IsRecording())
+		{
+			Record(SRecord { szName, GetTimeNs(), value, true });
+		}
+	}
+
+	void CGameProfiler::EndFrame()
+	{
+		const bool isCapturingTrace = m_traceFramesRemaining > 0;
+
+		{
+			std::lock_guard<std::mutex> lock(s_threadBufferMutex);
+
+			for (const std::unique_ptr<SThreadBuffer>& pBuffer : s_threadBuffers)
+			{
+				SRecord record;
+				while (pBuffer->ring.TryPop(record))
+				{
+					SStatistic& statistic = m_statistics[record.szName];
+					statistic.isCounter = record.isCounter;
+					statistic.currentFrameTotal += record.value;
+					++statistic.currentFrameCalls;
+
+					if (isCapturingTrace)
+					{
+						m_traceEvents.push_back(STraceEvent { record.szName, record.startNs, record.value, pBuffer->threadIndex, record.isCounter });
+					}
+				}
+
+				const uint32_t droppedRecords = pBuffer->droppedRecords.exchange(0, std::memory_order_relaxed);
+				if (droppedRecords > 0)
+				{
+					SStatistic& statistic = m_statistics["GameProfiler::DroppedRecords"];
+					statistic.isCounter = true;
+					statistic.currentFrameTotal += droppedRecords;
+					++statistic.currentFrameCalls;
+				}
+			}
+		}
+
+		for (auto& namedStatistic : m_statistics)
+		{
+			SStatistic& statistic = namedStatistic.second;
+			if (statistic.currentFrameCalls == 0)
+			{
+				continue;
+			}
+
+			if (statistic.frameTotals.size() < kHistoryFrames)
+			{
+				statistic.frameTotals.push_back(statistic.currentFrameTotal);
+				statistic.frameCalls.push_back(statistic.currentFrameCalls);
+			}
+			else
+			{
+				statistic.frameTotals[statistic.nextFrameIndex] = statistic.currentFrameTotal;
+				statistic.frameCalls[statistic.nextFrameIndex] = statistic.currentFrameCalls;
+			}
+			statistic.nextFrameIndex = (statistic.nextFrameIndex + 1) % kHistoryFrames;
+
+			statistic.currentFrameTotal = 0;
+			statistic.currentFrameCalls = 0;
+		}
+
+		if (isCapturingTrace && --m_traceFramesRemaining == 0)
+		{
+			WriteTrace();
+		}
+
+		s_isRecording.store(g_profiler != 0 || m_traceFramesRemaining > 0, std::memory_order_relaxed);
+	}
+
+	void CGameProfiler::LogStatistics() const
+	{
+		if (m_statistics.empty())
+		{
+			CryLogAlways("[GameProfiler] Nothing recorded, set g_profiler 1 first");
+			return;
+		}
+
+		struct SRow
+		{
+			const char* szName;
+			const SStatistic* pStatistic;
+			int64_t p95;
+		};
+
+		std::vector<SRow> rows;
+		std::vector<int64_t> totals;
+		for (const auto& namedStatistic : m_statistics)
+		{
+			if (!namedStatistic.second.frameTotals.empty())
+			{
+				totals = namedStatistic.second.frameTotals;
+				rows.push_back(SRow { namedStatistic.first, &namedStatistic.second, GetPercentile(totals, 0.95f) });
+			}
+		}
+
+		// Timers first, most expensive first
+		std::sort(rows.begin(), rows.end(), [](const SRow& a, const SRow& b)
+		{
+			return a.pStatistic->isCounter != b.pStatistic->isCounter ? !a.pStatistic->isCounter : a.p95 > b.p95;
+		});
+
+		CryLogAlways("[GameProfiler] Per frame over the last %" PRISIZE_T " frames each name was used in", kHistoryFrames);
+		CryLogAlways("[GameProfiler] %-40s %8s %10s %10s %10s %7s", "Name", "Frames", "p50", "p95", "p99", "Calls");
+
+		for (const SRow& row : rows)
+		{
+			const SStatistic& statistic = *row.pStatistic;
+
+			totals = statistic.frameTotals;
+			const int64_t p50 = GetPercentile(totals, 0.5f);
+			const int64_t p99 = GetPercentile(totals, 0.99f);
+
+			uint64_t callCount = 0;
+			for (const uint32_t calls : statistic.frameCalls)
+			{
+				callCount += calls;
+			}
+			const float callsPerFrame = static_cast<float>(callCount) / static_cast<float>(statistic.frameCalls.size());
+
+			if (statistic.isCounter)
+			{
+				CryLogAlways("[GameProfiler] %-40s %8" PRISIZE_T " %10lld %10lld %10lld %7.1f", row.szName, statistic.frameTotals.size(), static_cast<long long>(p50), static_cast<long long>(row.p95), static_cast<long long>(p99), callsPerFrame);
+			}
+			else
+			{
+				CryLogAlways("[GameProfiler] %-40s %8" PRISIZE_T " %8.3fms %8.3fms %8.3fms %7.1f", row.szName, statistic.frameTotals.size(), p50 / 1e6, row.p95 / 1e6, p99 / 1e6, callsPerFrame);
+			}
+		}
+	}
+
+	void CGameProfiler::StartTraceCapture(uint32_t frameCount, const char* szFileName)
+	{
+		if (m_traceFramesRemaining > 0)
+		{
+			CryLogAlways("[GameProfiler] A trace capture is already running");
+			return;
+		}
+
+		m_traceEvents.clear();
+		m_traceFileName = szFileName;
+		m_traceFramesRemaining = frameCount;
+		m_traceStartNs = GetTimeNs();
+
+		s_isRecording.store(true, std::memory_order_relaxed);
+		CryLogAlways("[GameProfiler] Capturing %u frames to %s", frameCount, szFileName);
+	}
+
+	void CGameProfiler::WriteTrace()
+	{
+		FILE* pFile = gEnv->pCryPak->FOpen(m_traceFileName.c_str(), "wb");
+		if (pFile == nullptr)
+		{
+			CryLogAlways("[GameProfiler] Could not open %s for writing", m_traceFileName.c_str());
+			return;
+		}
+
+		// Counters become running totals so that the trace viewer shows their value over time
+		std::unordered_map<const char*, int64_t> counterValues;
+
+		string json = "{\"traceEvents\":[\n";
+		char line[512];
+		for (size_t i = 0, n = m_traceEvents.size(); i < n; ++i)
+		{
+			const STraceEvent& event = m_traceEvents[i];
+
+			// Records from before the capture started were still in the rings
+			const double timestampUs = event.startNs >= m_traceStartNs ? (event.startNs - m_traceStartNs) / 1000.0 : 0.0;
+
+			if (event.isCounter)
+			{
+				const int64_t value = counterValues[event.szName] += event.value;
+				cry_sprintf(line, "{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":0,\"tid\":%u,\"args\":{\"value\":%lld}}", event.szName, timestampUs, event.threadIndex, static_cast<long long>(value));
+			}
+			else
+			{
+				cry_sprintf(line, "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":0,\"tid\":%u}", event.szName, timestampUs, event.value / 1000.0, event.threadIndex);
+			}
+
+			json += line;
+			json += i + 1 < n ? ",\n" : "\n";
+		}
+		json += "]}\n";
+
+		gEnv->pCryPak->FWrite(json.c_str(), json.length(), 1, pFile);
+		gEnv->pCryPak->FClose(pFile);
+
+		CryLogAlways("[GameProfiler] Wrote %" PRISIZE_T " events to %s", m_traceEvents.size(), m_traceFileName.c_str());
+
+		m_traceEvents.clear();
+		m_traceEvents.shrink_to_fit();
+	}
+}
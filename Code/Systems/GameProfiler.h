@@ -0,0 +1,120 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Gameplay instrumentation is compiled out of release builds
+#if !defined(_RELEASE)
+	#define GAME_PROFILER_ENABLED 1
+#else
+	#define GAME_PROFILER_ENABLED 0
+#endif
+
+#define GAME_PROFILE_CONCAT_IMPL(a, b) a ## b
+#define GAME_PROFILE_CONCAT(a, b)      GAME_PROFILE_CONCAT_IMPL(a, b)
+
+#if GAME_PROFILER_ENABLED
+	// Times the enclosing scope, szName has to be a string literal
+	#define GAME_PROFILE_SCOPE(szName)          const Game::CGameProfiler::CScopedTimer GAME_PROFILE_CONCAT(gameProfileScope, __LINE__)(szName)
+	// Adds value to a per-frame counter, szName has to be a string literal
+	#define GAME_PROFILE_COUNTER(szName, value) Game::CGameProfiler::AddToCounter(szName, value)
+#else
+	#define GAME_PROFILE_SCOPE(szName)          (void)0
+	#define GAME_PROFILE_COUNTER(szName, value) (void)0
+#endif
+
+namespace Game
+{
+	////////////////////////////////////////////////////////
+	// Scoped timers and counters for gameplay code
+	// Every thread records into its own lock-free ring, the main thread drains all rings once per frame
+	// into per-frame totals. g_profilerStats logs p50/p95/p99 over the last frames and g_profilerTrace
+	// captures frames as Chrome trace JSON (chrome://tracing, Perfetto).
+	////////////////////////////////////////////////////////
+	class CGameProfiler
+	{
+	public:
+		class CScopedTimer
+		{
+		public:
+			explicit CScopedTimer(const char* szName)
+				: m_szName(IsRecording() ? szName : nullptr)
+				, m_startNs(m_szName != nullptr ? GetTimeNs() : 0)
+			{}
+
+			~CScopedTimer()
+			{
+				if (m_szName != nullptr)
+				{
+					RecordScope(m_szName, m_startNs, GetTimeNs() - m_startNs);
+				}
+			}
+
+			CScopedTimer(const CScopedTimer&) = delete;
+			CScopedTimer& operator=(const CScopedTimer&) = delete;
+
+		private:
+			const char* m_szName;
+			uint64_t m_startNs;
+		};
+
+		// Frames kept for the percentiles, ten seconds at 60 fps
+		static constexpr size_t kHistoryFrames = 600;
+
+		CGameProfiler();
+		~CGameProfiler();
+
+		// Drains the per-thread rings, called once per frame from the main thread
+		void EndFrame();
+
+		static bool IsRecording() { return s_isRecording.load(std::memory_order_relaxed); }
+		static uint64_t GetTimeNs();
+
+		static void RecordScope(const char* szName, uint64_t startNs, uint64_t durationNs);
+		static void AddToCounter(const char* szName, int64_t value);
+
+		void LogStatistics() const;
+		void ResetStatistics() { m_statistics.clear(); }
+		// Captures the next frameCount frames and writes them to the file once done
+		void StartTraceCapture(uint32_t frameCount, const char* szFileName);
+
+	private:
+		// Per-frame totals of one timer or counter over the last kHistoryFrames frames in which it was used
+		struct SStatistic
+		{
+			bool isCounter = false;
+			int64_t currentFrameTotal = 0;
+			uint32_t currentFrameCalls = 0;
+
+			std::vector<int64_t> frameTotals;
+			std::vector<uint32_t> frameCalls;
+			size_t nextFrameIndex = 0;
+		};
+
+		struct STraceEvent
+		{
+			const char* szName;
+			uint64_t startNs;
+			int64_t value;
+			uint32_t threadIndex;
+			bool isCounter;
+		};
+
+		void WriteTrace();
+
+	private:
+		static std::atomic<bool> s_isRecording;
+
+		std::unordered_map<const char*, SStatistic> m_statistics;
+
+		std::vector<STraceEvent> m_traceEvents;
+		std::string m_traceFileName;
+		uint32_t m_traceFramesRemaining = 0;
+		uint64_t m_traceStartNs = 0;
+	};
+}
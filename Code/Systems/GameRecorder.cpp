@@ -0,0 +1,425 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+#include "StdAfx.h"
+#include "GameRecorder.h"
+
+#include "BulletPool.h"
+#include "GamePlugin.h"
+#include "GameProfiler.h"
+#include "PlayerSystem.h"
+
+#include "Components/Player.h"
+
+#include <CryEntitySystem/IEntitySystem.h>
+
+namespace Game
+{
+	namespace
+	{
+		float g_recordBudget = 0.1f;
+
+		void StartGameRecording(IConsoleCmdArgs* pArgs)
+		{
+			const char* szFileName = pArgs->GetArgCount() > 1 ? pArgs->GetArg(1) : "%USER%/Recordings/Match.grec";
+			CGamePlugin::GetInstance()->GetGameRecorder().StartRecording(szFileName);
+		}
+
+		void StopGameRecording(IConsoleCmdArgs* pArgs)
+		{
+			CGamePlugin::GetInstance()->GetGameRecorder().StopRecording();
+		}
+
+		void StartGameReplay(IConsoleCmdArgs* pArgs)
+		{
+			const char* szFileName = pArgs->GetArgCount() > 1 ? pArgs->GetArg(1) : "%USER%/Recordings/Match.grec";
+			const float speed = pArgs->GetArgCount() > 2 ? max(0.f, static_cast<float>(atof(pArgs->GetArg(2)))) : 1.f;
+			CGamePlugin::GetInstance()->GetGameRecorder().StartReplay(szFileName, speed);
+		}
+
+		void StopGameReplay(IConsoleCmdArgs* pArgs)
+		{
+			CGamePlugin::GetInstance()->GetGameRecorder().StopReplay();
+		}
+
+		CPlayerComponent* FindLocalPlayer()
+		{
+			for (CPlayerComponent* pPlayer : CGamePlugin::GetInstance()->GetPlayerSystem().GetPlayers())
+			{
+				if (pPlayer->GetEntity()->GetFlags() & ENTITY_FLAG_LOCAL_PLAYER)
+				{
+					return pPlayer;
+				}
+			}
+			return nullptr;
+		}
+
+		// Adds the time until the end of the scope to the recording time of the tick
+		class CRecordingTimer
+		{
+		public:
+			explicit CRecordingTimer(uint64& totalNs)
+				: m_totalNs(totalNs)
+				, m_startNs(CGameProfiler::GetTimeNs())
+			{}
+
+			~CRecordingTimer() { m_totalNs += CGameProfiler::GetTimeNs() - m_startNs; }
+
+		private:
+			uint64& m_totalNs;
+			uint64 m_startNs;
+		};
+	}
+
+	CGameRecorder::CGameRecorder()
+	{
+		REGISTER_CVAR2("g_recordBudget", &g_recordBudget, g_recordBudget, VF_NULL, "Milliseconds per frame that g_record may take on average over a second before a warning is logged");
+		REGISTER_COMMAND("g_record", StartGameRecording, VF_NULL, "Records input, shots, spawns and the transforms of players and bullets every frame until g_recordStop\nUsage: g_record [file]");
+		REGISTER_COMMAND("g_recordStop", StopGameRecording, VF_NULL, "Stops the recording started with g_record");
+		REGISTER_COMMAND("g_replay", StartGameReplay, VF_NULL, "Drives the local player with the input, shots and spawns of a recorded player\nUsage: g_replay [file] [speed], speed 0 replays one recorded frame per frame as fast as possible");
+		REGISTER_COMMAND("g_replayStop", StopGameReplay, VF_NULL, "Stops the replay started with g_replay and logs how far the local player drifted from the recording");
+	}
+
+	CGameRecorder::~CGameRecorder()
+	{
+		StopReplay();
+
+		if (IConsole* pConsole = gEnv->pConsole)
+		{
+			pConsole->UnregisterVariable("g_recordBudget", true);
+			pConsole->RemoveCommand("g_record");
+			pConsole->RemoveCommand("g_recordStop");
+			pConsole->RemoveCommand("g_replay");
+			pConsole->RemoveCommand("g_replayStop");
+		}
+	}
+
+	bool CGameRecorder::StartRecording(const char* szFileName)
+	{
+		StopRecording();
+
+		char adjustedFileName[ICryPak::g_nMaxPath];
+		const char* szPath = gEnv->pCryPak->AdjustFileName(szFileName, adjustedFileName, ICryPak::FLAGS_FOR_WRITING);
+		gEnv->pCryPak->MakeDir(PathUtil::GetPathWithoutFilename(szPath));
+
+		if (!m_writer.Open(szPath))
+		{
+			CryWarning(VALIDATOR_MODULE_GAME, VALIDATOR_WARNING, "[GameRecorder] Failed to open %s for writing", szPath);
+			return false;
+		}
+
+		m_tickNs = 0;
+		m_totalNs = 0;
+		m_windowNs = 0;
+		m_windowTicks = 0;
+		m_windowTime = 0.f;
+		m_overBudgetWindows = 0;
+
+		CryLogAlways("[GameRecorder] Recording to %s", szPath);
+		return true;
+	}
+
+	void CGameRecorder::StopRecording()
+	{
+		if (!m_writer.IsOpen())
+		{
+			return;
+		}
+
+		m_writer.Close();
+
+		const uint64 tickCount = max<uint64>(m_writer.GetTickCount(), 1);
+		CryLogAlways("[GameRecorder] Recorded %" PRIu64 " frames, %" PRIu64 " KB, %.1f bytes/frame, recording took %.3f ms/frame, %u seconds over g_recordBudget",
+			m_writer.GetTickCount(), m_writer.GetByteCount() / 1024, static_cast<double>(m_writer.GetByteCount()) / tickCount,
+			static_cast<double>(m_totalNs) / 1e6 / tickCount, m_overBudgetWindows);
+	}
+
+	bool CGameRecorder::StartReplay(const char* szFileName, float speed)
+	{
+		StopReplay();
+
+		// A client predicts its input and sends it to the server, replaying it there would need the same network traffic
+		if (!gEnv->bServer)
+		{
+			CryWarning(VALIDATOR_MODULE_GAME, VALIDATOR_WARNING, "[GameRecorder] Replays only run on the server or in a local game");
+			return false;
+		}
+
+		char adjustedFileName[ICryPak::g_nMaxPath];
+		const char* szPath = gEnv->pCryPak->AdjustFileName(szFileName, adjustedFileName, 0);
+
+		if (!m_reader.Open(szPath))
+		{
+			CryWarning(VALIDATOR_MODULE_GAME, VALIDATOR_WARNING, "[GameRecorder] Failed to open %s for replaying", szPath);
+			return false;
+		}
+
+		m_isReplaying = true;
+		m_replaySpeed = speed;
+		m_replayTime = 0.f;
+		m_nextTickTime = 0.f;
+		m_replayedEntityId = INVALID_ENTITYID;
+		m_hasRecordedPosition = false;
+		m_replayDrift = 0.f;
+		m_maxReplayDrift = 0.f;
+
+		if (m_replaySpeed > 0.f)
+		{
+			gEnv->pTimer->SetTimeScale(m_replaySpeed);
+		}
+		else if (ICVar* pFixedStep = gEnv->pConsole->GetCVar("t_FixedStep"))
+		{
+			m_previousFixedStep = pFixedStep->GetFVal();
+		}
+
+		CryLogAlways("[GameRecorder] Replaying %" PRIu64 " frames from %s", m_reader.GetTickCount(), szPath);
+		return true;
+	}
+
+	void CGameRecorder::StopReplay()
+	{
+		if (!m_isReplaying)
+		{
+			return;
+		}
+
+		m_isReplaying = false;
+
+		if (m_replaySpeed > 0.f)
+		{
+			gEnv->pTimer->SetTimeScale(1.f);
+		}
+		else if (ICVar* pFixedStep = gEnv->pConsole->GetCVar("t_FixedStep"))
+		{
+			pFixedStep->Set(m_previousFixedStep);
+		}
+
+		CryLogAlways("[GameRecorder] Replayed %" PRIu64 " of %" PRIu64 " frames, the local player ended %.2f m from its recorded position, %.2f m at most",
+			m_reader.GetNextTick(), m_reader.GetTickCount(), m_replayDrift, m_maxReplayDrift);
+		m_reader.Close();
+	}
+
+	void CGameRecorder::UpdateReplay(float frameTime)
+	{
+		if (!m_isReplaying)
+		{
+			return;
+		}
+
+		GAME_PROFILE_SCOPE("CGameRecorder::UpdateReplay");
+
+		if (m_replaySpeed <= 0.f)
+		{
+			if (!m_reader.ReadTick(m_replayedTick))
+			{
+				StopReplay();
+				return;
+			}
+
+			// Takes effect with the next frame, recorded frame times hardly change from one frame to the next
+			if (ICVar* pFixedStep = gEnv->pConsole->GetCVar("t_FixedStep"))
+			{
+				pFixedStep->Set(m_replayedTick.frameTime);
+			}
+			ReplayTick(m_replayedTick);
+			return;
+		}
+
+		// The frame time is scaled by the replay speed already
+		m_replayTime += frameTime;
+		while (m_nextTickTime <= m_replayTime)
+		{
+			if (!m_reader.ReadTick(m_replayedTick))
+			{
+				StopReplay();
+				return;
+			}
+
+			m_nextTickTime += m_replayedTick.frameTime;
+			ReplayTick(m_replayedTick);
+		}
+	}
+
+	void CGameRecorder::ReplayTick(const SRecordedTick& tick)
+	{
+		CPlayerComponent* pPlayer = FindLocalPlayer();
+		if (pPlayer == nullptr)
+		{
+			return;
+		}
+
+		IEntity& entity = *pPlayer->GetEntity();
+
+		// The player has run the previous tick's input by now
+		if (m_hasRecordedPosition)
+		{
+			m_replayDrift = entity.GetWorldPos().GetDistance(m_recordedPosition);
+			m_maxReplayDrift = max(m_maxReplayDrift, m_replayDrift);
+		}
+
+		// The local player's own recording if it is in the file, otherwise the first recorded player
+		if (m_replayedEntityId == INVALID_ENTITYID && !tick.inputs.empty())
+		{
+			m_replayedEntityId = tick.inputs.front().entityId;
+			for (const SRecordedInput& input : tick.inputs)
+			{
+				m_replayedEntityId = input.entityId == entity.GetId() ? input.entityId : m_replayedEntityId;
+			}
+		}
+
+		// Only the newest command of a frame is applied, but a jump in any of them counts, as in CPlayerComponent::SvRequestInput
+		const SPlayerInputCommand* pNewestCommand = nullptr;
+		uint8 jumpFlags = 0;
+		for (const SRecordedInput& input : tick.inputs)
+		{
+			if (input.entityId == m_replayedEntityId)
+			{
+				pNewestCommand = &input.command;
+				jumpFlags |= input.command.flags & ePlayerInputFlag_Jump;
+			}
+		}
+
+		if (pNewestCommand != nullptr)
+		{
+			SPlayerInputCommand command = *pNewestCommand;
+			command.flags |= jumpFlags;
+			pPlayer->ApplyExternalInput(command);
+		}
+
+		for (const SRecordedSpawn& spawn : tick.spawns)
+		{
+			if (spawn.entityId == m_replayedEntityId)
+			{
+				if (const IEntity* pSpawnPoint = gEnv->pEntitySystem->GetEntity(spawn.spawnPointId))
+				{
+					pPlayer->Teleport(pSpawnPoint->GetWorldTM());
+				}
+			}
+		}
+
+		for (const SRecordedShot& shot : tick.shots)
+		{
+			if (shot.entityId == m_replayedEntityId)
+			{
+				const Quat rotation(shot.rotation[3], shot.rotation[0], shot.rotation[1], shot.rotation[2]);
+				pPlayer->ReplayShot(QuatTS(rotation.GetNormalized(), Vec3(shot.position.x, shot.position.y, shot.position.z), 1.f));
+			}
+		}
+
+		for (const SRecordedTransform& transform : tick.transforms)
+		{
+			if (transform.entityId == m_replayedEntityId)
+			{
+				m_recordedPosition = Vec3(transform.position.x, transform.position.y, transform.position.z);
+				m_hasRecordedPosition = true;
+			}
+		}
+	}
+
+	void CGameRecorder::UpdateRecording(float frameTime)
+	{
+		if (!m_writer.IsOpen())
+		{
+			return;
+		}
+
+		GAME_PROFILE_SCOPE("CGameRecorder::UpdateRecording");
+
+		{
+			CRecordingTimer timer(m_tickNs);
+
+			for (const CPlayerComponent* pPlayer : CGamePlugin::GetInstance()->GetPlayerSystem().GetPlayers())
+			{
+				const IEntity& entity = *pPlayer->GetEntity();
+				WriteTransform(entity.GetId(), entity.GetWorldPos(), entity.GetWorldRotation());
+			}
+
+			const CBulletPool& bulletPool = CGamePlugin::GetInstance()->GetBulletPool();
+			for (size_t i = 0, n = bulletPool.GetActiveCount(); i < n; ++i)
+			{
+				if (const IEntity* pBullet = gEnv->pEntitySystem->GetEntity(bulletPool.GetActiveId(i)))
+				{
+					WriteTransform(pBullet->GetId(), pBullet->GetWorldPos(), pBullet->GetWorldRotation());
+				}
+			}
+
+			m_writer.EndTick(frameTime);
+		}
+
+		GAME_PROFILE_COUNTER("GameRecorder::RecordingUs", static_cast<int64>(m_tickNs / 1000));
+
+		m_totalNs += m_tickNs;
+		m_windowNs += m_tickNs;
+		m_tickNs = 0;
+		++m_windowTicks;
+		m_windowTime += frameTime;
+
+		if (m_windowTime >= 1.f)
+		{
+			const float msPerTick = static_cast<float>(static_cast<double>(m_windowNs) / 1e6 / m_windowTicks);
+			if (msPerTick > g_recordBudget)
+			{
+				// Only the first time, the total is logged when the recording stops
+				if (m_overBudgetWindows++ == 0)
+				{
+					CryWarning(VALIDATOR_MODULE_GAME, VALIDATOR_WARNING, "[GameRecorder] Recording took %.3f ms/frame over the last second, g_recordBudget is %.3f ms", msPerTick, g_recordBudget);
+				}
+			}
+
+			m_windowNs = 0;
+			m_windowTicks = 0;
+			m_windowTime = 0.f;
+		}
+	}
+
+	void CGameRecorder::RecordInput(EntityId entityId, const SPlayerInputCommand& command)
+	{
+		if (!m_writer.IsOpen())
+		{
+			return;
+		}
+
+		CRecordingTimer timer(m_tickNs);
+		m_writer.WriteInput(entityId, command);
+	}
+
+	void CGameRecorder::RecordShot(EntityId shooterId, const QuatTS& muzzle)
+	{
+		if (!m_writer.IsOpen())
+		{
+			return;
+		}
+
+		CRecordingTimer timer(m_tickNs);
+
+		SRecordedShot shot;
+		shot.entityId = shooterId;
+		shot.position = SVec3f(muzzle.t.x, muzzle.t.y, muzzle.t.z);
+		shot.rotation[0] = muzzle.q.v.x;
+		shot.rotation[1] = muzzle.q.v.y;
+		shot.rotation[2] = muzzle.q.v.z;
+		shot.rotation[3] = muzzle.q.w;
+		m_writer.WriteShot(shot);
+	}
+
+	void CGameRecorder::RecordSpawn(EntityId entityId, EntityId spawnPointId)
+	{
+		if (!m_writer.IsOpen())
+		{
+			return;
+		}
+
+		CRecordingTimer timer(m_tickNs);
+		m_writer.WriteSpawn(SRecordedSpawn { entityId, spawnPointId });
+	}
+
+	void CGameRecorder::WriteTransform(EntityId entityId, const Vec3& position, const Quat& rotation)
+	{
+		SRecordedTransform transform;
+		transform.entityId = entityId;
+		transform.position = SVec3f(position.x, position.y, position.z);
+		transform.rotation[0] = rotation.v.x;
+		transform.rotation[1] = rotation.v.y;
+		transform.rotation[2] = rotation.v.z;
+		transform.rotation[3] = rotation.w;
+		m_writer.WriteTransform(transform);
+	}
+}
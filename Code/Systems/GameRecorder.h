@@ -0,0 +1,71 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+#pragma once
+
+#include "Core/GameRecording.h"
+
+namespace Game
+{
+	////////////////////////////////////////////////////////
+	// Records matches for offline analysis and bug reproduction, and replays them
+	// One tick per frame holds the input commands of all players, the shots fired, the spawn points selected and
+	// the transforms of players and pooled bullets, see Core/GameRecording.h for the file format.
+	// A replay drives the local player with the recorded input of one player, fires its recorded shots and moves it
+	// to its recorded spawn points. The time the hooks and the per-frame update take is checked against g_recordBudget.
+	////////////////////////////////////////////////////////
+	class CGameRecorder
+	{
+	public:
+		CGameRecorder();
+		~CGameRecorder();
+
+		bool StartRecording(const char* szFileName);
+		void StopRecording();
+		// A speed of zero replays one recorded tick per frame with the recorded frame time, as fast as frames render
+		bool StartReplay(const char* szFileName, float speed);
+		void StopReplay();
+
+		// Feeds the recorded ticks that are due, before the players update
+		void UpdateReplay(float frameTime);
+		// Closes this frame's tick, after everything that is recorded has updated
+		void UpdateRecording(float frameTime);
+
+		bool IsRecording() const { return m_writer.IsOpen(); }
+		bool IsReplaying() const { return m_isReplaying; }
+
+		void RecordInput(EntityId entityId, const SPlayerInputCommand& command);
+		void RecordShot(EntityId shooterId, const QuatTS& muzzle);
+		void RecordSpawn(EntityId entityId, EntityId spawnPointId);
+
+	private:
+		void ReplayTick(const SRecordedTick& tick);
+		void WriteTransform(EntityId entityId, const Vec3& position, const Quat& rotation);
+
+	private:
+		CGameRecordingWriter m_writer;
+		// Time spent recording in the current tick, and over the current budget window
+		uint64 m_tickNs = 0;
+		uint64 m_totalNs = 0;
+		uint64 m_windowNs = 0;
+		uint32 m_windowTicks = 0;
+		float m_windowTime = 0.f;
+		uint32 m_overBudgetWindows = 0;
+
+		CGameRecordingReader m_reader;
+		SRecordedTick m_replayedTick;
+		bool m_isReplaying = false;
+		float m_replaySpeed = 1.f;
+		// Replay clock and the recorded time at the end of the next tick
+		float m_replayTime = 0.f;
+		float m_nextTickTime = 0.f;
+		// Recorded player whose input drives the local player, chosen with the first recorded input
+		EntityId m_replayedEntityId = INVALID_ENTITYID;
+		// Recorded position of the replayed player at the end of the last replayed tick
+		Vec3 m_recordedPosition = ZERO;
+		bool m_hasRecordedPosition = false;
+		// Distance between the local player and its recorded position, the last and the largest one
+		float m_replayDrift = 0.f;
+		float m_maxReplayDrift = 0.f;
+		float m_previousFixedStep = 0.f;
+	};
+}
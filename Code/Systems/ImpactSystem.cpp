@@ -0,0 +1,241 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+#include "StdAfx.h"
+#include "ImpactSystem.h"
+#include "BulletPool.h"
+#include "GamePlugin.h"
+#include "GameProfiler.h"
+#include "LevelMemory.h"
+
+#include <Cry3DEngine/ISurfaceType.h>
+#include <CryEntitySystem/IEntitySystem.h>
+#include <CryGame/IGameFramework.h>
+#include <CryAction/IMaterialEffects.h>
+
+#include <algorithm>
+
+namespace Game
+{
+	namespace
+	{
+		float g_impactMergeDistance = 0.25f;
+		float g_impactEffectRate = 120.f;
+		float g_impactEffectBurst = 24.f;
+		float g_impactReleaseRate = 2000.f;
+		float g_impactReleaseBurst = 64.f;
+
+		// Covers a full pool emptying against a wall within one tick, impacts over it are dropped
+		constexpr size_t kReservedImpacts = 256;
+	}
+
+	CImpactSystem::CImpactSystem()
+		: m_impacts(&CGamePlugin::GetInstance()->GetLevelMemory().GetArena())
+	{
+		REGISTER_CVAR2("g_impactMergeDistance", &g_impactMergeDistance, g_impactMergeDistance, VF_NULL, "Impacts of the same effect within a tick play one effect when they fall into the same cell of this size in meters\n0 = don't merge");
+		REGISTER_CVAR2("g_impactEffectRate", &g_impactEffectRate, g_impactEffectRate, VF_NULL, "Impact effects and sounds played per second on average, effects over the limit are skipped");
+		REGISTER_CVAR2("g_impactEffectBurst", &g_impactEffectBurst, g_impactEffectBurst, VF_NULL, "Impact effects that may play at once after a quiet period");
+		REGISTER_CVAR2("g_impactReleaseRate", &g_impactReleaseRate, g_impactReleaseRate, VF_NULL, "Bullets returned to the pool or removed per second on average, the rest wait for the next tick");
+		REGISTER_CVAR2("g_impactReleaseBurst", &g_impactReleaseBurst, g_impactReleaseBurst, VF_NULL, "Bullets that may be returned or removed at once");
+		REGISTER_COMMAND("g_impactStats", LogStatistics, VF_NULL, "Logs the impacts, merged impacts, played and skipped effects and deferred bullet releases, pass 'reset' to clear them afterwards");
+
+		m_pendingReleases.reserve(kReservedImpacts);
+		m_effectLimiter.Reset(g_impactEffectBurst);
+		m_releaseLimiter.Reset(g_impactReleaseBurst);
+	}
+
+	CImpactSystem::~CImpactSystem()
+	{
+		if (IConsole* pConsole = gEnv->pConsole)
+		{
+			pConsole->UnregisterVariable("g_impactMergeDistance", true);
+			pConsole->UnregisterVariable("g_impactEffectRate", true);
+			pConsole->UnregisterVariable("g_impactEffectBurst", true);
+			pConsole->UnregisterVariable("g_impactReleaseRate", true);
+			pConsole->UnregisterVariable("g_impactReleaseBurst", true);
+			pConsole->RemoveCommand("g_impactStats");
+		}
+	}
+
+	void CImpactSystem::QueueRelease(EntityId bulletId, CBulletPool* pPool)
+	{
+		m_pendingReleases.push_back(SPendingRelease{ bulletId, pPool });
+	}
+
+	void CImpactSystem::CancelRelease(EntityId bulletId)
+	{
+		const auto isCancelled = [bulletId](const SPendingRelease& release) { return release.bulletId == bulletId; };
+		m_pendingReleases.erase(std::remove_if(m_pendingReleases.begin(), m_pendingReleases.end(), isCancelled), m_pendingReleases.end());
+	}
+
+	void CImpactSystem::QueueImpact(const Vec3& position, const Vec3& normal, int targetSurfaceId, EntityId sourceId, EntityId targetId)
+	{
+		// Nobody sees or hears the effects on a dedicated server
+		if (gEnv->IsDedicated())
+		{
+			return;
+		}
+
+		SImpact impact;
+		impact.position = SVec3f(position.x, position.y, position.z);
+		impact.normal = SVec3f(normal.x, normal.y, normal.z);
+		impact.targetSurfaceId = targetSurfaceId;
+		impact.sourceId = sourceId;
+		impact.targetId = targetId;
+
+		// Level storage, taken again after the previous level released it
+		m_impacts.Reserve(kReservedImpacts);
+		m_impacts.Push(impact);
+	}
+
+	void CImpactSystem::Update(float deltaTime)
+	{
+		GAME_PROFILE_SCOPE("CImpactSystem::Update");
+
+		m_releaseLimiter.Refill(deltaTime, max(0.f, g_impactReleaseRate), max(1.f, g_impactReleaseBurst));
+		m_effectLimiter.Refill(deltaTime, max(0.f, g_impactEffectRate), max(1.f, g_impactEffectBurst));
+
+		ProcessReleases();
+		ProcessImpacts();
+	}
+
+	void CImpactSystem::OnGameplayStarted()
+	{
+		BuildEffectTable();
+	}
+
+	void CImpactSystem::Clear()
+	{
+		m_impacts.Release();
+		m_pendingReleases.clear();
+		m_effectTable.Clear();
+		m_bulletSurfaceId = -1;
+	}
+
+	void CImpactSystem::BuildEffectTable()
+	{
+		GAME_PROFILE_SCOPE("CImpactSystem::BuildEffectTable");
+
+		m_effectTable.Clear();
+
+		IMaterialEffects* pMaterialEffects = gEnv->pGameFramework->GetIMaterialEffects();
+		ISurfaceTypeManager* pSurfaceTypes = gEnv->p3DEngine->GetMaterialManager()->GetSurfaceTypeManager();
+		if (pMaterialEffects == nullptr || pSurfaceTypes == nullptr)
+		{
+			return;
+		}
+
+		// Pooled bullets use 'mat_projectile', which has no effects of its own so that the engine doesn't play them
+		// for every physics collision. Their impacts, like those of simulated projectiles, play the 'mat_bullet' ones.
+		m_bulletSurfaceId = gEnv->p3DEngine->GetMaterialManager()->GetSurfaceTypeIdByName("mat_bullet");
+
+		size_t effectCount = 0;
+		ISurfaceTypeEnumerator* pEnumerator = pSurfaceTypes->GetEnumerator();
+		for (ISurfaceType* pSurfaceType = pEnumerator->GetFirst(); pSurfaceType != nullptr; pSurfaceType = pEnumerator->GetNext())
+		{
+			const int surfaceId = pSurfaceType->GetId();
+			const TMFXEffectId effectId = pMaterialEffects->GetEffectId(m_bulletSurfaceId, surfaceId);
+			m_effectTable.Set(surfaceId, effectId);
+			effectCount += effectId != InvalidEffectId ? 1 : 0;
+		}
+		pEnumerator->Release();
+
+		CryLogAlways("[ImpactSystem] %" PRISIZE_T " of %" PRISIZE_T " surface types play a bullet impact effect", effectCount, m_effectTable.GetSurfaceCount());
+	}
+
+	void CImpactSystem::ProcessReleases()
+	{
+		size_t releasedCount = 0;
+		while (releasedCount < m_pendingReleases.size() && m_releaseLimiter.TryTake())
+		{
+			const SPendingRelease& release = m_pendingReleases[releasedCount++];
+			if (release.pPool != nullptr)
+			{
+				release.pPool->Release(release.bulletId, CBulletPool::EReleaseReason::Collision);
+			}
+			else
+			{
+				gEnv->pEntitySystem->RemoveEntity(release.bulletId);
+			}
+		}
+
+		const size_t deferredCount = m_pendingReleases.size() - releasedCount;
+		m_pendingReleases.erase(m_pendingReleases.begin(), m_pendingReleases.begin() + releasedCount);
+
+		m_statistics.releases += releasedCount;
+		m_statistics.deferredReleases += deferredCount;
+		GAME_PROFILE_COUNTER("Impacts::DeferredReleases", static_cast<int64>(deferredCount));
+	}
+
+	void CImpactSystem::ProcessImpacts()
+	{
+		const size_t impactCount = m_impacts.GetCount();
+		if (impactCount == 0)
+		{
+			return;
+		}
+
+		// The level may have been started before the plug-in was listening, e.g. when it is reloaded in the editor
+		if (m_effectTable.IsEmpty())
+		{
+			BuildEffectTable();
+		}
+
+		const size_t resolvedCount = m_impacts.Resolve(m_effectTable, max(0.f, g_impactMergeDistance));
+		const size_t mergedCount = m_impacts.GetMergedCount();
+
+		size_t playedCount = 0;
+		if (IMaterialEffects* pMaterialEffects = gEnv->pGameFramework->GetIMaterialEffects())
+		{
+			for (const SResolvedImpact& resolved : m_impacts.GetResolved())
+			{
+				if (!m_effectLimiter.TryTake())
+				{
+					break;
+				}
+
+				const SImpact& impact = m_impacts.GetImpact(resolved.impactIndex);
+
+				SMFXRunTimeEffectParams effectParams;
+				effectParams.pos = Vec3(impact.position.x, impact.position.y, impact.position.z);
+				effectParams.normal = Vec3(impact.normal.x, impact.normal.y, impact.normal.z);
+				effectParams.src = impact.sourceId;
+				effectParams.trg = impact.targetId;
+				effectParams.srcSurfaceId = m_bulletSurfaceId;
+				effectParams.trgSurfaceId = impact.targetSurfaceId;
+
+				pMaterialEffects->ExecuteEffect(resolved.effectId, effectParams);
+				++playedCount;
+			}
+		}
+
+		m_statistics.impacts += impactCount;
+		m_statistics.merged += mergedCount;
+		m_statistics.withoutEffect += impactCount - resolvedCount - mergedCount;
+		m_statistics.effects += playedCount;
+		m_statistics.droppedEffects += resolvedCount - playedCount;
+
+		GAME_PROFILE_COUNTER("Impacts::Queued", static_cast<int64>(impactCount));
+		GAME_PROFILE_COUNTER("Impacts::Merged", static_cast<int64>(mergedCount));
+		GAME_PROFILE_COUNTER("Impacts::Effects", static_cast<int64>(playedCount));
+		GAME_PROFILE_COUNTER("Impacts::DroppedEffects", static_cast<int64>(resolvedCount - playedCount));
+
+		m_impacts.Clear();
+	}
+
+	void CImpactSystem::LogStatistics(IConsoleCmdArgs* pArgs)
+	{
+		CImpactSystem& impactSystem = CGamePlugin::GetInstance()->GetImpactSystem();
+		const SStatistics& statistics = impactSystem.m_statistics;
+
+		CryLogAlways("[ImpactSystem] %" PRIu64 " impacts: %" PRIu64 " merged, %" PRIu64 " without effect, %" PRIu64 " effects played, %" PRIu64 " skipped over the rate limit",
+			statistics.impacts, statistics.merged, statistics.withoutEffect, statistics.effects, statistics.droppedEffects);
+		const SObjectPoolStatistics bufferStatistics = impactSystem.m_impacts.GetStatistics();
+		CryLogAlways("[ImpactSystem] %" PRIu64 " impacts dropped since startup because more than %" PRISIZE_T " arrived within a tick", bufferStatistics.failedCount, kReservedImpacts);
+		CryLogAlways("[ImpactSystem] %" PRIu64 " bullets released, %" PRIu64 " release deferrals, %" PRISIZE_T " waiting",
+			statistics.releases, statistics.deferredReleases, impactSystem.m_pendingReleases.size());
+
+		if (pArgs->GetArgCount() > 1 && strcmp(pArgs->GetArg(1), "reset") == 0)
+		{
+			impactSystem.m_statistics = SStatistics();
+		}
+	}
+}
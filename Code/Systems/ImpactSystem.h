@@ -0,0 +1,75 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+#pragma once
+
+#include "Core/ImpactBatch.h"
+
+#include <vector>
+
+namespace Game
+{
+	class CBulletPool;
+
+	////////////////////////////////////////////////////////
+	// Plays the impact effects of pooled bullets and simulated projectiles, and expires the bullets that hit something
+	// Collisions only queue their impact and release here, a server tick task processes everything queued in one
+	// pass: effects come from a surface table built at level start, impacts of the same effect in the same place are
+	// merged, and effects and bullet releases are rate limited. Releases over the limit wait for the next tick.
+	////////////////////////////////////////////////////////
+	class CImpactSystem
+	{
+	public:
+		CImpactSystem();
+		~CImpactSystem();
+
+		// Pooled bullets are released, bullets without a pool are removed
+		void QueueRelease(EntityId bulletId, CBulletPool* pPool);
+		// Drops a queued release, e.g. when the pool steals the bullet to launch it again
+		void CancelRelease(EntityId bulletId);
+		void QueueImpact(const Vec3& position, const Vec3& normal, int targetSurfaceId, EntityId sourceId, EntityId targetId);
+
+		// Processes the impacts and releases queued since the last update
+		void Update(float deltaTime);
+
+		// Looks up the effect of every surface type hit by a bullet, once the level's surface types are known
+		void OnGameplayStarted();
+		// Drops the queues and the table, and gives the impact storage back to the level memory
+		void Clear();
+
+		SObjectPoolStatistics GetImpactStatistics() const { return m_impacts.GetStatistics(); }
+
+	private:
+		struct SPendingRelease
+		{
+			EntityId bulletId;
+			CBulletPool* pPool;
+		};
+
+		struct SStatistics
+		{
+			uint64 impacts = 0;
+			uint64 merged = 0;
+			uint64 withoutEffect = 0;
+			uint64 effects = 0;
+			uint64 droppedEffects = 0;
+			uint64 releases = 0;
+			uint64 deferredReleases = 0;
+		};
+
+		void BuildEffectTable();
+		void ProcessReleases();
+		void ProcessImpacts();
+		static void LogStatistics(IConsoleCmdArgs* pArgs);
+
+	private:
+		CImpactBuffer m_impacts;
+		CSurfaceEffectTable m_effectTable;
+		int m_bulletSurfaceId = -1;
+		CRateLimiter m_effectLimiter;
+
+		std::vector<SPendingRelease> m_pendingReleases;
+		CRateLimiter m_releaseLimiter;
+
+		SStatistics m_statistics;
+	};
+}
@@ -0,0 +1,285 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+#include "StdAfx.h"
+#include "LagCompensation.h"
+
+#include "GamePlugin.h"
+#include "LevelMemory.h"
+
+#include "Components/Player.h"
+
+#include <DefaultComponents/Geometry/AdvancedAnimationComponent.h>
+
+#include <CryAnimation/ICryAnimation.h>
+#include <CryEntitySystem/IEntitySystem.h>
+#include <CryGame/IGameFramework.h>
+#include <CryNetwork/INetwork.h>
+
+#include <algorithm>
+
+namespace Game
+{
+	namespace
+	{
+		int   g_lagCompensation = 1;
+		float g_lagCompMaxRewind = 0.5f;
+		float g_lagCompInterpolationDelay = 0.f;
+		int   g_lagCompDebug = 0;
+
+		struct SHitboxDefinition
+		{
+			const char* szName;
+			const char* szStartJoint;
+			const char* szEndJoint;
+			float radius;
+		};
+
+		// Joints of Objects/Characters/SampleCharacter, a capsule with the same start and end joint is a sphere
+		constexpr SHitboxDefinition kHitboxDefinitions[] =
+		{
+			{ "head",           "head",       "head",       0.15f },
+			{ "torso",          "pelvis",     "spine04",    0.2f  },
+			{ "left_upperarm",  "L_upperarm", "L_forearm",  0.07f },
+			{ "left_forearm",   "L_forearm",  "L_hand",     0.06f },
+			{ "right_upperarm", "R_upperarm", "R_forearm",  0.07f },
+			{ "right_forearm",  "R_forearm",  "R_hand",     0.06f },
+			{ "left_thigh",     "L_thigh",    "L_calf",     0.1f  },
+			{ "left_calf",      "L_calf",     "L_foot",     0.08f },
+			{ "right_thigh",    "R_thigh",    "R_calf",     0.1f  },
+			{ "right_calf",     "R_calf",     "R_foot",     0.08f }
+		};
+
+		constexpr uint32 kHitboxCount = CRY_ARRAY_COUNT(kHitboxDefinitions);
+		static_assert(kHitboxCount <= kMaxHitboxesPerPose, "Hitbox poses are stored in fixed size arrays");
+	}
+
+	CLagCompensation::CLagCompensation()
+		: m_histories(&CGamePlugin::GetInstance()->GetLevelMemory().GetArena())
+	{
+		m_entries.reserve(kMaxPlayers);
+
+		REGISTER_CVAR2("g_lagCompensation", &g_lagCompensation, g_lagCompensation, VF_NULL, "Validates hitscan shots on the server against player poses rewound to the shooter's view time");
+		REGISTER_CVAR2("g_lagCompMaxRewind", &g_lagCompMaxRewind, g_lagCompMaxRewind, VF_NULL, "Upper bound in seconds for how far a shot may be rewound, limits the advantage of high latency");
+		REGISTER_CVAR2("g_lagCompInterpolationDelay", &g_lagCompInterpolationDelay, g_lagCompInterpolationDelay, VF_NULL, "Seconds by which clients render remote players behind the latest server state, for clients that don't send the time they rendered at");
+		REGISTER_CVAR2("g_lagCompDebug", &g_lagCompDebug, g_lagCompDebug, VF_NULL, "Logs every lag compensated hit");
+	}
+
+	CLagCompensation::~CLagCompensation()
+	{
+		if (IConsole* pConsole = gEnv->pConsole)
+		{
+			pConsole->UnregisterVariable("g_lagCompensation", true);
+			pConsole->UnregisterVariable("g_lagCompMaxRewind", true);
+			pConsole->UnregisterVariable("g_lagCompInterpolationDelay", true);
+			pConsole->UnregisterVariable("g_lagCompDebug", true);
+		}
+	}
+
+	void CLagCompensation::Register(IEntity& entity, Cry::DefaultComponents::CAdvancedAnimationComponent& animationComponent)
+	{
+		const EntityId entityId = entity.GetId();
+		if (std::any_of(m_entries.begin(), m_entries.end(), [entityId](const SEntry& entry) { return entry.entityId == entityId; }))
+		{
+			return;
+		}
+
+		if (m_entries.size() >= kMaxPlayers)
+		{
+			CryLogAlways("[LagCompensation] More than %" PRISIZE_T " players, %s is not lag compensated", kMaxPlayers, entity.GetName());
+			return;
+		}
+
+		SEntry entry;
+		entry.entityId = entityId;
+		entry.pEntity = &entity;
+		entry.pAnimationComponent = &animationComponent;
+
+		m_entries.push_back(entry);
+	}
+
+	void CLagCompensation::Unregister(EntityId entityId)
+	{
+		const auto it = std::find_if(m_entries.begin(), m_entries.end(), [entityId](const SEntry& entry) { return entry.entityId == entityId; });
+		if (it != m_entries.end())
+		{
+			if (it->pHistory != nullptr)
+			{
+				m_histories.Destroy(it->pHistory);
+			}
+
+			*it = m_entries.back();
+			m_entries.pop_back();
+		}
+	}
+
+	void CLagCompensation::Update()
+	{
+		if (!gEnv->bServer || !IsEnabled())
+		{
+			return;
+		}
+
+		const float time = gEnv->pTimer->GetCurrTime();
+		SHitboxCapsule capsules[kMaxHitboxesPerPose];
+
+		for (SEntry& entry : m_entries)
+		{
+			// Only the server records, and a player that stays registered across a level reset gets a new history
+			// from the next level's memory
+			if (entry.pHistory == nullptr)
+			{
+				entry.pHistory = CreateHistory();
+			}
+
+			uint32 count = 0;
+			if (SampleCapsules(entry, capsules, count))
+			{
+				entry.pHistory->Record(time, capsules, count);
+			}
+		}
+	}
+
+	void CLagCompensation::Clear()
+	{
+		for (SEntry& entry : m_entries)
+		{
+			if (entry.pHistory != nullptr)
+			{
+				m_histories.Destroy(entry.pHistory);
+				entry.pHistory = nullptr;
+			}
+		}
+		m_histories.Release();
+	}
+
+	bool CLagCompensation::IsEnabled() const
+	{
+		return g_lagCompensation != 0;
+	}
+
+	float CLagCompensation::GetShooterViewTime(EntityId shooterId) const
+	{
+		const float currentTime = gEnv->pTimer->GetCurrTime();
+
+		// The server's own player sees the authoritative state
+		const IEntity* pShooter = gEnv->pEntitySystem->GetEntity(shooterId);
+		const uint16 channelId = pShooter != nullptr ? pShooter->GetNetEntity()->GetChannelId() : 0;
+		if (channelId == 0)
+		{
+			return currentTime;
+		}
+
+		// Clients that interpolate report the server time they showed the other players at, which covers the latency,
+		// the playback delay and its adaptation. It can't ask for more than the maximum rewind or for the future.
+		const CPlayerComponent* pPlayer = pShooter->GetComponent<CPlayerComponent>();
+		const float viewTime = pPlayer != nullptr ? pPlayer->GetViewTime() : 0.f;
+		if (viewTime > 0.f)
+		{
+			return clamp_tpl(viewTime, currentTime - g_lagCompMaxRewind, currentTime);
+		}
+
+		// Otherwise the shot took half a round trip to arrive and the targets were half a round trip old when the
+		// client saw them as they arrived
+		const INetChannel* pNetChannel = gEnv->pGameFramework->GetNetChannel(channelId);
+		const float latency = pNetChannel != nullptr ? pNetChannel->GetPing(true) : 0.f;
+
+		return currentTime - min(latency + g_lagCompInterpolationDelay, g_lagCompMaxRewind);
+	}
+
+	bool CLagCompensation::Raycast(const Vec3& origin, const Vec3& direction, float range, float time, EntityId ignoreEntityId, SHit& outHit) const
+	{
+		const SVec3f rayOrigin(origin.x, origin.y, origin.z);
+		const Vec3 normalizedDirection = direction.GetNormalized();
+		const SVec3f rayDirection(normalizedDirection.x, normalizedDirection.y, normalizedDirection.z);
+
+		bool hasHit = false;
+		float closestDistance = range;
+		SHitboxPose pose;
+
+		for (const SEntry& entry : m_entries)
+		{
+			uint32 hitboxIndex = 0;
+			if (entry.entityId == ignoreEntityId || entry.pHistory == nullptr || !entry.pHistory->Sample(time, pose))
+			{
+				continue;
+			}
+
+			const float distance = IntersectRayPose(rayOrigin, rayDirection, closestDistance, pose, hitboxIndex);
+			if (distance >= 0.f)
+			{
+				hasHit = true;
+				closestDistance = distance;
+
+				outHit.entityId = entry.entityId;
+				outHit.hitboxIndex = hitboxIndex;
+				outHit.distance = distance;
+				outHit.point = origin + normalizedDirection * distance;
+			}
+		}
+
+		if (hasHit && g_lagCompDebug != 0)
+		{
+			CryLogAlways("[LagCompensation] Hit entity %u in %s at %.2f m, rewound %.0f ms", outHit.entityId, GetHitboxName(outHit.hitboxIndex), outHit.distance, (gEnv->pTimer->GetCurrTime() - time) * 1000.f);
+		}
+
+		return hasHit;
+	}
+
+	CLagCompensation::THitboxHistory* CLagCompensation::CreateHistory()
+	{
+		// Level storage for every player at once, the first player of a level takes it
+		m_histories.Reserve(kMaxPlayers);
+		return m_histories.Create();
+	}
+
+	const char* CLagCompensation::GetHitboxName(uint32 hitboxIndex)
+	{
+		return hitboxIndex < kHitboxCount ? kHitboxDefinitions[hitboxIndex].szName : "unknown";
+	}
+
+	bool CLagCompensation::SampleCapsules(SEntry& entry, SHitboxCapsule* pOutCapsules, uint32& outCount) const
+	{
+		ICharacterInstance* pCharacter = entry.pAnimationComponent->GetCharacter();
+		if (pCharacter == nullptr)
+		{
+			return false;
+		}
+
+		if (entry.pResolvedCharacter != pCharacter)
+		{
+			const IDefaultSkeleton& skeleton = pCharacter->GetIDefaultSkeleton();
+			for (uint32 i = 0; i < kHitboxCount; ++i)
+			{
+				entry.jointIds[i * 2] = static_cast<int16>(skeleton.GetJointIDByName(kHitboxDefinitions[i].szStartJoint));
+				entry.jointIds[i * 2 + 1] = static_cast<int16>(skeleton.GetJointIDByName(kHitboxDefinitions[i].szEndJoint));
+			}
+			entry.pResolvedCharacter = pCharacter;
+		}
+
+		const ISkeletonPose* pSkeletonPose = pCharacter->GetISkeletonPose();
+		const Matrix34& characterTransform = entry.pEntity->GetSlotWorldTM(entry.pAnimationComponent->GetEntitySlotId());
+
+		// Hitboxes keep their index even if a joint is missing, interpolation matches capsules by index
+		for (uint32 i = 0; i < kHitboxCount; ++i)
+		{
+			const int16 startJointId = entry.jointIds[i * 2];
+			const int16 endJointId = entry.jointIds[i * 2 + 1];
+
+			SHitboxCapsule& capsule = pOutCapsules[i];
+			if (startJointId < 0 || endJointId < 0)
+			{
+				capsule = SHitboxCapsule();
+				continue;
+			}
+
+			const Vec3 start = characterTransform * pSkeletonPose->GetAbsJointByID(startJointId).t;
+			const Vec3 end = characterTransform * pSkeletonPose->GetAbsJointByID(endJointId).t;
+
+			capsule.start = SVec3f(start.x, start.y, start.z);
+			capsule.end = SVec3f(end.x, end.y, end.z);
+			capsule.radius = kHitboxDefinitions[i].radius;
+		}
+
+		outCount = kHitboxCount;
+		return true;
+	}
+}
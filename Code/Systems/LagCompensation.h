@@ -0,0 +1,81 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+#pragma once
+
+#include "Core/HitboxHistory.h"
+#include "Core/ObjectPool.h"
+
+#include <vector>
+
+namespace Cry::DefaultComponents
+{
+	class CAdvancedAnimationComponent;
+}
+
+namespace Game
+{
+	////////////////////////////////////////////////////////
+	// Server-side hit validation against past player poses
+	// Every tick the hitbox capsules of all registered players are sampled from their characters and
+	// recorded, a shot is then tested against the poses at the time the shooter saw them.
+	////////////////////////////////////////////////////////
+	class CLagCompensation
+	{
+	public:
+		// Enough for 64 players, histories are taken from the level memory for all of them at once
+		static constexpr size_t kMaxPlayers = 64;
+		// At least one second at the minimum sample interval of the history
+		static constexpr size_t kHistoryCapacity = 128;
+
+		using THitboxHistory = CHitboxHistory<kHistoryCapacity>;
+
+		struct SHit
+		{
+			EntityId entityId = INVALID_ENTITYID;
+			uint32 hitboxIndex = 0;
+			float distance = 0.f;
+			Vec3 point = ZERO;
+		};
+
+		CLagCompensation();
+		~CLagCompensation();
+
+		void Register(IEntity& entity, Cry::DefaultComponents::CAdvancedAnimationComponent& animationComponent);
+		void Unregister(EntityId entityId);
+
+		// Records the current pose of every registered player, only does work on the server
+		void Update();
+		// Drops all recorded poses and gives their storage back to the level memory, but keeps the registrations
+		void Clear();
+
+		bool IsEnabled() const;
+		// Server time at which the shooter saw the other players, as its client reported it or now minus its latency
+		float GetShooterViewTime(EntityId shooterId) const;
+		// Closest player hitbox hit by the ray within range, with all players rewound to the given time
+		bool Raycast(const Vec3& origin, const Vec3& direction, float range, float time, EntityId ignoreEntityId, SHit& outHit) const;
+
+		static const char* GetHitboxName(uint32 hitboxIndex);
+		SObjectPoolStatistics GetHistoryStatistics() const { return m_histories.GetStatistics(); }
+
+	private:
+		struct SEntry
+		{
+			EntityId entityId = INVALID_ENTITYID;
+			IEntity* pEntity = nullptr;
+			Cry::DefaultComponents::CAdvancedAnimationComponent* pAnimationComponent = nullptr;
+			// Taken from the level memory by the first Update on the server, given back by Clear
+			THitboxHistory* pHistory = nullptr;
+
+			// Joint ids of the hitbox end points, resolved when the character changes
+			const ICharacterInstance* pResolvedCharacter = nullptr;
+			std::array<int16, kMaxHitboxesPerPose * 2> jointIds;
+		};
+
+		THitboxHistory* CreateHistory();
+		bool SampleCapsules(SEntry& entry, SHitboxCapsule* pOutCapsules, uint32& outCount) const;
+
+	private:
+		CObjectPool<THitboxHistory> m_histories;
+		std::vector<SEntry> m_entries;
+	};
+}
@@ -0,0 +1,67 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+#include "StdAfx.h"
+#include "LevelMemory.h"
+
+#include "GamePlugin.h"
+#include "ImpactSystem.h"
+#include "LagCompensation.h"
+#include "ProjectileSystem.h"
+
+namespace Game
+{
+	namespace
+	{
+		int g_levelMemoryBudget = 8;
+	}
+
+	CLevelMemory::CLevelMemory()
+	{
+		REGISTER_CVAR2("g_levelMemoryBudget", &g_levelMemoryBudget, g_levelMemoryBudget, VF_REQUIRE_APP_RESTART, "Megabytes reserved at startup for the level lifetime data of gameplay systems, larger levels overflow to the heap");
+		REGISTER_COMMAND("g_levelMemoryInfo", LogInfo, VF_NULL, "Logs the usage of the per-level gameplay memory and the live objects of its users");
+
+		m_pArena = stl::make_unique<CLinearArena>(static_cast<size_t>(max(g_levelMemoryBudget, 0)) * 1024 * 1024);
+	}
+
+	CLevelMemory::~CLevelMemory()
+	{
+		if (IConsole* pConsole = gEnv->pConsole)
+		{
+			pConsole->UnregisterVariable("g_levelMemoryBudget", true);
+			pConsole->RemoveCommand("g_levelMemoryInfo");
+		}
+	}
+
+	void CLevelMemory::Reset()
+	{
+		const SLinearArenaStatistics statistics = m_pArena->GetStatistics();
+		if (statistics.overflowCount > m_reportedOverflowCount)
+		{
+			CryLogAlways("[LevelMemory] %" PRIu64 " allocations did not fit into g_levelMemoryBudget and went to the heap, peak usage %" PRISIZE_T " KB",
+				statistics.overflowCount - m_reportedOverflowCount, statistics.peakBytes / 1024);
+			m_reportedOverflowCount = statistics.overflowCount;
+		}
+
+		m_pArena->Reset();
+	}
+
+	void CLevelMemory::LogInfo(IConsoleCmdArgs* pArgs)
+	{
+		CGamePlugin* pPlugin = CGamePlugin::GetInstance();
+		const SLinearArenaStatistics statistics = pPlugin->GetLevelMemory().GetArena().GetStatistics();
+
+		CryLogAlways("[LevelMemory] %" PRISIZE_T " KB used, %" PRISIZE_T " KB peak of %" PRISIZE_T " KB, %" PRIu64 " allocations, level %u",
+			statistics.usedBytes / 1024, statistics.peakBytes / 1024, statistics.capacity / 1024, statistics.allocationCount, statistics.generation);
+		CryLogAlways("[LevelMemory] %" PRIu64 " allocations, %" PRISIZE_T " KB overflowed to the heap", statistics.overflowCount, statistics.overflowBytes / 1024);
+
+		const CProjectileSystem& projectileSystem = pPlugin->GetProjectileSystem();
+		CryLogAlways("[LevelMemory] Projectiles: %" PRISIZE_T " live, room for %" PRISIZE_T, projectileSystem.GetLiveCount(), projectileSystem.GetCapacity());
+
+		const auto logPool = [](const char* szName, const SObjectPoolStatistics& pool)
+		{
+			CryLogAlways("[LevelMemory] %s: %" PRISIZE_T " live, %" PRISIZE_T " peak, room for %" PRISIZE_T ", %" PRIu64 " did not fit",
+				szName, pool.liveCount, pool.peakLiveCount, pool.capacity, pool.failedCount);
+		};
+		logPool("Hitbox histories", pPlugin->GetLagCompensation().GetHistoryStatistics());
+		logPool("Impacts", pPlugin->GetImpactSystem().GetImpactStatistics());
+	}
+}
@@ -0,0 +1,37 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+#pragma once
+
+#include "Core/LinearArena.h"
+
+#include <memory>
+
+namespace Game
+{
+	////////////////////////////////////////////////////////
+	// Per-level memory of gameplay systems
+	// Systems take level lifetime storage from one linear arena instead of individual heap allocations, either through
+	// SArenaAllocator or as typed CObjectPools that count their live objects, and give it up in their Clear. The
+	// plug-in then releases the whole arena at once when the level is unloaded or the editor leaves game mode. The
+	// arena is sized by g_levelMemoryBudget at startup, overflow goes to the heap and is logged.
+	////////////////////////////////////////////////////////
+	class CLevelMemory
+	{
+	public:
+		CLevelMemory();
+		~CLevelMemory();
+
+		CLinearArena& GetArena() { return *m_pArena; }
+
+		// Releases all level allocations in O(1), every user must have released its storage before
+		void Reset();
+
+	private:
+		static void LogInfo(IConsoleCmdArgs* pArgs);
+
+	private:
+		std::unique_ptr<CLinearArena> m_pArena;
+		// Overflow already reported by Reset
+		uint64_t m_reportedOverflowCount = 0;
+	};
+}
@@ -0,0 +1,127 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+#include "StdAfx.h"
+#include "NetRelevancy.h"
+
+#include "GamePlugin.h"
+#include "GameProfiler.h"
+#include "PlayerSystem.h"
+#include "SpatialIndex.h"
+
+#include "Components/Player.h"
+
+#include <CryEntitySystem/IEntitySystem.h>
+
+namespace Game
+{
+	namespace
+	{
+		int   g_netRelevancy = 1;
+		float g_netRelevancyMaxDistance = 150.f;
+		float g_netRelevancyMaxRate = 30.f;
+		float g_netRelevancyMinRate = 2.f;
+	}
+
+	CNetRelevancy::CNetRelevancy()
+	{
+		// Only players are bound to the network, pooled bullets and simulated projectiles stay local to each machine
+		m_scheduler.SetClassPriority(eSpatialType_Player, 1.f);
+
+		REGISTER_CVAR2("g_netRelevancy", &g_netRelevancy, g_netRelevancy, VF_NULL, "Replicates player movement at a rate depending on how relevant the player is to the clients\n0 = every frame, 1 = by relevancy");
+		REGISTER_CVAR2("g_netRelevancyMaxDistance", &g_netRelevancyMaxDistance, g_netRelevancyMaxDistance, VF_NULL, "Distance from a client's player beyond which other players are not relevant to that client");
+		REGISTER_CVAR2("g_netRelevancyMaxRate", &g_netRelevancyMaxRate, g_netRelevancyMaxRate, VF_NULL, "Updates per second of a fully relevant player");
+		REGISTER_CVAR2("g_netRelevancyMinRate", &g_netRelevancyMinRate, g_netRelevancyMinRate, VF_NULL, "Updates per second of a barely relevant player");
+		REGISTER_COMMAND("net_relevancyInfo", LogInfo, VF_NULL, "Logs how many players are relevant to the clients and how many were marked for replication last frame");
+	}
+
+	CNetRelevancy::~CNetRelevancy()
+	{
+		if (IConsole* pConsole = gEnv->pConsole)
+		{
+			pConsole->UnregisterVariable("g_netRelevancy", true);
+			pConsole->UnregisterVariable("g_netRelevancyMaxDistance", true);
+			pConsole->UnregisterVariable("g_netRelevancyMaxRate", true);
+			pConsole->UnregisterVariable("g_netRelevancyMinRate", true);
+			pConsole->RemoveCommand("net_relevancyInfo");
+		}
+	}
+
+	bool CNetRelevancy::IsEnabled()
+	{
+		return g_netRelevancy != 0;
+	}
+
+	void CNetRelevancy::Update()
+	{
+		if (!gEnv->bServer || !IsEnabled())
+		{
+			return;
+		}
+
+		GAME_PROFILE_SCOPE("CNetRelevancy::Update");
+
+		SRelevancyParams params = m_scheduler.GetParams();
+		params.maxDistance = max(1.f, g_netRelevancyMaxDistance);
+		params.maxRate = max(0.1f, g_netRelevancyMaxRate);
+		params.minRate = clamp_tpl(g_netRelevancyMinRate, 0.1f, params.maxRate);
+		m_scheduler.SetParams(params);
+
+		GatherViewers();
+
+		uint32 dueCount = 0;
+		const CSpatialGrid& grid = CGamePlugin::GetInstance()->GetSpatialIndex().GetGrid();
+		m_scheduler.UpdateObjects(m_viewers.data(), m_viewers.size(), grid, eSpatialType_Player, gEnv->pTimer->GetCurrTime(), [&dueCount](const SSpatialObject& object, float)
+		{
+			if (IEntity* pEntity = gEnv->pEntitySystem->GetEntity(object.userId))
+			{
+				pEntity->GetNetEntity()->MarkAspectsDirty(CPlayerComponent::kMovementAspect);
+				++dueCount;
+			}
+		});
+
+		m_lastDueCount = dueCount;
+		GAME_PROFILE_COUNTER("NetRelevancy::MarkedPlayers", static_cast<int64>(dueCount));
+	}
+
+	void CNetRelevancy::Clear()
+	{
+		m_scheduler.Clear();
+		m_viewers.clear();
+		m_lastDueCount = 0;
+	}
+
+	void CNetRelevancy::NoteInteraction(EntityId first, EntityId second)
+	{
+		const float time = gEnv->pTimer->GetCurrTime();
+		m_scheduler.NoteInteraction(first, second, time);
+		m_scheduler.NoteInteraction(second, first, time);
+	}
+
+	void CNetRelevancy::GatherViewers()
+	{
+		m_viewers.clear();
+
+		for (const CPlayerComponent* pPlayer : CGamePlugin::GetInstance()->GetPlayerSystem().GetPlayers())
+		{
+			// Players without a channel are the server's own and need no replication
+			const IEntity& entity = *pPlayer->GetEntity();
+			if (entity.GetNetEntity()->GetChannelId() == 0)
+			{
+				continue;
+			}
+
+			SRelevancyViewer viewer;
+			viewer.userId = entity.GetId();
+			viewer.position = CSpatialIndex::ToGridVector(pPlayer->GetEyePosition());
+			viewer.forward = CSpatialIndex::ToGridVector(pPlayer->GetViewDirection());
+			m_viewers.push_back(viewer);
+		}
+	}
+
+	void CNetRelevancy::LogInfo(IConsoleCmdArgs* pArgs)
+	{
+		const CNetRelevancy& relevancy = CGamePlugin::GetInstance()->GetNetRelevancy();
+
+		CryLogAlways("[NetRelevancy] %s, %" PRISIZE_T " clients", IsEnabled() ? "Enabled" : "Disabled", relevancy.m_viewers.size());
+		CryLogAlways("[NetRelevancy] %" PRISIZE_T " players relevant to at least one client, %u marked for replication last frame", relevancy.m_scheduler.GetRelevantObjectCount(), relevancy.m_lastDueCount);
+	}
+}
@@ -0,0 +1,42 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+#pragma once
+
+#include "Core/Relevancy.h"
+
+#include <vector>
+
+namespace Game
+{
+	////////////////////////////////////////////////////////
+	// Server-side interest management of replicated players
+	// Every remote client's player is a viewer that scores the players around it by distance, view cone, recent hits
+	// and class priority. The engine replicates a dirty aspect to all clients at once, so each player's movement
+	// aspect is marked dirty at the rate of the client it is most relevant to, and not at all while it is relevant to
+	// nobody. While g_netRelevancy is off, players mark their aspect every frame as before.
+	////////////////////////////////////////////////////////
+	class CNetRelevancy
+	{
+	public:
+		CNetRelevancy();
+		~CNetRelevancy();
+
+		// Marks the players that are due this frame, server only
+		void Update();
+		void Clear();
+
+		// Keeps both entities fully relevant to each other for a while, e.g. after one has hit the other
+		void NoteInteraction(EntityId first, EntityId second);
+
+		static bool IsEnabled();
+
+	private:
+		void GatherViewers();
+		static void LogInfo(IConsoleCmdArgs* pArgs);
+
+	private:
+		CRelevancyScheduler m_scheduler;
+		std::vector<SRelevancyViewer> m_viewers;
+		uint32 m_lastDueCount = 0;
+	};
+}
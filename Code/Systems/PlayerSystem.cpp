@@ -0,0 +1,312 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+#include "StdAfx.h"
+#include "PlayerSystem.h"
+#include "GamePlugin.h"
+#include "GameProfiler.h"
+
+#include "Components/Player.h"
+
+#include <algorithm>
+
+namespace Game
+{
+	namespace
+	{
+		int g_playerBatchUpdate = 1;
+		int g_playerBatchJobSize = 32;
+
+		int   g_playerDormancy = 1;
+		float g_playerDormancySettleTime = 0.5f;
+		float g_playerDormancyMaxSpeed = 0.05f;
+
+		int   g_playerInterpolation = 1;
+		float g_playerInterpolationMinDelay = 0.05f;
+		float g_playerInterpolationMaxDelay = 0.5f;
+		float g_playerInterpolationJitterScale = 2.f;
+		float g_playerInterpolationMaxExtrapolation = 0.25f;
+		float g_playerInterpolationSnapDistance = 1.f;
+	}
+
+	CPlayerSystem::CPlayerSystem()
+	{
+		REGISTER_CVAR2_CB("g_playerBatchUpdate", &g_playerBatchUpdate, g_playerBatchUpdate, VF_NULL, "Updates all players in one batch on the job system instead of through per-entity update events", OnBatchUpdateChanged);
+		REGISTER_CVAR2("g_playerBatchJobSize", &g_playerBatchJobSize, g_playerBatchJobSize, VF_NULL, "Minimum number of players per job of the batched player update, smaller batches are updated on the main thread");
+
+		REGISTER_CVAR2_CB("g_playerDormancy", &g_playerDormancy, g_playerDormancy, VF_NULL, "Stops updating players that stand on the ground without input until input, physics or gameplay wakes them", OnDormancyChanged);
+		REGISTER_CVAR2("g_playerDormancySettleTime", &g_playerDormancySettleTime, g_playerDormancySettleTime, VF_NULL, "Seconds a player has to stand still without input before it goes dormant");
+		REGISTER_CVAR2("g_playerDormancyMaxSpeed", &g_playerDormancyMaxSpeed, g_playerDormancyMaxSpeed, VF_NULL, "Speed below which a grounded player counts as standing still");
+
+		REGISTER_CVAR2("g_playerInterpolation", &g_playerInterpolation, g_playerInterpolation, VF_NULL, "Plays remote players back between received snapshots at an adaptive delay\n0 = place them at every snapshot as it arrives");
+		REGISTER_CVAR2("g_playerInterpolationMinDelay", &g_playerInterpolationMinDelay, g_playerInterpolationMinDelay, VF_NULL, "Shortest delay in seconds at which remote players are played back");
+		REGISTER_CVAR2("g_playerInterpolationMaxDelay", &g_playerInterpolationMaxDelay, g_playerInterpolationMaxDelay, VF_NULL, "Longest delay in seconds at which remote players are played back");
+		REGISTER_CVAR2("g_playerInterpolationJitterScale", &g_playerInterpolationJitterScale, g_playerInterpolationJitterScale, VF_NULL, "Multiples of the measured snapshot jitter added to the snapshot interval to get the playback delay");
+		REGISTER_CVAR2("g_playerInterpolationMaxExtrapolation", &g_playerInterpolationMaxExtrapolation, g_playerInterpolationMaxExtrapolation, VF_NULL, "Seconds a remote player keeps moving past its newest snapshot before it stops");
+		REGISTER_CVAR2("g_playerInterpolationSnapDistance", &g_playerInterpolationSnapDistance, g_playerInterpolationSnapDistance, VF_NULL, "Meters two snapshots of a remote player may be further apart than its speed covers before it jumps to the newer one instead of moving there");
+		REGISTER_COMMAND("g_playerInterpolationInfo", LogInterpolationInfo, VF_NULL, "Logs the playback delay, snapshot interval and jitter of every remote player");
+	}
+
+	CPlayerSystem::~CPlayerSystem()
+	{
+		if (IConsole* pConsole = gEnv->pConsole)
+		{
+			pConsole->UnregisterVariable("g_playerBatchUpdate", true);
+			pConsole->UnregisterVariable("g_playerBatchJobSize", true);
+			pConsole->UnregisterVariable("g_playerDormancy", true);
+			pConsole->UnregisterVariable("g_playerDormancySettleTime", true);
+			pConsole->UnregisterVariable("g_playerDormancyMaxSpeed", true);
+			pConsole->UnregisterVariable("g_playerInterpolation", true);
+			pConsole->UnregisterVariable("g_playerInterpolationMinDelay", true);
+			pConsole->UnregisterVariable("g_playerInterpolationMaxDelay", true);
+			pConsole->UnregisterVariable("g_playerInterpolationJitterScale", true);
+			pConsole->UnregisterVariable("g_playerInterpolationMaxExtrapolation", true);
+			pConsole->UnregisterVariable("g_playerInterpolationSnapDistance", true);
+			pConsole->RemoveCommand("g_playerInterpolationInfo");
+		}
+	}
+
+	void CPlayerSystem::Register(CPlayerComponent& player)
+	{
+		if (std::find(m_players.begin(), m_players.end(), &player) == m_players.end())
+		{
+			m_players.push_back(&player);
+			m_awakePlayers.push_back(&player);
+		}
+	}
+
+	void CPlayerSystem::Unregister(CPlayerComponent& player)
+	{
+		const auto it = std::find(m_players.begin(), m_players.end(), &player);
+		if (it != m_players.end())
+		{
+			*it = m_players.back();
+			m_players.pop_back();
+		}
+
+		const auto awakeIt = std::find(m_awakePlayers.begin(), m_awakePlayers.end(), &player);
+		if (awakeIt != m_awakePlayers.end())
+		{
+			*awakeIt = m_awakePlayers.back();
+			m_awakePlayers.pop_back();
+		}
+	}
+
+	void CPlayerSystem::OnPlayerWoken(CPlayerComponent& player)
+	{
+		// Still in the list if it went dormant during this update
+		if (std::find(m_awakePlayers.begin(), m_awakePlayers.end(), &player) == m_awakePlayers.end())
+		{
+			m_awakePlayers.push_back(&player);
+		}
+	}
+
+	bool CPlayerSystem::IsBatchingEnabled()
+	{
+		return g_playerBatchUpdate != 0;
+	}
+
+	bool CPlayerSystem::IsDormancyEnabled()
+	{
+		return g_playerDormancy != 0;
+	}
+
+	SDormancyParams CPlayerSystem::GetDormancyParams()
+	{
+		SDormancyParams params;
+		params.settleTime = max(0.f, g_playerDormancySettleTime);
+		params.maxSpeed = max(0.f, g_playerDormancyMaxSpeed);
+		return params;
+	}
+
+	bool CPlayerSystem::IsInterpolationEnabled()
+	{
+		return g_playerInterpolation != 0;
+	}
+
+	void CPlayerSystem::Update(float frameTime)
+	{
+		if (m_players.empty())
+		{
+			return;
+		}
+
+		GAME_PROFILE_SCOPE("CPlayerSystem::Update");
+		GAME_PROFILE_COUNTER("PlayerSystem::Players", static_cast<int64>(m_players.size()));
+
+		// Order doesn't matter, every player in the batch is independent of the others
+		m_awakePlayers.erase(std::remove_if(m_awakePlayers.begin(), m_awakePlayers.end(), [](const CPlayerComponent* pPlayer) { return pPlayer->IsDormant(); }), m_awakePlayers.end());
+		GAME_PROFILE_COUNTER("PlayerSystem::AwakePlayers", static_cast<int64>(m_awakePlayers.size()));
+		GAME_PROFILE_COUNTER("PlayerSystem::DormantPlayers", static_cast<int64>(m_players.size() - m_awakePlayers.size()));
+
+		if (IsBatchingEnabled())
+		{
+			UpdateBatch(frameTime);
+		}
+
+		// After the movement update, so that the snapshot position is what the frame renders
+		if (!gEnv->bServer && IsInterpolationEnabled())
+		{
+			UpdateRemotePlayers(frameTime);
+		}
+		else
+		{
+			m_remoteViewTime = 0.f;
+		}
+	}
+
+	void CPlayerSystem::UpdateBatch(float frameTime)
+	{
+		// Players woken during the update are appended and join the batch with the next one
+		const size_t playerCount = m_awakePlayers.size();
+		m_batch.Resize(playerCount);
+
+		{
+			GAME_PROFILE_SCOPE("CPlayerSystem::Gather");
+			for (size_t i = 0; i < playerCount; ++i)
+			{
+				m_awakePlayers[i]->PrepareBatchedUpdate(m_batch, i, frameTime);
+			}
+		}
+
+		{
+			GAME_PROFILE_SCOPE("CPlayerSystem::Compute");
+			UpdateInParallel(m_batch, static_cast<size_t>(max(1, g_playerBatchJobSize)));
+		}
+
+		{
+			GAME_PROFILE_SCOPE("CPlayerSystem::Commit");
+			for (size_t i = 0; i < playerCount; ++i)
+			{
+				m_awakePlayers[i]->ApplyBatchedUpdate(m_batch, i);
+			}
+		}
+	}
+
+	void CPlayerSystem::UpdateRemotePlayers(float frameTime)
+	{
+		GAME_PROFILE_SCOPE("CPlayerSystem::UpdateRemotePlayers");
+
+		m_remotePlayers.clear();
+		for (CPlayerComponent* pPlayer : m_players)
+		{
+			if (pPlayer->IsRemote())
+			{
+				m_remotePlayers.push_back(pPlayer);
+			}
+		}
+
+		const size_t remoteCount = m_remotePlayers.size();
+		m_remoteSamples.resize(remoteCount);
+		GAME_PROFILE_COUNTER("PlayerSystem::RemotePlayers", static_cast<int64>(remoteCount));
+
+		const SPlayoutParams params = GetPlayoutParams();
+		const float localTime = gEnv->pTimer->GetCurrTime();
+
+		// Sampling only touches the snapshot buffers, the entities are moved in a second pass
+		float renderTimeSum = 0.f;
+		size_t renderedCount = 0;
+		for (size_t i = 0; i < remoteCount; ++i)
+		{
+			CPlayerComponent::TSnapshotInterpolator& snapshots = m_remotePlayers[i]->GetSnapshots();
+			m_remoteSamples[i] = snapshots.Update(localTime, frameTime, params);
+
+			if (m_remoteSamples[i].result != ESnapshotSampleResult::Empty)
+			{
+				renderTimeSum += snapshots.GetRenderTime(localTime);
+				++renderedCount;
+			}
+		}
+		m_remoteViewTime = renderedCount > 0 ? renderTimeSum / static_cast<float>(renderedCount) : 0.f;
+
+		for (size_t i = 0; i < remoteCount; ++i)
+		{
+			m_remotePlayers[i]->ApplySnapshotSample(m_remoteSamples[i]);
+		}
+	}
+
+	SPlayoutParams CPlayerSystem::GetPlayoutParams()
+	{
+		SPlayoutParams params;
+		params.minDelay = max(0.f, g_playerInterpolationMinDelay);
+		params.maxDelay = max(params.minDelay, g_playerInterpolationMaxDelay);
+		params.jitterScale = max(0.f, g_playerInterpolationJitterScale);
+		params.maxExtrapolation = max(0.f, g_playerInterpolationMaxExtrapolation);
+		params.snapDistance = max(0.f, g_playerInterpolationSnapDistance);
+		return params;
+	}
+
+	void CPlayerSystem::LogInterpolationInfo(IConsoleCmdArgs* pArgs)
+	{
+		const CPlayerSystem& playerSystem = CGamePlugin::GetInstance()->GetPlayerSystem();
+		const SPlayoutParams params = GetPlayoutParams();
+
+		size_t remoteCount = 0;
+		for (const CPlayerComponent* pPlayer : playerSystem.m_players)
+		{
+			if (!pPlayer->IsRemote())
+			{
+				continue;
+			}
+
+			const CPlayerComponent::TSnapshotInterpolator& snapshots = pPlayer->GetSnapshots();
+			CryLogAlways("[PlayerSystem] %s: delay %.0f ms (target %.0f ms), interval %.0f ms, jitter %.1f ms, %" PRISIZE_T " snapshots",
+				pPlayer->GetEntity()->GetName(), snapshots.GetDelay() * 1000.f, snapshots.GetTargetDelay(params) * 1000.f, snapshots.GetInterval() * 1000.f, snapshots.GetJitter() * 1000.f, snapshots.GetCount());
+			++remoteCount;
+		}
+
+		CryLogAlways("[PlayerSystem] Interpolation %s, %" PRISIZE_T " remote players", IsInterpolationEnabled() ? "enabled" : "disabled", remoteCount);
+	}
+
+	void CPlayerSystem::UpdateInParallel(CPlayerBatch& batch, size_t minRangeSize)
+	{
+		const size_t count = batch.Size();
+		const size_t rangeSize = max(minRangeSize, (count + kMaxJobs - 1) / kMaxJobs);
+		const size_t rangeCount = (count + rangeSize - 1) / rangeSize;
+
+		if (rangeCount <= 1 || gEnv->pJobManager == nullptr)
+		{
+			batch.Update(0, count);
+			return;
+		}
+
+		// The main thread takes the first range itself instead of idling until the jobs are done
+		for (size_t range = 1; range < rangeCount; ++range)
+		{
+			const size_t first = range * rangeSize;
+			const size_t last = min(first + rangeSize, count);
+			gEnv->pJobManager->AddLambdaJob("CPlayerSystem::UpdateInParallel", [&batch, first, last]()
+			{
+				batch.Update(first, last);
+			}, JobManager::eRegularPriority, &m_jobStates[range]);
+		}
+
+		batch.Update(0, min(rangeSize, count));
+
+		for (size_t range = 1; range < rangeCount; ++range)
+		{
+			gEnv->pJobManager->WaitForJob(m_jobStates[range]);
+		}
+	}
+
+	void CPlayerSystem::OnDormancyChanged(ICVar* pCVar)
+	{
+		if (pCVar->GetIVal() != 0)
+		{
+			return;
+		}
+
+		// Dormant players rejoin the update
+		for (CPlayerComponent* pPlayer : CGamePlugin::GetInstance()->GetPlayerSystem().m_players)
+		{
+			pPlayer->Wake();
+		}
+	}
+
+	void CPlayerSystem::OnBatchUpdateChanged(ICVar* pCVar)
+	{
+		// Players stop or start listening to entity update events
+		for (CPlayerComponent* pPlayer : CGamePlugin::GetInstance()->GetPlayerSystem().m_players)
+		{
+			pPlayer->GetEntity()->UpdateComponentEventMask(pPlayer);
+		}
+	}
+}
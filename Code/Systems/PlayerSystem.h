@@ -0,0 +1,80 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+#pragma once
+
+#include "Core/Dormancy.h"
+#include "Core/PlayerBatch.h"
+#include "Core/SnapshotInterpolation.h"
+
+#include <CryThreading/IJobManager.h>
+
+#include <array>
+#include <vector>
+
+namespace Game
+{
+	class CPlayerComponent;
+
+	////////////////////////////////////////////////////////
+	// Batched frame update of all players
+	// While g_playerBatchUpdate is set, players don't receive entity update events. Instead their state is
+	// gathered into one CPlayerBatch, the movement and look math runs as a parallel-for on the job system, and
+	// the results are applied to the character controllers and entity rotations in one pass on the main thread.
+	// On clients, remote players are then placed along their received snapshots, also in one pass.
+	// Players that stand still without input go dormant and drop out of both the batch and the entity update until
+	// something wakes them, see CPlayerComponent::IsDormant.
+	////////////////////////////////////////////////////////
+	class CPlayerSystem
+	{
+	public:
+		// Upper bound for the jobs of one update, larger batches get larger ranges
+		static constexpr size_t kMaxJobs = 32;
+
+		CPlayerSystem();
+		~CPlayerSystem();
+
+		void Register(CPlayerComponent& player);
+		void Unregister(CPlayerComponent& player);
+		// Puts a player that left dormancy back into the batch
+		void OnPlayerWoken(CPlayerComponent& player);
+
+		// Updates all registered players while batching is enabled and plays back remote players on clients
+		void Update(float frameTime);
+
+		static bool IsBatchingEnabled();
+		static bool IsDormancyEnabled();
+		static SDormancyParams GetDormancyParams();
+		// Whether remote players are interpolated between snapshots, instead of being placed as each one arrives
+		static bool IsInterpolationEnabled();
+
+		// Runs CPlayerBatch::Update over the whole batch, split into ranges of at least minRangeSize players
+		void UpdateInParallel(CPlayerBatch& batch, size_t minRangeSize);
+
+		size_t GetCount() const { return m_players.size(); }
+		size_t GetAwakeCount() const { return m_awakePlayers.size(); }
+		// Server time at which the last frame showed the remote players on average, 0 while none are interpolated
+		// Sent with the input so that the server rewinds shots to what the player aimed at, see CLagCompensation.
+		float GetRemoteViewTime() const { return m_remoteViewTime; }
+		const std::vector<CPlayerComponent*>& GetPlayers() const { return m_players; }
+
+	private:
+		void UpdateBatch(float frameTime);
+		void UpdateRemotePlayers(float frameTime);
+
+		static SPlayoutParams GetPlayoutParams();
+		static void OnBatchUpdateChanged(ICVar* pCVar);
+		static void OnDormancyChanged(ICVar* pCVar);
+		static void LogInterpolationInfo(IConsoleCmdArgs* pArgs);
+
+	private:
+		std::vector<CPlayerComponent*> m_players;
+		// Players that are not dormant, the ones that went dormant during an update are removed at the start of the next
+		std::vector<CPlayerComponent*> m_awakePlayers;
+		CPlayerBatch m_batch;
+		// Remote players of this frame and their samples, parallel
+		std::vector<CPlayerComponent*> m_remotePlayers;
+		std::vector<SSnapshotSample> m_remoteSamples;
+		float m_remoteViewTime = 0.f;
+		std::array<JobManager::SJobState, kMaxJobs> m_jobStates;
+	};
+}
@@ -0,0 +1,174 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+#include "StdAfx.h"
+#include "ProjectileSystem.h"
+#include "GamePlugin.h"
+#include "GameProfiler.h"
+#include "ImpactSystem.h"
+#include "LagCompensation.h"
+#include "LevelMemory.h"
+#include "NetRelevancy.h"
+#include "SpatialIndex.h"
+
+#include <CryEntitySystem/IEntitySystem.h>
+#include <CryGame/IGameFramework.h>
+
+namespace Game
+{
+	namespace
+	{
+		float g_projectileLifetime = 5.f;
+
+		// Matches the momentum handed over by a physicalized bullet, see CBulletComponent::Launch
+		constexpr float kImpactImpulse = 1000.f;
+	}
+
+	CProjectileSystem::CProjectileSystem()
+		: m_projectiles(&CGamePlugin::GetInstance()->GetLevelMemory().GetArena())
+		, m_spatialHandles(decltype(m_spatialHandles)::allocator_type(&CGamePlugin::GetInstance()->GetLevelMemory().GetArena()))
+	{
+		REGISTER_CVAR2("g_projectileLifetime", &g_projectileLifetime, g_projectileLifetime, VF_NULL, "Seconds a simulated projectile may fly before it is discarded without hitting anything");
+	}
+
+	CProjectileSystem::~CProjectileSystem()
+	{
+		if (IConsole* pConsole = gEnv->pConsole)
+		{
+			pConsole->UnregisterVariable("g_projectileLifetime", true);
+		}
+	}
+
+	void CProjectileSystem::Spawn(const Vec3& position, const Vec3& velocity, EntityId ownerId)
+	{
+		m_projectiles.Add(position.x, position.y, position.z, velocity.x, velocity.y, velocity.z, g_projectileLifetime, ownerId);
+		m_spatialHandles.push_back(CGamePlugin::GetInstance()->GetSpatialIndex().Register(ownerId, eSpatialType_Projectile, position, 0.f));
+	}
+
+	bool CProjectileSystem::FireHitscan(const Vec3& position, const Vec3& direction, float range, EntityId ownerId)
+	{
+		const CLagCompensation& lagCompensation = CGamePlugin::GetInstance()->GetLagCompensation();
+		const bool isLagCompensated = gEnv->bServer && lagCompensation.IsEnabled();
+
+		// Living entities are where they are now, the rewound hitboxes replace them
+		ray_hit hit;
+		const bool hasWorldHit = TraceSegment(position, direction * range, ownerId, hit, isLagCompensated ? ent_all & ~ent_living : ent_all);
+
+		if (isLagCompensated)
+		{
+			// Players have no health yet, a validated hit is where damage would be applied
+			CLagCompensation::SHit playerHit;
+			if (lagCompensation.Raycast(position, direction, hasWorldHit ? hit.dist : range, lagCompensation.GetShooterViewTime(ownerId), ownerId, playerHit))
+			{
+				return true;
+			}
+		}
+
+		if (hasWorldHit)
+		{
+			OnImpact(hit, direction, ownerId);
+			return true;
+		}
+
+		return false;
+	}
+
+	void CProjectileSystem::Update(float frameTime)
+	{
+		GAME_PROFILE_SCOPE("CProjectileSystem::Update");
+		GAME_PROFILE_COUNTER("ProjectileSystem::LiveProjectiles", static_cast<int64>(m_projectiles.Size()));
+
+		if (m_projectiles.Empty() || frameTime <= 0.f)
+		{
+			return;
+		}
+
+		// Exact for constant acceleration, so the step size does not change the trajectory
+		const Vec3 gravity = gEnv->pPhysicalWorld->GetPhysVars()->gravity;
+		m_projectiles.Integrate(frameTime, gravity.x, gravity.y, gravity.z);
+
+		CSpatialIndex& spatialIndex = CGamePlugin::GetInstance()->GetSpatialIndex();
+
+		// Walk backwards so that swap-removal only moves projectiles that were already traced
+		for (size_t i = m_projectiles.Size(); i-- > 0;)
+		{
+			const Vec3 previousPosition(m_projectiles.GetPreviousX(i), m_projectiles.GetPreviousY(i), m_projectiles.GetPreviousZ(i));
+			const Vec3 position(m_projectiles.GetPositionX(i), m_projectiles.GetPositionY(i), m_projectiles.GetPositionZ(i));
+			const EntityId ownerId = m_projectiles.GetOwner(i);
+
+			const Vec3 delta = position - previousPosition;
+
+			ray_hit hit;
+			const bool hasHit = TraceSegment(previousPosition, delta, ownerId, hit);
+			if (hasHit)
+			{
+				OnImpact(hit, delta.GetNormalizedFast(), ownerId);
+			}
+
+			// Removed on collision, the same way CBulletComponent expires
+			if (hasHit || m_projectiles.GetLifetime(i) <= 0.f)
+			{
+				m_projectiles.RemoveSwap(i);
+
+				spatialIndex.Unregister(m_spatialHandles[i]);
+				m_spatialHandles[i] = m_spatialHandles.back();
+				m_spatialHandles.pop_back();
+			}
+			else
+			{
+				spatialIndex.Move(m_spatialHandles[i], position);
+			}
+		}
+	}
+
+	void CProjectileSystem::Clear()
+	{
+		// Gives the storage back to the level memory, which is reset right after
+		m_projectiles.Release();
+
+		CSpatialIndex& spatialIndex = CGamePlugin::GetInstance()->GetSpatialIndex();
+		for (const CSpatialGrid::THandle handle : m_spatialHandles)
+		{
+			spatialIndex.Unregister(handle);
+		}
+		decltype(m_spatialHandles)(m_spatialHandles.get_allocator()).swap(m_spatialHandles);
+	}
+
+	bool CProjectileSystem::TraceSegment(const Vec3& from, const Vec3& delta, EntityId ownerId, ray_hit& hit, int objectTypes) const
+	{
+		// Don't let the shooter's own character controller stop the round
+		IPhysicalEntity* pSkipEntities[1];
+		int numSkipEntities = 0;
+
+		if (IEntity* pOwner = gEnv->pEntitySystem->GetEntity(ownerId))
+		{
+			if (IPhysicalEntity* pOwnerPhysics = pOwner->GetPhysics())
+			{
+				pSkipEntities[numSkipEntities++] = pOwnerPhysics;
+			}
+		}
+
+		const int flags = rwi_colltype_any | rwi_stop_at_pierceable;
+		return gEnv->pPhysicalWorld->RayWorldIntersection(from, delta, objectTypes, flags, &hit, 1, pSkipEntities, numSkipEntities) > 0;
+	}
+
+	void CProjectileSystem::OnImpact(const ray_hit& hit, const Vec3& direction, EntityId ownerId)
+	{
+		IEntity* pHitEntity = gEnv->pEntitySystem->GetEntityFromPhysics(hit.pCollider);
+
+		if (hit.pCollider != nullptr)
+		{
+			pe_action_impulse impulseAction;
+			impulseAction.impulse = direction * kImpactImpulse;
+			impulseAction.point = hit.pt;
+			hit.pCollider->Action(&impulseAction);
+		}
+
+		// Shooter and target stay relevant to each other's clients no matter where they look
+		if (pHitEntity != nullptr && gEnv->bServer)
+		{
+			CGamePlugin::GetInstance()->GetNetRelevancy().NoteInteraction(ownerId, pHitEntity->GetId());
+		}
+
+		// Played with the bullet impacts of this tick, the same way as the 'mat_bullet' surface of the bullet material
+		CGamePlugin::GetInstance()->GetImpactSystem().QueueImpact(hit.pt, hit.n, hit.surface_idx, ownerId, pHitEntity != nullptr ? pHitEntity->GetId() : INVALID_ENTITYID);
+	}
+}
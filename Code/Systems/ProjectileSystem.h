@@ -0,0 +1,47 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+#pragma once
+
+#include "Core/LinearArena.h"
+#include "Core/ProjectileStore.h"
+#include "Core/SpatialGrid.h"
+
+#include <vector>
+
+namespace Game
+{
+	////////////////////////////////////////////////////////
+	// Simulates bullets as plain data instead of physicalized entities
+	// All projectiles are advanced in a single batched update using gravity-only integration,
+	// with one ray query per step segment. Entities and effects are only touched on impact.
+	// The projectile arrays live in the level memory and are released by Clear.
+	////////////////////////////////////////////////////////
+	class CProjectileSystem
+	{
+	public:
+		CProjectileSystem();
+		~CProjectileSystem();
+
+		// Adds a ballistic projectile that is advanced by Update until it hits something or expires
+		void Spawn(const Vec3& position, const Vec3& velocity, EntityId ownerId);
+		// Resolves an instantaneous shot with a single ray query
+		// On the server players are tested at the poses the shooter saw, see CLagCompensation
+		bool FireHitscan(const Vec3& position, const Vec3& direction, float range, EntityId ownerId);
+
+		void Update(float frameTime);
+		void Clear();
+
+		size_t GetLiveCount() const { return m_projectiles.Size(); }
+		size_t GetCapacity() const { return m_projectiles.Capacity(); }
+		const CProjectileStore& GetProjectiles() const { return m_projectiles; }
+
+	private:
+		bool TraceSegment(const Vec3& from, const Vec3& delta, EntityId ownerId, ray_hit& hit, int objectTypes = ent_all) const;
+		void OnImpact(const ray_hit& hit, const Vec3& direction, EntityId ownerId);
+
+	private:
+		CProjectileStore m_projectiles;
+		// Entry in the spatial index for every projectile, parallel to m_projectiles
+		std::vector<CSpatialGrid::THandle, SArenaAllocator<CSpatialGrid::THandle>> m_spatialHandles;
+	};
+}
@@ -0,0 +1,215 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+#include "StdAfx.h"
+#include "ResourceHandles.h"
+
+#include "AssetPreloader.h"
+#include "GamePlugin.h"
+#include "GameProfiler.h"
+
+#include <CryAnimation/ICryAnimation.h>
+
+#include <algorithm>
+
+namespace Game
+{
+	CResourceHandles::CResourceHandles()
+	{
+		REGISTER_COMMAND("g_resourceHandleInfo", LogInfo, VF_NULL, "Logs the registered resource handles and how many name lookups they saved");
+	}
+
+	CResourceHandles::~CResourceHandles()
+	{
+		if (IConsole* pConsole = gEnv->pConsole)
+		{
+			pConsole->RemoveCommand("g_resourceHandleInfo");
+		}
+	}
+
+	template<typename TResource>
+	TResourceHandle<TResource> CResourceHandles::Register(std::vector<SEntry<TResource>>& entries, const char* szName)
+	{
+		TResourceHandle<TResource> handle;
+
+		const auto it = std::find_if(entries.begin(), entries.end(), [szName](const SEntry<TResource>& entry) { return stricmp(entry.name.c_str(), szName) == 0; });
+		if (it != entries.end())
+		{
+			handle.index = static_cast<uint16>(it - entries.begin());
+			return handle;
+		}
+
+		if (entries.size() >= TResourceHandle<TResource>::kInvalidIndex)
+		{
+			CRY_ASSERT_MESSAGE(false, "Too many resource handles");
+			return handle;
+		}
+
+		SEntry<TResource> entry;
+		entry.name = szName;
+		entries.push_back(entry);
+
+		handle.index = static_cast<uint16>(entries.size() - 1);
+		return handle;
+	}
+
+	TMeshHandle CResourceHandles::RegisterMesh(const char* szPath)
+	{
+		return Register(m_meshes, szPath);
+	}
+
+	TMaterialHandle CResourceHandles::RegisterMaterial(const char* szPath)
+	{
+		return Register(m_materials, szPath);
+	}
+
+	TAttachmentHandle CResourceHandles::RegisterAttachment(const char* szName)
+	{
+		TAttachmentHandle handle;
+
+		const auto it = std::find_if(m_attachmentNames.begin(), m_attachmentNames.end(), [szName](const string& name) { return stricmp(name.c_str(), szName) == 0; });
+		if (it != m_attachmentNames.end())
+		{
+			handle.index = static_cast<uint16>(it - m_attachmentNames.begin());
+			return handle;
+		}
+
+		m_attachmentNames.push_back(szName);
+		handle.index = static_cast<uint16>(m_attachmentNames.size() - 1);
+		return handle;
+	}
+
+	void CResourceHandles::Resolve()
+	{
+		for (SEntry<IStatObj>& entry : m_meshes)
+		{
+			ResolveMesh(entry);
+		}
+
+		for (SEntry<IMaterial>& entry : m_materials)
+		{
+			ResolveMaterial(entry);
+		}
+	}
+
+	void CResourceHandles::Invalidate()
+	{
+		for (SEntry<IStatObj>& entry : m_meshes)
+		{
+			entry.pResource = nullptr;
+		}
+
+		for (SEntry<IMaterial>& entry : m_materials)
+		{
+			entry.pResource = nullptr;
+		}
+
+		++m_generation;
+	}
+
+	IStatObj* CResourceHandles::Get(TMeshHandle handle)
+	{
+		if (!handle.IsValid())
+		{
+			return nullptr;
+		}
+
+		SEntry<IStatObj>& entry = m_meshes[handle.index];
+		if (entry.pResource == nullptr)
+		{
+			ResolveMesh(entry);
+		}
+		else
+		{
+			++m_handleHitCount;
+			GAME_PROFILE_COUNTER("ResourceHandles::LookupsSaved", 1);
+		}
+		return entry.pResource;
+	}
+
+	IMaterial* CResourceHandles::Get(TMaterialHandle handle)
+	{
+		if (!handle.IsValid())
+		{
+			return nullptr;
+		}
+
+		SEntry<IMaterial>& entry = m_materials[handle.index];
+		if (entry.pResource == nullptr)
+		{
+			ResolveMaterial(entry);
+		}
+		else
+		{
+			++m_handleHitCount;
+			GAME_PROFILE_COUNTER("ResourceHandles::LookupsSaved", 1);
+		}
+		return entry.pResource;
+	}
+
+	IAttachment* CResourceHandles::Get(ICharacterInstance& character, TAttachmentHandle handle, SCachedAttachment& cache)
+	{
+		if (!handle.IsValid())
+		{
+			return nullptr;
+		}
+
+		// The attachment belongs to the character instance, which is replaced when the character file changes
+		if (cache.pCharacter == &character && cache.generation == m_generation && cache.pAttachment != nullptr)
+		{
+			++m_handleHitCount;
+			GAME_PROFILE_COUNTER("ResourceHandles::LookupsSaved", 1);
+			return cache.pAttachment;
+		}
+
+		++m_lookupCount;
+		GAME_PROFILE_COUNTER("ResourceHandles::Lookups", 1);
+
+		cache.pCharacter = &character;
+		cache.generation = m_generation;
+		cache.pAttachment = character.GetIAttachmentManager()->GetInterfaceByName(m_attachmentNames[handle.index].c_str());
+		return cache.pAttachment;
+	}
+
+	void CResourceHandles::ResolveMesh(SEntry<IStatObj>& entry)
+	{
+		++m_lookupCount;
+		GAME_PROFILE_COUNTER("ResourceHandles::Lookups", 1);
+
+		entry.pResource = CGamePlugin::GetInstance()->GetAssetPreloader().GetGeometry(entry.name.c_str());
+		if (entry.pResource == nullptr)
+		{
+			entry.pResource = gEnv->p3DEngine->LoadStatObj(entry.name.c_str(), nullptr, nullptr, false);
+		}
+	}
+
+	void CResourceHandles::ResolveMaterial(SEntry<IMaterial>& entry)
+	{
+		++m_lookupCount;
+		GAME_PROFILE_COUNTER("ResourceHandles::Lookups", 1);
+
+		entry.pResource = CGamePlugin::GetInstance()->GetAssetPreloader().GetMaterial(entry.name.c_str());
+		if (entry.pResource == nullptr)
+		{
+			entry.pResource = gEnv->p3DEngine->GetMaterialManager()->LoadMaterial(entry.name.c_str());
+		}
+	}
+
+	void CResourceHandles::LogInfo(IConsoleCmdArgs* pArgs)
+	{
+		const CResourceHandles& handles = CGamePlugin::GetInstance()->GetResourceHandles();
+
+		for (const SEntry<IStatObj>& entry : handles.m_meshes)
+		{
+			CryLogAlways("[ResourceHandles] Mesh       %-8s %s", entry.pResource != nullptr ? "resolved" : "-", entry.name.c_str());
+		}
+		for (const SEntry<IMaterial>& entry : handles.m_materials)
+		{
+			CryLogAlways("[ResourceHandles] Material   %-8s %s", entry.pResource != nullptr ? "resolved" : "-", entry.name.c_str());
+		}
+		for (const string& name : handles.m_attachmentNames)
+		{
+			CryLogAlways("[ResourceHandles] Attachment          %s", name.c_str());
+		}
+
+		CryLogAlways("[ResourceHandles] %" PRIu64 " name lookups, %" PRIu64 " served by handles since startup", handles.m_lookupCount, handles.m_handleHitCount);
+	}
+}
@@ -0,0 +1,92 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+#pragma once
+
+#include <vector>
+
+struct IStatObj;
+struct IMaterial;
+struct IAttachment;
+struct ICharacterInstance;
+
+namespace Game
+{
+	// Index of an interned resource name, typed by the kind of resource it resolves to
+	template<typename TResource>
+	struct TResourceHandle
+	{
+		static constexpr uint16 kInvalidIndex = 0xFFFF;
+
+		bool IsValid() const { return index != kInvalidIndex; }
+
+		uint16 index = kInvalidIndex;
+	};
+
+	using TMeshHandle = TResourceHandle<IStatObj>;
+	using TMaterialHandle = TResourceHandle<IMaterial>;
+	using TAttachmentHandle = TResourceHandle<IAttachment>;
+
+	// Attachment resolved for one character, kept by the component that uses it
+	struct SCachedAttachment
+	{
+		ICharacterInstance* pCharacter = nullptr;
+		IAttachment* pAttachment = nullptr;
+		uint32 generation = 0;
+	};
+
+	////////////////////////////////////////////////////////
+	// Interned handles of meshes, materials and attachments used on hot gameplay paths
+	// Names are registered once, e.g. at component initialization, and resolved together when gameplay starts, so
+	// that a shot or a spawned bullet costs an array access instead of a path hash and a manager lookup. Level
+	// unload drops the resolved resources, handles stay valid and resolve again on next use.
+	////////////////////////////////////////////////////////
+	class CResourceHandles
+	{
+	public:
+		CResourceHandles();
+		~CResourceHandles();
+
+		// Registering the same name again returns the same handle
+		TMeshHandle RegisterMesh(const char* szPath);
+		TMaterialHandle RegisterMaterial(const char* szPath);
+		TAttachmentHandle RegisterAttachment(const char* szName);
+
+		// Looks up all registered meshes and materials, taking them from the asset preloader where possible
+		void Resolve();
+		// Drops all resolved resources and cached attachments, called on level unload
+		void Invalidate();
+
+		// Resolved resource, looked up by name first if it isn't resolved yet
+		IStatObj* Get(TMeshHandle handle);
+		IMaterial* Get(TMaterialHandle handle);
+		// Attachment of the character, looked up by name only when the character or the level changed
+		IAttachment* Get(ICharacterInstance& character, TAttachmentHandle handle, SCachedAttachment& cache);
+
+	private:
+		template<typename TResource>
+		struct SEntry
+		{
+			string name;
+			_smart_ptr<TResource> pResource;
+		};
+
+		template<typename TResource>
+		static TResourceHandle<TResource> Register(std::vector<SEntry<TResource>>& entries, const char* szName);
+
+		void ResolveMesh(SEntry<IStatObj>& entry);
+		void ResolveMaterial(SEntry<IMaterial>& entry);
+		static void LogInfo(IConsoleCmdArgs* pArgs);
+
+	private:
+		std::vector<SEntry<IStatObj>> m_meshes;
+		std::vector<SEntry<IMaterial>> m_materials;
+		std::vector<string> m_attachmentNames;
+
+		// Bumped by Invalidate, cached attachments of an older generation are looked up again
+		uint32 m_generation = 1;
+
+		// Totals since startup, the profiler counters show them per frame
+		uint64 m_lookupCount = 0;
+		uint64 m_handleHitCount = 0;
+	};
+}
@@ -0,0 +1,152 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+#include "StdAfx.h"
+#include "ServerTick.h"
+
+#include "BulletPool.h"
+#include "CharacterAnimation.h"
+#include "GamePlugin.h"
+#include "GameProfiler.h"
+#include "ImpactSystem.h"
+#include "LagCompensation.h"
+#include "NetRelevancy.h"
+#include "PlayerSystem.h"
+#include "ProjectileSystem.h"
+#include "SpatialIndex.h"
+
+namespace Game
+{
+	namespace
+	{
+		int   g_tickRate = 60;
+		int   g_tickMaxCatchUp = 4;
+		float g_tickBudget = 0.f;
+
+		constexpr uint64 kNsPerMs = 1000000;
+
+		void UpdatePlayers(void* pContext, float deltaTime) { static_cast<CPlayerSystem*>(pContext)->Update(deltaTime); }
+		void UpdateAnimation(void* pContext, float deltaTime) { static_cast<CCharacterAnimation*>(pContext)->Update(deltaTime); }
+		void UpdateBullets(void* pContext, float deltaTime) { static_cast<CBulletPool*>(pContext)->Update(deltaTime); }
+		void UpdateProjectiles(void* pContext, float deltaTime) { static_cast<CProjectileSystem*>(pContext)->Update(deltaTime); }
+		void UpdateImpacts(void* pContext, float deltaTime) { static_cast<CImpactSystem*>(pContext)->Update(deltaTime); }
+		void UpdateHitValidation(void* pContext, float deltaTime) { static_cast<CLagCompensation*>(pContext)->Update(); }
+		void UpdateRelevancy(void* pContext, float deltaTime) { static_cast<CNetRelevancy*>(pContext)->Update(); }
+		// Entities have reported their movement during the tick, publish it for the next tick's queries
+		void CommitSpatialIndex(void* pContext, float deltaTime) { static_cast<CSpatialIndex*>(pContext)->Commit(); }
+	}
+
+	CServerTick::CServerTick()
+	{
+		REGISTER_CVAR2("sv_tickRate", &g_tickRate, g_tickRate, VF_NULL, "Gameplay ticks per second of a dedicated server, keep sv_DedicatedMaxRate at or above it so that ticks don't bunch up\n0 = one tick per frame");
+		REGISTER_CVAR2("sv_tickMaxCatchUp", &g_tickMaxCatchUp, g_tickMaxCatchUp, VF_NULL, "Most ticks a frame runs to catch up after a hitch, the rest of the backlog is dropped");
+		REGISTER_CVAR2("sv_tickBudget", &g_tickBudget, g_tickBudget, VF_NULL, "Milliseconds the tasks of one tick may take before deferrable tasks are skipped\n0 = the tick length");
+		REGISTER_COMMAND("sv_tickStats", LogStatistics, VF_NULL, "Logs ticks, dropped ticks and the runs, time, budget overruns and deferrals of every tick task, pass 'reset' to clear them afterwards");
+		REGISTER_COMMAND("sv_tickTaskBudget", SetTaskBudget, VF_NULL, "Sets the budget of a tick task in milliseconds, logs all budgets without arguments\nUsage: sv_tickTaskBudget [task] [ms]");
+
+		CGamePlugin& plugin = *CGamePlugin::GetInstance();
+		// Players move first, so that projectiles and lag compensation see this tick's positions
+		m_scheduler.AddTask("Players", &UpdatePlayers, &plugin.GetPlayerSystem(), 4 * kNsPerMs, 0);
+		// After movement and snapshot playback, so that locomotion follows this tick's velocity
+		m_scheduler.AddTask("Animation", &UpdateAnimation, &plugin.GetCharacterAnimation(), 2 * kNsPerMs, 0);
+		m_scheduler.AddTask("Bullets", &UpdateBullets, &plugin.GetBulletPool(), 1 * kNsPerMs, 0);
+		m_scheduler.AddTask("Projectiles", &UpdateProjectiles, &plugin.GetProjectileSystem(), 2 * kNsPerMs, 0);
+		// After both kinds of projectiles queued their impacts, effects and bullet returns may wait a tick
+		m_scheduler.AddTask("Impacts", &UpdateImpacts, &plugin.GetImpactSystem(), 1 * kNsPerMs, 2);
+		// Hit validation samples hitboxes over time and relevancy scores against the positions published last tick,
+		// neither feeds back into the simulation, so both may run late
+		m_scheduler.AddTask("HitValidation", &UpdateHitValidation, &plugin.GetLagCompensation(), 1 * kNsPerMs, 2);
+		m_scheduler.AddTask("Relevancy", &UpdateRelevancy, &plugin.GetNetRelevancy(), 1 * kNsPerMs, 4);
+		m_scheduler.AddTask("SpatialIndex", &CommitSpatialIndex, &plugin.GetSpatialIndex(), kNsPerMs / 2, 0);
+	}
+
+	CServerTick::~CServerTick()
+	{
+		if (IConsole* pConsole = gEnv->pConsole)
+		{
+			pConsole->UnregisterVariable("sv_tickRate", true);
+			pConsole->UnregisterVariable("sv_tickMaxCatchUp", true);
+			pConsole->UnregisterVariable("sv_tickBudget", true);
+			pConsole->RemoveCommand("sv_tickStats");
+			pConsole->RemoveCommand("sv_tickTaskBudget");
+		}
+	}
+
+	void CServerTick::Update(float frameTime)
+	{
+		// A client or a listen server renders every frame, its simulation follows the frame rate
+		m_scheduler.SetRate(gEnv->IsDedicated() ? static_cast<float>(max(0, g_tickRate)) : 0.f);
+		m_scheduler.SetMaxTicksPerFrame(static_cast<uint32>(max(1, g_tickMaxCatchUp)));
+		m_scheduler.SetTickBudget(static_cast<uint64>(max(0.f, g_tickBudget) * static_cast<float>(kNsPerMs)));
+
+		const uint32 tickCount = m_scheduler.Update(frameTime);
+
+		const uint64 droppedTicks = m_scheduler.GetStatistics().droppedTicks;
+		GAME_PROFILE_COUNTER("ServerTick::Ticks", static_cast<int64>(tickCount));
+		GAME_PROFILE_COUNTER("ServerTick::DroppedTicks", static_cast<int64>(droppedTicks - m_lastDroppedTicks));
+		m_lastDroppedTicks = droppedTicks;
+	}
+
+	void CServerTick::Reset()
+	{
+		m_scheduler.Reset();
+	}
+
+	void CServerTick::LogStatistics(IConsoleCmdArgs* pArgs)
+	{
+		CServerTick& serverTick = CGamePlugin::GetInstance()->GetServerTick();
+		const CTickScheduler& scheduler = serverTick.m_scheduler;
+		const STickStatistics& statistics = scheduler.GetStatistics();
+
+		if (scheduler.IsFixed())
+		{
+			CryLogAlways("[ServerTick] %.0f Hz, up to %d ticks per frame", 1.f / scheduler.GetTickLength(), max(1, g_tickMaxCatchUp));
+		}
+		else
+		{
+			CryLogAlways("[ServerTick] One tick per frame");
+		}
+
+		CryLogAlways("[ServerTick] %" PRIu64 " frames, %" PRIu64 " ticks, %" PRIu64 " dropped, at most %u ticks per frame, %" PRIu64 " ticks over budget, longest tick %.2f ms",
+			statistics.frames, statistics.ticks, statistics.droppedTicks, statistics.maxTicksPerFrame, statistics.overBudgetTicks, statistics.maxTickNs / 1e6);
+
+		for (size_t i = 0, n = scheduler.GetTaskCount(); i < n; ++i)
+		{
+			const STickTaskStatistics& task = scheduler.GetTaskStatistics(i);
+			const double runs = static_cast<double>(max<uint64>(task.runs, 1));
+			CryLogAlways("[ServerTick] %-14s budget %.2f ms, mean %.3f ms, max %.3f ms, %" PRIu64 " runs, %" PRIu64 " overruns (%.1f%%), %" PRIu64 " deferrals",
+				scheduler.GetTaskName(i), scheduler.GetTaskBudget(i) / 1e6, task.totalNs / 1e6 / runs, task.maxNs / 1e6,
+				task.runs, task.overruns, 100.0 * task.overruns / runs, task.deferrals);
+		}
+
+		if (pArgs->GetArgCount() > 1 && strcmp(pArgs->GetArg(1), "reset") == 0)
+		{
+			serverTick.m_scheduler.ResetStatistics();
+			serverTick.m_lastDroppedTicks = 0;
+		}
+	}
+
+	void CServerTick::SetTaskBudget(IConsoleCmdArgs* pArgs)
+	{
+		CTickScheduler& scheduler = CGamePlugin::GetInstance()->GetServerTick().m_scheduler;
+
+		if (pArgs->GetArgCount() < 3)
+		{
+			for (size_t i = 0, n = scheduler.GetTaskCount(); i < n; ++i)
+			{
+				CryLogAlways("[ServerTick] %-14s %.2f ms", scheduler.GetTaskName(i), scheduler.GetTaskBudget(i) / 1e6);
+			}
+			return;
+		}
+
+		for (size_t i = 0, n = scheduler.GetTaskCount(); i < n; ++i)
+		{
+			if (stricmp(scheduler.GetTaskName(i), pArgs->GetArg(1)) == 0)
+			{
+				const float budget = max(0.f, static_cast<float>(atof(pArgs->GetArg(2))));
+				scheduler.SetTaskBudget(i, static_cast<uint64>(budget * static_cast<float>(kNsPerMs)));
+				return;
+			}
+		}
+
+		CryLogAlways("[ServerTick] No tick task named %s", pArgs->GetArg(1));
+	}
+}
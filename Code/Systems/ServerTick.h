@@ -0,0 +1,41 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+#pragma once
+
+#include "Core/TickScheduler.h"
+
+namespace Game
+{
+	////////////////////////////////////////////////////////
+	// Runs the gameplay simulation of the dedicated server at sv_tickRate
+	// Players, character animation, bullets, projectiles, impacts, hit validation, relevancy and the spatial index
+	// commit are tasks of one CTickScheduler, in the order the plug-in used to update them. Impacts, hit validation
+	// and relevancy don't feed back into the simulation within a tick, so they are deferred when they overrun their
+	// budget or the tick ran out of time. Everywhere else, and with a rate of zero, there is exactly one tick per frame.
+	// Players only run in the tick while g_playerBatchUpdate is set, otherwise the entity system updates them.
+	// Spawn selection is not a task, it has no work of its own per tick: CSpawnPointRegistry only selects when an
+	// entity is about to spawn, e.g. through sv_botsSpawn, and the caller needs the spawn point right away.
+	////////////////////////////////////////////////////////
+	class CServerTick
+	{
+	public:
+		// Constructed after the systems it runs
+		CServerTick();
+		~CServerTick();
+
+		// Runs the ticks that are due this frame
+		void Update(float frameTime);
+		// Drops the backlog, e.g. when a level is unloaded
+		void Reset();
+
+		const CTickScheduler& GetScheduler() const { return m_scheduler; }
+
+	private:
+		static void LogStatistics(IConsoleCmdArgs* pArgs);
+		static void SetTaskBudget(IConsoleCmdArgs* pArgs);
+
+	private:
+		CTickScheduler m_scheduler;
+		uint64 m_lastDroppedTicks = 0;
+	};
+}
@@ -0,0 +1,43 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+#include "StdAfx.h"
+#include "SpatialIndex.h"
+
+namespace Game
+{
+	namespace
+	{
+		// Matches the size of a small room, players and projectiles rarely share a cell with more than a few others
+		constexpr float kCellSize = 8.f;
+	}
+
+	CSpatialIndex::CSpatialIndex()
+		: m_grid(kCellSize)
+	{
+	}
+
+	CSpatialIndex::THandle CSpatialIndex::Register(uint32 userId, ESpatialType type, const Vec3& position, float radius)
+	{
+		SSpatialObject object;
+		object.position = ToGridVector(position);
+		object.radius = radius;
+		object.userId = userId;
+		object.typeMask = type;
+		return m_grid.Insert(object);
+	}
+
+	void CSpatialIndex::Move(THandle handle, const Vec3& position)
+	{
+		if (handle != kInvalidHandle)
+		{
+			m_grid.Move(handle, ToGridVector(position));
+		}
+	}
+
+	void CSpatialIndex::Unregister(THandle handle)
+	{
+		if (handle != kInvalidHandle)
+		{
+			m_grid.Remove(handle);
+		}
+	}
+}
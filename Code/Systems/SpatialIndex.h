@@ -0,0 +1,47 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+#pragma once
+
+#include "Core/SpatialGrid.h"
+
+namespace Game
+{
+	enum ESpatialType : uint32
+	{
+		eSpatialType_Player = 1 << 0,
+		eSpatialType_Projectile = 1 << 1,
+		eSpatialType_SpawnPoint = 1 << 2,
+
+		eSpatialType_All = ~0u
+	};
+
+	////////////////////////////////////////////////////////
+	// Gameplay-side proximity index of players, projectiles and spawn points
+	// Owners register their objects and report movement, changes become visible to queries once per frame
+	// when the plug-in commits them. Queries go straight to the grid and are safe to run from jobs.
+	////////////////////////////////////////////////////////
+	class CSpatialIndex
+	{
+	public:
+		using THandle = CSpatialGrid::THandle;
+		static constexpr THandle kInvalidHandle = CSpatialGrid::kInvalidHandle;
+
+		CSpatialIndex();
+
+		// userId is usually the EntityId of the object
+		THandle Register(uint32 userId, ESpatialType type, const Vec3& position, float radius);
+		void Move(THandle handle, const Vec3& position);
+		void Unregister(THandle handle);
+
+		// Publishes this frame's changes to queries
+		void Commit() { m_grid.Commit(); }
+
+		const CSpatialGrid& GetGrid() const { return m_grid; }
+
+		static SVec3f ToGridVector(const Vec3& value) { return SVec3f(value.x, value.y, value.z); }
+		static Vec3 FromGridVector(const SVec3f& value) { return Vec3(value.x, value.y, value.z); }
+
+	private:
+		CSpatialGrid m_grid;
+	};
+}
@@ -0,0 +1,156 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+#include "StdAfx.h"
+#include "SpawnPointRegistry.h"
+
+#include "GameRecorder.h"
+#include "GamePlugin.h"
+#include "SpatialIndex.h"
+
+#include "Components/SpawnPoint.h"
+
+#include <CryMath/Random.h>
+
+#include <algorithm>
+
+namespace Game
+{
+	namespace
+	{
+		float g_spawnEnemySearchRadius = 100.f;
+	}
+
+	CSpawnPointRegistry::CSpawnPointRegistry()
+	{
+		REGISTER_CVAR2("g_spawnEnemySearchRadius", &g_spawnEnemySearchRadius, g_spawnEnemySearchRadius, VF_NULL, "Distance around a spawn point that is searched for enemies by the FarthestFromEnemies policy");
+	}
+
+	CSpawnPointRegistry::~CSpawnPointRegistry()
+	{
+		if (IConsole* pConsole = gEnv->pConsole)
+		{
+			pConsole->UnregisterVariable("g_spawnEnemySearchRadius", true);
+		}
+	}
+
+	void CSpawnPointRegistry::Register(CSpawnPointComponent& spawnPoint)
+	{
+		const auto it = std::find_if(m_entries.begin(), m_entries.end(), [&spawnPoint](const SEntry& entry) { return entry.pSpawnPoint == &spawnPoint; });
+		if (it == m_entries.end())
+		{
+			m_entries.push_back(SEntry { &spawnPoint, 0.f });
+		}
+	}
+
+	void CSpawnPointRegistry::Unregister(CSpawnPointComponent& spawnPoint)
+	{
+		// Erase instead of swapping with the last entry, the First and RoundRobin policies depend on the order
+		const auto it = std::find_if(m_entries.begin(), m_entries.end(), [&spawnPoint](const SEntry& entry) { return entry.pSpawnPoint == &spawnPoint; });
+		if (it != m_entries.end())
+		{
+			m_entries.erase(it);
+		}
+	}
+
+	CSpawnPointComponent* CSpawnPointRegistry::Select(ESpawnSelectionPolicy policy, EntityId spawningEntityId)
+	{
+		if (m_entries.empty())
+		{
+			return nullptr;
+		}
+
+		GatherCandidates();
+
+		const size_t index = SelectIndex(policy, spawningEntityId, std::vector<Vec3>());
+		MarkUsed(index);
+		CGamePlugin::GetInstance()->GetGameRecorder().RecordSpawn(spawningEntityId, m_entries[index].pSpawnPoint->GetEntityId());
+
+		return m_entries[index].pSpawnPoint;
+	}
+
+	size_t CSpawnPointRegistry::SelectMany(ESpawnSelectionPolicy policy, size_t count, std::vector<Matrix34>& outTransforms)
+	{
+		if (m_entries.empty())
+		{
+			return 0;
+		}
+
+		GatherCandidates();
+		size_t claimedCount = 0;
+
+		std::vector<Vec3> occupiedPositions;
+		occupiedPositions.reserve(count);
+
+		outTransforms.reserve(outTransforms.size() + count);
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			// Once every spawn point has been handed out, start over
+			if (claimedCount == m_candidates.size())
+			{
+				for (SSpawnCandidate& candidate : m_candidates)
+				{
+					candidate.isClaimed = false;
+				}
+				claimedCount = 0;
+			}
+
+			const size_t index = SelectIndex(policy, INVALID_ENTITYID, occupiedPositions);
+			MarkUsed(index);
+			m_candidates[index].isClaimed = true;
+			++claimedCount;
+
+			const Matrix34 transform = m_entries[index].pSpawnPoint->GetWorldTransformMatrix();
+			occupiedPositions.push_back(transform.GetTranslation());
+			outTransforms.push_back(transform);
+		}
+
+		return count;
+	}
+
+	void CSpawnPointRegistry::GatherCandidates()
+	{
+		m_candidates.resize(m_entries.size());
+
+		for (size_t i = 0, n = m_entries.size(); i < n; ++i)
+		{
+			m_candidates[i].position = CSpatialIndex::ToGridVector(m_entries[i].pSpawnPoint->GetWorldTransformMatrix().GetTranslation());
+			m_candidates[i].lastUsedTime = m_entries[i].lastUsedTime;
+			m_candidates[i].isClaimed = false;
+		}
+	}
+
+	size_t CSpawnPointRegistry::SelectIndex(ESpawnSelectionPolicy policy, EntityId spawningEntityId, const std::vector<Vec3>& occupiedPositions)
+	{
+		return SelectSpawnCandidate(policy, m_candidates.data(), m_candidates.size(), m_nextRoundRobinIndex,
+			[&](const SVec3f& position) { return GetClosestEnemyDistanceSquared(CSpatialIndex::FromGridVector(position), spawningEntityId, occupiedPositions); },
+			[](size_t count) { return cry_random<size_t>(0, count - 1); });
+	}
+
+	float CSpawnPointRegistry::GetClosestEnemyDistanceSquared(const Vec3& position, EntityId spawningEntityId, const std::vector<Vec3>& occupiedPositions) const
+	{
+		const float searchRadius = g_spawnEnemySearchRadius;
+		float closestDistanceSquared = sqr(searchRadius);
+
+		for (const Vec3& occupiedPosition : occupiedPositions)
+		{
+			closestDistanceSquared = min(closestDistanceSquared, position.GetSquaredDistance(occupiedPosition));
+		}
+
+		// Only players within the search radius are considered, anything further away counts as being at the radius
+		const CSpatialGrid& grid = CGamePlugin::GetInstance()->GetSpatialIndex().GetGrid();
+		grid.QueryRadius(CSpatialIndex::ToGridVector(position), searchRadius, eSpatialType_Player, [&](const SSpatialObject& object)
+		{
+			if (object.userId != spawningEntityId)
+			{
+				closestDistanceSquared = min(closestDistanceSquared, position.GetSquaredDistance(CSpatialIndex::FromGridVector(object.position)));
+			}
+		});
+
+		return closestDistanceSquared;
+	}
+
+	void CSpawnPointRegistry::MarkUsed(size_t index)
+	{
+		m_entries[index].lastUsedTime = m_candidates[index].lastUsedTime = gEnv->pTimer->GetCurrTime();
+	}
+}
@@ -0,0 +1,56 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+#pragma once
+
+#include "Core/SpawnSelection.h"
+
+#include <vector>
+
+class CSpawnPointComponent;
+
+namespace Game
+{
+	////////////////////////////////////////////////////////
+	// Flat list of all spawn points in the level
+	// Spawn points register themselves when they are initialized and leave when they are shut down,
+	// so selecting a spawn point never has to iterate the entity system.
+	////////////////////////////////////////////////////////
+	class CSpawnPointRegistry
+	{
+	public:
+		CSpawnPointRegistry();
+		~CSpawnPointRegistry();
+
+		void Register(CSpawnPointComponent& spawnPoint);
+		void Unregister(CSpawnPointComponent& spawnPoint);
+
+		// Returns the selected spawn point and marks it as used, or nullptr if the level has none
+		// The entity that is about to spawn is ignored when looking for enemies
+		CSpawnPointComponent* Select(ESpawnSelectionPolicy policy, EntityId spawningEntityId = INVALID_ENTITYID);
+		// Selects spawn points for several entities at once, e.g. at round start
+		// Spawn points are not handed out twice as long as there are enough of them, and every pick counts
+		// as an enemy position for the following FarthestFromEnemies picks. Returns the number of transforms written.
+		size_t SelectMany(ESpawnSelectionPolicy policy, size_t count, std::vector<Matrix34>& outTransforms);
+
+		size_t GetCount() const { return m_entries.size(); }
+
+	private:
+		struct SEntry
+		{
+			CSpawnPointComponent* pSpawnPoint;
+			float lastUsedTime;
+		};
+
+		// Refreshes the positions in m_candidates and clears their claims
+		void GatherCandidates();
+		size_t SelectIndex(ESpawnSelectionPolicy policy, EntityId spawningEntityId, const std::vector<Vec3>& occupiedPositions);
+		float GetClosestEnemyDistanceSquared(const Vec3& position, EntityId spawningEntityId, const std::vector<Vec3>& occupiedPositions) const;
+		void MarkUsed(size_t index);
+
+	private:
+		std::vector<SEntry> m_entries;
+		// Parallel to m_entries, rebuilt for every selection
+		std::vector<SSpawnCandidate> m_candidates;
+		size_t m_nextRoundRobinIndex = 0;
+	};
+}
@@ -0,0 +1,173 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+#include "StdAfx.h"
+#include "StateRecorder.h"
+
+#include "BulletPool.h"
+#include "GamePlugin.h"
+#include "GameProfiler.h"
+#include "PlayerSystem.h"
+#include "ProjectileSystem.h"
+
+#include "Components/Player.h"
+
+#include <CryEntitySystem/IEntitySystem.h>
+#include <CryPhysics/physinterface.h>
+
+namespace Game
+{
+	namespace
+	{
+		// Policies of the fields in CPlayerComponent::NetSerialize, see Assets/Scripts/network/CompressionPolicy.xml
+		constexpr uint32_t kPlayerPositionPolicy = MakeStateTag('w', 'r', 'l', 'd');
+		constexpr uint32_t kPlayerVelocityPolicy = MakeStateTag('v', 'e', 'l', '0');
+
+		void StartStateRecording(IConsoleCmdArgs* pArgs)
+		{
+			const char* szFileName = pArgs->GetArgCount() > 1 ? pArgs->GetArg(1) : "%USER%/Profiling/GameState.gsst";
+			const float duration = pArgs->GetArgCount() > 2 ? max(0.f, static_cast<float>(atof(pArgs->GetArg(2)))) : 0.f;
+
+			CGamePlugin::GetInstance()->GetStateRecorder().Start(szFileName, duration);
+		}
+
+		void StopStateRecording(IConsoleCmdArgs* pArgs)
+		{
+			CGamePlugin::GetInstance()->GetStateRecorder().Stop();
+		}
+	}
+
+	CStateRecorder::CStateRecorder()
+	{
+		REGISTER_COMMAND("net_stateRecord", StartStateRecording, VF_NULL, "Records player, bullet and projectile state every frame for Tools/CompressionProfiler\nUsage: net_stateRecord [file] [seconds], records until net_stateRecordStop without a duration");
+		REGISTER_COMMAND("net_stateRecordStop", StopStateRecording, VF_NULL, "Stops the recording started with net_stateRecord");
+	}
+
+	CStateRecorder::~CStateRecorder()
+	{
+		if (IConsole* pConsole = gEnv->pConsole)
+		{
+			pConsole->RemoveCommand("net_stateRecord");
+			pConsole->RemoveCommand("net_stateRecordStop");
+		}
+	}
+
+	bool CStateRecorder::Start(const char* szFileName, float duration)
+	{
+		Stop();
+
+		char adjustedFileName[ICryPak::g_nMaxPath];
+		const char* szPath = gEnv->pCryPak->AdjustFileName(szFileName, adjustedFileName, ICryPak::FLAGS_FOR_WRITING);
+		gEnv->pCryPak->MakeDir(PathUtil::GetPathWithoutFilename(szPath));
+
+		if (!m_writer.Open(szPath))
+		{
+			CryWarning(VALIDATOR_MODULE_GAME, VALIDATOR_WARNING, "[StateRecorder] Failed to open %s for writing", szPath);
+			return false;
+		}
+
+		m_startTime = gEnv->pTimer->GetCurrTime();
+		m_duration = duration;
+		m_time = 0.f;
+
+		CryLogAlways("[StateRecorder] Recording to %s", szPath);
+		return true;
+	}
+
+	void CStateRecorder::Stop()
+	{
+		if (!m_writer.IsOpen())
+		{
+			return;
+		}
+
+		CryLogAlways("[StateRecorder] Recorded %" PRIu64 " samples over %.1f seconds", m_writer.GetSampleCount(), m_time);
+		m_writer.Close();
+	}
+
+	void CStateRecorder::Update()
+	{
+		if (!m_writer.IsOpen())
+		{
+			return;
+		}
+
+		GAME_PROFILE_SCOPE("CStateRecorder::Update");
+
+		m_time = gEnv->pTimer->GetCurrTime() - m_startTime;
+
+		for (const CPlayerComponent* pPlayer : CGamePlugin::GetInstance()->GetPlayerSystem().GetPlayers())
+		{
+			const IEntity& entity = *pPlayer->GetEntity();
+			Write(eStateField_PlayerPosition, kPlayerPositionPolicy, entity.GetId(), entity.GetWorldPos());
+			Write(eStateField_PlayerVelocity, kPlayerVelocityPolicy, entity.GetId(), pPlayer->GetVelocity());
+			// The rotation follows from the replicated input and isn't serialized itself
+			Write(eStateField_PlayerRotation, 0, entity.GetId(), entity.GetWorldRotation());
+		}
+
+		// Bullets and projectiles are simulated on every machine, recording them shows what replicating them would cost
+		const CBulletPool& bulletPool = CGamePlugin::GetInstance()->GetBulletPool();
+		for (size_t i = 0, n = bulletPool.GetActiveCount(); i < n; ++i)
+		{
+			const EntityId bulletId = bulletPool.GetActiveId(i);
+			const IEntity* pBullet = gEnv->pEntitySystem->GetEntity(bulletId);
+			if (pBullet == nullptr)
+			{
+				continue;
+			}
+
+			Write(eStateField_BulletPosition, 0, bulletId, pBullet->GetWorldPos());
+			Write(eStateField_BulletRotation, 0, bulletId, pBullet->GetWorldRotation());
+
+			pe_status_dynamics dynamics;
+			if (IPhysicalEntity* pPhysics = pBullet->GetPhysicalEntity())
+			{
+				if (pPhysics->GetStatus(&dynamics))
+				{
+					Write(eStateField_BulletVelocity, 0, bulletId, dynamics.v);
+				}
+			}
+		}
+
+		const CProjectileStore& projectiles = CGamePlugin::GetInstance()->GetProjectileSystem().GetProjectiles();
+		for (size_t i = 0, n = projectiles.Size(); i < n; ++i)
+		{
+			// Projectiles have no identity, the index is only stable while no projectile before it is removed
+			const EntityId id = static_cast<EntityId>(i);
+			Write(eStateField_ProjectilePosition, 0, id, Vec3(projectiles.GetPositionX(i), projectiles.GetPositionY(i), projectiles.GetPositionZ(i)));
+			Write(eStateField_ProjectileVelocity, 0, id, Vec3(projectiles.GetVelocityX(i), projectiles.GetVelocityY(i), projectiles.GetVelocityZ(i)));
+		}
+
+		if (m_duration > 0.f && m_time >= m_duration)
+		{
+			Stop();
+		}
+	}
+
+	void CStateRecorder::Write(EStateField field, uint32_t policy, EntityId entityId, const Vec3& value)
+	{
+		SStateSample sample;
+		sample.time = m_time;
+		sample.entityId = entityId;
+		sample.field = field;
+		sample.policy = policy;
+		sample.componentCount = 3;
+		sample.values[0] = value.x;
+		sample.values[1] = value.y;
+		sample.values[2] = value.z;
+		m_writer.Write(sample);
+	}
+
+	void CStateRecorder::Write(EStateField field, uint32_t policy, EntityId entityId, const Quat& value)
+	{
+		SStateSample sample;
+		sample.time = m_time;
+		sample.entityId = entityId;
+		sample.field = field;
+		sample.policy = policy;
+		sample.componentCount = 4;
+		sample.values[0] = value.v.x;
+		sample.values[1] = value.v.y;
+		sample.values[2] = value.v.z;
+		sample.values[3] = value.w;
+		m_writer.Write(sample);
+	}
+}
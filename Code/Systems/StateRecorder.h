@@ -0,0 +1,38 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+#pragma once
+
+#include "Core/StateStream.h"
+
+namespace Game
+{
+	////////////////////////////////////////////////////////
+	// Records the replicated state of players, pooled bullets and simulated projectiles every frame
+	// The stream is the input of Tools/CompressionProfiler, which measures the compression policies against it.
+	// Started with net_stateRecord and stopped with net_stateRecordStop or after the requested duration.
+	////////////////////////////////////////////////////////
+	class CStateRecorder
+	{
+	public:
+		CStateRecorder();
+		~CStateRecorder();
+
+		bool Start(const char* szFileName, float duration);
+		void Stop();
+		// Writes this frame's samples while recording
+		void Update();
+
+		bool IsRecording() const { return m_writer.IsOpen(); }
+
+	private:
+		void Write(EStateField field, uint32_t policy, EntityId entityId, const Vec3& value);
+		void Write(EStateField field, uint32_t policy, EntityId entityId, const Quat& value);
+
+	private:
+		CStateStreamWriter m_writer;
+		float m_startTime = 0.f;
+		// Zero records until stopped
+		float m_duration = 0.f;
+		float m_time = 0.f;
+	};
+}
@@ -0,0 +1,890 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+// Measures what the network compression policies cost and how much precision they lose on recorded entity state
+// Usage: CompressionProfiler --policies <CompressionPolicy.xml> (--stream <file> | --synthetic <seconds>)
+//                            [--precision <m>] [--velocityPrecision <m/s>] [--margin <fraction>]
+//                            [--bounds <minX,minY,minZ,maxX,maxY,maxZ>] [--verify]
+// Streams are recorded in the game with net_stateRecord. --synthetic records the headless simulation instead.
+// --verify fails if any policy loses more than half a quantization step on values within its range.
+//
+// Every policy is modeled as fixed rate quantization of each component with the policy's range and bit count.
+// The adaptive policies entropy code their values on top, their bit counts are upper bounds.
+
+#include "Core/GameSimulation.h"
+#include "Core/StateStream.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace
+{
+	////////////////////////////////////////////////////////
+	// Minimal XML reader for the policy files: elements, attributes and comments, no text content or entities
+	////////////////////////////////////////////////////////
+	struct SXmlElement
+	{
+		std::string name;
+		std::map<std::string, std::string> attributes;
+		std::vector<SXmlElement> children;
+
+		const char* GetAttribute(const char* szName) const
+		{
+			const auto it = attributes.find(szName);
+			return it != attributes.end() ? it->second.c_str() : nullptr;
+		}
+
+		const SXmlElement* FindChild(const char* szName) const
+		{
+			for (const SXmlElement& child : children)
+			{
+				if (child.name == szName)
+				{
+					return &child;
+				}
+			}
+			return nullptr;
+		}
+	};
+
+	class CXmlParser
+	{
+	public:
+		explicit CXmlParser(const std::string& text) : m_text(text) {}
+
+		bool Parse(SXmlElement& outRoot)
+		{
+			std::vector<SXmlElement*> stack;
+			bool hasRoot = false;
+
+			while (SkipToTag())
+			{
+				if (Consume("<!--"))
+				{
+					const size_t end = m_text.find("-->", m_position);
+					if (end == std::string::npos)
+					{
+						return false;
+					}
+					m_position = end + 3;
+					continue;
+				}
+
+				if (Consume("<?"))
+				{
+					const size_t end = m_text.find("?>", m_position);
+					if (end == std::string::npos)
+					{
+						return false;
+					}
+					m_position = end + 2;
+					continue;
+				}
+
+				if (Consume("</"))
+				{
+					const std::string name = ReadName();
+					SkipSpace();
+					if (!Consume(">") || stack.empty() || stack.back()->name != name)
+					{
+						return false;
+					}
+					stack.pop_back();
+					continue;
+				}
+
+				++m_position;
+				SXmlElement element;
+				element.name = ReadName();
+				if (element.name.empty())
+				{
+					return false;
+				}
+
+				bool isClosed = false;
+				for (;;)
+				{
+					SkipSpace();
+					if (Consume("/>"))
+					{
+						isClosed = true;
+						break;
+					}
+					if (Consume(">"))
+					{
+						break;
+					}
+
+					const std::string attributeName = ReadName();
+					SkipSpace();
+					if (attributeName.empty() || !Consume("="))
+					{
+						return false;
+					}
+					SkipSpace();
+
+					const char quote = m_position < m_text.size() ? m_text[m_position] : '\0';
+					if (quote != '"' && quote != '\'')
+					{
+						return false;
+					}
+					const size_t end = m_text.find(quote, m_position + 1);
+					if (end == std::string::npos)
+					{
+						return false;
+					}
+					element.attributes[attributeName] = m_text.substr(m_position + 1, end - m_position - 1);
+					m_position = end + 1;
+				}
+
+				SXmlElement* pElement;
+				if (stack.empty())
+				{
+					if (hasRoot)
+					{
+						return false;
+					}
+					outRoot = std::move(element);
+					pElement = &outRoot;
+					hasRoot = true;
+				}
+				else
+				{
+					stack.back()->children.push_back(std::move(element));
+					pElement = &stack.back()->children.back();
+				}
+
+				if (!isClosed)
+				{
+					stack.push_back(pElement);
+				}
+			}
+
+			return hasRoot && stack.empty();
+		}
+
+	private:
+		bool SkipToTag()
+		{
+			m_position = m_text.find('<', m_position);
+			return m_position != std::string::npos;
+		}
+
+		void SkipSpace()
+		{
+			while (m_position < m_text.size() && (m_text[m_position] == ' ' || m_text[m_position] == '\t' || m_text[m_position] == '\r' || m_text[m_position] == '\n'))
+			{
+				++m_position;
+			}
+		}
+
+		bool Consume(const char* szToken)
+		{
+			const size_t length = strlen(szToken);
+			if (m_text.compare(m_position, length, szToken) == 0)
+			{
+				m_position += length;
+				return true;
+			}
+			return false;
+		}
+
+		std::string ReadName()
+		{
+			const size_t start = m_position;
+			while (m_position < m_text.size() && (isalnum(static_cast<unsigned char>(m_text[m_position])) || m_text[m_position] == '_' || m_text[m_position] == '-' || m_text[m_position] == ':'))
+			{
+				++m_position;
+			}
+			return m_text.substr(start, m_position - start);
+		}
+
+	private:
+		const std::string& m_text;
+		size_t m_position = 0;
+	};
+
+	////////////////////////////////////////////////////////
+	// Policies
+	////////////////////////////////////////////////////////
+	enum class EPolicyKind
+	{
+		Vector,
+		UnitVector,
+		Orientation,
+		Scalar,
+		Integer,
+		Unsupported
+	};
+
+	struct SAxis
+	{
+		float min = 0.f;
+		float max = 1.f;
+		uint32_t bitCount = 0;
+		bool isTruncating = false;
+
+		// Quantized and reconstructed value, outIsClipped is set for values outside the range
+		double Quantize(float value, bool& outIsClipped) const
+		{
+			const double steps = std::ldexp(1.0, static_cast<int>(bitCount)) - 1.0;
+			const double normalized = (static_cast<double>(value) - min) / (static_cast<double>(max) - min);
+			outIsClipped = outIsClipped || normalized < 0.0 || normalized > 1.0;
+
+			double quantized = isTruncating ? std::floor(normalized * steps) : std::floor(normalized * steps + 0.5);
+			quantized = std::min(std::max(quantized, 0.0), steps);
+			return min + quantized / steps * (static_cast<double>(max) - min);
+		}
+
+		double GetStep() const { return (static_cast<double>(max) - min) / (std::ldexp(1.0, static_cast<int>(bitCount)) - 1.0); }
+	};
+
+	struct SPolicy
+	{
+		std::string name;
+		std::string impl;
+		EPolicyKind kind = EPolicyKind::Unsupported;
+		SAxis axes[4];
+		uint32_t componentCount = 0;
+
+		bool IsAdaptive() const { return impl.compare(0, 8, "Adaptive") == 0; }
+
+		uint32_t GetBitCount() const
+		{
+			uint32_t bits = 0;
+			for (uint32_t i = 0; i < componentCount; ++i)
+			{
+				bits += axes[i].bitCount;
+			}
+			return bits;
+		}
+
+		bool IsCompatible(const Game::SStateSample& sample) const
+		{
+			switch (kind)
+			{
+			// None of the recorded fields is a direction, unit vectors are only listed
+			case EPolicyKind::Vector:
+				return sample.componentCount == 3 && sample.field != Game::eStateField_PlayerRotation && sample.field != Game::eStateField_BulletRotation;
+			case EPolicyKind::Orientation:
+				return sample.componentCount == 4;
+			default:
+				return false;
+			}
+		}
+	};
+
+	bool ReadAxis(const SXmlElement* pParams, SAxis& outAxis)
+	{
+		if (pParams == nullptr || pParams->GetAttribute("min") == nullptr || pParams->GetAttribute("max") == nullptr || pParams->GetAttribute("nbits") == nullptr)
+		{
+			return false;
+		}
+
+		outAxis.min = static_cast<float>(atof(pParams->GetAttribute("min")));
+		outAxis.max = static_cast<float>(atof(pParams->GetAttribute("max")));
+		outAxis.bitCount = static_cast<uint32_t>(std::max(1, std::min(32, atoi(pParams->GetAttribute("nbits")))));
+
+		const char* szQuantization = pParams->GetAttribute("quantization");
+		outAxis.isTruncating = szQuantization != nullptr && strncmp(szQuantization, "Truncate", 8) == 0;
+		return outAxis.max > outAxis.min;
+	}
+
+	SPolicy ReadPolicy(const SXmlElement& element)
+	{
+		SPolicy policy;
+		policy.name = element.GetAttribute("name") != nullptr ? element.GetAttribute("name") : "";
+		policy.impl = element.GetAttribute("impl") != nullptr ? element.GetAttribute("impl") : "";
+
+		const std::string& impl = policy.impl;
+		if (impl == "QuantizedVec3" || impl == "AdaptiveVec3")
+		{
+			const bool isValid = ReadAxis(element.FindChild("XParams"), policy.axes[0]) && ReadAxis(element.FindChild("YParams"), policy.axes[1]) && ReadAxis(element.FindChild("ZParams"), policy.axes[2]);
+			policy.kind = isValid ? EPolicyKind::Vector : EPolicyKind::Unsupported;
+			policy.componentCount = 3;
+		}
+		else if (impl == "Velocity" || impl == "AdaptiveUnitVec3" || impl == "AdaptiveOrientation")
+		{
+			policy.componentCount = impl == "AdaptiveOrientation" ? 4 : 3;
+			bool isValid = ReadAxis(element.FindChild("Params"), policy.axes[0]);
+			for (uint32_t i = 1; i < policy.componentCount; ++i)
+			{
+				policy.axes[i] = policy.axes[0];
+			}
+
+			const EPolicyKind kind = impl == "Velocity" ? EPolicyKind::Vector : (impl == "AdaptiveUnitVec3" ? EPolicyKind::UnitVector : EPolicyKind::Orientation);
+			policy.kind = isValid ? kind : EPolicyKind::Unsupported;
+		}
+		else if (impl == "FloatAsInt" || impl == "AdaptiveFloat" || impl == "Jumpy")
+		{
+			policy.componentCount = 1;
+			policy.kind = ReadAxis(element.FindChild("Params"), policy.axes[0]) ? EPolicyKind::Scalar : EPolicyKind::Unsupported;
+		}
+		else if (impl == "RangedInt" || impl == "RangedUnsignedInt")
+		{
+			const SXmlElement* pRange = element.FindChild("Range");
+			if (pRange != nullptr && pRange->GetAttribute("min") != nullptr && pRange->GetAttribute("max") != nullptr)
+			{
+				const double range = atof(pRange->GetAttribute("max")) - atof(pRange->GetAttribute("min"));
+				policy.axes[0].bitCount = range > 0.0 ? static_cast<uint32_t>(std::ceil(std::log2(range + 1.0))) : 0;
+				policy.componentCount = 1;
+				policy.kind = EPolicyKind::Integer;
+			}
+		}
+
+		return policy;
+	}
+
+	bool LoadPolicies(const char* szPath, std::vector<SPolicy>& outPolicies, std::map<std::string, std::string>& outAliases)
+	{
+		std::FILE* pFile = std::fopen(szPath, "rb");
+		if (pFile == nullptr)
+		{
+			return false;
+		}
+
+		std::string text;
+		char buffer[4096];
+		size_t count;
+		while ((count = std::fread(buffer, 1, sizeof(buffer), pFile)) > 0)
+		{
+			text.append(buffer, count);
+		}
+		std::fclose(pFile);
+
+		SXmlElement root;
+		if (!CXmlParser(text).Parse(root) || root.name != "CompressionPolicy")
+		{
+			return false;
+		}
+
+		for (const SXmlElement& element : root.children)
+		{
+			if (element.name == "Policy")
+			{
+				outPolicies.push_back(ReadPolicy(element));
+			}
+			else if (element.name == "Alias" && element.GetAttribute("name") != nullptr && element.GetAttribute("is") != nullptr)
+			{
+				outAliases[element.GetAttribute("name")] = element.GetAttribute("is");
+			}
+		}
+
+		return true;
+	}
+
+	const SPolicy* FindPolicy(const std::vector<SPolicy>& policies, const std::map<std::string, std::string>& aliases, std::string name)
+	{
+		// Aliases may refer to aliases, give up on cycles
+		for (int depth = 0; depth < 8; ++depth)
+		{
+			const auto it = aliases.find(name);
+			if (it == aliases.end())
+			{
+				break;
+			}
+			name = it->second;
+		}
+
+		for (const SPolicy& policy : policies)
+		{
+			if (policy.name == name)
+			{
+				return &policy;
+			}
+		}
+		return nullptr;
+	}
+
+	////////////////////////////////////////////////////////
+	// Recorded fields
+	////////////////////////////////////////////////////////
+	struct SFieldValues
+	{
+		Game::EStateField field;
+		uint32_t policy = 0;
+		uint32_t componentCount = 0;
+		std::vector<Game::SStateSample> samples;
+		float firstTime = 0.f;
+		float lastTime = 0.f;
+	};
+
+	void AddSample(std::vector<SFieldValues>& fields, const Game::SStateSample& sample)
+	{
+		auto it = std::find_if(fields.begin(), fields.end(), [&sample](const SFieldValues& values) { return values.field == sample.field; });
+		if (it == fields.end())
+		{
+			SFieldValues values;
+			values.field = sample.field;
+			values.policy = sample.policy;
+			values.componentCount = sample.componentCount;
+			values.firstTime = sample.time;
+			fields.push_back(values);
+			it = fields.end() - 1;
+		}
+
+		it->firstTime = std::min(it->firstTime, sample.time);
+		it->lastTime = std::max(it->lastTime, sample.time);
+		it->samples.push_back(sample);
+	}
+
+	bool LoadStream(const char* szPath, std::vector<SFieldValues>& outFields)
+	{
+		Game::CStateStreamReader reader;
+		if (!reader.Open(szPath))
+		{
+			return false;
+		}
+
+		Game::SStateSample sample;
+		while (reader.Read(sample))
+		{
+			AddSample(outFields, sample);
+		}
+		return true;
+	}
+
+	// The same fields as net_stateRecord, taken from the headless match
+	void RecordSynthetic(float seconds, std::vector<SFieldValues>& outFields)
+	{
+		Game::SGameSimulationParams params;
+		Game::CGameSimulation simulation(params);
+
+		// Terrain coordinates start at zero, the simulated arena is centered on the origin
+		const Game::SVec3f offset(params.arenaSize * 0.5f + 16.f, params.arenaSize * 0.5f + 16.f, 32.f);
+		const uint64_t ticks = static_cast<uint64_t>(seconds * params.tickRate);
+
+		const auto makeSample = [](float time, uint32_t id, Game::EStateField field, uint32_t policy, const Game::SVec3f& value)
+		{
+			Game::SStateSample sample;
+			sample.time = time;
+			sample.entityId = id;
+			sample.field = field;
+			sample.policy = policy;
+			sample.componentCount = 3;
+			sample.values[0] = value.x;
+			sample.values[1] = value.y;
+			sample.values[2] = value.z;
+			return sample;
+		};
+
+		for (uint64_t tick = 0; tick < ticks; ++tick)
+		{
+			simulation.Tick();
+			const float time = simulation.GetTime();
+
+			for (uint32_t i = 0; i < simulation.GetPlayerCount(); ++i)
+			{
+				const Game::SPlayerMovementState& movement = simulation.GetPlayerMovement(i);
+				AddSample(outFields, makeSample(time, i, Game::eStateField_PlayerPosition, Game::MakeStateTag('w', 'r', 'l', 'd'), movement.position + offset));
+				AddSample(outFields, makeSample(time, i, Game::eStateField_PlayerVelocity, Game::MakeStateTag('v', 'e', 'l', '0'), movement.velocity));
+
+				const float halfYaw = simulation.GetPlayerYaw(i) * 0.5f;
+				Game::SStateSample rotation;
+				rotation.time = time;
+				rotation.entityId = i;
+				rotation.field = Game::eStateField_PlayerRotation;
+				rotation.componentCount = 4;
+				rotation.values[2] = std::sin(halfYaw);
+				rotation.values[3] = std::cos(halfYaw);
+				AddSample(outFields, rotation);
+			}
+
+			const Game::CProjectileStore& projectiles = simulation.GetProjectiles();
+			for (size_t i = 0; i < projectiles.Size(); ++i)
+			{
+				const Game::SVec3f position(projectiles.GetPositionX(i), projectiles.GetPositionY(i), projectiles.GetPositionZ(i));
+				const Game::SVec3f velocity(projectiles.GetVelocityX(i), projectiles.GetVelocityY(i), projectiles.GetVelocityZ(i));
+				AddSample(outFields, makeSample(time, static_cast<uint32_t>(i), Game::eStateField_ProjectilePosition, 0, position + offset));
+				AddSample(outFields, makeSample(time, static_cast<uint32_t>(i), Game::eStateField_ProjectileVelocity, 0, velocity));
+			}
+		}
+	}
+
+	////////////////////////////////////////////////////////
+	// Measurement
+	////////////////////////////////////////////////////////
+	// Error buckets by order of magnitude, the last one also collects clipped values
+	constexpr int kHistogramBuckets = 8;
+	constexpr double kHistogramFirstLimit = 1e-5;
+
+	struct SPolicyResult
+	{
+		const SPolicy* pPolicy = nullptr;
+		double maxError = 0.0;
+		double squaredErrorSum = 0.0;
+		uint64_t clippedCount = 0;
+		// Largest error of a value within the policy's range relative to half a step, above one means a broken model
+		double maxInRangeErrorRatio = 0.0;
+		uint64_t histogram[kHistogramBuckets] = {};
+	};
+
+	double MeasureError(const SPolicy& policy, const Game::SStateSample& sample, bool& outIsClipped, double& outInRangeRatio)
+	{
+		outIsClipped = false;
+		outInRangeRatio = 0.0;
+
+		if (policy.kind == EPolicyKind::Orientation)
+		{
+			double quantized[4];
+			double length = 0.0;
+			double dot = 0.0;
+			for (uint32_t i = 0; i < 4; ++i)
+			{
+				quantized[i] = policy.axes[i].Quantize(sample.values[i], outIsClipped);
+				length += quantized[i] * quantized[i];
+			}
+			length = std::sqrt(length);
+			for (uint32_t i = 0; i < 4; ++i)
+			{
+				dot += sample.values[i] * (length > 0.0 ? quantized[i] / length : 0.0);
+			}
+
+			// Angle between the orientations in degrees
+			return 2.0 * std::acos(std::min(1.0, std::fabs(dot))) * 180.0 / 3.14159265358979323846;
+		}
+
+		double squaredError = 0.0;
+		for (uint32_t i = 0; i < policy.componentCount; ++i)
+		{
+			bool isClipped = false;
+			const double error = policy.axes[i].Quantize(sample.values[i], isClipped) - sample.values[i];
+			squaredError += error * error;
+
+			const double maxError = policy.axes[i].GetStep() * (policy.axes[i].isTruncating ? 1.0 : 0.5);
+			if (!isClipped && maxError > 0.0)
+			{
+				outInRangeRatio = std::max(outInRangeRatio, std::fabs(error) / maxError);
+			}
+			outIsClipped = outIsClipped || isClipped;
+		}
+		return std::sqrt(squaredError);
+	}
+
+	SPolicyResult Measure(const SPolicy& policy, const SFieldValues& values)
+	{
+		SPolicyResult result;
+		result.pPolicy = &policy;
+
+		for (const Game::SStateSample& sample : values.samples)
+		{
+			bool isClipped;
+			double inRangeRatio;
+			const double error = MeasureError(policy, sample, isClipped, inRangeRatio);
+
+			result.maxError = std::max(result.maxError, error);
+			result.squaredErrorSum += error * error;
+			result.maxInRangeErrorRatio = std::max(result.maxInRangeErrorRatio, inRangeRatio);
+
+			int bucket = 0;
+			for (double limit = kHistogramFirstLimit; bucket < kHistogramBuckets - 1 && error >= limit; limit *= 10.0)
+			{
+				++bucket;
+			}
+			if (isClipped)
+			{
+				++result.clippedCount;
+				bucket = kHistogramBuckets - 1;
+			}
+			++result.histogram[bucket];
+		}
+
+		return result;
+	}
+
+	// Smallest bit count whose rounding error stays within precision
+	uint32_t GetRequiredBitCount(float min, float max, float precision)
+	{
+		const double steps = (static_cast<double>(max) - min) / (2.0 * precision);
+		return static_cast<uint32_t>(std::max(1.0, std::ceil(std::log2(steps + 1.0))));
+	}
+
+	struct SOptions
+	{
+		const char* szPolicyPath = nullptr;
+		const char* szStreamPath = nullptr;
+		float syntheticSeconds = 0.f;
+		float precision = 0.01f;
+		float velocityPrecision = 0.05f;
+		float margin = 0.05f;
+		// Level bounds for the position proposals instead of the recorded range
+		bool hasBounds = false;
+		float boundsMin[3] = {};
+		float boundsMax[3] = {};
+		bool verify = false;
+	};
+
+	bool ParseOptions(int argc, char** argv, SOptions& outOptions)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			const char* szArgument = argv[i];
+			const char* szValue = i + 1 < argc ? argv[i + 1] : nullptr;
+
+			if (strcmp(szArgument, "--verify") == 0)
+			{
+				outOptions.verify = true;
+				continue;
+			}
+
+			if (szValue == nullptr)
+			{
+				return false;
+			}
+
+			if (strcmp(szArgument, "--policies") == 0)
+			{
+				outOptions.szPolicyPath = szValue;
+			}
+			else if (strcmp(szArgument, "--stream") == 0)
+			{
+				outOptions.szStreamPath = szValue;
+			}
+			else if (strcmp(szArgument, "--synthetic") == 0)
+			{
+				outOptions.syntheticSeconds = std::max(0.1f, static_cast<float>(atof(szValue)));
+			}
+			else if (strcmp(szArgument, "--precision") == 0)
+			{
+				outOptions.precision = std::max(1e-6f, static_cast<float>(atof(szValue)));
+			}
+			else if (strcmp(szArgument, "--velocityPrecision") == 0)
+			{
+				outOptions.velocityPrecision = std::max(1e-6f, static_cast<float>(atof(szValue)));
+			}
+			else if (strcmp(szArgument, "--margin") == 0)
+			{
+				outOptions.margin = std::max(0.f, static_cast<float>(atof(szValue)));
+			}
+			else if (strcmp(szArgument, "--bounds") == 0)
+			{
+				float* pBounds[6] = { &outOptions.boundsMin[0], &outOptions.boundsMin[1], &outOptions.boundsMin[2], &outOptions.boundsMax[0], &outOptions.boundsMax[1], &outOptions.boundsMax[2] };
+				if (sscanf(szValue, "%f,%f,%f,%f,%f,%f", pBounds[0], pBounds[1], pBounds[2], pBounds[3], pBounds[4], pBounds[5]) != 6)
+				{
+					return false;
+				}
+				outOptions.hasBounds = true;
+			}
+			else
+			{
+				return false;
+			}
+			++i;
+		}
+
+		return outOptions.szPolicyPath != nullptr && (outOptions.szStreamPath != nullptr || outOptions.syntheticSeconds > 0.f);
+	}
+
+	bool IsVelocityField(Game::EStateField field)
+	{
+		return field == Game::eStateField_PlayerVelocity || field == Game::eStateField_BulletVelocity || field == Game::eStateField_ProjectileVelocity;
+	}
+
+	// Range of the recorded values or level bounds plus the margin, and the bits it needs for the target precision
+	// Velocities keep one symmetric range for all axes, as the Velocity policies do.
+	void ReportProposal(const SFieldValues& values, const SPolicy* pCurrentPolicy, const SOptions& options)
+	{
+		if (values.componentCount != 3)
+		{
+			return;
+		}
+
+		const bool isVelocity = IsVelocityField(values.field);
+		const bool useBounds = options.hasBounds && !isVelocity;
+
+		float min[3] = { values.samples[0].values[0], values.samples[0].values[1], values.samples[0].values[2] };
+		float max[3] = { min[0], min[1], min[2] };
+		for (const Game::SStateSample& sample : values.samples)
+		{
+			for (int i = 0; i < 3; ++i)
+			{
+				min[i] = std::min(min[i], sample.values[i]);
+				max[i] = std::max(max[i], sample.values[i]);
+			}
+		}
+
+		if (useBounds)
+		{
+			std::copy(options.boundsMin, options.boundsMin + 3, min);
+			std::copy(options.boundsMax, options.boundsMax + 3, max);
+		}
+
+		const float precision = isVelocity ? options.velocityPrecision : options.precision;
+
+		char name[5];
+		Game::GetStateTagName(values.field, name);
+		printf("  Proposal for %s within %g%s (%.0f%% margin on the %s):\n", name, precision, isVelocity ? " m/s" : " m", options.margin * 100.f, useBounds ? "level bounds" : "recorded range");
+
+		uint32_t totalBits = 0;
+		if (isVelocity)
+		{
+			float limit = 0.f;
+			for (int i = 0; i < 3; ++i)
+			{
+				limit = std::max(limit, std::max(std::fabs(min[i]), std::fabs(max[i])));
+			}
+			limit = std::ceil(limit + std::max(limit * options.margin, precision));
+
+			const uint32_t bits = GetRequiredBitCount(-limit, limit, precision);
+			totalBits = bits * 3;
+			printf("    <Policy name=\"%s\" impl=\"Velocity\">\n", pCurrentPolicy != nullptr ? pCurrentPolicy->name.c_str() : name);
+			printf("      <Params min=\"%g\" max=\"%g\" nbits=\"%u\"/>\n", -limit, limit, bits);
+		}
+		else
+		{
+			const char* axisNames[3] = { "XParams", "YParams", "ZParams" };
+			printf("    <Policy name=\"%s\" impl=\"QuantizedVec3\">\n", pCurrentPolicy != nullptr ? pCurrentPolicy->name.c_str() : name);
+
+			for (int i = 0; i < 3; ++i)
+			{
+				const float padding = std::max((max[i] - min[i]) * options.margin, precision);
+				// Whole units keep the XML readable and the range stable between recordings
+				const float proposedMin = std::floor(min[i] - padding);
+				const float proposedMax = std::ceil(max[i] + padding);
+				const uint32_t bits = GetRequiredBitCount(proposedMin, proposedMax, precision);
+				totalBits += bits;
+				printf("      <%s min=\"%g\" max=\"%g\" nbits=\"%u\"/>\n", axisNames[i], proposedMin, proposedMax, bits);
+			}
+		}
+
+		printf("    </Policy>\n");
+		if (pCurrentPolicy != nullptr)
+		{
+			printf("    %u bits instead of %u\n", totalBits, pCurrentPolicy->GetBitCount());
+		}
+	}
+
+	void ReportField(const SFieldValues& values, const std::vector<SPolicy>& policies, const std::map<std::string, std::string>& aliases, const SOptions& options, bool& inOutIsValid)
+	{
+		char name[5];
+		char policyName[5];
+		Game::GetStateTagName(values.field, name);
+		const double duration = std::max(1e-3, static_cast<double>(values.lastTime - values.firstTime));
+		const double samplesPerSecond = static_cast<double>(values.samples.size()) / duration;
+
+		const SPolicy* pCurrentPolicy = values.policy != 0 ? FindPolicy(policies, aliases, Game::GetStateTagName(values.policy, policyName)) : nullptr;
+
+		printf("\n[CompressionProfiler] %s: %zu samples over %.1f s, %s\n", name, values.samples.size(), duration,
+			pCurrentPolicy != nullptr ? ("serialized as '" + pCurrentPolicy->name + "'").c_str() : "not replicated");
+		printf("  %-5s %-20s %5s %9s %12s %12s %8s  error histogram (<1e-5 ... >=0.1, clipped)\n", "", "impl", "bits", "kbit/s", "max error", "rms error", "clipped");
+
+		std::vector<SPolicyResult> results;
+		for (const SPolicy& policy : policies)
+		{
+			if (policy.IsCompatible(values.samples.front()))
+			{
+				results.push_back(Measure(policy, values));
+			}
+		}
+
+		// Cheapest first
+		std::sort(results.begin(), results.end(), [](const SPolicyResult& a, const SPolicyResult& b)
+		{
+			return a.pPolicy->GetBitCount() != b.pPolicy->GetBitCount() ? a.pPolicy->GetBitCount() < b.pPolicy->GetBitCount() : a.pPolicy->name < b.pPolicy->name;
+		});
+
+		const double sampleCount = static_cast<double>(values.samples.size());
+		for (const SPolicyResult& result : results)
+		{
+			const SPolicy& policy = *result.pPolicy;
+			const uint32_t bits = policy.GetBitCount();
+
+			printf("%s %-5s %-20s %4u%s %9.1f %12.6f %12.6f %7.2f%% ", &policy == pCurrentPolicy ? " *" : "  ", policy.name.c_str(), policy.impl.c_str(), bits, policy.IsAdaptive() ? "<" : " ",
+				static_cast<double>(bits) * samplesPerSecond / 1000.0, result.maxError, std::sqrt(result.squaredErrorSum / sampleCount), 100.0 * static_cast<double>(result.clippedCount) / sampleCount);
+			for (int i = 0; i < kHistogramBuckets; ++i)
+			{
+				printf(" %5.1f", 100.0 * static_cast<double>(result.histogram[i]) / sampleCount);
+			}
+			printf("\n");
+
+			if (result.maxInRangeErrorRatio > 1.0001)
+			{
+				printf("  Error of '%s' exceeds half a quantization step by %.2fx\n", policy.name.c_str(), result.maxInRangeErrorRatio);
+				inOutIsValid = false;
+			}
+		}
+
+		if (values.policy != 0 && pCurrentPolicy == nullptr)
+		{
+			printf("  Policy '%s' is not defined in the policy file\n", policyName);
+		}
+
+		ReportProposal(values, pCurrentPolicy, options);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	SOptions options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		printf("Usage: %s --policies <CompressionPolicy.xml> (--stream <file> | --synthetic <seconds>) [--precision m] [--velocityPrecision m/s] [--margin fraction] [--bounds minX,minY,minZ,maxX,maxY,maxZ] [--verify]\n", argv[0]);
+		return 2;
+	}
+
+	std::vector<SPolicy> policies;
+	std::map<std::string, std::string> aliases;
+	if (!LoadPolicies(options.szPolicyPath, policies, aliases))
+	{
+		printf("[CompressionProfiler] Failed to read %s\n", options.szPolicyPath);
+		return 1;
+	}
+
+	std::map<std::string, size_t> implCounts;
+	size_t supportedCount = 0;
+	for (const SPolicy& policy : policies)
+	{
+		++implCounts[policy.impl];
+		supportedCount += policy.kind != EPolicyKind::Unsupported ? 1 : 0;
+	}
+
+	printf("[CompressionProfiler] %zu policies and %zu aliases in %s, %zu with a quantization model\n", policies.size(), aliases.size(), options.szPolicyPath, supportedCount);
+	for (const auto& implCount : implCounts)
+	{
+		printf("  %-20s %zu\n", implCount.first.c_str(), implCount.second);
+	}
+
+	std::vector<SFieldValues> fields;
+	if (options.szStreamPath != nullptr)
+	{
+		if (!LoadStream(options.szStreamPath, fields))
+		{
+			printf("[CompressionProfiler] Failed to read state stream %s\n", options.szStreamPath);
+			return 1;
+		}
+	}
+	else
+	{
+		RecordSynthetic(options.syntheticSeconds, fields);
+	}
+
+	if (fields.empty())
+	{
+		printf("[CompressionProfiler] The state stream is empty\n");
+		return 1;
+	}
+
+	// '*' marks the policy the field is serialized with, '<' an upper bound of an adaptive policy
+	bool isValid = true;
+	for (const SFieldValues& values : fields)
+	{
+		ReportField(values, policies, aliases, options, isValid);
+	}
+
+	if (options.verify)
+	{
+		if (!isValid)
+		{
+			printf("\n[CompressionProfiler] Verification failed\n");
+			return 1;
+		}
+		printf("\n[CompressionProfiler] All policies within half a quantization step on in-range values\n");
+	}
+
+	return 0;
+}
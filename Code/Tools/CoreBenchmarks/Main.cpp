@@ -0,0 +1,1066 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+// Measures the engine independent gameplay cores in isolation
+// Usage: CoreBenchmarks [--iterations N] [benchmark...]
+// Runs the named benchmarks, or all of them without a name, and fails if one of them finds its results wrong.
+//   projectiles      integration of 1k, 10k and 100k live rounds, with the SIMD kernel of this build and the scalar one
+//   inputCodec       input packets of 64 players at 60 Hz over a lossy link, every decoded command checked
+//   inputCodecFuzz   decoding of truncated, random and bit flipped packets, which has to fail or stay in range
+//   lagCompensation  recording one second of hitbox poses for 64 players, then rewinding and ray testing all of them
+//   spatialGrid      radius, k-nearest and ray queries of the grid against brute force at 1k, 10k and 100k objects
+//   playerBatch      per-entity player update through virtual calls against the batched update, at 16, 64 and 256 players
+//   lookRotation     camera rotation of 256 players through quaternion, matrix and angle conversions against yaw/pitch
+
+#include "Core/HitboxHistory.h"
+#include "Core/InputCommandCodec.h"
+#include "Core/PlayerBatch.h"
+#include "Core/ProjectileStore.h"
+#include "Core/SequenceBuffer.h"
+#include "Core/SpatialGrid.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace
+{
+	struct SOptions
+	{
+		int iterations = 100;
+		std::vector<const char*> benchmarks;
+	};
+
+	bool ParseOptions(int argc, char** argv, SOptions& outOptions)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			const char* szArgument = argv[i];
+			const char* szValue = i + 1 < argc ? argv[i + 1] : nullptr;
+
+			if (strcmp(szArgument, "--iterations") == 0 && szValue != nullptr)
+			{
+				outOptions.iterations = std::max(1, atoi(szValue));
+				++i;
+				continue;
+			}
+
+			if (strncmp(szArgument, "--", 2) == 0)
+			{
+				return false;
+			}
+
+			outOptions.benchmarks.push_back(szArgument);
+		}
+
+		return true;
+	}
+
+	double GetNanoseconds(std::chrono::steady_clock::time_point start)
+	{
+		const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+		return elapsed.count();
+	}
+
+	// Measures the integration kernels without ray queries, and checks that both move the rounds the same way
+	bool BenchmarkProjectiles(const SOptions& options)
+	{
+#if defined(GAME_PROJECTILE_STORE_AVX)
+		const char* szKernel = "AVX";
+#elif defined(GAME_PROJECTILE_STORE_SSE)
+		const char* szKernel = "SSE2";
+#else
+		const char* szKernel = "scalar";
+#endif
+
+		bool isPassed = true;
+		for (const std::size_t projectileCount : { std::size_t(1000), std::size_t(10000), std::size_t(100000) })
+		{
+			Game::CProjectileStore vectorizedStore;
+			Game::CProjectileStore scalarStore;
+			for (Game::CProjectileStore* pStore : { &vectorizedStore, &scalarStore })
+			{
+				pStore->Reserve(projectileCount);
+				for (std::size_t i = 0; i < projectileCount; ++i)
+				{
+					const float offset = static_cast<float>(i);
+					pStore->Add(offset, 0.f, 100.f, 0.f, 1000.f, offset * 0.001f, 5.f, static_cast<uint32_t>(i));
+				}
+			}
+
+			const auto measure = [&](auto&& integrate)
+			{
+				const auto start = std::chrono::steady_clock::now();
+				for (int i = 0; i < options.iterations; ++i)
+				{
+					integrate(1.f / 60.f, 0.f, 0.f, -9.81f);
+				}
+				return GetNanoseconds(start) / static_cast<double>(options.iterations * projectileCount);
+			};
+
+			const double vectorizedNs = measure([&](float dt, float gx, float gy, float gz) { vectorizedStore.Integrate(dt, gx, gy, gz); });
+			const double scalarNs = measure([&](float dt, float gx, float gy, float gz) { scalarStore.IntegrateScalar(dt, gx, gy, gz); });
+
+			printf("[CoreBenchmarks] Projectiles: %6zu live rounds, %s %.3f ns/projectile, scalar %.3f ns/projectile\n", projectileCount, szKernel, vectorizedNs, scalarNs);
+
+			// Same operations in the same order, only the rounding of fused operations may differ
+			float maxDifference = 0.f;
+			for (std::size_t i = 0; i < projectileCount; ++i)
+			{
+				maxDifference = std::fmax(maxDifference, std::fabs(vectorizedStore.GetPositionZ(i) - scalarStore.GetPositionZ(i)));
+				maxDifference = std::fmax(maxDifference, std::fabs(vectorizedStore.GetPositionY(i) - scalarStore.GetPositionY(i)));
+			}
+			if (maxDifference > 0.01f)
+			{
+				printf("[CoreBenchmarks] Projectiles: the %s kernel ended %.4f m away from the scalar one\n", szKernel, maxDifference);
+				isPassed = false;
+			}
+		}
+
+		return isPassed;
+	}
+
+
+	// Mouse look drifts by small steps and movement keys change every few ticks, like a player in a match
+	void GenerateInput(Game::SPlayerInputCommand& input, std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> lookDelta(-0.02f, 0.02f);
+		std::uniform_int_distribution<int> axis(-1, 1);
+		std::uniform_int_distribution<int> chance(0, 99);
+
+		input.yaw += lookDelta(random);
+		input.yaw = input.yaw > Game::kPi ? input.yaw - 2.f * Game::kPi : (input.yaw < -Game::kPi ? input.yaw + 2.f * Game::kPi : input.yaw);
+		input.pitch = Game::ClampValue(input.pitch + lookDelta(random) * 0.5f, -Game::kPi * 0.5f, Game::kPi * 0.5f);
+
+		if (chance(random) < 10)
+		{
+			input.moveX = static_cast<float>(axis(random));
+			input.moveY = static_cast<float>(axis(random));
+		}
+
+		if (chance(random) < 20)
+		{
+			input.flags ^= Game::ePlayerInputFlag_Walk;
+		}
+
+		input.flags = static_cast<uint8_t>(chance(random) < 2 ? (input.flags | Game::ePlayerInputFlag_Jump) : (input.flags & ~Game::ePlayerInputFlag_Jump));
+	}
+
+	bool IsSameCommand(const Game::SPlayerInputCommand& a, const Game::SPlayerInputCommand& b)
+	{
+		return a.sequence == b.sequence && a.moveX == b.moveX && a.moveY == b.moveY && a.yaw == b.yaw && a.pitch == b.pitch && a.flags == b.flags;
+	}
+
+	// Simulated input of one remote player: a sender with its history and a receiver with everything that arrived
+	struct SCodecPlayer
+	{
+		Game::CSequenceBuffer<Game::SPlayerInputCommand, 128> sentCommands;
+		Game::CSequenceBuffer<Game::SPlayerInputCommand, 128> receivedCommands;
+		Game::SPlayerInputCommand input;
+		uint32_t lastReceivedSequence = 0;
+	};
+
+	// 10 s of input with 5 % packet loss and the default g_inputRedundancy of 3, every decoded command has to match the sent one
+	bool BenchmarkInputCodec(const SOptions&)
+	{
+		namespace Codec = Game::InputCommandCodec;
+
+		constexpr std::size_t playerCount = 64;
+		constexpr uint32_t tickRate = 60;
+		constexpr uint32_t tickCount = 10 * tickRate;
+		constexpr uint32_t redundancy = 3;
+		constexpr int lossPercent = 5;
+
+		std::mt19937 random(1234);
+		std::uniform_int_distribution<int> lossRoll(0, 99);
+
+		std::vector<SCodecPlayer> players(playerCount);
+
+		std::size_t totalBytes = 0;
+		std::size_t encodedCommands = 0;
+		std::size_t decodedCommands = 0;
+		std::size_t droppedPackets = 0;
+		std::size_t undecodablePackets = 0;
+		std::size_t mismatches = 0;
+		double encodeNs = 0.0;
+		double decodeNs = 0.0;
+
+		for (uint32_t sequence = 1; sequence <= tickCount; ++sequence)
+		{
+			for (SCodecPlayer& player : players)
+			{
+				GenerateInput(player.input, random);
+				player.input.sequence = sequence;
+				player.sentCommands.Insert(sequence, Codec::RoundTripCommand(player.input));
+
+				// The receiver acknowledges the newest command it has, as CPlayerComponent does through kMovementAspect
+				const uint32_t firstSequence = sequence + 1 - std::min(redundancy, sequence - player.lastReceivedSequence);
+				Game::SPlayerInputCommand commands[Codec::kMaxCommandsPerPacket];
+				uint32_t count = 0;
+				for (uint32_t i = firstSequence; i <= sequence; ++i)
+				{
+					commands[count++] = *player.sentCommands.Find(i);
+				}
+
+				uint8_t buffer[Codec::kMaxPacketBytes];
+				const auto encodeStart = std::chrono::steady_clock::now();
+				const std::size_t size = Codec::EncodePacket(commands, count, player.sentCommands.Find(player.lastReceivedSequence), buffer, sizeof(buffer));
+				encodeNs += GetNanoseconds(encodeStart);
+				encodedCommands += count;
+				totalBytes += size;
+
+				if (lossRoll(random) < lossPercent)
+				{
+					++droppedPackets;
+					continue;
+				}
+
+				Game::SPlayerInputCommand decoded[Codec::kMaxCommandsPerPacket];
+				const auto lookupBaseline = [&player](uint32_t baselineSequence) { return player.receivedCommands.Find(baselineSequence); };
+				const auto decodeStart = std::chrono::steady_clock::now();
+				const std::size_t decodedCount = Codec::DecodePacket(buffer, size, player.lastReceivedSequence, lookupBaseline, decoded, std::size(decoded));
+				decodeNs += GetNanoseconds(decodeStart);
+				decodedCommands += decodedCount;
+				if (decodedCount == 0)
+				{
+					++undecodablePackets;
+					continue;
+				}
+
+				for (std::size_t i = 0; i < decodedCount; ++i)
+				{
+					const Game::SPlayerInputCommand* pExpected = player.sentCommands.Find(decoded[i].sequence);
+					if (pExpected == nullptr || !IsSameCommand(*pExpected, decoded[i]))
+					{
+						++mismatches;
+					}
+
+					player.receivedCommands.Insert(decoded[i].sequence, decoded[i]);
+					player.lastReceivedSequence = std::max(player.lastReceivedSequence, decoded[i].sequence);
+				}
+			}
+		}
+
+		const double bytesPerTick = static_cast<double>(totalBytes) / static_cast<double>(tickCount);
+		printf("[CoreBenchmarks] InputCodec: %zu players at %u Hz, redundancy %u, %d%% loss\n", playerCount, tickRate, redundancy, lossPercent);
+		printf("[CoreBenchmarks] InputCodec: %.2f bytes/tick per player, %.1f kbit/s per player\n", bytesPerTick / playerCount, bytesPerTick / playerCount * tickRate * 8.0 / 1000.0);
+		printf("[CoreBenchmarks] InputCodec: encode %.1f ns/command, decode %.1f ns/command\n", encodeNs / static_cast<double>(encodedCommands), decodeNs / static_cast<double>(std::max<std::size_t>(decodedCommands, 1)));
+		printf("[CoreBenchmarks] InputCodec: %zu packets dropped, %zu undecodable, %zu round-trip mismatches\n", droppedPackets, undecodablePackets, mismatches);
+
+		return undecodablePackets == 0 && mismatches == 0;
+	}
+
+	struct SFuzzResult
+	{
+		std::size_t count = 0;
+		Game::SPlayerInputCommand commands[Game::InputCommandCodec::kMaxCommandsPerPacket];
+	};
+
+	// Decodes size bytes that are followed by filler, so that a read past the end changes the result
+	template<typename TBaselineLookup>
+	SFuzzResult DecodeFollowedBy(const std::vector<uint8_t>& packet, std::size_t size, uint8_t filler, uint32_t latestReceivedSequence, TBaselineLookup&& lookupBaseline, std::size_t capacity)
+	{
+		std::vector<uint8_t> buffer(packet.begin(), packet.begin() + size);
+		buffer.resize(size + 16, filler);
+
+		SFuzzResult result;
+		result.count = Game::InputCommandCodec::DecodePacket(buffer.data(), size, latestReceivedSequence, lookupBaseline, result.commands, capacity);
+		return result;
+	}
+
+	bool IsInRange(const Game::SPlayerInputCommand& command)
+	{
+		constexpr float tolerance = 1e-5f;
+		return std::fabs(command.moveX) <= 1.f + tolerance && std::fabs(command.moveY) <= 1.f + tolerance
+			&& std::fabs(command.yaw) <= Game::kPi + tolerance && std::fabs(command.pitch) <= Game::kPi * 0.5f + tolerance;
+	}
+
+	// Feeds corrupted packets to the decoder
+	// Every decode runs twice with different bytes after the packet and has to give the same result both times, a
+	// decoder that reads past the size it was given would see the difference. Truncated packets have to be rejected,
+	// random and bit flipped ones may decode by chance but then have to respect the capacity and the value ranges.
+	bool BenchmarkInputCodecFuzz(const SOptions& options)
+	{
+		namespace Codec = Game::InputCommandCodec;
+
+		std::mt19937 random(4321);
+
+		// A receiver that has commands 1 to 128, so that baselines in the history resolve
+		constexpr uint32_t latestReceivedSequence = 128;
+		Game::CSequenceBuffer<Game::SPlayerInputCommand, 128> receivedCommands;
+		Game::SPlayerInputCommand input;
+		for (uint32_t sequence = 1; sequence <= latestReceivedSequence; ++sequence)
+		{
+			GenerateInput(input, random);
+			input.sequence = sequence;
+			receivedCommands.Insert(sequence, Codec::RoundTripCommand(input));
+		}
+		const auto lookupBaseline = [&receivedCommands](uint32_t sequence) { return receivedCommands.Find(sequence); };
+
+		// Valid packets to corrupt: up to eight new commands against a baseline up to 64 commands back, or none
+		const auto encodeValidPacket = [&]()
+		{
+			std::uniform_int_distribution<uint32_t> countRoll(1, Codec::kMaxCommandsPerPacket);
+			std::uniform_int_distribution<uint32_t> baselineRoll(0, 64);
+
+			Game::SPlayerInputCommand commands[Codec::kMaxCommandsPerPacket];
+			const uint32_t count = countRoll(random);
+			Game::SPlayerInputCommand command = *receivedCommands.Find(latestReceivedSequence);
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				GenerateInput(command, random);
+				command.sequence = latestReceivedSequence + 1 + i;
+				commands[i] = Codec::RoundTripCommand(command);
+			}
+
+			const uint32_t baselineDistance = baselineRoll(random);
+			const Game::SPlayerInputCommand* pBaseline = baselineDistance > 0 ? receivedCommands.Find(latestReceivedSequence + 1 - baselineDistance) : nullptr;
+
+			std::vector<uint8_t> packet(Codec::kMaxPacketBytes);
+			packet.resize(Codec::EncodePacket(commands, count, pBaseline, packet.data(), packet.size()));
+			return packet;
+		};
+
+		std::size_t decodedCount = 0;
+		std::size_t outOfBoundsReads = 0;
+		std::size_t acceptedTruncations = 0;
+		std::size_t overCapacity = 0;
+		std::size_t outOfRange = 0;
+
+		const auto check = [&](const std::vector<uint8_t>& packet, std::size_t size, std::size_t capacity)
+		{
+			const SFuzzResult zeros = DecodeFollowedBy(packet, size, 0x00, latestReceivedSequence, lookupBaseline, capacity);
+			const SFuzzResult ones = DecodeFollowedBy(packet, size, 0xFF, latestReceivedSequence, lookupBaseline, capacity);
+
+			bool isSame = zeros.count == ones.count;
+			for (std::size_t i = 0; isSame && i < zeros.count && i < capacity; ++i)
+			{
+				isSame = IsSameCommand(zeros.commands[i], ones.commands[i]);
+			}
+			outOfBoundsReads += isSame ? 0 : 1;
+			overCapacity += zeros.count > capacity ? 1 : 0;
+			outOfRange += std::any_of(zeros.commands, zeros.commands + std::min(zeros.count, capacity), [](const Game::SPlayerInputCommand& command) { return !IsInRange(command); }) ? 1 : 0;
+			decodedCount += zeros.count > 0 ? 1 : 0;
+			return zeros.count;
+		};
+
+		const std::size_t caseCount = static_cast<std::size_t>(options.iterations) * 1000;
+		std::uniform_int_distribution<std::size_t> capacityRoll(1, Codec::kMaxCommandsPerPacket);
+
+		// Every prefix of a valid packet, down to nothing
+		std::size_t truncatedCount = 0;
+		for (std::size_t i = 0; truncatedCount < caseCount; ++i)
+		{
+			const std::vector<uint8_t> packet = encodeValidPacket();
+			for (std::size_t size = 0; size < packet.size() && truncatedCount < caseCount; ++size, ++truncatedCount)
+			{
+				acceptedTruncations += check(packet, size, Codec::kMaxCommandsPerPacket) > 0 ? 1 : 0;
+			}
+		}
+
+		// Random bytes of random length
+		std::uniform_int_distribution<std::size_t> sizeRoll(0, Codec::kMaxPacketBytes);
+		std::uniform_int_distribution<int> byteRoll(0, 255);
+		for (std::size_t i = 0; i < caseCount; ++i)
+		{
+			std::vector<uint8_t> packet(sizeRoll(random));
+			for (uint8_t& byte : packet)
+			{
+				byte = static_cast<uint8_t>(byteRoll(random));
+			}
+			check(packet, packet.size(), capacityRoll(random));
+		}
+
+		// Valid packets with one to four bits flipped
+		std::uniform_int_distribution<int> flipCountRoll(1, 4);
+		for (std::size_t i = 0; i < caseCount; ++i)
+		{
+			std::vector<uint8_t> packet = encodeValidPacket();
+			std::uniform_int_distribution<std::size_t> bitRoll(0, packet.size() * 8 - 1);
+			for (int flip = flipCountRoll(random); flip > 0; --flip)
+			{
+				const std::size_t bit = bitRoll(random);
+				packet[bit >> 3] ^= static_cast<uint8_t>(1u << (bit & 7));
+			}
+			check(packet, packet.size(), capacityRoll(random));
+		}
+
+		printf("[CoreBenchmarks] InputCodecFuzz: %zu truncated, %zu random and %zu bit flipped packets, %zu of them decoded\n", caseCount, caseCount, caseCount, decodedCount);
+		printf("[CoreBenchmarks] InputCodecFuzz: %zu reads past the end, %zu accepted truncations, %zu over capacity, %zu out of range\n", outOfBoundsReads, acceptedTruncations, overCapacity, outOfRange);
+
+		return outOfBoundsReads == 0 && acceptedTruncations == 0 && overCapacity == 0 && outOfRange == 0;
+	}
+
+	// Same sizes as CLagCompensation and the hitboxes of Objects/Characters/SampleCharacter
+	constexpr std::size_t kLagCompensationPlayers = 64;
+	using THitboxHistory = Game::CHitboxHistory<128>;
+	constexpr float kHitboxRadii[] = { 0.15f, 0.2f, 0.07f, 0.06f, 0.07f, 0.06f, 0.1f, 0.08f, 0.1f, 0.08f };
+	constexpr uint32_t kHitboxCount = static_cast<uint32_t>(std::size(kHitboxRadii));
+
+	// Laid out like a character standing at the given position, swaying a little per tick
+	void MakeHitboxPose(const Game::SVec3f& position, float time, Game::SHitboxCapsule* pOutCapsules)
+	{
+		const float sway = std::sin(time * 4.f) * 0.1f;
+		for (uint32_t i = 0; i < kHitboxCount; ++i)
+		{
+			const float height = 1.8f - static_cast<float>(i) * 0.15f;
+			pOutCapsules[i].start = position + Game::SVec3f(sway, 0.f, height);
+			pOutCapsules[i].end = position + Game::SVec3f(sway, 0.1f, height - 0.3f);
+			pOutCapsules[i].radius = kHitboxRadii[i];
+		}
+	}
+
+	// Records 64 players on a grid for one second at 60 Hz, then fires rows of shots through the grid at rewound times
+	bool BenchmarkLagCompensation(const SOptions& options)
+	{
+		constexpr uint32_t tickRate = 60;
+
+		std::unique_ptr<THitboxHistory[]> histories(new THitboxHistory[kLagCompensationPlayers]);
+		Game::SHitboxCapsule capsules[Game::kMaxHitboxesPerPose];
+
+		const auto getPlayerPosition = [](std::size_t player) { return Game::SVec3f(static_cast<float>(player % 8) * 2.f, static_cast<float>(player / 8) * 2.f, 0.f); };
+
+		double recordNs = 0.0;
+		for (int iteration = 0; iteration < options.iterations; ++iteration)
+		{
+			for (std::size_t player = 0; player < kLagCompensationPlayers; ++player)
+			{
+				histories[player].Clear();
+			}
+
+			for (uint32_t tick = 0; tick < tickRate; ++tick)
+			{
+				const float time = static_cast<float>(tick) / static_cast<float>(tickRate);
+				for (std::size_t player = 0; player < kLagCompensationPlayers; ++player)
+				{
+					MakeHitboxPose(getPlayerPosition(player), time, capsules);
+
+					const auto start = std::chrono::steady_clock::now();
+					histories[player].Record(time, capsules, kHitboxCount);
+					recordNs += GetNanoseconds(start);
+				}
+			}
+		}
+
+		// Rows at even y run through a line of eight players, rows at odd y pass between them
+		std::size_t sampleFailures = 0;
+		std::size_t hitCount = 0;
+		std::size_t expectedHitCount = 0;
+		Game::SHitboxPose pose;
+
+		const auto start = std::chrono::steady_clock::now();
+		for (int iteration = 0; iteration < options.iterations; ++iteration)
+		{
+			const float time = static_cast<float>(iteration % tickRate) / static_cast<float>(tickRate) + 0.5f / static_cast<float>(tickRate);
+			const int row = iteration % 16;
+			const Game::SVec3f origin(-10.f, static_cast<float>(row), 1.5f);
+			const Game::SVec3f direction(1.f, 0.f, 0.f);
+			expectedHitCount += row % 2 == 0 ? 8 : 0;
+
+			for (std::size_t player = 0; player < kLagCompensationPlayers; ++player)
+			{
+				uint32_t hitboxIndex = 0;
+				if (!histories[player].Sample(time, pose))
+				{
+					++sampleFailures;
+				}
+				else if (Game::IntersectRayPose(origin, direction, 100.f, pose, hitboxIndex) >= 0.f)
+				{
+					++hitCount;
+				}
+			}
+		}
+		const double shotNs = GetNanoseconds(start);
+
+		const double recordedPoses = static_cast<double>(options.iterations) * tickRate * kLagCompensationPlayers;
+		printf("[CoreBenchmarks] LagCompensation: %zu players x 1 s at %u Hz, %zu KB of history\n", kLagCompensationPlayers, tickRate, kLagCompensationPlayers * sizeof(THitboxHistory) / 1024);
+		printf("[CoreBenchmarks] LagCompensation: record %.1f ns/player/tick\n", recordNs / recordedPoses);
+		printf("[CoreBenchmarks] LagCompensation: rewind and ray test %.1f ns/player, %.2f us/shot against all players, %zu of %zu expected hits\n",
+			shotNs / (static_cast<double>(options.iterations) * kLagCompensationPlayers), shotNs / options.iterations / 1000.0, hitCount, expectedHitCount);
+
+		return sampleFailures == 0 && hitCount == expectedHitCount;
+	}
+
+	// Distance along the ray to the sphere of the object, 0 if the origin is inside and -1 on a miss
+	float IntersectRaySphere(const Game::SVec3f& origin, const Game::SVec3f& direction, const Game::SSpatialObject& object)
+	{
+		const Game::SVec3f offset = origin - object.position;
+		const float b = offset.Dot(direction);
+		const float c = offset.GetLengthSquared() - object.radius * object.radius;
+		if (c <= 0.f)
+		{
+			return 0.f;
+		}
+
+		const float discriminant = b * b - c;
+		return b > 0.f || discriminant < 0.f ? -1.f : -b - std::sqrt(discriminant);
+	}
+
+	// Objects spread over a 1 km square in the 8 m cells of CSpatialIndex, 10 queries per iteration
+	// Every grid query has to find the same objects as brute force over the same data. One ray in ten has no length
+	// limit, so that the grid falls back to scanning its occupied cells.
+	bool BenchmarkSpatialGrid(const SOptions& options)
+	{
+		constexpr float cellSize = 8.f;
+		constexpr float queryRadius = 10.f;
+		constexpr std::size_t nearestCount = 8;
+		constexpr float nearestMaxDistance = 100.f;
+		constexpr float rayLength = 200.f;
+		const std::size_t queryCount = static_cast<std::size_t>(options.iterations) * 10;
+
+		bool isPassed = true;
+		for (const std::size_t objectCount : { std::size_t(1000), std::size_t(10000), std::size_t(100000) })
+		{
+			std::mt19937 random(42);
+			std::uniform_real_distribution<float> horizontal(-500.f, 500.f);
+			std::uniform_real_distribution<float> vertical(0.f, 20.f);
+			std::uniform_real_distribution<float> unit(-1.f, 1.f);
+
+			Game::CSpatialGrid grid(cellSize);
+			std::vector<Game::SSpatialObject> objects(objectCount);
+			std::vector<Game::CSpatialGrid::THandle> handles(objectCount);
+
+			for (std::size_t i = 0; i < objectCount; ++i)
+			{
+				objects[i].position = Game::SVec3f(horizontal(random), horizontal(random), vertical(random));
+				objects[i].radius = 0.5f;
+				objects[i].userId = static_cast<uint32_t>(i);
+				objects[i].typeMask = 1;
+				handles[i] = grid.Insert(objects[i]);
+			}
+			grid.Commit();
+			grid.Commit();
+
+			std::vector<Game::SVec3f> queryPoints(queryCount);
+			std::vector<Game::SVec3f> rayDirections(queryCount);
+			std::vector<float> rayLengths(queryCount);
+			for (std::size_t i = 0; i < queryCount; ++i)
+			{
+				queryPoints[i] = Game::SVec3f(horizontal(random), horizontal(random), vertical(random));
+				const Game::SVec3f direction(unit(random), unit(random), unit(random) * 0.1f);
+				rayDirections[i] = direction * (1.f / std::max(std::sqrt(direction.GetLengthSquared()), 0.001f));
+				rayLengths[i] = i % 10 == 9 ? std::numeric_limits<float>::max() : rayLength;
+			}
+
+			std::vector<std::size_t> gridResults(queryCount);
+			std::vector<std::size_t> bruteResults(queryCount);
+			std::size_t mismatches = 0;
+			const auto compareResults = [&]()
+			{
+				mismatches += gridResults == bruteResults ? 0 : 1;
+			};
+
+			auto start = std::chrono::steady_clock::now();
+			for (std::size_t i = 0; i < queryCount; ++i)
+			{
+				gridResults[i] = 0;
+				grid.QueryRadius(queryPoints[i], queryRadius, ~0u, [&gridResults, i](const Game::SSpatialObject&) { ++gridResults[i]; });
+			}
+			const double gridRadiusNs = GetNanoseconds(start) / queryCount;
+
+			start = std::chrono::steady_clock::now();
+			for (std::size_t i = 0; i < queryCount; ++i)
+			{
+				bruteResults[i] = 0;
+				for (const Game::SSpatialObject& object : objects)
+				{
+					const float reach = queryRadius + object.radius;
+					bruteResults[i] += (object.position - queryPoints[i]).GetLengthSquared() <= reach * reach ? 1 : 0;
+				}
+			}
+			const double bruteRadiusNs = GetNanoseconds(start) / queryCount;
+			compareResults();
+
+			std::vector<Game::SSpatialObject> nearest;
+			start = std::chrono::steady_clock::now();
+			for (std::size_t i = 0; i < queryCount; ++i)
+			{
+				gridResults[i] = grid.QueryNearest(queryPoints[i], nearestCount, nearestMaxDistance, ~0u, nearest);
+			}
+			const double gridNearestNs = GetNanoseconds(start) / queryCount;
+
+			std::vector<float> distances(objectCount);
+			start = std::chrono::steady_clock::now();
+			for (std::size_t i = 0; i < queryCount; ++i)
+			{
+				for (std::size_t object = 0; object < objectCount; ++object)
+				{
+					distances[object] = (objects[object].position - queryPoints[i]).GetLengthSquared();
+				}
+				std::nth_element(distances.begin(), distances.begin() + nearestCount, distances.end());
+				bruteResults[i] = static_cast<std::size_t>(std::count_if(distances.begin(), distances.begin() + nearestCount, [](float distance) { return distance <= nearestMaxDistance * nearestMaxDistance; }));
+			}
+			const double bruteNearestNs = GetNanoseconds(start) / queryCount;
+			compareResults();
+
+			// Results are the hit user ids plus one, zero for a miss
+			Game::SSpatialRayHit hit;
+			start = std::chrono::steady_clock::now();
+			for (std::size_t i = 0; i < queryCount; ++i)
+			{
+				gridResults[i] = grid.Raycast(queryPoints[i], rayDirections[i], rayLengths[i], ~0u, hit) ? hit.object.userId + 1 : 0;
+			}
+			const double gridRayNs = GetNanoseconds(start) / queryCount;
+
+			start = std::chrono::steady_clock::now();
+			for (std::size_t i = 0; i < queryCount; ++i)
+			{
+				float closest = rayLengths[i];
+				bruteResults[i] = 0;
+				for (const Game::SSpatialObject& object : objects)
+				{
+					const float distance = IntersectRaySphere(queryPoints[i], rayDirections[i], object);
+					if (distance >= 0.f && distance <= closest)
+					{
+						closest = distance;
+						bruteResults[i] = object.userId + 1;
+					}
+				}
+			}
+			const double bruteRayNs = GetNanoseconds(start) / queryCount;
+			compareResults();
+
+			// One frame of movement for a tenth of the objects, including the commit
+			const std::size_t movedCount = std::max<std::size_t>(objectCount / 10, 1);
+			start = std::chrono::steady_clock::now();
+			for (std::size_t i = 0; i < movedCount; ++i)
+			{
+				const std::size_t index = (i * 7919) % objectCount;
+				objects[index].position += Game::SVec3f(unit(random), unit(random), 0.f) * 0.2f;
+				grid.Move(handles[index], objects[index].position);
+			}
+			grid.Commit();
+			const double updateNs = GetNanoseconds(start) / movedCount;
+
+			printf("[CoreBenchmarks] SpatialGrid: %6zu objects, %zu queries\n", objectCount, queryCount);
+			printf("[CoreBenchmarks] SpatialGrid:   radius %.0f m: grid %.0f ns, brute force %.0f ns\n", queryRadius, gridRadiusNs, bruteRadiusNs);
+			printf("[CoreBenchmarks] SpatialGrid:   %zu-nearest: grid %.0f ns, brute force %.0f ns\n", nearestCount, gridNearestNs, bruteNearestNs);
+			printf("[CoreBenchmarks] SpatialGrid:   ray %.0f m, every tenth unbounded: grid %.0f ns, brute force %.0f ns\n", rayLength, gridRayNs, bruteRayNs);
+			printf("[CoreBenchmarks] SpatialGrid:   move and commit: %.0f ns per moved object\n", updateNs);
+
+			if (mismatches > 0)
+			{
+				printf("[CoreBenchmarks] SpatialGrid: %zu of 3 query types found other objects than brute force\n", mismatches);
+				isPassed = false;
+			}
+		}
+
+		return isPassed;
+	}
+
+	// Stand-in for a player component: state scattered over a heap allocated object the size of a component,
+	// updated through a virtual call per player like an entity event
+	struct IBenchmarkPlayer
+	{
+		virtual ~IBenchmarkPlayer() = default;
+		virtual void Update() = 0;
+	};
+
+	struct SBenchmarkPlayer final : public IBenchmarkPlayer
+	{
+		virtual void Update() override
+		{
+			const Game::SVec3f velocity = Game::ComputeDesiredVelocity(moveX, moveY, bodyYaw, (flags & Game::ePlayerInputFlag_Walk) != 0, movementParams);
+			velocityX = velocity.x;
+			velocityY = velocity.y;
+			isJumping = Game::ShouldJump(isOnGround, flags);
+			Game::ApplyLookInput(lookYaw, lookPitch, mouseDeltaX, mouseDeltaY, lookParams);
+			bodyYaw = lookYaw;
+		}
+
+		Game::SPlayerMovementParams movementParams;
+		Game::SPlayerLookParams lookParams;
+		float moveX = 0.f;
+		float moveY = 0.f;
+		float bodyYaw = 0.f;
+		float mouseDeltaX = 0.f;
+		float mouseDeltaY = 0.f;
+		uint8_t flags = 0;
+		bool isOnGround = true;
+		// Prediction history, camera, input and the rest of the component in between
+		uint8_t otherState[512];
+		float lookYaw = 0.f;
+		float lookPitch = 0.f;
+		float velocityX = 0.f;
+		float velocityY = 0.f;
+		bool isJumping = false;
+	};
+
+	std::vector<std::unique_ptr<IBenchmarkPlayer>> CreateBenchmarkPlayers(std::size_t playerCount)
+	{
+		std::mt19937 random(42);
+		std::uniform_real_distribution<float> unit(-1.f, 1.f);
+
+		std::vector<std::unique_ptr<IBenchmarkPlayer>> players;
+		players.reserve(playerCount);
+		for (std::size_t i = 0; i < playerCount; ++i)
+		{
+			std::unique_ptr<SBenchmarkPlayer> pPlayer(new SBenchmarkPlayer());
+			pPlayer->movementParams.movementSpeed = 5.f;
+			pPlayer->movementParams.walkSpeed = 2.f;
+			pPlayer->lookParams.rotationSpeed = 0.002f;
+			pPlayer->moveX = unit(random);
+			pPlayer->moveY = unit(random);
+			pPlayer->mouseDeltaX = unit(random) * 20.f;
+			pPlayer->mouseDeltaY = unit(random) * 10.f;
+			pPlayer->flags = i % 4 == 0 ? Game::ePlayerInputFlag_Walk : 0;
+			players.push_back(std::move(pPlayer));
+		}
+		return players;
+	}
+
+	// Gameplay math and the data movement around it, 10 frames per iteration
+	// Only the serial batch is measured. CPlayerSystem splits the batch into jobs of the engine's job manager, and the
+	// results are written to the character controllers at the same cost in both paths, so neither is part of this.
+	bool BenchmarkPlayerBatch(const SOptions& options)
+	{
+		const int frameCount = options.iterations * 10;
+
+		bool isPassed = true;
+		for (const std::size_t playerCount : { std::size_t(16), std::size_t(64), std::size_t(256) })
+		{
+			const std::vector<std::unique_ptr<IBenchmarkPlayer>> entityPlayers = CreateBenchmarkPlayers(playerCount);
+
+			auto start = std::chrono::steady_clock::now();
+			for (int frame = 0; frame < frameCount; ++frame)
+			{
+				for (const std::unique_ptr<IBenchmarkPlayer>& pPlayer : entityPlayers)
+				{
+					pPlayer->Update();
+				}
+			}
+			const double perEntityNs = GetNanoseconds(start) / (static_cast<double>(frameCount) * playerCount);
+
+			const std::vector<std::unique_ptr<IBenchmarkPlayer>> batchedPlayers = CreateBenchmarkPlayers(playerCount);
+			Game::CPlayerBatch batch;
+
+			start = std::chrono::steady_clock::now();
+			for (int frame = 0; frame < frameCount; ++frame)
+			{
+				batch.Resize(playerCount);
+				for (std::size_t i = 0; i < playerCount; ++i)
+				{
+					const SBenchmarkPlayer& player = static_cast<const SBenchmarkPlayer&>(*batchedPlayers[i]);
+					batch.SetInput(i, player.moveX, player.moveY, player.bodyYaw, player.flags, player.isOnGround, player.movementParams);
+					batch.SetLookInput(i, player.lookYaw, player.lookPitch, player.mouseDeltaX, player.mouseDeltaY, player.lookParams);
+				}
+
+				batch.Update(0, playerCount);
+
+				for (std::size_t i = 0; i < playerCount; ++i)
+				{
+					SBenchmarkPlayer& player = static_cast<SBenchmarkPlayer&>(*batchedPlayers[i]);
+					const Game::SVec3f velocity = batch.GetVelocity(i);
+					player.velocityX = velocity.x;
+					player.velocityY = velocity.y;
+					player.isJumping = batch.IsJumping(i);
+					player.lookYaw = player.bodyYaw = batch.GetLookYaw(i);
+					player.lookPitch = batch.GetLookPitch(i);
+				}
+			}
+			const double batchedNs = GetNanoseconds(start) / (static_cast<double>(frameCount) * playerCount);
+
+			printf("[CoreBenchmarks] PlayerBatch: %3zu players, %d frames: per-entity %.1f ns, batched %.1f ns per player and frame\n", playerCount, frameCount, perEntityNs, batchedNs);
+
+			// Both paths ran the same frames on the same input
+			float maxDifference = 0.f;
+			for (std::size_t i = 0; i < playerCount; ++i)
+			{
+				const SBenchmarkPlayer& entityPlayer = static_cast<const SBenchmarkPlayer&>(*entityPlayers[i]);
+				const SBenchmarkPlayer& batchedPlayer = static_cast<const SBenchmarkPlayer&>(*batchedPlayers[i]);
+				for (const float difference : { entityPlayer.velocityX - batchedPlayer.velocityX, entityPlayer.velocityY - batchedPlayer.velocityY,
+				                                entityPlayer.lookYaw - batchedPlayer.lookYaw, entityPlayer.lookPitch - batchedPlayer.lookPitch })
+				{
+					maxDifference = std::fmax(maxDifference, std::fabs(difference));
+				}
+				if (entityPlayer.isJumping != batchedPlayer.isJumping)
+				{
+					maxDifference = std::fmax(maxDifference, 1.f);
+				}
+			}
+			if (maxDifference > 1e-4f)
+			{
+				printf("[CoreBenchmarks] PlayerBatch: the batched update differs from the per-entity one by up to %.6f\n", maxDifference);
+				isPassed = false;
+			}
+		}
+
+		return isPassed;
+	}
+
+	// Rotation math the way CPlayerComponent updated the camera before Core/PlayerLook.h: Quat, Matrix33 and Ang3 with
+	// the conversions of CCamera::CreateAnglesYPR and CCamera::CreateOrientationYPR, written out without the engine
+	struct SQuat
+	{
+		float w = 1.f;
+		float x = 0.f;
+		float y = 0.f;
+		float z = 0.f;
+	};
+
+	struct SMatrix33
+	{
+		float m00 = 1.f, m01 = 0.f, m02 = 0.f;
+		float m10 = 0.f, m11 = 1.f, m12 = 0.f;
+		float m20 = 0.f, m21 = 0.f, m22 = 1.f;
+	};
+
+	struct SMatrix34
+	{
+		SMatrix33 rotation;
+		Game::SVec3f translation;
+	};
+
+	// x is the yaw, y the pitch and z the roll
+	struct SAngles
+	{
+		float x = 0.f;
+		float y = 0.f;
+		float z = 0.f;
+	};
+
+	SMatrix33 MatrixFromQuat(const SQuat& q)
+	{
+		const float x2 = q.x * 2.f, y2 = q.y * 2.f, z2 = q.z * 2.f;
+		const float xx = 1.f - x2 * q.x, yy = y2 * q.y, zz = z2 * q.z;
+		const float xy = y2 * q.x, yz = z2 * q.y, xz = z2 * q.x;
+		const float xw = x2 * q.w, yw = y2 * q.w, zw = z2 * q.w;
+
+		SMatrix33 m;
+		m.m00 = 1.f - yy - zz; m.m01 = xy - zw;  m.m02 = xz + yw;
+		m.m10 = xy + zw;       m.m11 = xx - zz;  m.m12 = yz - xw;
+		m.m20 = xz - yw;       m.m21 = yz + xw;  m.m22 = xx - yy;
+		return m;
+	}
+
+	SQuat QuatFromMatrix(const SMatrix33& m)
+	{
+		SQuat q;
+		const float trace = m.m00 + m.m11 + m.m22;
+		if (trace > 0.f)
+		{
+			const float s = std::sqrt(trace + 1.f);
+			const float p = 0.5f / s;
+			q.w = s * 0.5f; q.x = (m.m21 - m.m12) * p; q.y = (m.m02 - m.m20) * p; q.z = (m.m10 - m.m01) * p;
+		}
+		else if (m.m00 >= m.m11 && m.m00 >= m.m22)
+		{
+			const float s = std::sqrt(m.m00 - m.m11 - m.m22 + 1.f);
+			const float p = 0.5f / s;
+			q.w = (m.m21 - m.m12) * p; q.x = s * 0.5f; q.y = (m.m10 + m.m01) * p; q.z = (m.m20 + m.m02) * p;
+		}
+		else if (m.m11 >= m.m00 && m.m11 >= m.m22)
+		{
+			const float s = std::sqrt(m.m11 - m.m22 - m.m00 + 1.f);
+			const float p = 0.5f / s;
+			q.w = (m.m02 - m.m20) * p; q.x = (m.m01 + m.m10) * p; q.y = s * 0.5f; q.z = (m.m21 + m.m12) * p;
+		}
+		else
+		{
+			const float s = std::sqrt(m.m22 - m.m00 - m.m11 + 1.f);
+			const float p = 0.5f / s;
+			q.w = (m.m10 - m.m01) * p; q.x = (m.m02 + m.m20) * p; q.y = (m.m12 + m.m21) * p; q.z = s * 0.5f;
+		}
+		return q;
+	}
+
+	SAngles CreateAnglesYPR(const SMatrix33& m)
+	{
+		SAngles angles;
+		const float length = std::sqrt(m.m01 * m.m01 + m.m11 * m.m11);
+		angles.y = std::atan2(m.m21, length);
+		if (length > 0.0001f)
+		{
+			angles.x = std::atan2(-m.m01 / length, m.m11 / length);
+			angles.z = std::atan2(-m.m20 / length, m.m22 / length);
+		}
+		return angles;
+	}
+
+	SMatrix33 CreateOrientationYPR(const SAngles& angles)
+	{
+		const float sz = std::sin(angles.x), cz = std::cos(angles.x);
+		const float sx = std::sin(angles.y), cx = std::cos(angles.y);
+		const float sy = std::sin(angles.z), cy = std::cos(angles.z);
+
+		SMatrix33 m;
+		m.m00 = cy * cz - sy * sz * sx; m.m01 = -sz * cx; m.m02 = sy * cz + cy * sz * sx;
+		m.m10 = cy * sz + sy * sx * cz; m.m11 = cz * cx;  m.m12 = sy * sz - cy * sx * cz;
+		m.m20 = -sy * cx;               m.m21 = sx;       m.m22 = cy * cx;
+		return m;
+	}
+
+	// Applies the look rotation to the entity and camera, like CPlayerComponent does with the batch results
+	void ApplyLookRotation(const Game::SLookRotation& rotation, const Game::SVec3f& cameraPosition, SQuat& outEntityRotation, SMatrix34& outCameraTransform)
+	{
+		outEntityRotation.w = rotation.yawW;
+		outEntityRotation.z = rotation.yawZ;
+
+		SQuat pitch;
+		pitch.w = rotation.pitchW;
+		pitch.x = rotation.pitchX;
+		outCameraTransform.rotation = MatrixFromQuat(pitch);
+		outCameraTransform.translation = cameraPosition;
+	}
+
+	// One frame of mouse input per iteration times 10, every variant has to end up looking in the same direction
+	bool BenchmarkLookRotation(const SOptions& options)
+	{
+		const int frameCount = options.iterations * 10;
+		constexpr std::size_t playerCount = 256;
+
+		std::mt19937 random(42);
+		std::uniform_real_distribution<float> unit(-1.f, 1.f);
+
+		Game::SPlayerLookParams lookParams;
+		lookParams.rotationSpeed = 0.002f;
+
+		std::vector<float> mouseDeltaX(playerCount);
+		std::vector<float> mouseDeltaY(playerCount);
+		for (std::size_t i = 0; i < playerCount; ++i)
+		{
+			mouseDeltaX[i] = unit(random) * 20.f;
+			mouseDeltaY[i] = unit(random) * 10.f;
+		}
+
+		std::vector<SQuat> entityRotations(playerCount);
+		std::vector<SMatrix34> cameraTransforms(playerCount);
+		const Game::SVec3f cameraPosition(0.f, 0.f, 1.7f);
+
+		std::vector<SQuat> lookOrientations(playerCount);
+		auto start = std::chrono::steady_clock::now();
+		for (int frame = 0; frame < frameCount; ++frame)
+		{
+			for (std::size_t i = 0; i < playerCount; ++i)
+			{
+				SAngles rotationAngle = CreateAnglesYPR(MatrixFromQuat(lookOrientations[i]));
+				rotationAngle.x += mouseDeltaX[i] * lookParams.rotationSpeed;
+				rotationAngle.y = Game::ClampValue(rotationAngle.y + mouseDeltaY[i] * lookParams.rotationSpeed, lookParams.minPitch, lookParams.maxPitch);
+				rotationAngle.z = 0.f;
+				lookOrientations[i] = QuatFromMatrix(CreateOrientationYPR(rotationAngle));
+
+				SAngles yawAngle = CreateAnglesYPR(MatrixFromQuat(lookOrientations[i]));
+				yawAngle.y = 0.f;
+				entityRotations[i] = QuatFromMatrix(CreateOrientationYPR(yawAngle));
+
+				SAngles pitchAngle = CreateAnglesYPR(MatrixFromQuat(lookOrientations[i]));
+				pitchAngle.x = 0.f;
+				cameraTransforms[i].translation = cameraPosition;
+				cameraTransforms[i].rotation = CreateOrientationYPR(pitchAngle);
+			}
+		}
+		const double conversionsNs = GetNanoseconds(start) / (static_cast<double>(frameCount) * playerCount);
+
+		std::vector<float> yaws(playerCount, 0.f);
+		std::vector<float> pitches(playerCount, 0.f);
+		start = std::chrono::steady_clock::now();
+		for (int frame = 0; frame < frameCount; ++frame)
+		{
+			for (std::size_t i = 0; i < playerCount; ++i)
+			{
+				Game::ApplyLookInput(yaws[i], pitches[i], mouseDeltaX[i], mouseDeltaY[i], lookParams);
+				ApplyLookRotation(Game::ComputeLookRotation(yaws[i], pitches[i]), cameraPosition, entityRotations[i], cameraTransforms[i]);
+			}
+		}
+		const double scalarNs = GetNanoseconds(start) / (static_cast<double>(frameCount) * playerCount);
+
+		Game::CPlayerBatch batch;
+		batch.Resize(playerCount);
+		for (std::size_t i = 0; i < playerCount; ++i)
+		{
+			batch.SetLookInput(i, 0.f, 0.f, mouseDeltaX[i], mouseDeltaY[i], lookParams);
+		}
+
+		start = std::chrono::steady_clock::now();
+		for (int frame = 0; frame < frameCount; ++frame)
+		{
+			batch.UpdateLook(0, playerCount);
+
+			for (std::size_t i = 0; i < playerCount; ++i)
+			{
+				ApplyLookRotation(batch.GetLookRotation(i), cameraPosition, entityRotations[i], cameraTransforms[i]);
+			}
+		}
+		const double batchedNs = GetNanoseconds(start) / (static_cast<double>(frameCount) * playerCount);
+
+		// The forward axis of the look orientation is the view direction
+		float scalarDifference = 0.f;
+		float batchedDifference = 0.f;
+		for (std::size_t i = 0; i < playerCount; ++i)
+		{
+			const SMatrix33 orientation = MatrixFromQuat(lookOrientations[i]);
+			const Game::SVec3f legacyForward(orientation.m01, orientation.m11, orientation.m21);
+			const Game::SVec3f scalarOffset = Game::GetLookDirection(yaws[i], pitches[i]) - legacyForward;
+			const Game::SVec3f batchedOffset = Game::GetLookDirection(batch.GetLookYaw(i), batch.GetLookPitch(i)) - legacyForward;
+			scalarDifference = std::fmax(scalarDifference, std::sqrt(scalarOffset.GetLengthSquared()));
+			batchedDifference = std::fmax(batchedDifference, std::sqrt(batchedOffset.GetLengthSquared()));
+		}
+
+		printf("[CoreBenchmarks] LookRotation: %zu players, %d frames, per player and frame:\n", playerCount, frameCount);
+		printf("[CoreBenchmarks] LookRotation:   quaternion/matrix/angle conversions %.1f ns, yaw/pitch %.1f ns, batched %.1f ns\n", conversionsNs, scalarNs, batchedNs);
+		printf("[CoreBenchmarks] LookRotation:   view direction difference to the conversions: yaw/pitch %.6f, batched %.6f\n", scalarDifference, batchedDifference);
+
+		return scalarDifference < 1e-3f && batchedDifference < 1e-3f;
+	}
+
+	struct SBenchmark
+	{
+		const char* szName;
+		bool (*pRun)(const SOptions& options);
+	};
+
+	constexpr SBenchmark kBenchmarks[] =
+	{
+		{ "projectiles", BenchmarkProjectiles },
+		{ "inputCodec", BenchmarkInputCodec },
+		{ "inputCodecFuzz", BenchmarkInputCodecFuzz },
+		{ "lagCompensation", BenchmarkLagCompensation },
+		{ "spatialGrid", BenchmarkSpatialGrid },
+		{ "playerBatch", BenchmarkPlayerBatch },
+		{ "lookRotation", BenchmarkLookRotation }
+	};
+}
+
+int main(int argc, char** argv)
+{
+	SOptions options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		printf("Usage: %s [--iterations N] [benchmark...]\nBenchmarks:", argv[0]);
+		for (const SBenchmark& benchmark : kBenchmarks)
+		{
+			printf(" %s", benchmark.szName);
+		}
+		printf("\n");
+		return 2;
+	}
+
+	for (const char* szName : options.benchmarks)
+	{
+		if (std::none_of(std::begin(kBenchmarks), std::end(kBenchmarks), [szName](const SBenchmark& benchmark) { return strcmp(benchmark.szName, szName) == 0; }))
+		{
+			printf("[CoreBenchmarks] Unknown benchmark '%s'\n", szName);
+			return 2;
+		}
+	}
+
+	bool isPassed = true;
+	for (const SBenchmark& benchmark : kBenchmarks)
+	{
+		const bool isSelected = options.benchmarks.empty()
+			|| std::any_of(options.benchmarks.begin(), options.benchmarks.end(), [&benchmark](const char* szName) { return strcmp(benchmark.szName, szName) == 0; });
+		if (isSelected && !benchmark.pRun(options))
+		{
+			isPassed = false;
+		}
+	}
+
+	return isPassed ? 0 : 1;
+}
@@ -0,0 +1,949 @@
+// Copyright 2017-2021 Crytek GmbH / Crytek Group. All rights reserved.
+
+// Runs the gameplay cores without the engine and reports their cost
+// Usage: HeadlessSimulation [--players N] [--seconds S] [--tickrate Hz] [--seed N] [--verify] [--relevancy] [--interpolation] [--scheduler] [--record file]
+// --verify runs the same match a second time and fails if the checksums differ or if a tick after the warmup
+// allocated from the heap.
+// --relevancy treats every player as a client and reports the replication bandwidth with and without relevancy.
+// --interpolation sends player snapshots at several rates over a jittery link and compares snapping to them with
+// interpolating between them.
+// --scheduler runs the match in the tick scheduler on uneven frames with hitches, next to a task that overruns its
+// budget, and fails if it doesn't end in the same state as ticking directly or if the deferred task lost time.
+// --record records the match into a file, replays it from the file as fast as possible and fails if the replay
+// doesn't end in the same state, if seeking doesn't return the same ticks or if recording took too long.
+
+#include "Core/GameRecording.h"
+#include "Core/GameSimulation.h"
+#include "Core/SnapshotInterpolation.h"
+#include "Core/TickScheduler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+#include <vector>
+
+namespace
+{
+	// Every heap allocation of the process goes through the replaced operators below
+	std::atomic<uint64_t> s_allocationCount { 0 };
+	std::atomic<uint64_t> s_allocatedBytes { 0 };
+
+	void* Allocate(std::size_t size)
+	{
+		s_allocationCount.fetch_add(1, std::memory_order_relaxed);
+		s_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+
+		if (void* pMemory = std::malloc(size > 0 ? size : 1))
+		{
+			return pMemory;
+		}
+		throw std::bad_alloc();
+	}
+
+	void* AllocateAligned(std::size_t size, std::size_t alignment)
+	{
+		s_allocationCount.fetch_add(1, std::memory_order_relaxed);
+		s_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+
+		// aligned_alloc requires the size to be a multiple of the alignment
+		const std::size_t alignedSize = (size + alignment - 1) / alignment * alignment;
+#if defined(_MSC_VER)
+		void* pMemory = _aligned_malloc(alignedSize > 0 ? alignedSize : alignment, alignment);
+#else
+		void* pMemory = std::aligned_alloc(alignment, alignedSize > 0 ? alignedSize : alignment);
+#endif
+		if (pMemory == nullptr)
+		{
+			throw std::bad_alloc();
+		}
+		return pMemory;
+	}
+
+	void FreeAligned(void* pMemory)
+	{
+#if defined(_MSC_VER)
+		_aligned_free(pMemory);
+#else
+		std::free(pMemory);
+#endif
+	}
+
+	struct SOptions
+	{
+		Game::SGameSimulationParams params;
+		float seconds = 60.f;
+		bool verify = false;
+		bool relevancy = false;
+		bool interpolation = false;
+		bool scheduler = false;
+		const char* szRecordPath = nullptr;
+	};
+
+	// Estimated size of one player movement update on the wire: sequence, compressed position and velocity,
+	// ground flag and the per-object header, see CPlayerComponent::NetSerialize
+	constexpr double kMovementUpdateBytes = 24.0;
+
+	bool ParseOptions(int argc, char** argv, SOptions& outOptions)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			const char* szArgument = argv[i];
+			const char* szValue = i + 1 < argc ? argv[i + 1] : nullptr;
+
+			if (strcmp(szArgument, "--verify") == 0)
+			{
+				outOptions.verify = true;
+				continue;
+			}
+
+			if (strcmp(szArgument, "--relevancy") == 0)
+			{
+				outOptions.relevancy = true;
+				continue;
+			}
+
+			if (strcmp(szArgument, "--interpolation") == 0)
+			{
+				outOptions.interpolation = true;
+				continue;
+			}
+
+			if (strcmp(szArgument, "--scheduler") == 0)
+			{
+				outOptions.scheduler = true;
+				continue;
+			}
+
+			if (szValue == nullptr)
+			{
+				return false;
+			}
+
+			if (strcmp(szArgument, "--players") == 0)
+			{
+				outOptions.params.playerCount = static_cast<uint32_t>(std::max(1, atoi(szValue)));
+			}
+			else if (strcmp(szArgument, "--seconds") == 0)
+			{
+				outOptions.seconds = std::max(0.1f, static_cast<float>(atof(szValue)));
+			}
+			else if (strcmp(szArgument, "--tickrate") == 0)
+			{
+				outOptions.params.tickRate = std::max(1.f, static_cast<float>(atof(szValue)));
+			}
+			else if (strcmp(szArgument, "--seed") == 0)
+			{
+				outOptions.params.seed = static_cast<uint32_t>(strtoul(szValue, nullptr, 10));
+			}
+			else if (strcmp(szArgument, "--record") == 0)
+			{
+				outOptions.szRecordPath = szValue;
+			}
+			else
+			{
+				return false;
+			}
+			++i;
+		}
+
+		return true;
+	}
+
+	struct SRunResult
+	{
+		uint64_t checksum;
+		uint64_t ticks;
+		double seconds;
+		uint64_t allocationCount;
+		uint64_t allocatedBytes;
+		uint64_t warmupAllocationCount;
+		Game::SLinearArenaStatistics arena;
+		Game::SGameSimulationStatistics statistics;
+		std::size_t projectileCount;
+	};
+
+	SRunResult Run(const SOptions& options)
+	{
+		const uint64_t allocationsBeforeWarmup = s_allocationCount.load(std::memory_order_relaxed);
+
+		Game::CGameSimulation simulation(options.params);
+
+		// The first simulated second fills the spatial grid's cells and the projectile store up to their steady state
+		const uint64_t warmupTicks = static_cast<uint64_t>(options.params.tickRate);
+		for (uint64_t tick = 0; tick < warmupTicks; ++tick)
+		{
+			simulation.Tick();
+		}
+
+		const uint64_t ticks = static_cast<uint64_t>(options.seconds * options.params.tickRate);
+
+		const uint64_t allocationsBefore = s_allocationCount.load(std::memory_order_relaxed);
+		const uint64_t bytesBefore = s_allocatedBytes.load(std::memory_order_relaxed);
+		const auto start = std::chrono::steady_clock::now();
+
+		for (uint64_t tick = 0; tick < ticks; ++tick)
+		{
+			simulation.Tick();
+		}
+
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+		SRunResult result;
+		result.checksum = simulation.GetChecksum();
+		result.ticks = ticks;
+		result.seconds = elapsed.count();
+		result.allocationCount = s_allocationCount.load(std::memory_order_relaxed) - allocationsBefore;
+		result.allocatedBytes = s_allocatedBytes.load(std::memory_order_relaxed) - bytesBefore;
+		result.warmupAllocationCount = allocationsBefore - allocationsBeforeWarmup;
+		result.arena = simulation.GetArenaStatistics();
+		result.statistics = simulation.GetStatistics();
+		result.projectileCount = simulation.GetProjectileCount();
+		return result;
+	}
+
+	struct SRelevancyResult
+	{
+		// Updates sent to all clients together
+		uint64_t broadcastUpdates = 0;
+		uint64_t perClientUpdates = 0;
+		uint64_t perObjectUpdates = 0;
+		uint64_t relevantPairs = 0;
+		uint64_t ticks = 0;
+		double seconds = 0.0;
+	};
+
+	// Every player is the viewer of one client, all players are replicated to all clients
+	SRelevancyResult RunRelevancy(const SOptions& options)
+	{
+		Game::CGameSimulation simulation(options.params);
+		Game::CRelevancyScheduler scheduler;
+		Game::CRelevancyScheduler objectScheduler;
+
+		const uint32_t playerCount = simulation.GetPlayerCount();
+		std::vector<Game::SRelevancyViewer> viewers(playerCount);
+
+		SRelevancyResult result;
+		result.ticks = static_cast<uint64_t>(options.seconds * options.params.tickRate);
+
+		for (uint64_t tick = 0; tick < result.ticks; ++tick)
+		{
+			simulation.Tick();
+
+			const float time = simulation.GetTime();
+			for (const Game::SGameSimulationHit& hit : simulation.GetTickHits())
+			{
+				for (Game::CRelevancyScheduler* pScheduler : { &scheduler, &objectScheduler })
+				{
+					pScheduler->NoteInteraction(hit.shooter, hit.victim, time);
+					pScheduler->NoteInteraction(hit.victim, hit.shooter, time);
+				}
+			}
+
+			for (uint32_t i = 0; i < playerCount; ++i)
+			{
+				viewers[i] = simulation.GetPlayerViewer(i);
+			}
+
+			const auto start = std::chrono::steady_clock::now();
+
+			scheduler.Update(viewers.data(), viewers.size(), simulation.GetGrid(), Game::CGameSimulation::kPlayerTypeMask, time,
+				[&](const Game::SRelevancyViewer&, const Game::SSpatialObject&, float) { ++result.perClientUpdates; });
+
+			// The engine replicates a dirty aspect to every client, as CNetRelevancy does in the game
+			objectScheduler.UpdateObjects(viewers.data(), viewers.size(), simulation.GetGrid(), Game::CGameSimulation::kPlayerTypeMask, time,
+				[&](const Game::SSpatialObject&, float) { result.perObjectUpdates += playerCount; });
+
+			const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+			result.seconds += elapsed.count();
+
+			for (uint32_t i = 0; i < playerCount; ++i)
+			{
+				result.relevantPairs += scheduler.GetRelevantCount(i);
+			}
+
+			result.broadcastUpdates += static_cast<uint64_t>(playerCount) * playerCount;
+		}
+
+		return result;
+	}
+
+	void ReportRelevancy(const SOptions& options)
+	{
+		const SRelevancyResult result = RunRelevancy(options);
+
+		const double clients = static_cast<double>(options.params.playerCount);
+		const double ticks = static_cast<double>(result.ticks > 0 ? result.ticks : 1);
+		const double simulatedSeconds = ticks / options.params.tickRate;
+		const auto bytesPerClientPerSecond = [&](uint64_t updates) { return static_cast<double>(updates) * kMovementUpdateBytes / clients / simulatedSeconds; };
+
+		printf("[HeadlessSimulation] Relevancy for %.0f clients, %.1f relevant players per client on average, %.3f ms/tick\n",
+			clients, static_cast<double>(result.relevantPairs) / ticks / clients, result.seconds * 1000.0 / ticks);
+		printf("[HeadlessSimulation] Every player every tick: %.0f bytes/client/s\n", bytesPerClientPerSecond(result.broadcastUpdates));
+		printf("[HeadlessSimulation] Relevancy per client:    %.0f bytes/client/s\n", bytesPerClientPerSecond(result.perClientUpdates));
+		printf("[HeadlessSimulation] Relevancy per object:    %.0f bytes/client/s (rate of the most interested client, sent to all)\n", bytesPerClientPerSecond(result.perObjectUpdates));
+	}
+
+	struct SInterpolationResult
+	{
+		// Per frame and player, in m/s^2 for the accelerations and in m for the error
+		// Frames in which a path jumps across a respawn are left out of its accelerations.
+		std::vector<float> trueAccelerations;
+		std::vector<float> snappedAccelerations;
+		std::vector<float> interpolatedAccelerations;
+		std::vector<float> interpolationErrors;
+		double delaySum = 0.0;
+		uint64_t extrapolatedCount = 0;
+		uint64_t snappedCount = 0;
+		uint64_t sampleCount = 0;
+		double seconds = 0.0;
+	};
+
+	float GetPercentile(std::vector<float>& values, float percentile)
+	{
+		if (values.empty())
+		{
+			return 0.f;
+		}
+		const std::size_t index = std::min(values.size() - 1, static_cast<std::size_t>(percentile * static_cast<float>(values.size())));
+		std::nth_element(values.begin(), values.begin() + index, values.end());
+		return values[index];
+	}
+
+	// Sends every player's state at sendRate with latency and jitter, and renders the remote players once per tick
+	SInterpolationResult RunInterpolation(const SOptions& options, float sendRate)
+	{
+		constexpr float kLatency = 0.05f;
+		constexpr float kMaxJitter = 0.03f;
+
+		struct SDelivery
+		{
+			float arrivalTime;
+			uint32_t player;
+			Game::SSnapshot snapshot;
+		};
+
+		struct SRemotePlayer
+		{
+			Game::CSnapshotInterpolator<32> snapshots;
+			Game::SVec3f snappedPosition;
+			Game::SVec3f shown[3];
+			Game::SVec3f snappedShown[3];
+			int shownCount = 0;
+			// Respawned since the last snapshot was sent
+			bool hasTeleported = false;
+		};
+
+		Game::CGameSimulation simulation(options.params);
+		const uint32_t playerCount = simulation.GetPlayerCount();
+		const float timeStep = 1.f / options.params.tickRate;
+		const uint64_t ticks = static_cast<uint64_t>(options.seconds * options.params.tickRate);
+		const uint64_t sendInterval = std::max<uint64_t>(1, static_cast<uint64_t>(options.params.tickRate / sendRate + 0.5f));
+
+		std::mt19937 random(options.params.seed);
+		std::uniform_real_distribution<float> jitter(0.f, kMaxJitter);
+
+		std::vector<Game::SVec3f> truePositions;
+		truePositions.reserve(static_cast<std::size_t>(ticks) * playerCount);
+		std::vector<float> tickTimes;
+		tickTimes.reserve(static_cast<std::size_t>(ticks));
+
+		std::vector<SRemotePlayer> remotePlayers(playerCount);
+		std::vector<SDelivery> deliveries;
+		std::vector<Game::SSnapshotSample> samples(playerCount);
+		Game::SPlayoutParams params;
+
+		// True position of a player at a time on the sender clock
+		const auto getTruePosition = [&](uint32_t player, float time)
+		{
+			const float tickPosition = std::max(0.f, (time - tickTimes.front()) / timeStep);
+			const std::size_t tick = std::min(static_cast<std::size_t>(tickPosition), tickTimes.size() - 1);
+			const std::size_t nextTick = std::min(tick + 1, tickTimes.size() - 1);
+			const float t = std::min(1.f, tickPosition - static_cast<float>(tick));
+			const Game::SVec3f& from = truePositions[tick * playerCount + player];
+			const Game::SVec3f& to = truePositions[nextTick * playerCount + player];
+			return from + (to - from) * t;
+		};
+
+		const auto getAcceleration = [timeStep](const Game::SVec3f (&positions)[3])
+		{
+			return (positions[2] - positions[1] * 2.f + positions[0]).GetLength() / (timeStep * timeStep);
+		};
+
+		// Faster than anyone runs or falls within a tick
+		const auto hasJump = [&params](const Game::SVec3f (&positions)[3])
+		{
+			const float maxStepSquared = params.snapDistance * params.snapDistance;
+			return (positions[1] - positions[0]).GetLengthSquared() > maxStepSquared || (positions[2] - positions[1]).GetLengthSquared() > maxStepSquared;
+		};
+
+		const auto addAcceleration = [&](std::vector<float>& accelerations, const Game::SVec3f (&positions)[3])
+		{
+			if (!hasJump(positions))
+			{
+				accelerations.push_back(getAcceleration(positions));
+			}
+		};
+
+		SInterpolationResult result;
+		for (uint64_t tick = 0; tick < ticks; ++tick)
+		{
+			simulation.Tick();
+			const float time = simulation.GetTime();
+
+			tickTimes.push_back(time);
+			for (const Game::SGameSimulationSpawn& spawn : simulation.GetTickSpawns())
+			{
+				remotePlayers[spawn.player].hasTeleported = true;
+			}
+
+			for (uint32_t i = 0; i < playerCount; ++i)
+			{
+				const Game::SPlayerMovementState& movement = simulation.GetPlayerMovement(i);
+				truePositions.push_back(movement.position);
+
+				// Staggered like players whose updates don't all fall on the same tick, a respawn is sent right away as
+				// CPlayerComponent::Teleport does
+				if ((tick + i) % sendInterval == 0 || remotePlayers[i].hasTeleported)
+				{
+					Game::SSnapshot snapshot;
+					snapshot.time = time;
+					snapshot.position = movement.position;
+					snapshot.velocity = movement.velocity;
+					snapshot.isTeleport = remotePlayers[i].hasTeleported;
+					remotePlayers[i].hasTeleported = false;
+					deliveries.push_back(SDelivery { time + kLatency + jitter(random), i, snapshot });
+				}
+			}
+
+			// Snapshots overtaken by a later one are dropped by the interpolator, and ignored when snapping
+			for (std::size_t d = 0; d < deliveries.size();)
+			{
+				const SDelivery& delivery = deliveries[d];
+				if (delivery.arrivalTime > time)
+				{
+					++d;
+					continue;
+				}
+
+				SRemotePlayer& remote = remotePlayers[delivery.player];
+				if (remote.snapshots.Push(delivery.snapshot, time))
+				{
+					remote.snappedPosition = delivery.snapshot.position;
+				}
+				deliveries[d] = deliveries.back();
+				deliveries.pop_back();
+			}
+
+			const auto start = std::chrono::steady_clock::now();
+			for (uint32_t i = 0; i < playerCount; ++i)
+			{
+				samples[i] = remotePlayers[i].snapshots.Update(time, timeStep, params);
+			}
+			const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+			result.seconds += elapsed.count();
+
+			for (uint32_t i = 0; i < playerCount; ++i)
+			{
+				SRemotePlayer& remote = remotePlayers[i];
+				const Game::SSnapshotSample& sample = samples[i];
+				if (sample.result == Game::ESnapshotSampleResult::Empty)
+				{
+					continue;
+				}
+
+				const float renderTime = remote.snapshots.GetRenderTime(time);
+				result.interpolationErrors.push_back((sample.position - getTruePosition(i, renderTime)).GetLength());
+				result.delaySum += remote.snapshots.GetDelay();
+				result.extrapolatedCount += sample.result == Game::ESnapshotSampleResult::Extrapolated || sample.result == Game::ESnapshotSampleResult::Held ? 1 : 0;
+				result.snappedCount += sample.result == Game::ESnapshotSampleResult::Snapped ? 1 : 0;
+				++result.sampleCount;
+
+				std::rotate(remote.shown, remote.shown + 1, remote.shown + 3);
+				std::rotate(remote.snappedShown, remote.snappedShown + 1, remote.snappedShown + 3);
+				remote.shown[2] = sample.position;
+				remote.snappedShown[2] = remote.snappedPosition;
+
+				if (++remote.shownCount >= 3)
+				{
+					const Game::SVec3f trueShown[3] = { getTruePosition(i, renderTime - 2.f * timeStep), getTruePosition(i, renderTime - timeStep), getTruePosition(i, renderTime) };
+					addAcceleration(result.trueAccelerations, trueShown);
+					addAcceleration(result.snappedAccelerations, remote.snappedShown);
+					addAcceleration(result.interpolatedAccelerations, remote.shown);
+				}
+			}
+		}
+
+		return result;
+	}
+
+	// Fails if interpolation doesn't beat snapping at a send rate below the tick rate
+	bool ReportInterpolation(const SOptions& options)
+	{
+		// Playback is centimeters off the true path, a respawn played back as movement tens of meters
+		constexpr float kMaxError = 1.f;
+
+		bool isPassed = true;
+		printf("[HeadlessSimulation] Remote players rendered every tick, snapshots with 50 ms latency and up to 30 ms jitter\n");
+		printf("[HeadlessSimulation] Acceleration as shown, median/95th percentile in m/s^2 without jumps across respawns, interpolation error against the true path\n");
+
+		for (const float sendRate : { 60.f, 30.f, 20.f, 10.f })
+		{
+			if (sendRate > options.params.tickRate)
+			{
+				continue;
+			}
+
+			SInterpolationResult result = RunInterpolation(options, sendRate);
+			const double samples = static_cast<double>(result.sampleCount > 0 ? result.sampleCount : 1);
+
+			const float snappedPeak = GetPercentile(result.snappedAccelerations, 0.95f);
+			const float interpolatedPeak = GetPercentile(result.interpolatedAccelerations, 0.95f);
+			const float errorPeak = GetPercentile(result.interpolationErrors, 0.95f);
+
+			printf("[HeadlessSimulation] %2.0f Hz: true %5.1f/%6.1f, snapped %7.1f/%7.1f, interpolated %5.1f/%6.1f, error %.3f/%.3f m, delay %.0f ms, %.1f%% extrapolated, %.1f%% snapped, %.0f ns/player\n",
+				sendRate, GetPercentile(result.trueAccelerations, 0.5f), GetPercentile(result.trueAccelerations, 0.95f),
+				GetPercentile(result.snappedAccelerations, 0.5f), snappedPeak,
+				GetPercentile(result.interpolatedAccelerations, 0.5f), interpolatedPeak,
+				GetPercentile(result.interpolationErrors, 0.5f), errorPeak,
+				result.delaySum * 1000.0 / samples, 100.0 * static_cast<double>(result.extrapolatedCount) / samples, 100.0 * static_cast<double>(result.snappedCount) / samples, result.seconds * 1e9 / samples);
+
+			if (sendRate < options.params.tickRate && interpolatedPeak >= snappedPeak)
+			{
+				printf("[HeadlessSimulation] %.0f Hz: interpolated players accelerate as hard as snapped ones\n", sendRate);
+				isPassed = false;
+			}
+			if (errorPeak > kMaxError)
+			{
+				printf("[HeadlessSimulation] %.0f Hz: interpolated players are %.2f m off their path, more than %.2f m\n", sendRate, errorPeak, kMaxError);
+				isPassed = false;
+			}
+		}
+
+		return isPassed;
+	}
+
+	// Recording may take this share of the time the simulation itself needs per tick
+	constexpr double kRecordingBudget = 0.2;
+
+	// Rotation of a player's body and view, yaw around +Z followed by pitch around +X
+	void GetLookRotation(float yaw, float pitch, float (&outRotation)[4])
+	{
+		const float sinYaw = std::sin(yaw * 0.5f);
+		const float cosYaw = std::cos(yaw * 0.5f);
+		const float sinPitch = std::sin(pitch * 0.5f);
+		const float cosPitch = std::cos(pitch * 0.5f);
+		outRotation[0] = cosYaw * sinPitch;
+		outRotation[1] = sinYaw * sinPitch;
+		outRotation[2] = sinYaw * cosPitch;
+		outRotation[3] = cosYaw * cosPitch;
+	}
+
+	uint64_t HashRecordedTick(const Game::SRecordedTick& tick)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		const auto mix = [&hash](const void* pData, std::size_t size)
+		{
+			const uint8_t* pBytes = static_cast<const uint8_t*>(pData);
+			for (std::size_t i = 0; i < size; ++i)
+			{
+				hash = (hash ^ pBytes[i]) * 1099511628211ull;
+			}
+		};
+
+		// Field by field, the structures have padding
+		for (const Game::SRecordedInput& input : tick.inputs)
+		{
+			mix(&input.entityId, sizeof(input.entityId));
+			mix(&input.command.yaw, sizeof(input.command.yaw));
+			mix(&input.command.pitch, sizeof(input.command.pitch));
+			mix(&input.command.moveX, sizeof(input.command.moveX));
+			mix(&input.command.moveY, sizeof(input.command.moveY));
+			mix(&input.command.flags, sizeof(input.command.flags));
+		}
+		for (const std::vector<Game::SRecordedTransform>* pTransforms : { &tick.transforms, &tick.shots })
+		{
+			for (const Game::SRecordedTransform& transform : *pTransforms)
+			{
+				mix(&transform.entityId, sizeof(transform.entityId));
+				mix(&transform.position, sizeof(transform.position));
+				mix(transform.rotation, sizeof(transform.rotation));
+			}
+		}
+		for (const Game::SRecordedSpawn& spawn : tick.spawns)
+		{
+			mix(&spawn, sizeof(spawn));
+		}
+		return hash;
+	}
+
+	// State of a task run by the scheduler test
+	struct SScheduledTaskContext
+	{
+		Game::CGameSimulation* pSimulation = nullptr;
+		uint64_t runs = 0;
+		// Sum of the delta times the task was run with
+		double simulatedTime = 0.0;
+		uint64_t spinNs = 0;
+	};
+
+	void TickSimulationTask(void* pContext, float deltaTime)
+	{
+		SScheduledTaskContext& context = *static_cast<SScheduledTaskContext*>(pContext);
+		context.pSimulation->Tick();
+		context.simulatedTime += deltaTime;
+		++context.runs;
+	}
+
+	// Stands in for work like relevancy scoring that may be late, every tenth run takes twice its budget
+	void OverrunningTask(void* pContext, float deltaTime)
+	{
+		SScheduledTaskContext& context = *static_cast<SScheduledTaskContext*>(pContext);
+		context.simulatedTime += deltaTime;
+		if (context.runs++ % 10 == 0)
+		{
+			const uint64_t startNs = Game::CTickScheduler::GetTimeNs();
+			while (Game::CTickScheduler::GetTimeNs() - startNs < context.spinNs)
+			{
+			}
+		}
+	}
+
+	bool RunScheduled(const SOptions& options)
+	{
+		constexpr uint32_t kMaxTicksPerFrame = 4;
+		constexpr uint32_t kMaxDeferredTicks = 3;
+		constexpr uint64_t kOverrunningBudgetNs = 100000;
+		// Early enough that every run has a backlog the scheduler can't catch up with, whatever its length
+		constexpr uint64_t kUnrecoverableHitchFrame = 10;
+
+		Game::CGameSimulation simulation(options.params);
+		SScheduledTaskContext simulationContext;
+		simulationContext.pSimulation = &simulation;
+		SScheduledTaskContext overrunningContext;
+		overrunningContext.spinNs = kOverrunningBudgetNs * 2;
+
+		Game::CTickScheduler scheduler;
+		scheduler.SetRate(options.params.tickRate);
+		scheduler.SetMaxTicksPerFrame(kMaxTicksPerFrame);
+		const std::size_t simulationTask = scheduler.AddTask("Simulation", &TickSimulationTask, &simulationContext, 2000000, 0);
+		const std::size_t overrunningTask = scheduler.AddTask("Overrunning", &OverrunningTask, &overrunningContext, kOverrunningBudgetNs, kMaxDeferredTicks);
+
+		// Frames at 144 Hz with 30% jitter, a short hitch every 300 frames and one the scheduler can't catch up with
+		// early on and every 1000 frames
+		std::mt19937 random(options.params.seed);
+		std::uniform_real_distribution<float> jitter(0.7f, 1.3f);
+		const uint64_t targetTicks = static_cast<uint64_t>(options.seconds * options.params.tickRate);
+		double frameTimeSum = 0.0;
+
+		const auto start = std::chrono::steady_clock::now();
+		for (uint64_t frame = 1; scheduler.GetStatistics().ticks < targetTicks; ++frame)
+		{
+			float frameTime = jitter(random) / 144.f;
+			frameTime = frame % 300 == 0 ? 0.05f : frameTime;
+			frameTime = frame == kUnrecoverableHitchFrame || frame % 1000 == 0 ? 0.5f : frameTime;
+			frameTimeSum += frameTime;
+			scheduler.Update(frameTime);
+		}
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+		const Game::STickStatistics& statistics = scheduler.GetStatistics();
+		const double tickLength = 1.0 / options.params.tickRate;
+		printf("[HeadlessSimulation] Scheduler: %llu frames over %.1f s, %llu ticks, %llu dropped, at most %u ticks per frame, %llu ticks over budget, %.3f s\n",
+			static_cast<unsigned long long>(statistics.frames), frameTimeSum, static_cast<unsigned long long>(statistics.ticks),
+			static_cast<unsigned long long>(statistics.droppedTicks), statistics.maxTicksPerFrame, static_cast<unsigned long long>(statistics.overBudgetTicks), elapsed.count());
+		for (std::size_t i = 0; i < scheduler.GetTaskCount(); ++i)
+		{
+			const Game::STickTaskStatistics& task = scheduler.GetTaskStatistics(i);
+			printf("[HeadlessSimulation]   %-12s %8llu runs, %6llu overruns, %6llu deferrals, mean %.1f us, max %.1f us\n", scheduler.GetTaskName(i),
+				static_cast<unsigned long long>(task.runs), static_cast<unsigned long long>(task.overruns), static_cast<unsigned long long>(task.deferrals),
+				task.runs > 0 ? static_cast<double>(task.totalNs) / 1000.0 / static_cast<double>(task.runs) : 0.0, static_cast<double>(task.maxNs) / 1000.0);
+		}
+
+		// The same number of ticks without the scheduler
+		Game::CGameSimulation reference(options.params);
+		for (uint64_t tick = 0; tick < statistics.ticks; ++tick)
+		{
+			reference.Tick();
+		}
+
+		bool isPassing = true;
+		if (simulation.GetChecksum() != reference.GetChecksum())
+		{
+			printf("[HeadlessSimulation] The scheduled match ended with checksum %016llx instead of %016llx\n",
+				static_cast<unsigned long long>(simulation.GetChecksum()), static_cast<unsigned long long>(reference.GetChecksum()));
+			isPassing = false;
+		}
+		if (scheduler.GetTaskStatistics(simulationTask).deferrals != 0)
+		{
+			printf("[HeadlessSimulation] The simulation task was deferred %llu times, it may never be\n",
+				static_cast<unsigned long long>(scheduler.GetTaskStatistics(simulationTask).deferrals));
+			isPassing = false;
+		}
+		if (statistics.maxTicksPerFrame > kMaxTicksPerFrame)
+		{
+			printf("[HeadlessSimulation] A frame ran %u ticks, more than the catch-up limit of %u\n", statistics.maxTicksPerFrame, kMaxTicksPerFrame);
+			isPassing = false;
+		}
+		if (statistics.frames >= kUnrecoverableHitchFrame && statistics.droppedTicks == 0)
+		{
+			printf("[HeadlessSimulation] No ticks were dropped after the hitch on frame %llu\n", static_cast<unsigned long long>(kUnrecoverableHitchFrame));
+			isPassing = false;
+		}
+		// A deferred task runs with the length of the ticks it skipped, only the ticks since its last run are missing
+		const double missingTime = static_cast<double>(statistics.ticks) * tickLength - overrunningContext.simulatedTime;
+		if (scheduler.GetTaskStatistics(overrunningTask).deferrals == 0 || missingTime < -1e-3 || missingTime > kMaxDeferredTicks * tickLength + 1e-3)
+		{
+			printf("[HeadlessSimulation] The overrunning task wasn't deferred or lost %.4f s of simulated time\n", missingTime);
+			isPassing = false;
+		}
+		if (isPassing)
+		{
+			printf("[HeadlessSimulation] Scheduled match matched ticking directly\n");
+		}
+		return isPassing;
+	}
+
+	// Records a match, then replays it from the memory mapped file into a second simulation
+	bool RecordAndReplay(const SOptions& options)
+	{
+		const uint64_t ticks = static_cast<uint64_t>(options.seconds * options.params.tickRate);
+		const float timeStep = 1.f / options.params.tickRate;
+
+		Game::CGameSimulation recordedSimulation(options.params);
+		Game::CGameRecordingWriter writer;
+		if (!writer.Open(options.szRecordPath))
+		{
+			printf("[HeadlessSimulation] Could not open %s for writing\n", options.szRecordPath);
+			return false;
+		}
+
+		double simulationSeconds = 0.0;
+		double recordingSeconds = 0.0;
+		double slowestRecordingSeconds = 0.0;
+
+		for (uint64_t tick = 0; tick < ticks; ++tick)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			recordedSimulation.Tick();
+			const auto recordingStart = std::chrono::steady_clock::now();
+
+			const std::vector<Game::SPlayerInputCommand>& inputs = recordedSimulation.GetTickInputs();
+			for (uint32_t i = 0, n = static_cast<uint32_t>(inputs.size()); i < n; ++i)
+			{
+				writer.WriteInput(i, inputs[i]);
+			}
+
+			for (const Game::SGameSimulationShot& shot : recordedSimulation.GetTickShots())
+			{
+				Game::SRecordedShot recordedShot;
+				recordedShot.entityId = shot.shooter;
+				recordedShot.position = shot.muzzle;
+				GetLookRotation(shot.yaw, shot.pitch, recordedShot.rotation);
+				writer.WriteShot(recordedShot);
+			}
+
+			for (const Game::SGameSimulationSpawn& spawn : recordedSimulation.GetTickSpawns())
+			{
+				writer.WriteSpawn(Game::SRecordedSpawn { spawn.player, spawn.spawnPoint });
+			}
+
+			for (uint32_t i = 0, n = recordedSimulation.GetPlayerCount(); i < n; ++i)
+			{
+				Game::SRecordedTransform transform;
+				transform.entityId = i;
+				transform.position = recordedSimulation.GetPlayerMovement(i).position;
+				GetLookRotation(recordedSimulation.GetPlayerYaw(i), 0.f, transform.rotation);
+				writer.WriteTransform(transform);
+			}
+
+			writer.EndTick(timeStep);
+
+			const auto end = std::chrono::steady_clock::now();
+			const std::chrono::duration<double> simulationElapsed = recordingStart - start;
+			const std::chrono::duration<double> recordingElapsed = end - recordingStart;
+			simulationSeconds += simulationElapsed.count();
+			recordingSeconds += recordingElapsed.count();
+			slowestRecordingSeconds = std::max(slowestRecordingSeconds, recordingElapsed.count());
+		}
+
+		writer.Close();
+
+		const double tickCount = static_cast<double>(ticks > 0 ? ticks : 1);
+		const double playerTicks = tickCount * static_cast<double>(options.params.playerCount);
+		printf("[HeadlessSimulation] Recorded %llu ticks in %u chunks, %llu bytes: %.1f bytes/tick, %.2f bytes per player and tick\n",
+			static_cast<unsigned long long>(writer.GetTickCount()), writer.GetChunkCount(), static_cast<unsigned long long>(writer.GetByteCount()),
+			static_cast<double>(writer.GetByteCount()) / tickCount, static_cast<double>(writer.GetByteCount()) / playerTicks);
+		printf("[HeadlessSimulation] Recording: %.1f us/tick, %.1f us slowest tick (incl. chunk write), %.1f%% of the simulation's %.1f us/tick\n",
+			recordingSeconds * 1e6 / tickCount, slowestRecordingSeconds * 1e6, simulationSeconds > 0.0 ? 100.0 * recordingSeconds / simulationSeconds : 0.0, simulationSeconds * 1e6 / tickCount);
+
+		Game::CGameRecordingReader reader;
+		if (!reader.Open(options.szRecordPath) || reader.GetTickCount() != ticks)
+		{
+			printf("[HeadlessSimulation] Could not read %llu ticks back from %s\n", static_cast<unsigned long long>(ticks), options.szRecordPath);
+			return false;
+		}
+
+		Game::CGameSimulation replayedSimulation(options.params);
+		std::vector<Game::SPlayerInputCommand> inputs(options.params.playerCount);
+		std::vector<uint64_t> tickHashes;
+		tickHashes.reserve(static_cast<std::size_t>(ticks));
+		Game::SRecordedTick recordedTick;
+
+		// Transforms are quantized, a replay that diverged is off by far more than the resolution
+		const float tolerance = 2.f / Game::GameRecording::kPositionScale;
+		uint64_t mismatchedTicks = 0;
+
+		const auto replayStart = std::chrono::steady_clock::now();
+		while (reader.ReadTick(recordedTick))
+		{
+			for (const Game::SRecordedInput& input : recordedTick.inputs)
+			{
+				if (input.entityId < inputs.size())
+				{
+					inputs[input.entityId] = input.command;
+				}
+			}
+
+			replayedSimulation.Tick(inputs.data());
+
+			bool isMatching = recordedTick.frameTime == timeStep;
+			for (const Game::SRecordedTransform& transform : recordedTick.transforms)
+			{
+				const Game::SVec3f& position = replayedSimulation.GetPlayerMovement(transform.entityId).position;
+				isMatching &= (position - transform.position).GetLength() <= tolerance;
+			}
+			mismatchedTicks += isMatching ? 0 : 1;
+			tickHashes.push_back(HashRecordedTick(recordedTick));
+		}
+		const std::chrono::duration<double> replayElapsed = std::chrono::steady_clock::now() - replayStart;
+
+		const double replayTicksPerSecond = replayElapsed.count() > 0.0 ? static_cast<double>(tickHashes.size()) / replayElapsed.count() : 0.0;
+		printf("[HeadlessSimulation] Replayed %zu ticks in %.3f s: %.1fx real time\n", tickHashes.size(), replayElapsed.count(), replayTicksPerSecond / options.params.tickRate);
+
+		// Random access into the middle of chunks
+		std::mt19937 random(options.params.seed);
+		std::uniform_int_distribution<uint64_t> tickDistribution(0, ticks - 1);
+		constexpr int kSeekCount = 200;
+		int mismatchedSeeks = 0;
+
+		const auto seekStart = std::chrono::steady_clock::now();
+		for (int i = 0; i < kSeekCount; ++i)
+		{
+			const uint64_t tick = tickDistribution(random);
+			const bool isFound = reader.Seek(tick) && reader.ReadTick(recordedTick);
+			mismatchedSeeks += isFound && recordedTick.tick == tick && HashRecordedTick(recordedTick) == tickHashes[tick] ? 0 : 1;
+		}
+		const std::chrono::duration<double> seekElapsed = std::chrono::steady_clock::now() - seekStart;
+		printf("[HeadlessSimulation] %d random seeks: %.1f us/seek\n", kSeekCount, seekElapsed.count() * 1e6 / kSeekCount);
+
+		bool isPassing = true;
+		if (replayedSimulation.GetChecksum() != recordedSimulation.GetChecksum() || mismatchedTicks > 0)
+		{
+			printf("[HeadlessSimulation] Replay diverged in %llu ticks, checksum %016llx instead of %016llx\n", static_cast<unsigned long long>(mismatchedTicks),
+				static_cast<unsigned long long>(replayedSimulation.GetChecksum()), static_cast<unsigned long long>(recordedSimulation.GetChecksum()));
+			isPassing = false;
+		}
+		if (mismatchedSeeks > 0)
+		{
+			printf("[HeadlessSimulation] %d of %d seeks returned a different tick than reading in order\n", mismatchedSeeks, kSeekCount);
+			isPassing = false;
+		}
+		if (recordingSeconds > simulationSeconds * kRecordingBudget)
+		{
+			printf("[HeadlessSimulation] Recording exceeded its budget of %.0f%% of the simulation time\n", kRecordingBudget * 100.0);
+			isPassing = false;
+		}
+		if (isPassing)
+		{
+			printf("[HeadlessSimulation] Replay matched the recording\n");
+		}
+		return isPassing;
+	}
+}
+
+void* operator new(std::size_t size) { return Allocate(size); }
+void* operator new[](std::size_t size) { return Allocate(size); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return AllocateAligned(size, static_cast<std::size_t>(alignment)); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return AllocateAligned(size, static_cast<std::size_t>(alignment)); }
+void operator delete(void* pMemory) noexcept { std::free(pMemory); }
+void operator delete[](void* pMemory) noexcept { std::free(pMemory); }
+void operator delete(void* pMemory, std::size_t) noexcept { std::free(pMemory); }
+void operator delete[](void* pMemory, std::size_t) noexcept { std::free(pMemory); }
+void operator delete(void* pMemory, std::align_val_t) noexcept { FreeAligned(pMemory); }
+void operator delete[](void* pMemory, std::align_val_t) noexcept { FreeAligned(pMemory); }
+void operator delete(void* pMemory, std::size_t, std::align_val_t) noexcept { FreeAligned(pMemory); }
+void operator delete[](void* pMemory, std::size_t, std::align_val_t) noexcept { FreeAligned(pMemory); }
+
+int main(int argc, char** argv)
+{
+	SOptions options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		printf("Usage: %s [--players N] [--seconds S] [--tickrate Hz] [--seed N] [--verify] [--relevancy] [--interpolation] [--scheduler] [--record file]\n", argv[0]);
+		return 2;
+	}
+
+	printf("[HeadlessSimulation] %u players, %.1f s at %.0f Hz, seed %u\n", options.params.playerCount, options.seconds, options.params.tickRate, options.params.seed);
+
+	const SRunResult result = Run(options);
+
+	const double ticksPerSecond = result.seconds > 0.0 ? static_cast<double>(result.ticks) / result.seconds : 0.0;
+	const double ticks = static_cast<double>(result.ticks > 0 ? result.ticks : 1);
+
+	printf("[HeadlessSimulation] %llu ticks in %.3f s: %.0f ticks/s, %.3f ms/tick, %.1fx real time\n",
+		static_cast<unsigned long long>(result.ticks), result.seconds, ticksPerSecond, result.seconds * 1000.0 / ticks, ticksPerSecond / options.params.tickRate);
+	printf("[HeadlessSimulation] Allocations: %.2f per tick, %.0f bytes per tick (%llu during setup and warmup)\n",
+		static_cast<double>(result.allocationCount) / ticks, static_cast<double>(result.allocatedBytes) / ticks, static_cast<unsigned long long>(result.warmupAllocationCount));
+	printf("[HeadlessSimulation] Arena: %zu KB peak of %zu KB, %llu allocations, %llu overflowed to the heap\n",
+		result.arena.peakBytes / 1024, result.arena.capacity / 1024, static_cast<unsigned long long>(result.arena.allocationCount), static_cast<unsigned long long>(result.arena.overflowCount));
+	printf("[HeadlessSimulation] %llu shots, %llu hits, %llu respawns, %zu projectiles in flight\n",
+		static_cast<unsigned long long>(result.statistics.shotsFired), static_cast<unsigned long long>(result.statistics.hits),
+		static_cast<unsigned long long>(result.statistics.respawns), result.projectileCount);
+	printf("[HeadlessSimulation] Checksum %016llx\n", static_cast<unsigned long long>(result.checksum));
+
+	if (options.verify)
+	{
+		const SRunResult repeatedResult = Run(options);
+		if (repeatedResult.checksum != result.checksum)
+		{
+			printf("[HeadlessSimulation] Not deterministic, the second run ended with checksum %016llx\n", static_cast<unsigned long long>(repeatedResult.checksum));
+			return 1;
+		}
+		printf("[HeadlessSimulation] Second run matched\n");
+
+		// Everything a tick needs is sized up front or taken from the arena
+		if (result.allocationCount != 0)
+		{
+			printf("[HeadlessSimulation] %llu heap allocations after the warmup, expected none\n", static_cast<unsigned long long>(result.allocationCount));
+			return 1;
+		}
+		printf("[HeadlessSimulation] No heap allocations after the warmup\n");
+	}
+
+	if (options.relevancy)
+	{
+		ReportRelevancy(options);
+	}
+
+	if (options.interpolation && !ReportInterpolation(options))
+	{
+		return 1;
+	}
+
+	if (options.scheduler && !RunScheduled(options))
+	{
+		return 1;
+	}
+
+	if (options.szRecordPath != nullptr && !RecordAndReplay(options))
+	{
+		return 1;
+	}
+
+	return 0;
+}